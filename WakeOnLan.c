@@ -5,33 +5,94 @@
 //! to a network card of a computer to wake up the PC.
 //!
 //! @note Compile it for Linux with:
-//! gcc -Wall -Wextra -O3 -o wol wol.c wake_on_lan.c && strip wol
+//! gcc -Wall -Wextra -O3 -o wol WakeOnLan.c wake_on_lan.c wake_on_lan_inventory.c wake_on_lan_raw.c wake_on_lan_confirm.c wake_on_lan_retry.c wake_on_lan_relay.c wake_on_lan_coalesce.c wake_on_lan_stagger.c wake_on_lan_metrics.c wake_on_lan_listen.c wake_on_lan_interfaces.c wake_on_lan_neighbors.c wake_on_lan_engine.c wake_on_lan_pipeline.c wake_on_lan_history.c -pthread && strip wol
 //!
 //! @note Compile it and reduce size for Windows with:
-//! gcc -Wall -Wextra -O3 -o wol.exe wol.c wake_on_lan.c -lws2_32
+//! gcc -Wall -Wextra -O3 -o wol.exe WakeOnLan.c wake_on_lan.c wake_on_lan_inventory.c wake_on_lan_raw.c wake_on_lan_confirm.c wake_on_lan_retry.c wake_on_lan_relay.c wake_on_lan_coalesce.c wake_on_lan_stagger.c wake_on_lan_metrics.c wake_on_lan_listen.c wake_on_lan_interfaces.c wake_on_lan_neighbors.c wake_on_lan_engine.c wake_on_lan_pipeline.c wake_on_lan_history.c -lws2_32 -liphlpapi
 //! strip wol.exe
+//!
+//! @note Add `-DWAKE_ON_LAN_METRICS` to fill the counters shown by `--stats`
 
 /*---------------------------------------------------------------------*
  *  private: include files
  *---------------------------------------------------------------------*/
 
 #include "wake_on_lan.h"
+#include "wake_on_lan_confirm.h"
+#include "wake_on_lan_history.h"
+#include "wake_on_lan_interfaces.h"
+#include "wake_on_lan_inventory.h"
+#include "wake_on_lan_listen.h"
+#include "wake_on_lan_metrics.h"
+#include "wake_on_lan_neighbors.h"
+#include "wake_on_lan_pipeline.h"
+#include "wake_on_lan_raw.h"
+#include "wake_on_lan_relay.h"
+#include "wake_on_lan_retry.h"
+#include "wake_on_lan_stagger.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /*---------------------------------------------------------------------*
  *  private: definitions
  *---------------------------------------------------------------------*/
+
+//! @brief IP used for inventory lines without IP if `-i` is not given, the limited broadcast
+#define DEFAULT_INVENTORY_IP UINT32_C(0xFFFFFFFF)
+
+//! @brief Maximum number of parse errors of an inventory that are printed line by line
+#define MAX_PRINTED_PARSE_ERRORS 64
+
+//! @brief Maximum number of expected hosts that `--listen` prints as missing
+#define MAX_PRINTED_MISSING 64
+
+//! @brief With `-r`, the burst is the number of packets of this fraction of a second
+#define PACING_BURSTS_PER_SECOND 100
+
+//! @brief With `-r`, the largest burst
+#define PACING_BURST_MAX 64
+
+//! @brief With `-n`, the jitter of the resends in percent
+#define RETRY_JITTER_PERCENT 10
+
+//! @brief Prefix of the `-c` argument of an ARP probe, followed by the device
+#define PROBE_ARP_PREFIX "arp:"
+
 /*---------------------------------------------------------------------*
  *  private: typedefs
  *---------------------------------------------------------------------*/
+
+//! @brief How the hosts of `-f` are sent
+typedef struct send_options_s
+{
+    uint32_t rate;                      //!< Packets per second, 0 sends without pacing, only used for UDP
+    uint32_t retries;                   //!< Resends of each target by a ::wol_retry_t scheduler, 0 sends once, only used for UDP
+    uint32_t stagger_ms;                //!< Time over which the first packets are spread, 0 sends at once, only used for UDP
+    uint32_t group_cap;                 //!< Wakes of one group per second with `stagger_ms`, 0 for no cap
+    const char * device;                //!< Network device for raw Ethernet frames, NULL to send UDP
+    wol_metrics_t * metrics;            //!< Instrumentation block of the sender for `--stats`, NULL for none, only used for UDP
+    bool resolve;                       //!< Replaces the IPs of hosts in a local subnet by the directed broadcast, see ::wol_interfaces_resolve()
+    wol_sender_options_t tuning;        //!< Send buffer, DSCP and TTL of the sender, only used for UDP
+    bool pipeline;                      //!< Text inventories are parsed and sent at the same time, see ::wol_pipeline_run()
+    size_t parsers;                     //!< Parser threads of the pipeline, 0 for one per processor
+    const char * probe;                 //!< Probe of `-c`, the hosts are woken with ::wol_wake_and_confirm(), NULL to send only
+    const char * history;               //!< Wake history of `--history`, orders and skips the hosts, NULL for none
+    size_t quiet_count;                 //!< Targets at the end of the array that get no resends of `retries` or of the probes, e.g. without answer to their last wakes
+} send_options_t;
 /*---------------------------------------------------------------------*
  *  private: variables
  *---------------------------------------------------------------------*/
+
+//! @brief Set by SIGINT and SIGTERM to end `--daemon` and `--listen`
+static volatile bool daemon_stop = false;
+
 /*---------------------------------------------------------------------*
  *  public:  variables
  *---------------------------------------------------------------------*/
@@ -41,6 +102,164 @@
 
 int main(int argc, char * const argv[]);
 
+//! @brief Wakes every host of an inventory file with one batch over a single sender
+//! @details Compiled inventories are used in place, text inventories are parsed first.
+//! @param path Path of the inventory file, `-` for stdin
+//! @param default_ip_v4 IP for lines without IP, as number, not in network order
+//! @param default_port Port for lines without port
+//! @param options Pointer to the options of the sender
+//! @param silent Mute output
+//! @return 0 if every host was sent, 1 otherwise
+static int wake_inventory(const char * path, uint32_t default_ip_v4, uint16_t default_port, const send_options_t * options, bool silent);
+
+//! @brief Wakes every host of a text inventory while it is still being parsed
+//! @details The hosts are printed in the order they were sent, the lines that could not be parsed are only counted.
+//! @param path Path of the inventory file, `-` for stdin
+//! @param map Pointer to the mapping of the inventory
+//! @param default_ip_v4 IP for lines without IP, as number, not in network order
+//! @param default_port Port for lines without port
+//! @param options Pointer to the options of the senders
+//! @param silent Mute output
+//! @return 0 if every host was sent, 1 otherwise
+static int wake_pipeline(const char * path, const wol_file_map_t * map, uint32_t default_ip_v4, uint16_t default_port, const send_options_t * options, bool silent);
+
+//! @brief Prints the result of a host sent by the pipeline, see ::wol_pipeline_callback_t
+//! @param context Not used
+//! @param target Pointer to the target
+//! @param result Pointer to the result
+static void print_pipeline_result(void * context, const wol_target_t * target, const wol_result_t * result);
+
+//! @brief Sends the targets over a new UDP sender or, with a device, as raw Ethernet frames
+//! @param targets Array of `count` targets
+//! @param groups Array of `count` groups for the cap of the stagger, NULL if the targets have no groups
+//! @param count Number of targets
+//! @param[out] results Array of `count` results
+//! @param options Pointer to the options of the sender
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get the error of the setup
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, the error of the setup or of a failed target otherwise
+static wake_on_lan_errors_t send_targets(const wol_target_t * targets, const uint32_t * groups, size_t count, wol_result_t * results, const send_options_t * options, wake_on_lan_t * wol);
+
+//! @brief Replaces the IPs of targets in a local subnet by the directed broadcast of the subnet, for `--resolve`
+//! @param[in,out] targets Array of `count` targets
+//! @param count Number of targets
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or the error of the enumeration of the interfaces
+static wake_on_lan_errors_t resolve_targets(wol_target_t * targets, size_t count);
+
+//! @brief Wakes targets with one sender and waits until they answer the probe of send_options_s::probe
+//! @param targets Array of `count` targets
+//! @param probe_ip_v4 Array of `count` IPs to probe, a 0 entry is woken once without probe
+//! @param count Number of targets
+//! @param[out] results Array of `count` results
+//! @param options Pointer to the options of the sender
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t, wake_on_lan_s::return_value is set if the setup failed
+//! @return Return value of ::wol_wake_and_confirm() or the error of the setup
+static wake_on_lan_errors_t confirm_targets(const wol_target_t * targets, const uint32_t * probe_ip_v4, size_t count, wol_confirm_result_t * results, const send_options_t * options, wake_on_lan_t * wol);
+
+//! @brief Converts the argument of `-c` into confirm options
+//! @param probe Kind of probe, `icmp`, `arp:<device>` or a TCP port
+//! @param[out] options Pointer to the options, the probe fields are set
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_PORT
+static wake_on_lan_errors_t parse_probe(const char * probe, wol_confirm_options_t * options);
+
+//! @brief Keeps the result of the last packet of a target, a ::wol_send_callback_t of the retry scheduler
+//! @param context Array of results
+//! @param index Index of the target
+//! @param result Result of the packet
+static void store_result(void * context, size_t index, const wol_result_t * result);
+
+//! @brief Wakes one host with a SecureOn password or a resolved IP, like ::wake_on_lan()
+//! @param ip IP of the magic packet
+//! @param port Port of the magic packet
+//! @param mac MAC of the host
+//! @param password SecureOn password, see ::wol_target_set_password(), NULL for none
+//! @param resolve Replaces an IP of a local subnet by the directed broadcast, see ::resolve_targets()
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or the error of the failing step
+static wake_on_lan_errors_t wake_target(const char * ip, uint16_t port, const char * mac, const char * password, bool resolve);
+
+//! @brief Wakes one host and waits until it answers a probe, see ::wol_wake_and_confirm()
+//! @param ip IP of the magic packet
+//! @param port Port of the magic packet
+//! @param mac MAC of the host
+//! @param password SecureOn password, NULL for none
+//! @param probe Kind of probe, `icmp`, `arp:<device>` or a TCP port
+//! @param probe_ip IPv4 of the host, NULL probes `ip`
+//! @param history Path of the wake history that records the wake, NULL for none
+//! @param metrics Instrumentation block of the sender for `--stats`, NULL for none
+//! @param resolve Sends to the directed broadcast of the subnet of `ip`, the probes still go to `ip`
+//! @param silent Mute output
+//! @return 0 if the host answered, 1 otherwise
+static int wake_and_confirm(const char * ip, uint16_t port, const char * mac, const char * password, const char * probe, const char * probe_ip, const char * history, wol_metrics_t * metrics, bool resolve, bool silent);
+
+//! @brief Runs a relay daemon until SIGINT or SIGTERM, see ::wol_relay_run()
+//! @param control_port UDP and TCP port of the requests
+//! @param allow Network of the allowed clients as `ip/prefix`, NULL allows all clients
+//! @param default_ip_v4 IP of records without IP, as number, not in network order
+//! @param default_port Port of records without port
+//! @param rate Packets per second, 0 sends without pacing
+//! @param coalesce_ms Window in which repeated requests for a MAC are merged, 0 sends every request
+//! @param silent Mute output
+//! @return 0 after a signal, 1 if the relay could not be started
+static int run_daemon(uint16_t control_port, const char * allow, uint32_t default_ip_v4, uint16_t default_port, uint32_t rate, uint32_t coalesce_ms, const wol_sender_options_t * tuning, bool silent);
+
+//! @brief Signal handler of `--daemon` and `--listen`
+//! @param signal_number Number of the signal
+static void daemon_signal(int signal_number);
+
+//! @brief Receives and checks magic packets until the sender is idle or SIGINT or SIGTERM, see ::wol_listen_run()
+//! @param listen_port UDP port of the magic packets, 0 for none
+//! @param device Network device of raw Ethernet frames, NULL for none
+//! @param path Path of the inventory of the expected hosts, NULL to count every MAC
+//! @param default_ip_v4 IP for lines without IP, as number, not in network order
+//! @param default_port Port for lines without port
+//! @param silent Mute output
+//! @return 0 if every expected host was received, 1 otherwise
+static int run_listener(uint16_t listen_port, const char * device, const char * path, uint32_t default_ip_v4, uint16_t default_port, bool silent);
+
+//! @brief Converts a text inventory into a compiled inventory, see ::wol_inventory_write()
+//! @param input Path of the text inventory, `-` for stdin
+//! @param output Path of the compiled inventory
+//! @param default_ip_v4 IP for lines without IP, as number, not in network order
+//! @param default_port Port for lines without port
+//! @param silent Mute output
+//! @return 0 if every line was compiled, 1 otherwise
+static int compile_inventory(const char * input, const char * output, uint32_t default_ip_v4, uint16_t default_port, bool silent);
+
+//! @brief Merges the hosts of the neighbor table into a compiled inventory, see ::wol_inventory_merge()
+//! @details The IP of a host in a local subnet becomes the directed broadcast of the subnet. A known host that is
+//!          still in the subnet of its record keeps the record as it is, e.g. a host IP written by hand.
+//! @param path Path of the compiled inventory, created if missing
+//! @param default_port Port of new records
+//! @param silent Mute output
+//! @return 0 if the inventory was merged, 1 otherwise
+static int harvest_inventory(const char * path, uint16_t default_port, bool silent);
+
+//! @brief Parses a mapped text inventory into a new array and prints the parse errors
+//! @param path Path of the inventory, only used for messages
+//! @param map Pointer to the mapped inventory
+//! @param default_ip_v4 IP for lines without IP, as number, not in network order
+//! @param default_port Port for lines without port
+//! @param silent Mute output
+//! @param[out] targets Allocated array of the parsed targets, must be freed by the caller
+//! @param[out] groups Allocated array of the group of each target, must be freed by the caller, can be NULL if not necessary
+//! @param[out] count Number of parsed targets
+//! @param[out] errors Number of lines that could not be parsed
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_MEMORY
+static wake_on_lan_errors_t parse_inventory(const char * path, const wol_file_map_t * map, uint32_t default_ip_v4, uint16_t default_port, bool silent, wol_target_t ** targets, uint32_t ** groups, size_t * count, size_t * errors);
+
+//! @brief Prints the MAC, IP, port and result of one target
+//! @param target Pointer to the target
+//! @param result Pointer to the result of the target
+static void print_result(const wol_target_t * target, const wol_result_t * result);
+
+//! @brief Prints the counters and percentiles of an instrumentation block for `--stats`
+//! @param metrics Pointer to the block
+static void print_metrics(const wol_metrics_t * metrics);
+
+//! @brief Prints one histogram of ::print_metrics()
+//! @param name Name of the histogram
+//! @param histogram Pointer to the histogram
+static void print_histogram(const char * name, const wol_histogram_t * histogram);
+
 
 /*---------------------------------------------------------------------*
  *  private: functions
@@ -52,16 +271,178 @@ int main(int argc, char * const argv[])
 #       error The function strtoumax() can not handle the size of the datatype
 #   endif
 
-    char ip[30] = { 0 };
+    char ip[64] = { 0 };
     uint16_t port = 60000;
+    send_options_t send_options = { 0 };
     char mac[30] = { 0 };
     
+    const char * file = NULL;
+    const char * probe = NULL;
+    const char * probe_ip = NULL;
+    const char * password = NULL;
+    const char * compile_input = NULL;
+    const char * compile_output = NULL;
+    const char * harvest_output = NULL;
+    const char * allow = NULL;
+    uint16_t daemon_port = 0;
+    uint16_t listen_port = 0;
+    bool listen_mode = false;
+    uint32_t coalesce_ms = 0;
+
     bool parameter_i = false;
     bool parameter_m = false;
     bool help = false;
     bool silent = false;
+    bool stats = false;
 
     for (int i = 0; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--compile"))
+        {
+            if(i + 2 < argc)
+            {
+                compile_input = argv[i + 1];
+                compile_output = argv[i + 2];
+            }
+            i += 2;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--harvest"))
+        {
+            if(i + 1 < argc)
+            {
+                harvest_output = argv[i + 1];
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--daemon"))
+        {
+            if(i + 1 < argc)
+            {
+                daemon_port = strtoumax(argv[i + 1], NULL, 10);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--listen"))
+        {
+            listen_mode = true;
+            if(i + 1 < argc)
+            {
+                listen_port = strtoumax(argv[i + 1], NULL, 10);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--coalesce"))
+        {
+            if(i + 1 < argc)
+            {
+                coalesce_ms = strtoumax(argv[i + 1], NULL, 10);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--sndbuf"))
+        {
+            if(i + 1 < argc)
+            {
+                uintmax_t bytes = strtoumax(argv[i + 1], NULL, 10);
+                send_options.tuning.send_buffer = (INT32_MAX < bytes) ? INT32_MAX : (int)bytes;
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--dscp"))
+        {
+            if(i + 1 < argc)
+            {
+                send_options.tuning.dscp = (uint8_t)(strtoumax(argv[i + 1], NULL, 10) & 0x3F);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--ttl"))
+        {
+            if(i + 1 < argc)
+            {
+                uintmax_t hops = strtoumax(argv[i + 1], NULL, 10);
+                send_options.tuning.ttl = (UINT8_MAX < hops) ? UINT8_MAX : (uint8_t)hops;
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--stagger"))
+        {
+            if(i + 1 < argc)
+            {
+                send_options.stagger_ms = strtoumax(argv[i + 1], NULL, 10);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--cap"))
+        {
+            if(i + 1 < argc)
+            {
+                send_options.group_cap = strtoumax(argv[i + 1], NULL, 10);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--pipeline"))
+        {
+            send_options.pipeline = true;
+            if(i + 1 < argc)
+            {
+                send_options.parsers = strtoumax(argv[i + 1], NULL, 10);
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--history"))
+        {
+            if(i + 1 < argc)
+            {
+                send_options.history = argv[i + 1];
+            }
+            i++;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--resolve"))
+        {
+            send_options.resolve = true;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--stats"))
+        {
+            stats = true;
+            continue;
+        }
+
+        if(0 == strcmp(argv[i], "--allow"))
+        {
+            if(i + 1 < argc)
+            {
+                allow = argv[i + 1];
+            }
+            i++;
+            continue;
+        }
+
         if('-' == argv[i][0])
         {
             switch(argv[i][1])
@@ -83,6 +464,62 @@ int main(int argc, char * const argv[])
                     strncpy(mac, argv[i], sizeof(mac)-1);
                     continue;
 
+                case 'r':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        send_options.rate = strtoumax(argv[i], NULL, 10);
+                    }
+                    continue;
+
+                case 'n':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        send_options.retries = strtoumax(argv[i], NULL, 10);
+                    }
+                    continue;
+
+                case 'f':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        file = argv[i];
+                    }
+                    continue;
+
+                case 'e':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        send_options.device = argv[i];
+                    }
+                    continue;
+
+                case 'c':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        probe = argv[i];
+                    }
+                    continue;
+
+                case 'a':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        probe_ip = argv[i];
+                    }
+                    continue;
+
+                case 'w':
+                    if(i + 1 < argc)
+                    {
+                        i++;
+                        password = argv[i];
+                    }
+                    continue;
+
                 case 'h':
                     help = true;
                     break;
@@ -98,16 +535,117 @@ int main(int argc, char * const argv[])
    }
 
    int return_value = 1;
+   // Raw frames of -e are not confirmed, wol_wake_and_confirm() resends over UDP
+   send_options.probe = send_options.device ? NULL : probe;
+
+   if(stats)
+   {
+       send_options.metrics = calloc(1, sizeof(*send_options.metrics));
+   }
+
+   if(send_options.history && NULL == send_options.probe)
+   {
+       // Only the answers of -c order and skip hosts, a history of attempts alone changes nothing
+       help = true;
+   }
+   else if(listen_mode && (listen_port || send_options.device))
+   {
+       uint32_t default_ip_v4 = DEFAULT_INVENTORY_IP;
+       if(parameter_i && !wol_parse_ip_v4(ip, strlen(ip), &default_ip_v4))
+       {
+           if(!silent)
+           {
+               printf("Error: %s\n", wake_on_lan_errors[WAKE_ON_LAN_ERRORS_IP]);
+               fflush(stdout);
+           }
+       }
+       else
+       {
+           return_value = run_listener(listen_port, send_options.device, file, default_ip_v4, port, silent);
+       }
+   }
+   else if(harvest_output)
+   {
+       return_value = harvest_inventory(harvest_output, port, silent);
+   }
+   else if(daemon_port)
+   {
+       uint32_t default_ip_v4 = DEFAULT_INVENTORY_IP;
+       if(parameter_i && !wol_parse_ip_v4(ip, strlen(ip), &default_ip_v4))
+       {
+           if(!silent)
+           {
+               printf("Error: %s\n", wake_on_lan_errors[WAKE_ON_LAN_ERRORS_IP]);
+               fflush(stdout);
+           }
+       }
+       else
+       {
+           return_value = run_daemon(daemon_port, allow, default_ip_v4, port, send_options.rate, coalesce_ms, &send_options.tuning, silent);
+       }
+   }
+   else if(file || compile_input)
+   {
+       uint32_t default_ip_v4 = DEFAULT_INVENTORY_IP;
+       if(parameter_i && !wol_parse_ip_v4(ip, strlen(ip), &default_ip_v4))
+       {
+           if(!silent)
+           {
+               printf("Error: %s\n", wake_on_lan_errors[WAKE_ON_LAN_ERRORS_IP]);
+               fflush(stdout);
+           }
+       }
+       else if(compile_input)
+       {
+           return_value = compile_inventory(compile_input, compile_output, default_ip_v4, port, silent);
+       }
+       else
+       {
+           return_value = wake_inventory(file, default_ip_v4, port, &send_options, silent);
+       }
+   }
+   else if(send_options.device && parameter_m)
+   {
+       wol_target_t target;
+       wol_result_t result;
+       wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_MAC;
 
-   if(parameter_i && parameter_m)
+       wol_target_init(&target, 0, port, 0);
+       if(wol_parse_mac(mac, strlen(mac), target.mac))
+       {
+           error = wol_target_set_password(&target, password);
+       }
+       if(WAKE_ON_LAN_ERRORS_NONE == error)
+       {
+           error = send_targets(&target, NULL, 1, &result, &send_options, NULL);
+       }
+
+       if(WAKE_ON_LAN_ERRORS_NONE == error)
+       {
+           return_value = 0;
+       }
+       else if(!silent)
+       {
+           printf("Error: %s\n", wake_on_lan_errors[error]);
+           fflush(stdout);
+       }
+   }
+   else if(parameter_i && parameter_m && probe)
+   {
+       return_value = wake_and_confirm(ip, port, mac, password, probe, probe_ip, send_options.history, send_options.metrics, send_options.resolve, silent);
+   }
+   else if(parameter_i && parameter_m)
    {
-       int return_value = wake_on_lan(NULL, ip, port, mac);
-       if( 0 != return_value)
+       wake_on_lan_errors_t error = (password || send_options.resolve) ? wake_target(ip, port, mac, password, send_options.resolve) : wake_on_lan(NULL, ip, port, mac);
+       if(WAKE_ON_LAN_ERRORS_NONE == error)
+       {
+           return_value = 0;
+       }
+       else
        {
-           if(1 <= return_value && 9 >= return_value )
            if(!silent)
            {
-               printf("Error: %s\n", wake_on_lan_errors[return_value]);
+               printf("Error: %s\n", wake_on_lan_errors[error]);
                fflush(stdout);
            }
        }
@@ -117,17 +655,64 @@ int main(int argc, char * const argv[])
        help = true;
    }
 
+   if(send_options.metrics && !help && !silent)
+   {
+       print_metrics(send_options.metrics);
+       fflush(stdout);
+   }
+   free(send_options.metrics);
+
    if(help)
    {
        if(!silent)
        {
            printf(
                "Sends a magic packet/Wake-On-LAN (WOL) packet to a network card of a computer to wake up the PC\n"
-               "wol.exe <-i <\"192.168.178.255\">> <-m <\"FF:FF:FF:FF:FF:FF\">> [-m {60000}] [-h] [-s]\n"
+               "wol.exe <-i <\"192.168.178.255\">> <-m <\"FF:FF:FF:FF:FF:FF\">> [-m {60000}] [-w <password>] [-c <icmp|arp:eth0|22> [-a <\"192.168.178.20\">] [--history <wake.log>] [--stats]] [--resolve] [-h] [-s]\n"
+               "wol.exe <-e <eth0>> <-m <\"FF:FF:FF:FF:FF:FF\">> [-w <password>] [-h] [-s]\n"
+               "wol.exe <-f <hosts.txt|hosts.wolbin|->> [-i <\"255.255.255.255\">] [-p {60000}] [-r <pps>] [-n <retries>] [--stagger <ms> [--cap <n>]] [-e <eth0>] [--sndbuf <bytes>] [--dscp <0-63>] [--ttl <hops>] [--pipeline <threads>] [-c <icmp|arp:eth0|22> [--history <wake.log>]] [--stats] [--resolve] [-h] [-s]\n"
+               "wol.exe <--compile <hosts.txt> <hosts.wolbin>> [-i <\"255.255.255.255\">] [-p {60000}] [-h] [-s]\n"
+               "wol.exe <--harvest <hosts.wolbin>> [-p {60000}] [-h] [-s]\n"
+               "wol.exe <--daemon <port>> [--allow <10.0.0.0/8>] [--coalesce <ms>] [-i <\"255.255.255.255\">] [-p {60000}] [-r <pps>] [--sndbuf <bytes>] [--dscp <0-63>] [--ttl <hops>] [-h] [-s]\n"
+               "wol.exe <--listen <port>> [-e <eth0>] [-f <hosts.txt|hosts.wolbin|->] [-h] [-s]\n"
                "Parameters:\n"
-               " -i   Sets the IP address\n"
-               " -p   Sets the port\n"
+               " -i   Sets the IPv4 or IPv6 address, e.g. ff02::1%%eth0, with -f the IPv4 of lines without IP\n"
+               " -p   Sets the port, with -f the port of lines without port\n"
                " -m   Sets the MAC address\n"
+               " -w   Appends a SecureOn password of 6 bytes like a MAC or 4 bytes like an IPv4 to the packet\n"
+               " -f   Wakes all hosts of a file with one \"mac [ip] [port] [group] [password]\" per line, - reads stdin\n"
+               "      or of a compiled inventory\n"
+               " -r   Limits -f to the given packets per second\n"
+               " -n   Resends -f to every host the given number of times after 1, 2, 4, ... up to 16 seconds\n"
+               " -e   Sends raw Ethernet frames (EtherType 0x0842) to the MAC over the device, no IP needed\n"
+               " -c   Waits until the host answers an ICMP echo, an ARP request on the device or a TCP connect\n"
+               "      to the port and resends the magic packet with growing intervals until then,\n"
+               "      with -f all hosts at once, hosts of -f with a broadcast IP are woken without probe\n"
+               " -a   Sets the IPv4 address probed by -c if -i is a broadcast\n");
+           printf(
+               " --compile  Converts a host file into a compiled inventory for instant loading\n"
+               " --harvest  Adds the hosts of the ARP/neighbor table to a compiled inventory and updates the IP\n"
+               "            of known hosts that moved, only changed records are written, -p is the port of new hosts\n"
+               " --daemon   Relays binary wake requests received on the UDP and TCP port to the local segment,\n"
+               "            -i and -p are used for records without IP and port\n"
+               " --stagger  Spreads the first packets of -f over the given milliseconds\n"
+               " --cap      Limits --stagger to the given wakes per second of each group, e.g. rack or PDU\n"
+               " --resolve  Replaces an IP of -i or -f in a subnet of a local interface by the directed broadcast\n"
+               "            of the subnet, e.g. the host 192.168.178.20 or the subnet 192.168.178.0 by 192.168.178.255\n"
+               " --sndbuf   Sets the send buffer of -f and --daemon in bytes, e.g. 4194304 for bursts of thousands of hosts\n"
+               " --dscp     Marks the packets of -f and --daemon with the DSCP, e.g. 46 for expedited forwarding\n"
+               " --ttl      Sets the TTL of -f and --daemon, directed broadcasts to remote subnets need one per router\n"
+               " --pipeline Sends the hosts of a text inventory of -f while it is parsed by the given threads,\n"
+               "            0 for one per processor, each local interface of --resolve has its own sender, not with -n\n"
+               "            --stagger and -e\n"
+               " --stats    Prints the packets, errors and send, batch and confirm time percentiles of -f or -c\n"
+               " --allow    Only accepts --daemon requests from the network\n"
+               " --coalesce Merges --daemon requests for a MAC within the given milliseconds into the first\n"
+               " --history  Records the wakes and answers of -c per MAC in the log, needs -c, -f wakes the hosts in\n"
+               "            the order of their last confirmed boot time, the slowest first, resends only to hosts that\n"
+               "            answered their last wake and skips hosts without answer to 5 wakes for a day\n"
+               " --listen   Counts the magic packets received on the UDP port, 0 for none, and with -e the raw frames\n"
+               "            until 2 seconds without packets and reports the hosts of -f that were not received\n"
                " -h   Shows this help\n"
                " -s   Mute output\n");
            fflush(stdout);
@@ -138,6 +723,1102 @@ int main(int argc, char * const argv[])
 }
 
 
+static int wake_inventory(const char * path, uint32_t default_ip_v4, uint16_t default_port, const send_options_t * options, bool silent)
+{
+    int return_value = 1;
+
+    wol_file_map_t map;
+    wol_inventory_t inventory;
+    wol_target_t * parsed = NULL;
+    uint32_t * groups = NULL;
+    wol_result_t * results = NULL;
+    uint32_t * probe_ips = NULL;
+    wol_target_t * ordered = NULL;
+    wol_confirm_result_t * confirmed = NULL;
+    wol_history_t history;
+    bool history_open = false;
+
+    wake_on_lan_t wol = { 0 };
+    wake_on_lan_errors_t error = wol_file_map_open(&map, path, &wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        if(!silent)
+        {
+            printf("Error: %s: %s\n", path, wake_on_lan_errors[error]);
+            fflush(stdout);
+        }
+        return return_value;
+    }
+
+    // A compiled inventory takes over the mapping
+    bool compiled = (WAKE_ON_LAN_ERRORS_NONE == wol_inventory_from_map(&inventory, &map));
+
+    // The pipeline sends each host once as soon as it is parsed, resends, plans and the history need the whole inventory first
+    if(!compiled && options->pipeline && 0 == options->retries && 0 == options->stagger_ms && 0 == options->group_cap && NULL == options->device
+        && NULL == options->history && NULL == options->probe)
+    {
+        return_value = wake_pipeline(path, &map, default_ip_v4, default_port, options, silent);
+        wol_file_map_close(&map);
+        return return_value;
+    }
+
+    do{
+
+        const wol_target_t * targets;
+        size_t count = 0;
+        size_t parse_errors = 0;
+
+        if(compiled)
+        {
+            targets = inventory.targets;
+            count = inventory.count;
+        }
+        else
+        {
+            error = parse_inventory(path, &map, default_ip_v4, default_port, silent, &parsed, &groups, &count, &parse_errors);
+            if(WAKE_ON_LAN_ERRORS_NONE != error)
+            {
+                break;
+            }
+            targets = parsed;
+        }
+
+        results = malloc((count ? count : 1) * sizeof(*results));
+        if(NULL == results)
+        {
+            error = WAKE_ON_LAN_ERRORS_MEMORY;
+            break;
+        }
+
+        // The probes go to the host IPs of the inventory, hosts behind a broadcast are woken without probe
+        if(options->probe)
+        {
+            probe_ips = malloc((count ? count : 1) * sizeof(*probe_ips));
+            confirmed = calloc(count ? count : 1, sizeof(*confirmed));
+            if(NULL == probe_ips || NULL == confirmed)
+            {
+                error = WAKE_ON_LAN_ERRORS_MEMORY;
+                break;
+            }
+            for(size_t i = 0; i < count; i++)
+            {
+                uint32_t ip_v4 = targets[i].ip_v4;
+                probe_ips[i] = (wol_target_is_v6(&targets[i]) || UINT32_MAX == ip_v4 || default_ip_v4 == ip_v4) ? 0 : ip_v4;
+            }
+        }
+
+        if(options->resolve)
+        {
+            // A compiled inventory is mapped read-only, its targets are resolved in a copy
+            if(compiled)
+            {
+                parsed = malloc((count ? count : 1) * sizeof(*parsed));
+                if(NULL == parsed)
+                {
+                    error = WAKE_ON_LAN_ERRORS_MEMORY;
+                    break;
+                }
+                memcpy(parsed, targets, count * sizeof(*parsed));
+                targets = parsed;
+            }
+
+            error = resolve_targets(parsed, count);
+            if(WAKE_ON_LAN_ERRORS_NONE != error)
+            {
+                break;
+            }
+        }
+
+        send_options_t planned_options = *options;
+        if(options->history)
+        {
+            error = wol_history_open(&history, options->history, &wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != error)
+            {
+                if(!silent)
+                {
+                    printf("Error: %s: %s\n", options->history, wake_on_lan_errors[error]);
+                }
+                // Reported with the path already
+                error = WAKE_ON_LAN_ERRORS_NONE;
+                break;
+            }
+            history_open = true;
+
+            // The plan is applied to copies, a compiled inventory stays mapped read-only
+            size_t * order = malloc((count ? count : 1) * sizeof(*order));
+            uint32_t * scratch = malloc((count ? count : 1) * sizeof(*scratch));
+            ordered = malloc((count ? count : 1) * sizeof(*ordered));
+            if(NULL == order || NULL == scratch || NULL == ordered)
+            {
+                free(order);
+                free(scratch);
+                error = WAKE_ON_LAN_ERRORS_MEMORY;
+                break;
+            }
+
+            size_t responsive = 0;
+            size_t planned = wol_history_plan(&history, targets, count, NULL, order, &responsive);
+            for(size_t i = 0; i < planned; i++)
+            {
+                ordered[i] = targets[order[i]];
+            }
+            if(groups)
+            {
+                for(size_t i = 0; i < planned; i++)
+                {
+                    scratch[i] = groups[order[i]];
+                }
+                memcpy(groups, scratch, planned * sizeof(*groups));
+            }
+            if(probe_ips)
+            {
+                for(size_t i = 0; i < planned; i++)
+                {
+                    scratch[i] = probe_ips[order[i]];
+                }
+                memcpy(probe_ips, scratch, planned * sizeof(*probe_ips));
+            }
+            free(scratch);
+            free(order);
+
+            if(!silent && planned < count)
+            {
+                printf("Skipped: %" PRIu64 " hosts without answer to their last %d wakes\n", (uint64_t)(count - planned), WOL_HISTORY_SKIP_STREAK);
+            }
+
+            targets = ordered;
+            count = planned;
+            planned_options.quiet_count = planned - responsive;
+        }
+
+        wake_on_lan_errors_t batch_result;
+        wol.return_value = WAKE_ON_LAN_ERRORS_NONE;
+        if(options->probe)
+        {
+            batch_result = confirm_targets(targets, probe_ips, count, confirmed, &planned_options, &wol);
+        }
+        else
+        {
+            batch_result = send_targets(targets, groups, count, results, &planned_options, &wol);
+        }
+        if(WAKE_ON_LAN_ERRORS_NONE != wol.return_value)
+        {
+            error = wol.return_value;
+            break;
+        }
+
+        size_t up = 0;
+        size_t probed = 0;
+        int64_t now = (int64_t)time(NULL);
+        for(size_t i = 0; i < count; i++)
+        {
+            bool sent;
+            if(options->probe)
+            {
+                results[i].return_value = confirmed[i].return_value;
+                results[i].last_error = confirmed[i].last_error;
+                sent = (0 != confirmed[i].packets);
+                probed += (0 != probe_ips[i]) ? 1 : 0;
+                up += confirmed[i].up ? 1 : 0;
+            }
+            else
+            {
+                sent = (WAKE_ON_LAN_ERRORS_NONE == results[i].return_value);
+            }
+
+            // Only a probe tells whether the host woke, a sent packet is just an attempt
+            if(history_open && sent)
+            {
+                wol_history_attempt(&history, targets[i].mac, now);
+                if(probe_ips && 0 != probe_ips[i])
+                {
+                    wol_history_result(&history, targets[i].mac, confirmed[i].up, (uint32_t)(confirmed[i].latency_ns / UINT64_C(1000000)), now);
+                }
+            }
+
+            if(!silent)
+            {
+                print_result(&targets[i], &results[i]);
+            }
+        }
+
+        if(!silent && options->probe)
+        {
+            printf("Up: %" PRIu64 " of %" PRIu64 " probed hosts\n", (uint64_t)up, (uint64_t)probed);
+        }
+
+        if(WAKE_ON_LAN_ERRORS_NONE == batch_result && 0 == parse_errors)
+        {
+            return_value = 0;
+        }
+
+    }while(0);
+
+    if(WAKE_ON_LAN_ERRORS_NONE != error && !silent)
+    {
+        printf("Error: %s\n", wake_on_lan_errors[error]);
+    }
+
+    if(!silent)
+    {
+        fflush(stdout);
+    }
+
+    if(history_open)
+    {
+        wol_history_close(&history);
+    }
+    free(confirmed);
+    free(ordered);
+    free(probe_ips);
+    free(results);
+    free(groups);
+    free(parsed);
+    if(compiled)
+    {
+        wol_inventory_close(&inventory);
+    }
+    else
+    {
+        wol_file_map_close(&map);
+    }
+
+    return return_value;
+}
+
+static int wake_pipeline(const char * path, const wol_file_map_t * map, uint32_t default_ip_v4, uint16_t default_port, const send_options_t * options, bool silent)
+{
+    wol_pipeline_options_t pipeline_options = { 0 };
+    pipeline_options.parser_threads = options->parsers;
+    pipeline_options.default_ip_v4 = default_ip_v4;
+    pipeline_options.default_port = default_port;
+    pipeline_options.sender_options = &options->tuning;
+    pipeline_options.metrics = options->metrics;
+    pipeline_options.callback = silent ? NULL : print_pipeline_result;
+
+    if(0 != options->rate)
+    {
+        uint32_t burst = options->rate / PACING_BURSTS_PER_SECOND;
+        pipeline_options.packets_per_second = options->rate;
+        pipeline_options.burst = (0 == burst) ? 1 : (PACING_BURST_MAX < burst) ? PACING_BURST_MAX : burst;
+    }
+
+    wol_interfaces_t interfaces;
+    wol_engine_binding_t * bindings = NULL;
+    wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_NONE;
+
+    // Resolved hosts are sent out of the interface of their subnet, each interface by its own sender
+    if(options->resolve)
+    {
+        error = wol_interfaces_open(&interfaces, NULL);
+        if(WAKE_ON_LAN_ERRORS_NONE == error)
+        {
+            bindings = malloc((interfaces.count ? interfaces.count : 1) * sizeof(*bindings));
+            if(NULL == bindings)
+            {
+                error = WAKE_ON_LAN_ERRORS_MEMORY;
+                wol_interfaces_close(&interfaces);
+            }
+            else
+            {
+                pipeline_options.bindings = bindings;
+                pipeline_options.binding_count = wol_interfaces_bindings(&interfaces, bindings, interfaces.count);
+                pipeline_options.interfaces = &interfaces;
+            }
+        }
+    }
+
+    wol_pipeline_stats_t stats = { 0 };
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        error = wol_pipeline_run(map->data, map->length, &pipeline_options, &stats);
+    }
+
+    if(!silent)
+    {
+        if(0 != stats.parse_errors)
+        {
+            printf("Error: %s: %" PRIu64 " lines could not be parsed\n", path, (uint64_t)stats.parse_errors);
+        }
+        if(WAKE_ON_LAN_ERRORS_NONE != error && 0 == stats.sent + stats.failed)
+        {
+            printf("Error: %s\n", wake_on_lan_errors[error]);
+        }
+        if(options->metrics)
+        {
+            printf("Pipeline: %" PRIu64 " hosts, first packet after %" PRIu64 " us, all sent after %" PRIu64 " ms\n",
+                (uint64_t)stats.targets, stats.first_send_ns / UINT64_C(1000), stats.duration_ns / UINT64_C(1000000));
+        }
+        fflush(stdout);
+    }
+
+    if(pipeline_options.interfaces)
+    {
+        wol_interfaces_close(&interfaces);
+    }
+    free(bindings);
+
+    return (WAKE_ON_LAN_ERRORS_NONE == error && 0 == stats.parse_errors) ? 0 : 1;
+}
+
+static void print_pipeline_result(void * context, const wol_target_t * target, const wol_result_t * result)
+{
+    (void)context;
+    print_result(target, result);
+}
+
+static wake_on_lan_errors_t send_targets(const wol_target_t * targets, const uint32_t * groups, size_t count, wol_result_t * results, const send_options_t * options, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t error;
+
+    if(options->device)
+    {
+        wol_raw_sender_t raw;
+        error = wol_raw_sender_open(&raw, options->device, wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            return error;
+        }
+
+        error = wol_raw_send(&raw, targets, count, results);
+        wol_raw_sender_close(&raw);
+
+        return error;
+    }
+
+    wake_on_lan_sender_t sender;
+    error = wake_on_lan_sender_open(&sender, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        return error;
+    }
+    sender.metrics = options->metrics;
+
+    if(0 != options->rate)
+    {
+        uint32_t burst = options->rate / PACING_BURSTS_PER_SECOND;
+        burst = (0 == burst) ? 1 : (PACING_BURST_MAX < burst) ? PACING_BURST_MAX : burst;
+
+        // Without SO_MAX_PACING_RATE the user space pacing still holds the rate
+        wake_on_lan_sender_set_rate(&sender, options->rate, burst, NULL);
+    }
+
+    // A refused tuning, e.g. a send buffer above net.core.wmem_max without privileges, keeps the defaults
+    wake_on_lan_sender_set_options(&sender, &options->tuning, NULL);
+
+    do{
+
+        wol_stagger_t stagger = { 0 };
+        if(0 != options->stagger_ms || 0 != options->group_cap)
+        {
+            wol_stagger_options_t stagger_options = { 0 };
+            stagger_options.duration_ms = options->stagger_ms;
+            stagger_options.group_cap = options->group_cap;
+
+            error = wol_stagger_plan(&stagger, groups, count, &stagger_options, wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != error)
+            {
+                if(wol) { wol->return_value = error; }
+                break;
+            }
+        }
+
+        if(0 != options->retries)
+        {
+            wol_retry_t retry;
+            wol_retry_options_t retry_options = { 0 };
+            retry_options.retries = options->retries;
+            retry_options.jitter_percent = RETRY_JITTER_PERCENT;
+            retry_options.callback = store_result;
+            retry_options.context = results;
+
+            error = wol_retry_open(&retry, targets, count, &retry_options, wol);
+            if(WAKE_ON_LAN_ERRORS_NONE == error)
+            {
+                // Hosts that did not answer their last wakes get their packet, but the resends go to the others
+                size_t quiet_start = count - options->quiet_count;
+                for(size_t i = quiet_start; i < count && NULL == stagger.entries; i++)
+                {
+                    wol_retry_schedule(&retry, i, 0, 0);
+                }
+
+                // The first packet of each target moves to its time of the plan, the resends follow from there
+                for(size_t i = 0; i < stagger.count; i++)
+                {
+                    wol_retry_schedule(&retry, stagger.entries[i].index,
+                        (uint32_t)(stagger.entries[i].offset_ns / UINT64_C(1000000)),
+                        (quiet_start <= stagger.entries[i].index) ? 0 : options->retries);
+                }
+
+                error = wol_retry_run(&retry, &sender);
+                wol_retry_close(&retry);
+            }
+            else if(wol)
+            {
+                wol->return_value = error;
+            }
+        }
+        else if(NULL != stagger.entries)
+        {
+            error = wol_stagger_send(&stagger, &sender, targets, results);
+        }
+        else
+        {
+            error = wake_on_lan_batch(&sender, targets, count, results);
+        }
+
+        wol_stagger_close(&stagger);
+
+    }while(0);
+    wake_on_lan_sender_close(&sender, NULL);
+
+    return error;
+}
+
+static wake_on_lan_errors_t resolve_targets(wol_target_t * targets, size_t count)
+{
+    wol_interfaces_t interfaces;
+    wake_on_lan_errors_t error = wol_interfaces_open(&interfaces, NULL);
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        wol_interfaces_resolve(&interfaces, targets, count);
+        wol_interfaces_close(&interfaces);
+    }
+
+    return error;
+}
+
+static void store_result(void * context, size_t index, const wol_result_t * result)
+{
+    ((wol_result_t *)context)[index] = *result;
+}
+
+static wake_on_lan_errors_t parse_probe(const char * probe, wol_confirm_options_t * options)
+{
+    if(0 == strcmp(probe, "icmp"))
+    {
+        options->probe = WOL_PROBE_ICMP;
+    }
+    else if(0 == strncmp(probe, PROBE_ARP_PREFIX, strlen(PROBE_ARP_PREFIX)))
+    {
+        options->probe = WOL_PROBE_ARP;
+        options->device = probe + strlen(PROBE_ARP_PREFIX);
+    }
+    else
+    {
+        options->probe = WOL_PROBE_TCP;
+        options->tcp_port = strtoumax(probe, NULL, 10);
+        if(0 == options->tcp_port)
+        {
+            return WAKE_ON_LAN_ERRORS_PORT;
+        }
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static wake_on_lan_errors_t confirm_targets(const wol_target_t * targets, const uint32_t * probe_ip_v4, size_t count, wol_confirm_result_t * results, const send_options_t * options, wake_on_lan_t * wol)
+{
+    wol_confirm_options_t confirm_options = { 0 };
+    wake_on_lan_errors_t error = parse_probe(options->probe, &confirm_options);
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        if(wol) { wol->return_value = error; }
+        return error;
+    }
+
+    wake_on_lan_sender_t sender;
+    error = wake_on_lan_sender_open(&sender, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        return error;
+    }
+    sender.metrics = options->metrics;
+
+    if(0 != options->rate)
+    {
+        uint32_t burst = options->rate / PACING_BURSTS_PER_SECOND;
+        burst = (0 == burst) ? 1 : (PACING_BURST_MAX < burst) ? PACING_BURST_MAX : burst;
+        wake_on_lan_sender_set_rate(&sender, options->rate, burst, NULL);
+    }
+    wake_on_lan_sender_set_options(&sender, &options->tuning, NULL);
+
+    // Hosts that did not answer their last wakes get their packet and the probes, but no resends
+    uint32_t * resend_limits = NULL;
+    if(0 != options->quiet_count)
+    {
+        resend_limits = malloc(count * sizeof(*resend_limits));
+        if(NULL == resend_limits)
+        {
+            wake_on_lan_sender_close(&sender, NULL);
+            if(wol) { wol->return_value = WAKE_ON_LAN_ERRORS_MEMORY; }
+            return WAKE_ON_LAN_ERRORS_MEMORY;
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            resend_limits[i] = (count - options->quiet_count <= i) ? 0 : UINT32_MAX;
+        }
+        confirm_options.resend_limits = resend_limits;
+    }
+
+    error = wol_wake_and_confirm(&sender, targets, probe_ip_v4, count, &confirm_options, results);
+    wake_on_lan_sender_close(&sender, NULL);
+    free(resend_limits);
+
+    return error;
+}
+
+static wake_on_lan_errors_t wake_target(const char * ip, uint16_t port, const char * mac, const char * password, bool resolve)
+{
+    wol_target_t target;
+    wake_on_lan_errors_t error = wol_target_parse(&target, ip, port, mac);
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        error = wol_target_set_password(&target, password);
+    }
+    if(WAKE_ON_LAN_ERRORS_NONE == error && resolve)
+    {
+        error = resolve_targets(&target, 1);
+    }
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        return error;
+    }
+
+    wake_on_lan_sender_t sender;
+    error = wake_on_lan_sender_open_target(&sender, &target, NULL);
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        error = wake_on_lan_sender_send_target(&sender, NULL, &target);
+        wake_on_lan_sender_close(&sender, NULL);
+    }
+
+    return error;
+}
+
+static int wake_and_confirm(const char * ip, uint16_t port, const char * mac, const char * password, const char * probe, const char * probe_ip, const char * history, wol_metrics_t * metrics, bool resolve, bool silent)
+{
+    wol_confirm_options_t options = { 0 };
+    wol_target_t target;
+    uint32_t probe_ip_v4 = 0;
+    wake_on_lan_errors_t error = wol_target_parse(&target, ip, port, mac);
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        error = wol_target_set_password(&target, password);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        error = parse_probe(probe, &options);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        const char * host = probe_ip ? probe_ip : ip;
+        if(!wol_parse_ip_v4(host, strlen(host), &probe_ip_v4))
+        {
+            error = WAKE_ON_LAN_ERRORS_IP;
+        }
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE == error && resolve)
+    {
+        error = resolve_targets(&target, 1);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        if(!silent)
+        {
+            printf("Error: %s\n", wake_on_lan_errors[error]);
+            fflush(stdout);
+        }
+        return 1;
+    }
+
+    wake_on_lan_sender_t sender;
+    wol_confirm_result_t result = { 0 };
+
+    error = wake_on_lan_sender_open_target(&sender, &target, NULL);
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        sender.metrics = metrics;
+        error = wol_wake_and_confirm(&sender, &target, &probe_ip_v4, 1, &options, &result);
+        wake_on_lan_sender_close(&sender, NULL);
+    }
+
+    // A failed history only loses the record, the wake itself is done
+    wol_history_t wake_history;
+    if(history && 0 != result.packets && WAKE_ON_LAN_ERRORS_NONE == wol_history_open(&wake_history, history, NULL))
+    {
+        int64_t now = (int64_t)time(NULL);
+        wol_history_attempt(&wake_history, target.mac, now);
+        wol_history_result(&wake_history, target.mac, result.up, (uint32_t)(result.latency_ns / UINT64_C(1000000)), now);
+        wol_history_close(&wake_history);
+    }
+
+    if(!silent)
+    {
+        if(result.up)
+        {
+            printf("Host is up after %" PRIu64 " ms and %" PRIu32 " magic packets\n",
+                result.latency_ns / UINT64_C(1000000), result.packets);
+        }
+        else
+        {
+            printf("Error: %s\n", wake_on_lan_errors[error]);
+        }
+        fflush(stdout);
+    }
+
+    return result.up ? 0 : 1;
+}
+
+static int run_daemon(uint16_t control_port, const char * allow, uint32_t default_ip_v4, uint16_t default_port, uint32_t rate, uint32_t coalesce_ms, const wol_sender_options_t * tuning, bool silent)
+{
+    wol_relay_options_t options = { 0 };
+    options.port = control_port;
+    options.default_ip_v4 = default_ip_v4;
+    options.default_port = default_port;
+    options.packets_per_second = rate;
+    options.sender_options = tuning;
+    options.stop = &daemon_stop;
+
+    if(allow)
+    {
+        const char * slash = strchr(allow, '/');
+        size_t length = slash ? (size_t)(slash - allow) : strlen(allow);
+        uintmax_t prefix = slash ? strtoumax(slash + 1, NULL, 10) : 32;
+
+        if(!wol_parse_ip_v4(allow, length, &options.allow_ip_v4) || 0 == prefix || 32 < prefix)
+        {
+            if(!silent)
+            {
+                printf("Error: %s\n", wake_on_lan_errors[WAKE_ON_LAN_ERRORS_IP]);
+                fflush(stdout);
+            }
+            return 1;
+        }
+        options.allow_prefix = (uint8_t)prefix;
+    }
+
+    wake_on_lan_t wol = { 0 };
+    wol_coalesce_t coalesce;
+    wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_NONE;
+
+    if(0 != coalesce_ms)
+    {
+        error = wol_coalesce_open(&coalesce, 0, coalesce_ms, &wol);
+        options.coalesce = &coalesce;
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        signal(SIGINT, daemon_signal);
+        signal(SIGTERM, daemon_signal);
+
+        error = wol_relay_run(&options, &wol);
+    }
+
+    if(0 != coalesce_ms)
+    {
+        wol_coalesce_close(&coalesce);
+    }
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        if(!silent)
+        {
+            printf("Error: %s\n", wake_on_lan_errors[error]);
+            fflush(stdout);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+static void daemon_signal(int signal_number)
+{
+    (void)signal_number;
+    daemon_stop = true;
+}
+
+static int run_listener(uint16_t listen_port, const char * device, const char * path, uint32_t default_ip_v4, uint16_t default_port, bool silent)
+{
+    int return_value = 1;
+
+    wol_file_map_t map;
+    wol_inventory_t inventory;
+    wol_target_t * parsed = NULL;
+    const wol_target_t * expected = NULL;
+    size_t count = 0;
+    bool mapped = false;
+    bool compiled = false;
+
+    wake_on_lan_t wol = { 0 };
+    wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_NONE;
+    wol_listen_t listener = { 0 };
+
+    do{
+
+        if(path)
+        {
+            error = wol_file_map_open(&map, path, &wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != error)
+            {
+                break;
+            }
+            mapped = true;
+
+            compiled = (WAKE_ON_LAN_ERRORS_NONE == wol_inventory_from_map(&inventory, &map));
+            if(compiled)
+            {
+                expected = inventory.targets;
+                count = inventory.count;
+            }
+            else
+            {
+                size_t parse_errors = 0;
+                error = parse_inventory(path, &map, default_ip_v4, default_port, silent, &parsed, NULL, &count, &parse_errors);
+                if(WAKE_ON_LAN_ERRORS_NONE != error)
+                {
+                    break;
+                }
+                expected = parsed;
+            }
+        }
+
+        error = wol_listen_open(&listener, expected, count, &wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            break;
+        }
+
+        wol_listen_options_t options = { 0 };
+        options.port = listen_port;
+        options.device = device;
+        options.stop = &daemon_stop;
+
+        signal(SIGINT, daemon_signal);
+        signal(SIGTERM, daemon_signal);
+
+        error = wol_listen_run(&listener, &options, &wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            break;
+        }
+
+        size_t missing = listener.expected - listener.expected_seen;
+        if(!silent)
+        {
+            printf("Packets: %" PRIu64 ", valid: %" PRIu64 ", invalid: %" PRIu64 ", dropped by the kernel: %" PRIu64 "\n",
+                listener.packets, listener.valid, listener.invalid, listener.dropped);
+            printf("MACs: %zu, duplicates: %" PRIu64 ", unexpected: %" PRIu64 "\n", listener.used, listener.duplicates, listener.unexpected);
+            if(listener.last_ns > listener.first_ns)
+            {
+                uint64_t elapsed_ns = listener.last_ns - listener.first_ns;
+                printf("Rate: %.0f packets per second over %" PRIu64 " ms\n",
+                    (double)listener.valid * 1e9 / (double)elapsed_ns, elapsed_ns / UINT64_C(1000000));
+            }
+            if(path)
+            {
+                printf("Expected: %zu, received: %zu, missing: %zu\n", listener.expected, listener.expected_seen, missing);
+            }
+
+            size_t printed = 0;
+            for(size_t i = 0; i < count && printed < missing && printed < MAX_PRINTED_MISSING; i++)
+            {
+                if(0 == wol_listen_hits(&listener, wol_target_mac(&expected[i])))
+                {
+                    const uint8_t * mac = expected[i].mac;
+                    printf("Missing: %02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+                    printed++;
+                }
+            }
+        }
+
+        if(0 == missing)
+        {
+            return_value = 0;
+        }
+
+    }while(0);
+
+    if(WAKE_ON_LAN_ERRORS_NONE != error && !silent)
+    {
+        printf("Error: %s\n", wake_on_lan_errors[error]);
+    }
+
+    if(!silent)
+    {
+        fflush(stdout);
+    }
+
+    wol_listen_close(&listener);
+    free(parsed);
+    if(compiled)
+    {
+        wol_inventory_close(&inventory);
+    }
+    else if(mapped)
+    {
+        wol_file_map_close(&map);
+    }
+
+    return return_value;
+}
+
+static int compile_inventory(const char * input, const char * output, uint32_t default_ip_v4, uint16_t default_port, bool silent)
+{
+    int return_value = 1;
+
+    wol_file_map_t map;
+    wol_target_t * targets = NULL;
+
+    wake_on_lan_t wol = { 0 };
+    wake_on_lan_errors_t error = wol_file_map_open(&map, input, &wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        if(!silent)
+        {
+            printf("Error: %s: %s\n", input, wake_on_lan_errors[error]);
+            fflush(stdout);
+        }
+        return return_value;
+    }
+
+    size_t count = 0;
+    size_t parse_errors = 0;
+    error = parse_inventory(input, &map, default_ip_v4, default_port, silent, &targets, NULL, &count, &parse_errors);
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        // One section per destination IP, so each broadcast domain is a contiguous range
+        error = wol_inventory_write(output, targets, count, true, &wol);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != error)
+    {
+        if(!silent)
+        {
+            printf("Error: %s: %s\n", output, wake_on_lan_errors[error]);
+        }
+    }
+    else if(0 == parse_errors)
+    {
+        return_value = 0;
+    }
+
+    if(!silent)
+    {
+        fflush(stdout);
+    }
+
+    free(targets);
+    wol_file_map_close(&map);
+
+    return return_value;
+}
+
+static int harvest_inventory(const char * path, uint16_t default_port, bool silent)
+{
+    int return_value = 1;
+
+    wol_neighbor_t * neighbors = NULL;
+    size_t count = 0;
+    wol_target_t * targets = NULL;
+
+    wake_on_lan_t wol = { 0 };
+    wake_on_lan_errors_t error = wol_neighbors_read(&neighbors, &count, &wol);
+    if(WAKE_ON_LAN_ERRORS_NONE == error && 0 != count)
+    {
+        targets = malloc(count * sizeof(*targets));
+        if(NULL == targets)
+        {
+            error = WAKE_ON_LAN_ERRORS_MEMORY;
+        }
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE == error)
+    {
+        // Without the interfaces the hosts keep their own IP, which still wakes them while their ARP entry lives
+        wol_interfaces_t interfaces;
+        bool resolve = (WAKE_ON_LAN_ERRORS_NONE == wol_interfaces_open(&interfaces, NULL));
+        wol_inventory_t inventory;
+        bool known = (WAKE_ON_LAN_ERRORS_NONE == wol_inventory_load(&inventory, path, NULL));
+
+        for(size_t i = 0; i < count; i++)
+        {
+            wol_target_init(&targets[i], neighbors[i].ip_v4, default_port, 0);
+            memcpy(targets[i].mac, neighbors[i].mac, sizeof(targets[i].mac));
+
+            const wol_interface_t * subnet = resolve ? wol_interfaces_lookup(&interfaces, neighbors[i].ip_v4) : NULL;
+            if(NULL == subnet)
+            {
+                continue;
+            }
+            targets[i].ip_v4 = subnet->broadcast;
+
+            const wol_target_t * record = known ? wol_inventory_find(&inventory, neighbors[i].mac) : NULL;
+            if(record && 0 != record->ip_v4 && subnet == wol_interfaces_lookup(&interfaces, record->ip_v4))
+            {
+                targets[i].ip_v4 = record->ip_v4;
+            }
+        }
+
+        if(known)
+        {
+            wol_inventory_close(&inventory);
+        }
+        if(resolve)
+        {
+            wol_interfaces_close(&interfaces);
+        }
+
+        wol_inventory_merge_t merge;
+        error = wol_inventory_merge(path, targets, count, &merge, &wol);
+        if(WAKE_ON_LAN_ERRORS_NONE == error)
+        {
+            return_value = 0;
+            if(!silent)
+            {
+                printf("%s: %zu neighbors, %zu added, %zu updated, %zu unchanged, %s\n", path, count, merge.added, merge.updated, merge.unchanged,
+                    merge.rewritten ? "rewritten" : ((0 != merge.updated) ? "updated in place" : "not written"));
+            }
+        }
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != error && !silent)
+    {
+        printf("Error: %s: %s\n", path, wake_on_lan_errors[error]);
+    }
+
+    if(!silent)
+    {
+        fflush(stdout);
+    }
+
+    free(targets);
+    free(neighbors);
+
+    return return_value;
+}
+
+static wake_on_lan_errors_t parse_inventory(const char * path, const wol_file_map_t * map, uint32_t default_ip_v4, uint16_t default_port, bool silent, wol_target_t ** targets, uint32_t ** groups, size_t * count, size_t * errors)
+{
+    wol_parse_error_t parse_errors[MAX_PRINTED_PARSE_ERRORS];
+
+    // The bound avoids a separate pass to count the lines
+    size_t capacity = wol_parse_targets_bound(map->length);
+    *targets = malloc(capacity * sizeof(**targets));
+    *count = 0;
+    *errors = 0;
+    if(groups)
+    {
+        *groups = malloc(capacity * sizeof(**groups));
+    }
+    if(NULL == *targets || (groups && NULL == *groups))
+    {
+        free(*targets);
+        *targets = NULL;
+        if(groups)
+        {
+            free(*groups);
+            *groups = NULL;
+        }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    wol_parse_t parse = { 0 };
+    parse.targets = *targets;
+    parse.groups = groups ? *groups : NULL;
+    parse.targets_capacity = capacity;
+    parse.errors = parse_errors;
+    parse.errors_capacity = MAX_PRINTED_PARSE_ERRORS;
+    parse.default_ip_v4 = default_ip_v4;
+    parse.default_port = default_port;
+    wol_parse_targets(&parse, map->data, map->length);
+
+    if(!silent)
+    {
+        for(size_t i = 0; i < parse.errors_count && i < parse.errors_capacity; i++)
+        {
+            printf("Error: %s:%" PRIu64 ":%" PRIu64 ": %s\n", path,
+                (uint64_t)parse_errors[i].line, (uint64_t)parse_errors[i].column, wake_on_lan_errors[parse_errors[i].error]);
+        }
+        if(parse.errors_count > parse.errors_capacity)
+        {
+            printf("Error: %s: %" PRIu64 " more lines could not be parsed\n", path,
+                (uint64_t)(parse.errors_count - parse.errors_capacity));
+        }
+    }
+
+    *count = parse.targets_count;
+    *errors = parse.errors_count;
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static void print_result(const wol_target_t * target, const wol_result_t * result)
+{
+    char message[256];
+    wol_error_format(message, sizeof(message), result->return_value, result->last_error);
+
+    // One call per line, the senders of the pipeline print at the same time
+    if(wol_target_is_v6(target))
+    {
+        const uint8_t * ip = target->ip_v6;
+        printf("%02X:%02X:%02X:%02X:%02X:%02X [%x:%x:%x:%x:%x:%x:%x:%x]:%u %s\n",
+            target->mac[0], target->mac[1], target->mac[2], target->mac[3], target->mac[4], target->mac[5],
+            (unsigned)(ip[0] << 8 | ip[1]), (unsigned)(ip[2] << 8 | ip[3]), (unsigned)(ip[4] << 8 | ip[5]), (unsigned)(ip[6] << 8 | ip[7]),
+            (unsigned)(ip[8] << 8 | ip[9]), (unsigned)(ip[10] << 8 | ip[11]), (unsigned)(ip[12] << 8 | ip[13]), (unsigned)(ip[14] << 8 | ip[15]),
+            (unsigned)target->port, message);
+        return;
+    }
+
+    printf("%02X:%02X:%02X:%02X:%02X:%02X %u.%u.%u.%u:%u %s\n",
+        target->mac[0], target->mac[1], target->mac[2], target->mac[3], target->mac[4], target->mac[5],
+        (unsigned)(target->ip_v4 >> 24) & 0xFF, (unsigned)(target->ip_v4 >> 16) & 0xFF,
+        (unsigned)(target->ip_v4 >> 8) & 0xFF, (unsigned)(target->ip_v4 >> 0) & 0xFF,
+        (unsigned)target->port, message);
+}
+
+static void print_metrics(const wol_metrics_t * metrics)
+{
+#if !defined(WAKE_ON_LAN_METRICS)
+    printf("Note: --stats needs a build with -DWAKE_ON_LAN_METRICS\n");
+#endif
+
+    wol_metrics_t snapshot;
+    wol_metrics_snapshot(metrics, &snapshot);
+
+    printf("Packets: %" PRIu64 ", bytes: %" PRIu64 ", socket full: %" PRIu64 "\n", snapshot.packets, snapshot.bytes, snapshot.again);
+    for(size_t i = 0; i < WOL_METRICS_ERRORS && i < WAKE_ON_LAN_ERRORS_COUNT; i++)
+    {
+        if(0 != snapshot.errors[i])
+        {
+            printf("Errors: %" PRIu64 " %s\n", snapshot.errors[i], wake_on_lan_errors[i]);
+        }
+    }
+
+    print_histogram("Send", &snapshot.send_ns);
+    print_histogram("Batch", &snapshot.batch_ns);
+    print_histogram("Confirm", &snapshot.confirm_ns);
+}
+
+static void print_histogram(const char * name, const wol_histogram_t * histogram)
+{
+    if(0 == histogram->count)
+    {
+        return;
+    }
+
+    printf("%s: %" PRIu64 " times, p50 %" PRIu64 " us, p90 %" PRIu64 " us, p99 %" PRIu64 " us, max %" PRIu64 " us\n", name, histogram->count,
+        wol_histogram_percentile(histogram, 50.0) / 1000, wol_histogram_percentile(histogram, 90.0) / 1000,
+        wol_histogram_percentile(histogram, 99.0) / 1000, histogram->max_ns / 1000);
+}
+
+
 /*---------------------------------------------------------------------*
  *  public:  functions
  *---------------------------------------------------------------------*/
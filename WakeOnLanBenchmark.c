@@ -0,0 +1,527 @@
+//! @file
+//! @brief Benchmark source file
+//!
+//! Measures the throughput and the latency percentiles of the parse, build and send paths
+//! of the wake_on_lan modules. The packets are sent to a sink socket on the loopback interface,
+//! so no host is woken and the network is not touched.
+//!
+//! Every benchmark runs a number of rounds with a fixed number of operations each, the
+//! percentiles are taken over the time per operation of the rounds.
+//!
+//! @note Compile it for Linux with:
+//! gcc -Wall -Wextra -O3 -o wol-benchmark WakeOnLanBenchmark.c wake_on_lan.c wake_on_lan_inventory.c
+//!
+//! @note Add `-DWAKE_ON_LAN_IO_URING` to measure the batch path over io_uring instead of `sendmmsg()`.
+//!
+//! @note Compile it for Windows with:
+//! gcc -Wall -Wextra -O3 -o wol-benchmark.exe WakeOnLanBenchmark.c wake_on_lan.c wake_on_lan_inventory.c -lws2_32
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+#include "wake_on_lan_inventory.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+
+#else
+
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+
+#endif
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Number of hosts of the parse and build benchmarks, one round handles all of them
+#define BENCH_HOSTS 4096
+
+//! @brief Number of packets of one round of the send benchmarks
+#define BENCH_SEND_PACKETS 256
+
+//! @brief Default number of rounds of each benchmark
+#define BENCH_ROUNDS 200
+
+//! @brief Receive buffer requested for the sink, so few packets of a round are dropped
+#define BENCH_SINK_BUFFER ( 4 * 1024 * 1024 )
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Data shared by all benchmarks
+typedef struct bench_state_s
+{
+    char ip[BENCH_HOSTS][16];           //!< IPs of the hosts as strings
+    char mac[BENCH_HOSTS][18];          //!< MACs of the hosts as strings
+    char * inventory;                   //!< Text inventory with one line per host
+    size_t inventory_length;            //!< Length of bench_state_s::inventory
+    wol_target_t targets[BENCH_HOSTS];  //!< Hosts as targets, all sent to the sink
+    wol_target_t parsed[BENCH_HOSTS];   //!< Output of the parse benchmarks
+    uint8_t * packets;                  //!< Output of the build benchmarks, one packet each ::WOL_PACKET_CACHE_STRIDE bytes
+    intptr_t sink;                      //!< Socket receiving the packets
+    char sink_ip[16];                   //!< IP of the sink as string, for ::wake_on_lan()
+    uint16_t sink_port;                 //!< Port of the sink
+    wake_on_lan_sender_t sender;        //!< Open sender of the send benchmarks
+    wol_packet_cache_t cache;           //!< Cache of the cached batch benchmark
+    size_t received;                    //!< Packets received by the sink so far
+} bench_state_t;
+
+//! @brief Runs one round of a benchmark
+//! @param state Pointer to the shared data
+//! @return Number of operations of the round
+typedef size_t (* bench_run_t)(bench_state_t * state);
+
+//! @brief One benchmark
+typedef struct bench_s
+{
+    const char * name;                  //!< Name printed and matched by the filter
+    const char * unit;                  //!< What one operation is
+    bench_run_t run;                    //!< Runs one round
+    bool sends;                         //!< The round sends packets to the sink
+} bench_t;
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+int main(int argc, char * const argv[]);
+
+//! @brief Fills the hosts, the inventory and the sink of the shared data
+//! @param state Pointer to the shared data
+//! @return True if everything is ready
+static bool bench_setup(bench_state_t * state);
+
+//! @brief Releases everything of ::bench_setup()
+//! @param state Pointer to the shared data
+static void bench_teardown(bench_state_t * state);
+
+//! @brief Reads every packet waiting at the sink and counts it
+//! @param state Pointer to the shared data
+static void bench_drain(bench_state_t * state);
+
+//! @brief Runs all rounds of a benchmark and prints one line of results
+//! @param state Pointer to the shared data
+//! @param bench Pointer to the benchmark
+//! @param rounds Number of rounds
+//! @param round_ns Array of `rounds` entries for the times of the rounds
+static void bench_measure(bench_state_t * state, const bench_t * bench, size_t rounds, double * round_ns);
+
+//! @brief Orders times ascending, for `qsort()`
+//! @param a Pointer to the first time
+//! @param b Pointer to the second time
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_double(const void * a, const void * b);
+
+//! @brief Builds a magic packet byte by byte, the way ::wake_on_lan() did before the vectorized builder
+//! @param[out] packet Buffer of ::WAKE_ON_LAN_PACKET_SIZE bytes
+//! @param mac MAC address, most significant byte first
+static void build_scalar(uint8_t * packet, const uint8_t mac[6]);
+
+//! @brief Parses the strings of every host with ::wol_target_parse(), the parsers behind ::wake_on_lan()
+static size_t run_parse_cstr(bench_state_t * state);
+
+//! @brief Parses the strings of every host with the strict parsers ::wol_parse_ip_v4() and ::wol_parse_mac()
+static size_t run_parse_strict(bench_state_t * state);
+
+//! @brief Parses the whole inventory with ::wol_parse_targets()
+static size_t run_parse_bulk(bench_state_t * state);
+
+//! @brief Builds the packet of every host with build_scalar()
+static size_t run_build_scalar(bench_state_t * state);
+
+//! @brief Builds the packet of every host with ::wol_packet_build()
+static size_t run_build_vector(bench_state_t * state);
+
+//! @brief Builds the packets of all hosts with ::wol_packet_build_many()
+static size_t run_build_many(bench_state_t * state);
+
+//! @brief Sends every packet with ::wake_on_lan(), a socket for each packet
+static size_t run_send_single(bench_state_t * state);
+
+//! @brief Sends every packet with ::wake_on_lan_sender_send_target() over the open sender
+static size_t run_send_pooled(bench_state_t * state);
+
+//! @brief Sends all packets with one ::wake_on_lan_batch()
+static size_t run_send_batch(bench_state_t * state);
+
+//! @brief Sends all packets with one ::wake_on_lan_batch() from the packet cache
+static size_t run_send_cached(bench_state_t * state);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+int main(int argc, char * const argv[])
+{
+    size_t rounds = BENCH_ROUNDS;
+    const char * filter = NULL;
+    bool help = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if('-' == argv[i][0] && 'r' == argv[i][1] && i + 1 < argc)
+        {
+            i++;
+            rounds = strtoumax(argv[i], NULL, 10);
+        }
+        else if('-' == argv[i][0] && 'h' == argv[i][1])
+        {
+            help = true;
+        }
+        else
+        {
+            filter = argv[i];
+        }
+    }
+
+    if(help || 0 == rounds)
+    {
+        printf(
+            "Measures the parse, build and send paths, the packets go to a loopback sink\n"
+            "wol-benchmark [-r {%d}] [name] [-h]\n"
+            "Parameters:\n"
+            " -r   Sets the number of rounds of each benchmark\n"
+            " name Runs only the benchmarks whose name contains it, e.g. send\n"
+            " -h   Shows this help\n", BENCH_ROUNDS);
+        return help ? 0 : 1;
+    }
+
+    const bench_t benches[] =
+    {
+        { "parse cstr",   "host",   run_parse_cstr,   false },
+        { "parse strict", "host",   run_parse_strict, false },
+        { "parse bulk",   "line",   run_parse_bulk,   false },
+        { "build scalar", "packet", run_build_scalar, false },
+        { "build vector", "packet", run_build_vector, false },
+        { "build many",   "packet", run_build_many,   false },
+        { "send single",  "packet", run_send_single,  true  },
+        { "send pooled",  "packet", run_send_pooled,  true  },
+        { "send batch",   "packet", run_send_batch,   true  },
+        { "send cached",  "packet", run_send_cached,  true  },
+    };
+
+    bench_state_t * state = calloc(1, sizeof(*state));
+    double * round_ns = malloc(rounds * sizeof(*round_ns));
+    int return_value = 1;
+
+    if(state && round_ns && bench_setup(state))
+    {
+#ifdef WAKE_ON_LAN_IO_URING
+        const char * backend = state->sender.uring ? "io_uring" : "sendmmsg, io_uring not available";
+#elif defined(__linux__)
+        const char * backend = "sendmmsg";
+#else
+        const char * backend = "sendto";
+#endif
+        printf("%" PRIu64 " rounds, send batch over %s, sink %s:%u\n", (uint64_t)rounds, backend, state->sink_ip, state->sink_port);
+        printf("%-14s %14s %10s %10s %10s %10s\n", "benchmark", "ops/s", "p50 ns", "p90 ns", "p99 ns", "max ns");
+
+        for(size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        {
+            if(NULL == filter || NULL != strstr(benches[i].name, filter))
+            {
+                bench_measure(state, &benches[i], rounds, round_ns);
+            }
+        }
+
+        printf("%" PRIu64 " packets received by the sink\n", (uint64_t)state->received);
+        return_value = 0;
+    }
+    else
+    {
+        printf("Error: the benchmark could not be set up\n");
+    }
+
+    if(state)
+    {
+        bench_teardown(state);
+    }
+    free(round_ns);
+    free(state);
+
+    return return_value;
+}
+
+static bool bench_setup(bench_state_t * state)
+{
+    state->sink = -1;
+    state->sender.sockfd = -1;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if(0 != WSAStartup(MAKEWORD(2, 2), &wsa))
+    {
+        return false;
+    }
+#endif
+
+    // The sink takes any free port of the loopback interface
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    socklen_t addr_length = sizeof(addr);
+    int buffer = BENCH_SINK_BUFFER;
+    state->sink = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(-1 == state->sink
+        || 0 != bind((int)state->sink, (const struct sockaddr *)&addr, sizeof(addr))
+        || 0 != getsockname((int)state->sink, (struct sockaddr *)&addr, &addr_length))
+    {
+        return false;
+    }
+    setsockopt((int)state->sink, SOL_SOCKET, SO_RCVBUF, (const char *)&buffer, sizeof(buffer));
+
+#ifdef _WIN32
+    u_long nonblocking = 1;
+    ioctlsocket((SOCKET)state->sink, FIONBIO, &nonblocking);
+#endif
+
+    state->sink_port = ntohs(addr.sin_port);
+    snprintf(state->sink_ip, sizeof(state->sink_ip), "127.0.0.1");
+
+    state->inventory = malloc(BENCH_HOSTS * 64);
+    state->packets = malloc(BENCH_HOSTS * WOL_PACKET_CACHE_STRIDE);
+    if(NULL == state->inventory || NULL == state->packets)
+    {
+        return false;
+    }
+
+    // The parse benchmarks see realistic addresses, the send benchmarks always the sink
+    state->inventory_length = 0;
+    for(size_t i = 0; i < BENCH_HOSTS; i++)
+    {
+        uint64_t mac = UINT64_C(0x020000000000) | (uint64_t)i * UINT64_C(0x9E3779B1) % UINT64_C(0x10000000000);
+        snprintf(state->ip[i], sizeof(state->ip[i]), "10.%u.%u.255", (unsigned)(i >> 8) & 0xFF, (unsigned)i & 0xFF);
+        snprintf(state->mac[i], sizeof(state->mac[i]), "%02X:%02X:%02X:%02X:%02X:%02X",
+            (unsigned)(mac >> 40) & 0xFF, (unsigned)(mac >> 32) & 0xFF, (unsigned)(mac >> 24) & 0xFF,
+            (unsigned)(mac >> 16) & 0xFF, (unsigned)(mac >> 8) & 0xFF, (unsigned)mac & 0xFF);
+        state->inventory_length += (size_t)snprintf(state->inventory + state->inventory_length, 64,
+            "%s %s %u\n", state->mac[i], state->ip[i], (unsigned)state->sink_port);
+
+        wol_target_init(&state->targets[i], INADDR_LOOPBACK, state->sink_port, mac);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != wol_packet_cache_init(&state->cache, BENCH_SEND_PACKETS))
+    {
+        return false;
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE == wake_on_lan_sender_open(&state->sender, NULL);
+}
+
+static void bench_teardown(bench_state_t * state)
+{
+    if(-1 != state->sender.sockfd)
+    {
+        wake_on_lan_sender_close(&state->sender, NULL);
+    }
+    wol_packet_cache_free(&state->cache);
+
+    if(-1 != state->sink)
+    {
+#ifdef _WIN32
+        closesocket((SOCKET)state->sink);
+#else
+        close((int)state->sink);
+#endif
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    free(state->packets);
+    free(state->inventory);
+}
+
+static void bench_drain(bench_state_t * state)
+{
+    char packet[WOL_PACKET_CACHE_STRIDE];
+
+#ifdef _WIN32
+    while(0 < recv((SOCKET)state->sink, packet, sizeof(packet), 0))
+#else
+    while(0 < recv((int)state->sink, packet, sizeof(packet), MSG_DONTWAIT))
+#endif
+    {
+        state->received++;
+    }
+}
+
+static void bench_measure(bench_state_t * state, const bench_t * bench, size_t rounds, double * round_ns)
+{
+    size_t operations = 0;
+    double total_ns = 0;
+
+    // One round outside the measurement warms the caches and the packet cache
+    bench->run(state);
+    if(bench->sends)
+    {
+        bench_drain(state);
+    }
+
+    for(size_t round = 0; round < rounds; round++)
+    {
+        uint64_t start_ns = wol_clock_ns();
+        size_t round_operations = bench->run(state);
+        uint64_t end_ns = wol_clock_ns();
+
+        if(bench->sends)
+        {
+            bench_drain(state);
+        }
+
+        operations += round_operations;
+        total_ns += (double)(end_ns - start_ns);
+        round_ns[round] = (double)(end_ns - start_ns) / (double)(round_operations ? round_operations : 1);
+    }
+
+    qsort(round_ns, rounds, sizeof(*round_ns), compare_double);
+
+    printf("%-14s %14.0f %10.1f %10.1f %10.1f %10.1f  per %s\n", bench->name,
+        (0 < total_ns) ? (double)operations * 1e9 / total_ns : 0.0,
+        round_ns[rounds / 2], round_ns[rounds * 9 / 10], round_ns[rounds * 99 / 100], round_ns[rounds - 1], bench->unit);
+    fflush(stdout);
+}
+
+static int compare_double(const void * a, const void * b)
+{
+    double value_a = *(const double *)a;
+    double value_b = *(const double *)b;
+
+    return (value_a < value_b) ? -1 : (value_a > value_b) ? 1 : 0;
+}
+
+static void build_scalar(uint8_t * packet, const uint8_t mac[6])
+{
+    for(size_t i = 0; i < 6; i++)
+    {
+        packet[i] = 0xFF;
+    }
+
+    for(size_t repetition = 0; repetition < 16; repetition++)
+    {
+        for(size_t i = 0; i < 6; i++)
+        {
+            packet[6 + 6 * repetition + i] = mac[i];
+        }
+    }
+}
+
+static size_t run_parse_cstr(bench_state_t * state)
+{
+    for(size_t i = 0; i < BENCH_HOSTS; i++)
+    {
+        wol_target_parse(&state->parsed[i], state->ip[i], state->sink_port, state->mac[i]);
+    }
+    return BENCH_HOSTS;
+}
+
+static size_t run_parse_strict(bench_state_t * state)
+{
+    for(size_t i = 0; i < BENCH_HOSTS; i++)
+    {
+        wol_parse_ip_v4(state->ip[i], strlen(state->ip[i]), &state->parsed[i].ip_v4);
+        wol_parse_mac(state->mac[i], strlen(state->mac[i]), state->parsed[i].mac);
+    }
+    return BENCH_HOSTS;
+}
+
+static size_t run_parse_bulk(bench_state_t * state)
+{
+    wol_parse_t parse = { 0 };
+    parse.targets = state->parsed;
+    parse.targets_capacity = BENCH_HOSTS;
+    parse.default_port = state->sink_port;
+
+    wol_parse_targets(&parse, state->inventory, state->inventory_length);
+
+    return parse.targets_count;
+}
+
+static size_t run_build_scalar(bench_state_t * state)
+{
+    for(size_t i = 0; i < BENCH_HOSTS; i++)
+    {
+        build_scalar(state->packets + i * WOL_PACKET_CACHE_STRIDE, state->targets[i].mac);
+    }
+    return BENCH_HOSTS;
+}
+
+static size_t run_build_vector(bench_state_t * state)
+{
+    for(size_t i = 0; i < BENCH_HOSTS; i++)
+    {
+        wol_packet_build(state->packets + i * WOL_PACKET_CACHE_STRIDE, state->targets[i].mac);
+    }
+    return BENCH_HOSTS;
+}
+
+static size_t run_build_many(bench_state_t * state)
+{
+    wol_packet_build_many(state->packets, WOL_PACKET_CACHE_STRIDE, state->targets, BENCH_HOSTS);
+    return BENCH_HOSTS;
+}
+
+static size_t run_send_single(bench_state_t * state)
+{
+    for(size_t i = 0; i < BENCH_SEND_PACKETS; i++)
+    {
+        wake_on_lan(NULL, state->sink_ip, state->sink_port, state->mac[i]);
+    }
+    return BENCH_SEND_PACKETS;
+}
+
+static size_t run_send_pooled(bench_state_t * state)
+{
+    for(size_t i = 0; i < BENCH_SEND_PACKETS; i++)
+    {
+        wake_on_lan_sender_send_target(&state->sender, NULL, &state->targets[i]);
+    }
+    return BENCH_SEND_PACKETS;
+}
+
+static size_t run_send_batch(bench_state_t * state)
+{
+    state->sender.cache = NULL;
+    wake_on_lan_batch(&state->sender, state->targets, BENCH_SEND_PACKETS, NULL);
+    return BENCH_SEND_PACKETS;
+}
+
+static size_t run_send_cached(bench_state_t * state)
+{
+    state->sender.cache = &state->cache;
+    wake_on_lan_batch(&state->sender, state->targets, BENCH_SEND_PACKETS, NULL);
+    state->sender.cache = NULL;
+    return BENCH_SEND_PACKETS;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -7,10 +7,18 @@
  *  private: include files
  *---------------------------------------------------------------------*/
 
+// @brief `sendmmsg()` is a GNU extension and must be requested before the first system header
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE
+#endif
+
 #include "wake_on_lan.h"
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // @brief Platform-specific includes and configuration for networking.
 // @details This block handles platform-specific headers and settings required for
@@ -19,6 +27,7 @@
 
   // Windows-specific headers and setup
   #include <winsock2.h>
+  #include <ws2tcpip.h>
 
   #ifdef _MSC_VER
     #pragma comment(lib, "ws2_32.lib")
@@ -28,13 +37,40 @@
 
   // POSIX headers for Linux/macOS
   #include <arpa/inet.h>
-//#include <sys/socket.h>
+  #include <net/if.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
 
   #include <errno.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <time.h>
   #include <unistd.h>
 
 #endif
 
+// @brief The io_uring backend is selected at build time with `-DWAKE_ON_LAN_IO_URING`, it uses the raw system calls and needs no liburing
+#if defined(__linux__) && defined(WAKE_ON_LAN_IO_URING)
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #define WAKE_ON_LAN_HAVE_IO_URING
+#endif
+
+// @brief The counters of wake_on_lan_sender_s::metrics are only updated if requested with `-DWAKE_ON_LAN_METRICS`
+#if defined(WAKE_ON_LAN_METRICS)
+  #include "wake_on_lan_metrics.h"
+#endif
+
+// @brief Wide stores for wol_packet_build() and wide compares for wol_results_count(), SSE2 on x86, NEON on ARM and 64-bit words otherwise
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && ( 2 <= _M_IX86_FP ) )
+  #include <emmintrin.h>
+  #define WOL_PACKET_BUILD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define WOL_PACKET_BUILD_NEON
+#endif
+
 
 /*---------------------------------------------------------------------*
  *  private: definitions
@@ -80,10 +116,64 @@
 #error The function strtoumax() can not handle the size of the datatype
 #endif
 
+//! @brief Marks a used slot in ::wol_packet_cache_s::keys, so that the MAC 00:00:00:00:00:00 can be cached too
+#define WOL_PACKET_CACHE_USED ( UINT64_C(1) << 48 )
+
+// @brief Linux can hand a whole chunk of a batch to the kernel with one `sendmmsg()` call.
+#if defined(__linux__)
+  #define WAKE_ON_LAN_HAVE_SENDMMSG
+#endif
+
+//! @brief Number of packets ::wake_on_lan_batch() builds on the stack and hands to the kernel at once
+#define WAKE_ON_LAN_BATCH_CHUNK 64
+
+//! @brief Bytes of one magic packet on the wire, Ethernet, IPv4 and UDP headers included, used for `SO_MAX_PACING_RATE`
+#define WAKE_ON_LAN_WIRE_SIZE ( 14 + 20 + 8 + WAKE_ON_LAN_PACKET_MAX_SIZE )
+
+//! @brief Nanoseconds per second
+#define NS_PER_SECOND UINT64_C(1000000000)
+
 
 /*---------------------------------------------------------------------*
  *  private: typedefs
  *---------------------------------------------------------------------*/
+
+//! @brief Destination of a target for `sendto()`/`sendmmsg()`, see sender_address()
+typedef union sender_address_u
+{
+    struct sockaddr_in v4;              //!< Destination of an IPv4 target
+    struct sockaddr_in6 v6;             //!< Destination of an IPv6 target
+} sender_address_t;
+
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+
+//! @brief State of the io_uring backend of a sender, see wake_on_lan_sender_s::uring
+typedef struct sender_uring_s
+{
+    int fd;                             //!< File descriptor of the ring
+    void * sq_ring;                     //!< Mapping of the submission ring
+    size_t sq_ring_size;                //!< Size of sender_uring_s::sq_ring
+    void * cq_ring;                     //!< Mapping of the completion ring, equal to sender_uring_s::sq_ring with `IORING_FEAT_SINGLE_MMAP`
+    size_t cq_ring_size;                //!< Size of sender_uring_s::cq_ring
+    struct io_uring_sqe * sqes;         //!< Mapping of the submission queue entries
+    size_t sqes_size;                   //!< Size of sender_uring_s::sqes
+    unsigned * sq_tail;                 //!< Tail of the submission ring, written by the sender
+    unsigned sq_mask;                   //!< Mask of the submission ring
+    unsigned * sq_array;                //!< Indices of the submitted entries
+    unsigned * cq_head;                 //!< Head of the completion ring, written by the sender
+    unsigned * cq_tail;                 //!< Tail of the completion ring, written by the kernel
+    unsigned cq_mask;                   //!< Mask of the completion ring
+    struct io_uring_cqe * cqes;         //!< Completion queue entries
+    bool registered;                    //!< Buffers are registered with the ring
+    bool paused;                        //!< The socket is non-blocking, the chunks take the socket path, see ::wake_on_lan_sender_set_nonblocking()
+    bool failed;                        //!< The completions of a chunk could not be awaited, the ring is not used again
+    const uint8_t * cache_packets;      //!< Packets of the registered cache as buffer 1, NULL if only the scratch buffer is registered
+    size_t cache_size;                  //!< Bytes registered at sender_uring_s::cache_packets
+    uint8_t scratch[WAKE_ON_LAN_BATCH_CHUNK][WOL_PACKET_CACHE_STRIDE]; //!< Registered buffer 0 for packets that are not in the cache
+    sender_address_t addr[WAKE_ON_LAN_BATCH_CHUNK];                     //!< Destinations of the chunk in flight
+} sender_uring_t;
+
+#endif
 /*---------------------------------------------------------------------*
  *  private: variables
  *---------------------------------------------------------------------*/
@@ -98,34 +188,61 @@
 //! @{
 
 //! @brief @ref wake_on_lan_error_messages
-static const char no_error[] = "Execution successful\n";
+static const char no_error[] = "Execution successful";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_1[] = "Unknown error";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_2[] = "Failed to convert IP";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_3[] = "Failed to parse hexadecimal MAC";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_4[] = "WSAStartup failed";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_5[] = "Could not find a usable version of Winsock.dll";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_6[] = "Socket creation failed";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_7[] = "Failed to set socket options";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_8[] = "Failed to send packet";
+
+//! @brief @ref wake_on_lan_error_messages
+static const char error_9[] = "Failed to close socket";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_1[] = "Unknown error\n";
+static const char error_10[] = "Failed to allocate memory";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_2[] = "Failed to convert IP\n";
+static const char error_11[] = "Failed to convert port";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_3[] = "Failed to parse hexadecimal MAC\n";
+static const char error_12[] = "Unexpected field in inventory line";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_4[] = "WSAStartup failed\n";
+static const char error_13[] = "Failed to read file";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_5[] = "Could not find a usable version of Winsock.dll\n";
+static const char error_14[] = "Invalid compiled inventory file";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_6[] = "Socket creation failed\n";
+static const char error_15[] = "Failed to bind socket";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_7[] = "Failed to set socket options\n";
+static const char error_16[] = "Sending would block, try again later";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_8[] = "Failed to send packet\n";
+static const char error_17[] = "Host did not answer in time";
 
 //! @brief @ref wake_on_lan_error_messages
-static const char error_9[] = "Failed to close socket\n";
+static const char error_18[] = "Failed to convert SecureOn password";
 
 //! @}
 
@@ -146,6 +263,15 @@ const char * wake_on_lan_errors[] =
     error_7,
     error_8,
     error_9,
+    error_10,
+    error_11,
+    error_12,
+    error_13,
+    error_14,
+    error_15,
+    error_16,
+    error_17,
+    error_18,
     NULL
 };
 
@@ -178,11 +304,207 @@ const char * wake_on_lan_errors[] =
 //! @return Upon successful completion, the function returns the internet address. Otherwise, it shall return INT64_C(-1).
 static int64_t ip_cstr_to_number(const char * ip, size_t sizeof_ip, int base);
 
+//! @brief Converts an IPv6 string with an optional scope into bytes
+//! @param ip IPv6 in the RFC 4291 text form, the scope follows a `%` as interface index or, under POSIX, as interface name
+//! @param[out] ip_v6 IPv6 address in network order
+//! @param[out] scope_id Interface index of the scope, 0 without scope
+//! @return True if the string is a valid IPv6 address other than `::`
+static bool ip_v6_cstr_to_bytes(const char * ip, uint8_t ip_v6[16], uint32_t * scope_id);
+
 //! @brief Converts the string pointed to by mac_cstr, in the standard hex format with or without colon notation, to an int64_t value
 //! @param mac_cstr MAC in the standard hex format with or without colon notation
 //! @return Upon successful completion, the function returns the MAC address. Otherwise, it shall return INT64_C(-1).
 static int64_t mac_cstr_to_number(const char * mac_cstr);
 
+//! @brief Computes 24 bytes of MAC repetitions, the MAC 4 times, as three 64-bit words in memory order
+//! @details 24 bytes is the smallest multiple of the 6 byte MAC that is also a multiple of 8 bytes.
+//! @param[out] pattern Three words, stored one after the other they give the bytes of 4 MACs
+//! @param mac MAC address, most significant byte first
+static inline void packet_pattern(uint64_t pattern[3], const uint8_t mac[6]);
+
+//! @brief Returns the packet for a target, from the cache of the sender if possible
+//! @param sender Pointer to a sender context, ::wake_on_lan_sender_s::cache may be NULL
+//! @param[out] scratch Buffer of ::WAKE_ON_LAN_PACKET_MAX_SIZE bytes, used if the packet is not cached
+//! @param target Pointer to the target
+//! @return Pointer to the cached packet or to `scratch`, ::wol_packet_size() bytes
+static const uint8_t * sender_packet(const wake_on_lan_sender_t * sender, uint8_t * scratch, const wol_target_t * target);
+
+//! @brief Key of a MAC in ::wol_packet_cache_s::keys
+//! @param mac MAC address, most significant byte first
+//! @param password_length Length of the password of the packet, packets of different lengths have different keys
+//! @return MAC address as number with ::WOL_PACKET_CACHE_USED and the password length above it set
+static uint64_t packet_cache_key(const uint8_t mac[6], uint8_t password_length);
+
+//! @brief Searches the hash slot of a key in a ::wol_packet_cache_t
+//! @param cache Pointer to the cache
+//! @param key Key from packet_cache_key()
+//! @return Index of the slot holding the key or of the free slot where it would be inserted
+static size_t packet_cache_probe(const wol_packet_cache_t * cache, uint64_t key);
+
+//! @brief Takes tokens from the token bucket of a paced sender, waits if there is none
+//! @details The bucket is implemented as the theoretical arrival time of the next packet,
+//!          tokens are the time the arrival time is behind the current time, limited to the burst.
+//! @param sender Pointer to a sender context
+//! @param wanted Number of packets the caller wants to send, at least 1
+//! @param[out] ready_at_ns NULL to sleep until a token is available, otherwise receives the time of the next token if there is none
+//! @return Number of packets that may be sent now, up to `wanted`, always `wanted` if the sender is not paced,
+//!         0 only if `ready_at_ns` is set and there is no token
+static size_t pacing_acquire(wake_on_lan_sender_t * sender, size_t wanted, uint64_t * ready_at_ns);
+
+//! @brief Gives back tokens of packets that were not sent
+//! @param sender Pointer to a sender context
+//! @param unused Number of tokens to give back
+static void pacing_release(wake_on_lan_sender_t * sender, size_t unused);
+
+//! @brief Sends up to ::WAKE_ON_LAN_BATCH_CHUNK targets with one `sendmmsg()` call or one `sendto()` per target
+//! @details A target that fails is recorded in its result and the rest is still sent. If the socket buffer
+//!          is full, the call stops before that target so that the caller can wait and continue.
+//! @param sender Pointer to an open sender context
+//! @param targets Array of `count` targets
+//! @param count Number of targets, at most ::WAKE_ON_LAN_BATCH_CHUNK
+//! @param[out] results Array of `count` results
+//! @param[out] would_block Set if the call stopped because the socket would block
+//! @return Number of targets with a result, the first targets of the array
+static size_t sender_send_chunk(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t count, wol_result_t * results, bool * would_block);
+
+//! @brief Sends a batch in chunks, see ::wake_on_lan_batch()
+//! @param sender Pointer to an open sender context
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param[out] results Array of `n` results, can be NULL
+//! @param[out] soa Results as structure of arrays, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, otherwise the error of a failed target
+static wake_on_lan_errors_t sender_batch(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t n, wol_result_t * results, wol_results_t * soa);
+
+//! @brief Counts one result code of ::wol_results_count()
+//! @param[in,out] counts Counts by error
+//! @param code Result code
+//! @return 1 if the code is an error, otherwise 0
+static inline size_t results_count_code(size_t * counts, uint8_t code);
+
+//! @brief Writes the text of an error of the system
+//! @param[out] buffer Buffer of the text, always terminated
+//! @param size Size of the buffer, not 0
+//! @param last_error Value of `WSAGetLastError()`/`GetLastError()`/`errno`
+static void format_system_error(char * buffer, size_t size, int last_error);
+
+//! @brief Sends a run of targets of one address family, see sender_send_chunk()
+//! @param sender Pointer to an open sender context
+//! @param targets Array of `count` targets, all IPv4 or all IPv6
+//! @param packet Array of `count` packets
+//! @param count Number of targets
+//! @param[out] results Array of `count` results
+//! @param[out] would_block Set if the call stopped because the socket would block or the device queue was full, see sender_backoff()
+//! @return Number of targets with a result, the first targets of the array
+static size_t sender_send_run(wake_on_lan_sender_t * sender, const wol_target_t * targets, const uint8_t * const * packet, size_t count, wol_result_t * results, bool * would_block);
+
+#if defined(WAKE_ON_LAN_METRICS)
+//! @brief Counts the results of one hand-over to the kernel in wake_on_lan_sender_s::metrics
+//! @param metrics Pointer to the block of the sender
+//! @param targets Array of the sent targets
+//! @param results Array of the results of the first `completed` targets
+//! @param completed Number of targets with a result
+//! @param would_block The socket was full
+//! @param elapsed_ns Time of the hand-over
+static void metrics_record(wol_metrics_t * metrics, const wol_target_t * targets, const wol_result_t * results, size_t completed, bool would_block, uint64_t elapsed_ns);
+#endif
+
+//! @brief Fills the destination of a target
+//! @param sender Pointer to an open sender context, its IPv6 interface is the scope of IPv6 targets without one
+//! @param target Pointer to the target
+//! @param[out] address Destination to fill
+//! @return Number of bytes of the destination for `sendto()`
+static int sender_address(const wake_on_lan_sender_t * sender, const wol_target_t * target, sender_address_t * address);
+
+//! @brief Socket of a sender for the address family of a target
+//! @param sender Pointer to an open sender context
+//! @param target Pointer to the target
+//! @return Descriptor of the socket, -1 if the sender has no IPv6 socket
+static intptr_t sender_socket(const wake_on_lan_sender_t * sender, const wol_target_t * target);
+
+//! @brief Waits until the sockets of a sender are writable
+//! @param sender Pointer to an open sender context
+static void sender_wait_writable(const wake_on_lan_sender_t * sender);
+
+//! @brief Grows the backoff of a sender after the device queue was full
+//! @details A full queue (`ENOBUFS`) is not reported by `poll()`, the socket stays writable, so the sender
+//!          waits wake_on_lan_sender_s::backoff_ns instead and tries the same packet again.
+//! @param sender Pointer to an open sender context
+//! @return True if the packet is tried again, false if the waits since the last accepted packet reached ::WOL_SENDER_BACKOFF_LIMIT_NS and the target fails
+static bool sender_backoff(wake_on_lan_sender_t * sender);
+
+//! @brief Checks whether a send error is a full device queue
+//! @param error Value of `WSAGetLastError()`/`errno`
+//! @return True for `WSAENOBUFS`/`ENOBUFS`
+static inline bool is_no_buffer(int error);
+
+//! @brief Sets an integer socket option
+//! @param sockfd Descriptor of the socket
+//! @param level Level of the option, e.g. `SOL_SOCKET`
+//! @param name Name of the option
+//! @param value Value of the option
+//! @return 0 or the value of `WSAGetLastError()`/`errno`
+static int socket_set_option(intptr_t sockfd, int level, int name, int value);
+
+//! @brief Waits until a socket is writable
+//! @param sockfd Descriptor of the socket, -1 returns at once
+static void socket_wait_writable(intptr_t sockfd);
+
+//! @brief Switches a socket between blocking and non-blocking mode
+//! @param sockfd Descriptor of the socket
+//! @param nonblocking True for non-blocking mode
+//! @return 0 or the value of `WSAGetLastError()`/`errno`
+static int socket_set_nonblocking(intptr_t sockfd, bool nonblocking);
+
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+
+//! @brief Sets up the io_uring backend of a sender
+//! @details Fails if the kernel has no io_uring, forbids it or does not support zero-copy sends
+//!          with registered buffers (`IORING_OP_SEND_ZC`, Linux 6.0), the sender uses the socket path then.
+//! @return Pointer to the new state or NULL
+static sender_uring_t * uring_open(void);
+
+//! @brief Releases the io_uring backend of a sender
+//! @param uring Pointer to the state, can be NULL
+static void uring_close(sender_uring_t * uring);
+
+//! @brief Registers the scratch buffer and the packets of a cache as fixed buffers
+//! @param uring Pointer to the state
+//! @param cache Pointer to the cache or NULL to register only the scratch buffer
+//! @return True if the scratch buffer is registered, the cache is left out if the kernel rejects it (e.g. `RLIMIT_MEMLOCK`)
+static bool uring_register(sender_uring_t * uring, const wol_packet_cache_t * cache);
+
+//! @brief Sends a chunk of targets through the ring, see sender_send_chunk()
+//! @details All packets are queued as zero-copy sends of registered buffers with one `io_uring_enter()` call,
+//!          the completions are reaped in batches. The call returns when every buffer is released by the kernel.
+//!          Sends that complete with `ENOBUFS` are queued again after the backoff of sender_backoff(), like on the socket path.
+//! @param sender Pointer to an open sender context with an io_uring backend
+//! @param targets Array of `count` targets
+//! @param count Number of targets, at most ::WAKE_ON_LAN_BATCH_CHUNK
+//! @param[out] results Array of `count` results, all of them are set if the call returns true
+//! @return True if the chunk was sent, false to take the socket path, only if no packet of the chunk was queued
+static bool uring_send_chunk(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t count, wol_result_t * results);
+
+#endif
+
+//! @brief Sends one prepared packet over the socket of an open sender context
+//! @param sender Pointer to an open sender context
+//! @param data Packet to send
+//! @param data_length Number of bytes in `data`
+//! @param target Pointer to the target, its address family selects the socket
+//! @param[out] result Receives the return value and the value of `WSAGetLastError()`/`errno`
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+static wake_on_lan_errors_t sender_sendto(const wake_on_lan_sender_t * sender, const uint8_t * data, size_t data_length, const wol_target_t * target, wol_result_t * result);
+
+//! @brief Opens a sender context like ::wake_on_lan_sender_open() with only the given parts
+//! @param[out] sender Pointer to the sender context
+//! @param ip_v4 Opens the IPv4 socket
+//! @param ip_v6 Opens the IPv6 socket, it is required if `ip_v4` is not set
+//! @param uring Sets up the io_uring backend if it is built in
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+static wake_on_lan_errors_t sender_open(wake_on_lan_sender_t * sender, bool ip_v4, bool ip_v6, bool uring, wake_on_lan_t * wol);
+
 
 /*---------------------------------------------------------------------*
  *  private: functions
@@ -222,6 +544,58 @@ static int64_t ip_cstr_to_number(const char * ip, size_t sizeof_ip, int base)
     return no;
 }
 
+static bool ip_v6_cstr_to_bytes(const char * ip, uint8_t ip_v6[16], uint32_t * scope_id)
+{
+    char address[INET6_ADDRSTRLEN + 1];
+    const char * scope = strchr(ip, '%');
+    size_t length = scope ? (size_t)(scope - ip) : strlen(ip);
+
+    if(sizeof(address) <= length)
+    {
+        return false;
+    }
+    memcpy(address, ip, length);
+    address[length] = '\0';
+
+    struct in6_addr in6;
+    if(1 != inet_pton(AF_INET6, address, &in6))
+    {
+        return false;
+    }
+    memcpy(ip_v6, &in6, 16);
+
+    *scope_id = 0;
+    if(scope && '\0' != scope[1])
+    {
+        char * endptr;
+        uintmax_t index = strtoumax(scope + 1, &endptr, 10);
+        if('\0' == *endptr && UINT32_MAX >= index)
+        {
+            *scope_id = (uint32_t)index;
+        }
+        else
+        {
+#ifdef _WIN32
+            return false;
+#else
+            *scope_id = if_nametoindex(scope + 1);
+            if(0 == *scope_id)
+            {
+                return false;
+            }
+#endif
+        }
+    }
+    else if(scope)
+    {
+        return false;
+    }
+
+    // The unspecified address marks IPv4 targets
+    static const uint8_t unspecified[16] = { 0 };
+    return 0 != memcmp(ip_v6, unspecified, sizeof(unspecified));
+}
+
 static int64_t mac_cstr_to_number(const char * mac_cstr)
 {
     int64_t no = 0;
@@ -257,257 +631,2179 @@ static int64_t mac_cstr_to_number(const char * mac_cstr)
     }
 }
 
-#if false
+static inline void packet_pattern(uint64_t pattern[3], const uint8_t mac[6])
+{
+#if ( defined(__BYTE_ORDER__) && ( __ORDER_LITTLE_ENDIAN__ == __BYTE_ORDER__ ) ) || defined(_WIN32)
+    // The first MAC byte is the lowest byte of the word, so shifting the word rotates the MAC in memory
+    uint64_t m = (uint64_t)mac[0]
+        | (uint64_t)mac[1] << 0x08
+        | (uint64_t)mac[2] << 0x10
+        | (uint64_t)mac[3] << 0x18
+        | (uint64_t)mac[4] << 0x20
+        | (uint64_t)mac[5] << 0x28;
+
+    pattern[0] = m | (m << 0x30);
+    pattern[1] = (m >> 0x10) | (m << 0x20);
+    pattern[2] = (m >> 0x20) | (m << 0x10);
+#else
+    uint8_t bytes[24];
+    for(size_t i = 0; i < sizeof(bytes); i += 6)
+    {
+        memcpy(bytes + i, mac, 6);
+    }
+    memcpy(pattern, bytes, sizeof(bytes));
+#endif
+}
 
-typedef struct hex_cstr_s
+static const uint8_t * sender_packet(const wake_on_lan_sender_t * sender, uint8_t * scratch, const wol_target_t * target)
 {
-    char cstr[4];
-} hex_cstr_t;
+    if(sender->cache)
+    {
+        const uint8_t * packet = wol_packet_cache_get_target(sender->cache, target);
+        if(packet)
+        {
+            return packet;
+        }
+    }
 
-static const char hex[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+    wol_packet_build_target(scratch, target);
+    return scratch;
+}
 
-static bool number_2_mac_cstr(int64_t number, char * mac_cstr, uint8_t sizeof_mac_cstr);
+static uint64_t packet_cache_key(const uint8_t mac[6], uint8_t password_length)
+{
+    uint64_t key = WOL_PACKET_CACHE_USED | (uint64_t)password_length << 49;
+    for(size_t i = 0; i < 6; i++)
+    {
+        key |= (uint64_t)mac[i] << (40 - 8 * i);
+    }
+    return key;
+}
 
-static bool number_2_mac_cstr(int64_t number, char * mac_cstr, uint8_t sizeof_mac_cstr)
+static size_t packet_cache_probe(const wol_packet_cache_t * cache, uint64_t key)
 {
-    int8_t i = 0;
+    // Fibonacci hashing, the upper bits of the product are the best mixed ones
+    size_t slot = (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> cache->shift);
 
-    if(NULL == mac_cstr)
+    // Linear probing, at most half of the slots are used so a free slot always ends the search
+    while(0 != cache->keys[slot] && key != cache->keys[slot])
     {
-        return false;
+        slot = (slot + 1) & cache->slot_mask;
     }
 
-    if(INT64_C(-1) == number || 13 > sizeof_mac_cstr)
+    return slot;
+}
+
+static size_t pacing_acquire(wake_on_lan_sender_t * sender, size_t wanted, uint64_t * ready_at_ns)
+{
+    if(0 == sender->pacing_interval_ns)
     {
-        for(i = 0; i < 13; i++)
+        return wanted;
+    }
+
+    const uint64_t interval = sender->pacing_interval_ns;
+    const uint64_t window = sender->pacing_burst * interval;
+
+    uint64_t now = wol_clock_ns();
+    if(sender->pacing_tat_ns + window < now)
+    {
+        // An idle sender collects at most one burst of tokens
+        sender->pacing_tat_ns = (now > window) ? now - window : 0;
+    }
+
+    if(sender->pacing_tat_ns + interval > now + window)
+    {
+        if(ready_at_ns)
         {
-            mac_cstr[i] = '\0';
+            *ready_at_ns = sender->pacing_tat_ns + interval - window;
+            return 0;
         }
 
-        return false;
+        wol_sleep_until_ns(sender->pacing_tat_ns + interval - window);
+        now = wol_clock_ns();
     }
 
-    for(i = 11; i >= 0; i--)
+    size_t available = (size_t)((now + window - sender->pacing_tat_ns) / interval);
+    if(available > wanted)
     {
-        mac_cstr[i] = hex[number & 0x0F];
-        number >>= 4;
+        available = wanted;
+    }
+    if(0 == available)
+    {
+        available = 1;
     }
-    mac_cstr[12] = '\0';
 
-    return true;
+    sender->pacing_tat_ns += available * interval;
+
+    return available;
 }
 
-// the low byte contains the high nibble hex ascii character of the number
-// the high byte contains the low nibble hex ascii character of the number
-hex_cstr_t number_2_hex_cstr_t(uint8_t number)
+static void pacing_release(wake_on_lan_sender_t * sender, size_t unused)
 {
-    hex_cstr_t hex_cstr;
-    hex_cstr.cstr[0] = hex[( number >> 4 ) & 0x0F];
-    hex_cstr.cstr[1] = hex[( number >> 0 ) & 0x0F];
-    hex_cstr.cstr[2] = '\0';
-    hex_cstr.cstr[3] = number;
-    return hex_cstr;
+    sender->pacing_tat_ns -= unused * sender->pacing_interval_ns;
 }
 
-#endif
+static size_t sender_send_chunk(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t count, wol_result_t * results, bool * would_block)
+{
+    *would_block = false;
 
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+    if(sender->uring && uring_send_chunk(sender, targets, count, results))
+    {
+        return count;
+    }
+#endif
 
-/*---------------------------------------------------------------------*
- *  public:  functions
- *---------------------------------------------------------------------*/
+    uint8_t data[WAKE_ON_LAN_BATCH_CHUNK][WAKE_ON_LAN_PACKET_MAX_SIZE];
+    const uint8_t * packet[WAKE_ON_LAN_BATCH_CHUNK];
 
-wake_on_lan_errors_t wake_on_lan(wake_on_lan_t * wol, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr)
-{
-    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+    for(size_t i = 0; i < count; i++)
+    {
+        packet[i] = sender_packet(sender, data[i], &targets[i]);
+    }
 
-    uint8_t data[6 * ( 1 + 16 )];
-    data[0] = 0xFF;
-    data[1] = 0xFF;
-    data[2] = 0xFF;
-    data[3] = 0xFF;
-    data[4] = 0xFF;
-    data[5] = 0xFF;
+    // IPv4 and IPv6 targets go through different sockets, each run of one family is sent at once
+    size_t done = 0;
+    while(done < count && !*would_block)
+    {
+        size_t run = 1;
+        while(done + run < count && wol_target_is_v6(&targets[done]) == wol_target_is_v6(&targets[done + run]))
+        {
+            run++;
+        }
 
+        done += sender_send_run(sender, targets + done, packet + done, run, results + done, would_block);
+    }
 
-#ifdef _WIN32
-    SOCKET sockfd = INVALID_SOCKET;
-#else
-    int sockfd = -1;
-#endif
+    return done;
+}
 
-    do{
+#if defined(WAKE_ON_LAN_METRICS)
+static void metrics_record(wol_metrics_t * metrics, const wol_target_t * targets, const wol_result_t * results, size_t completed, bool would_block, uint64_t elapsed_ns)
+{
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
 
-        int64_t ip_v4;
-        ip_v4 = ip_cstr_to_number(ip_v4_cstr, 13, 0);
-        if(INT64_C(-1) == ip_v4)
+    for(size_t i = 0; i < completed; i++)
+    {
+        if(WAKE_ON_LAN_ERRORS_NONE == results[i].return_value)
         {
-            return_value = WAKE_ON_LAN_ERRORS_IP;
-            if(wol) { wol->last_error = -1; }
-            break;
+            packets++;
+            bytes += wol_packet_size(&targets[i]);
+        }
+        else
+        {
+            wol_metrics_error(metrics, results[i].return_value);
         }
-        if(wol) { wol->ip_v4 = (uint32_t)ip_v4; }
+    }
+
+    wol_metrics_add(&metrics->packets, packets);
+    wol_metrics_add(&metrics->bytes, bytes);
+    if(would_block)
+    {
+        wol_metrics_add(&metrics->again, 1);
+    }
+    wol_histogram_record(&metrics->send_ns, elapsed_ns);
+}
+#endif
 
-        int64_t mac = mac_cstr_to_number(mac_cstr);
-        if(INT64_C(-1) == mac)
+static size_t sender_send_run(wake_on_lan_sender_t * sender, const wol_target_t * targets, const uint8_t * const * packet, size_t count, wol_result_t * results, bool * would_block)
+{
+    if(-1 == sender_socket(sender, targets))
+    {
+        for(size_t i = 0; i < count; i++)
         {
-            return_value = WAKE_ON_LAN_ERRORS_MAC;
-            if(wol) { wol->last_error = -1; }
-            break;
+            results[i].return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+            results[i].last_error = -1;
         }
-        if(wol) { wol->mac = mac; }
+        return count;
+    }
 
+#ifdef WAKE_ON_LAN_HAVE_SENDMMSG
+    sender_address_t addr[WAKE_ON_LAN_BATCH_CHUNK];
+    struct iovec iov[WAKE_ON_LAN_BATCH_CHUNK];
+    struct mmsghdr msgs[WAKE_ON_LAN_BATCH_CHUNK];
 
-#ifdef _WIN32
-        // Initialize Winsock
-        WSADATA wsaData;
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for(size_t i = 0; i < count; i++)
+    {
+        iov[i].iov_base = (void *)packet[i];
+        iov[i].iov_len = wol_packet_size(&targets[i]);
 
-        // Use the MAKEWORD(lowbyte, highbyte) macro declared in Windef.h
-        // The highest version of Windows Sockets specification that the caller can use.
-        // The high-order byte specifies the minor version number; the low-order byte specifies the major version number.
-        uint8_t major = 2;
-        uint8_t minor = 2;
-        WORD wVersionRequested = MAKEWORD(major, minor);
+        msgs[i].msg_hdr.msg_name = &addr[i];
+        msgs[i].msg_hdr.msg_namelen = (socklen_t)sender_address(sender, &targets[i], &addr[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
+    int sockfd = (int)sender_socket(sender, targets);
 
-        int wsa_startup_result = WSAStartup(wVersionRequested, &wsaData);
-        if (0 != wsa_startup_result) {
-            return_value = WAKE_ON_LAN_ERRORS_WSA_STARTUP;
-            if(wol) { wol->last_error = WSAGetLastError(); }
-            break;
+    // sendmmsg() stops at the first message that fails and reports the number sent so far,
+    // the failing message is then reported with errno by the next call
+    size_t sent = 0;
+    while(sent < count)
+    {
+        int sendmmsg_result = sendmmsg(sockfd, &msgs[sent], (unsigned int)(count - sent), 0);
+        if(0 < sendmmsg_result)
+        {
+            for(int i = 0; i < sendmmsg_result; i++)
+            {
+                results[sent + i].return_value = WAKE_ON_LAN_ERRORS_NONE;
+                results[sent + i].last_error = 0;
+            }
+            sent += (size_t)sendmmsg_result;
+            sender->backoff_ns = 0;
+            sender->backoff_waited_ns = 0;
         }
-
-        // Confirm that the WinSock DLL supports 2.2.
-        // Note that if the DLL supports versions greater than 2.2
-        // in addition to 2.2, it will still return 2.2 in wVersion
-        // since that is the version we requested.
-        uint8_t available_major = LOBYTE(wsaData.wVersion);
-        uint8_t available_minor = HIBYTE(wsaData.wVersion);
-        if ( available_major != major || available_minor != minor)
+        else if(0 > sendmmsg_result && EINTR == errno)
         {
-            return_value = WAKE_ON_LAN_ERRORS_WINSOCK;
-            if(wol) { wol->last_error = available_major << 8 | available_minor; }
-            break;
+            continue;
         }
-#endif
-
-
-        // AF_INET    : The Internet Protocol version 4 (IPv4) address family.
-        // SOCK_DGRAM : A socket type that supports datagrams, which are connectionless,
-        //              unreliable buffers of a fixed (typically small) maximum length.
-        //              This socket type uses the User Datagram Protocol (UDP) for the
-        //              Internet address family (AF_INET or AF_INET6).
-        // IPPROTO_UDP: The User Datagram Protocol (UDP). This is a possible value when
-        //              the af parameter is AF_INET or AF_INET6 and the type parameter
-        //              is SOCK_DGRAM.
-        sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-
-#ifdef _WIN32
-        if (INVALID_SOCKET == sockfd)
+        else if(0 > sendmmsg_result && (EAGAIN == errno || EWOULDBLOCK == errno))
         {
-            return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
-            if(wol) { wol->last_error = WSAGetLastError(); }
+            sender->backoff_ns = 0;
+            *would_block = true;
             break;
         }
-#else
-        if (0 > sockfd)
+        else if(0 > sendmmsg_result && is_no_buffer(errno) && sender_backoff(sender))
         {
-            return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
-            if(wol) { wol->last_error = errno; }
+            *would_block = true;
             break;
         }
-#endif
-
-
-
-        char mac5 = GET_BYTE_5(mac);
-        char mac4 = GET_BYTE_4(mac);
-        char mac3 = GET_BYTE_3(mac);
-        char mac2 = GET_BYTE_2(mac);
-        char mac1 = GET_BYTE_1(mac);
-        char mac0 = GET_BYTE_0(mac);
-
-        char index;
-        for(size_t i = 1; i <= 16; i++)
+        else
         {
-            index = i * 6;
-            data[index+0] = mac5;
-            data[index+1] = mac4;
-            data[index+2] = mac3;
-            data[index+3] = mac2;
-            data[index+4] = mac1;
-            data[index+5] = mac0;
+            results[sent].return_value = WAKE_ON_LAN_ERRORS_SEND;
+            results[sent].last_error = (0 > sendmmsg_result) ? errno : -1;
+            sent++;
         }
+    }
 
-        // Set socket options.
-        const int optval = 1;
-
-#ifdef _WIN32
-        if (SOCKET_ERROR == setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, (const char *)(&optval), sizeof(optval)))
-        {
-            return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
-            if(wol) { wol->last_error = WSAGetLastError(); }
-            break;
-        }
+    return sent;
 #else
-        if (0 > setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, (const char *)(&optval), sizeof(optval)))
+    for(size_t i = 0; i < count; i++)
+    {
+        if(WAKE_ON_LAN_ERRORS_NONE == sender_sendto(sender, packet[i], wol_packet_size(&targets[i]), &targets[i], &results[i]))
         {
-            return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
-            if(wol) { wol->last_error = errno; }
-            break;
+            sender->backoff_ns = 0;
+            sender->backoff_waited_ns = 0;
+            continue;
         }
-#endif
-
 
 #ifdef _WIN32
-        int sendto_result = SOCKET_ERROR;
+        if(WSAEWOULDBLOCK == results[i].last_error)
 #else
-        int sendto_result = -1;
+        if(EAGAIN == results[i].last_error || EWOULDBLOCK == results[i].last_error)
 #endif
-
-        struct sockaddr_in addr = { 0 };
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = htonl(ip_v4);
-        addr.sin_port = htons(port);
-
-        size_t data_length = sizeof(data);
-        sendto_result = sendto(sockfd, (const char *) data, data_length, 0,
-            (struct sockaddr*)(&addr), sizeof(addr));
-
-#ifdef _WIN32
-        if (SOCKET_ERROR == sendto_result) {
-            return_value = WAKE_ON_LAN_ERRORS_SEND;
-            if(wol) { wol->last_error = WSAGetLastError(); }
-            break;
+        {
+            sender->backoff_ns = 0;
+            *would_block = true;
+            return i;
         }
-#else
-        if (0 > sendto_result) {
-            return_value = WAKE_ON_LAN_ERRORS_SEND;
-            if(wol) { wol->last_error = sendto_result; }
-            break;
+        if(is_no_buffer(results[i].last_error) && sender_backoff(sender))
+        {
+            *would_block = true;
+            return i;
         }
+    }
+
+    return count;
 #endif
+}
 
-        return_value = WAKE_ON_LAN_ERRORS_NONE;
+static int sender_address(const wake_on_lan_sender_t * sender, const wol_target_t * target, sender_address_t * address)
+{
+    memset(address, 0, sizeof(*address));
 
-    }while(0);
+    if(wol_target_is_v6(target))
+    {
+        address->v6.sin6_family = AF_INET6;
+        memcpy(&address->v6.sin6_addr, target->ip_v6, sizeof(target->ip_v6));
+        address->v6.sin6_port = htons(target->port);
+        address->v6.sin6_scope_id = target->scope_id ? target->scope_id : sender->ip_v6_interface;
+        return (int)sizeof(address->v6);
+    }
 
+    address->v4.sin_family = AF_INET;
+    address->v4.sin_addr.s_addr = htonl(target->ip_v4);
+    address->v4.sin_port = htons(target->port);
+    return (int)sizeof(address->v4);
+}
 
-#ifdef _WIN32
-    if(INVALID_SOCKET != sockfd)
-    {
-        int closesocket_result = closesocket(sockfd);
-        if (SOCKET_ERROR == closesocket_result) {
+static intptr_t sender_socket(const wake_on_lan_sender_t * sender, const wol_target_t * target)
+{
+    return wol_target_is_v6(target) ? sender->sockfd_v6 : sender->sockfd;
+}
+
+static void sender_wait_writable(const wake_on_lan_sender_t * sender)
+{
+    socket_wait_writable(sender->sockfd);
+    socket_wait_writable(sender->sockfd_v6);
+}
+
+static wake_on_lan_errors_t sender_batch(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t n, wol_result_t * results, wol_results_t * soa)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    wol_result_t chunk_results[WAKE_ON_LAN_BATCH_CHUNK];
+
+#if defined(WAKE_ON_LAN_METRICS)
+    uint64_t batch_start_ns = sender->metrics ? wol_clock_ns() : 0;
+#endif
+
+    for(size_t done = 0; done < n; )
+    {
+        size_t count = n - done;
+        if(WAKE_ON_LAN_BATCH_CHUNK < count)
+        {
+            count = WAKE_ON_LAN_BATCH_CHUNK;
+        }
+
+        // A paced sender hands smaller chunks to the kernel, as many as the bucket allows
+        count = pacing_acquire(sender, count, NULL);
+
+        wol_result_t * result = results ? results + done : chunk_results;
+        bool would_block = false;
+
+#if defined(WAKE_ON_LAN_METRICS)
+        uint64_t start_ns = sender->metrics ? wol_clock_ns() : 0;
+#endif
+
+        size_t completed = sender_send_chunk(sender, targets + done, count, result, &would_block);
+
+#if defined(WAKE_ON_LAN_METRICS)
+        if(sender->metrics)
+        {
+            metrics_record(sender->metrics, targets + done, result, completed, would_block, wol_clock_ns() - start_ns);
+        }
+#endif
+
+        for(size_t i = 0; i < completed; i++)
+        {
+            if(WAKE_ON_LAN_ERRORS_NONE != result[i].return_value)
+            {
+                return_value = result[i].return_value;
+            }
+        }
+        for(size_t i = 0; soa && i < completed; i++)
+        {
+            soa->codes[done + i] = (uint8_t)result[i].return_value;
+            if(soa->errors) { soa->errors[done + i] = result[i].last_error; }
+        }
+        done += completed;
+
+        if(would_block)
+        {
+            // A non-blocking sender is waited for here, the unsent packets give back their tokens.
+            // A full device queue leaves the socket writable, it is waited out with the backoff.
+            pacing_release(sender, count - completed);
+            if(0 != sender->backoff_ns)
+            {
+                wol_sleep_until_ns(wol_clock_ns() + sender->backoff_ns);
+            }
+            else
+            {
+                sender_wait_writable(sender);
+            }
+        }
+    }
+
+#if defined(WAKE_ON_LAN_METRICS)
+    if(sender->metrics)
+    {
+        wol_histogram_record(&sender->metrics->batch_ns, wol_clock_ns() - batch_start_ns);
+    }
+#endif
+
+    return return_value;
+}
+
+static bool sender_backoff(wake_on_lan_sender_t * sender)
+{
+    if(WOL_SENDER_BACKOFF_LIMIT_NS <= sender->backoff_waited_ns)
+    {
+        // The queue did not drain in time, e.g. the link is down, the following targets fail
+        // without waiting until a packet is accepted again
+        sender->backoff_ns = 0;
+        return false;
+    }
+
+    sender->backoff_ns = (0 == sender->backoff_ns) ? WOL_SENDER_BACKOFF_MIN_NS : 2 * sender->backoff_ns;
+    if(WOL_SENDER_BACKOFF_MAX_NS < sender->backoff_ns)
+    {
+        sender->backoff_ns = WOL_SENDER_BACKOFF_MAX_NS;
+    }
+    sender->backoff_waited_ns += sender->backoff_ns;
+
+    return true;
+}
+
+static inline bool is_no_buffer(int error)
+{
+#ifdef _WIN32
+    return WSAENOBUFS == error;
+#else
+    return ENOBUFS == error;
+#endif
+}
+
+static int socket_set_option(intptr_t sockfd, int level, int name, int value)
+{
+#ifdef _WIN32
+    if (SOCKET_ERROR == setsockopt((SOCKET)sockfd, level, name, (const char *)(&value), sizeof(value)))
+    {
+        return WSAGetLastError();
+    }
+#else
+    if (0 > setsockopt((int)sockfd, level, name, (const char *)(&value), sizeof(value)))
+    {
+        return errno;
+    }
+#endif
+
+    return 0;
+}
+
+static inline size_t results_count_code(size_t * counts, uint8_t code)
+{
+    counts[(WAKE_ON_LAN_ERRORS_COUNT > code) ? code : WAKE_ON_LAN_ERRORS_UNKNOWN]++;
+    return (WAKE_ON_LAN_ERRORS_NONE != code) ? 1 : 0;
+}
+
+static void format_system_error(char * buffer, size_t size, int last_error)
+{
+    buffer[0] = '\0';
+
+#ifdef _WIN32
+    DWORD length = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, (DWORD)last_error,
+        0, buffer, (DWORD)size, NULL);
+    // The messages of the system end with a line break and often a period
+    while(0 < length && ('\r' == buffer[length - 1] || '\n' == buffer[length - 1] || '.' == buffer[length - 1] || ' ' == buffer[length - 1]))
+    {
+        buffer[--length] = '\0';
+    }
+#elif defined(__GLIBC__) && defined(_GNU_SOURCE)
+    // The GNU variant returns a pointer, either to a static string or to the buffer
+    const char * text = strerror_r(last_error, buffer, size);
+    if(text != buffer)
+    {
+        strncpy(buffer, text, size - 1);
+        buffer[size - 1] = '\0';
+    }
+#else
+    if(0 != strerror_r(last_error, buffer, size))
+    {
+        buffer[0] = '\0';
+    }
+#endif
+}
+
+static void socket_wait_writable(intptr_t sockfd)
+{
+    if(-1 == sockfd)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET((SOCKET)sockfd, &writable);
+    select(0, NULL, &writable, NULL, NULL);
+#else
+    struct pollfd descriptor;
+    descriptor.fd = (int)sockfd;
+    descriptor.events = POLLOUT;
+    descriptor.revents = 0;
+    while(0 > poll(&descriptor, 1, -1) && EINTR == errno)
+    {
+    }
+#endif
+}
+
+static int socket_set_nonblocking(intptr_t sockfd, bool nonblocking)
+{
+#ifdef _WIN32
+    u_long mode = nonblocking ? 1 : 0;
+    if (SOCKET_ERROR == ioctlsocket((SOCKET)sockfd, FIONBIO, &mode))
+    {
+        return WSAGetLastError();
+    }
+#else
+    int flags = fcntl((int)sockfd, F_GETFL, 0);
+    if (0 > flags)
+    {
+        return errno;
+    }
+
+    flags = nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (0 > fcntl((int)sockfd, F_SETFL, flags))
+    {
+        return errno;
+    }
+#endif
+
+    return 0;
+}
+
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+
+static sender_uring_t * uring_open(void)
+{
+    sender_uring_t * uring = calloc(1, sizeof(*uring));
+    if(NULL == uring)
+    {
+        return NULL;
+    }
+
+    uring->fd = -1;
+    uring->sq_ring = MAP_FAILED;
+    uring->cq_ring = MAP_FAILED;
+    uring->sqes = MAP_FAILED;
+
+    do{
+
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+
+        uring->fd = (int)syscall(__NR_io_uring_setup, WAKE_ON_LAN_BATCH_CHUNK, &params);
+        if(0 > uring->fd)
+        {
+            break;
+        }
+
+        uring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        uring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            if(uring->cq_ring_size > uring->sq_ring_size)
+            {
+                uring->sq_ring_size = uring->cq_ring_size;
+            }
+            uring->cq_ring_size = uring->sq_ring_size;
+        }
+
+        uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+        if(MAP_FAILED == uring->sq_ring)
+        {
+            break;
+        }
+
+        if(params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            uring->cq_ring = uring->sq_ring;
+        }
+        else
+        {
+            uring->cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+            if(MAP_FAILED == uring->cq_ring)
+            {
+                break;
+            }
+        }
+
+        uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+        if(MAP_FAILED == uring->sqes)
+        {
+            break;
+        }
+
+        uint8_t * sq = uring->sq_ring;
+        uint8_t * cq = uring->cq_ring;
+        uring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+        uring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+        uring->sq_array = (unsigned *)(sq + params.sq_off.array);
+        uring->cq_head = (unsigned *)(cq + params.cq_off.head);
+        uring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+        uring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+        uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+        // Zero-copy sends of registered buffers exist since Linux 6.0, older kernels take the socket path
+        size_t probe_size = sizeof(struct io_uring_probe) + (IORING_OP_SEND_ZC + 1) * sizeof(struct io_uring_probe_op);
+        struct io_uring_probe * probe = calloc(1, probe_size);
+        if(NULL == probe)
+        {
+            break;
+        }
+
+        bool supported = 0 == syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_PROBE, probe, IORING_OP_SEND_ZC + 1)
+                      && IORING_OP_SEND_ZC <= probe->last_op
+                      && (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+        free(probe);
+
+        if(!supported || !uring_register(uring, NULL))
+        {
+            break;
+        }
+
+        return uring;
+
+    }while(0);
+
+    uring_close(uring);
+
+    return NULL;
+}
+
+static void uring_close(sender_uring_t * uring)
+{
+    if(NULL == uring)
+    {
+        return;
+    }
+
+    if(MAP_FAILED != uring->sqes)
+    {
+        munmap(uring->sqes, uring->sqes_size);
+    }
+    if(MAP_FAILED != uring->cq_ring && uring->cq_ring != uring->sq_ring)
+    {
+        munmap(uring->cq_ring, uring->cq_ring_size);
+    }
+    if(MAP_FAILED != uring->sq_ring)
+    {
+        munmap(uring->sq_ring, uring->sq_ring_size);
+    }
+    if(0 <= uring->fd)
+    {
+        close(uring->fd);
+    }
+
+    free(uring);
+}
+
+static bool uring_register(sender_uring_t * uring, const wol_packet_cache_t * cache)
+{
+    struct iovec buffers[2];
+    buffers[0].iov_base = uring->scratch;
+    buffers[0].iov_len = sizeof(uring->scratch);
+
+    // The kernel only knows one set of buffers per ring
+    if(uring->registered)
+    {
+        syscall(__NR_io_uring_register, uring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    }
+
+    uring->registered = false;
+    uring->cache_packets = NULL;
+    uring->cache_size = 0;
+
+    if(cache && cache->packets)
+    {
+        buffers[1].iov_base = cache->packets;
+        buffers[1].iov_len = cache->capacity * WOL_PACKET_CACHE_STRIDE;
+
+        if(0 == syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_BUFFERS, buffers, 2))
+        {
+            uring->registered = true;
+            uring->cache_packets = cache->packets;
+            uring->cache_size = buffers[1].iov_len;
+            return true;
+        }
+    }
+
+    uring->registered = 0 == syscall(__NR_io_uring_register, uring->fd, IORING_REGISTER_BUFFERS, buffers, 1);
+
+    return uring->registered;
+}
+
+static bool uring_send_chunk(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t count, wol_result_t * results)
+{
+    sender_uring_t * uring = sender->uring;
+
+    if(uring->paused || uring->failed)
+    {
+        return false;
+    }
+
+    // A new or reallocated cache is registered once, before its first chunk
+    const uint8_t * cache_packets = sender->cache ? sender->cache->packets : NULL;
+    size_t cache_size = sender->cache ? sender->cache->capacity * WOL_PACKET_CACHE_STRIDE : 0;
+    if(cache_packets != uring->cache_packets || cache_size != uring->cache_size)
+    {
+        if(!uring_register(uring, sender->cache))
+        {
+            return false;
+        }
+    }
+
+    // IPv6 targets of a sender without IPv6 socket get their error from the socket path
+    for(size_t i = 0; i < count; i++)
+    {
+        if(-1 == sender_socket(sender, &targets[i]))
+        {
+            return false;
+        }
+    }
+
+    const uint8_t * packet[WAKE_ON_LAN_BATCH_CHUNK];
+    uint16_t buffer[WAKE_ON_LAN_BATCH_CHUNK];
+    uint16_t addr_length[WAKE_ON_LAN_BATCH_CHUNK];
+    size_t queue[WAKE_ON_LAN_BATCH_CHUNK];
+    size_t no_buffer[WAKE_ON_LAN_BATCH_CHUNK];
+
+    for(size_t i = 0; i < count; i++)
+    {
+        packet[i] = NULL;
+        buffer[i] = 0;
+
+        if(uring->cache_packets)
+        {
+            packet[i] = wol_packet_cache_get_target(sender->cache, &targets[i]);
+            buffer[i] = 1;
+        }
+        if(NULL == packet[i])
+        {
+            wol_packet_build_target(uring->scratch[i], &targets[i]);
+            packet[i] = uring->scratch[i];
+            buffer[i] = 0;
+        }
+
+        addr_length[i] = (uint16_t)sender_address(sender, &targets[i], &uring->addr[i]);
+        queue[i] = i;
+    }
+
+    // The buffers stay untouched until their notifications, so a send refused with ENOBUFS is queued again as it is
+    size_t queued = count;
+    bool first_round = true;
+    while(0 != queued)
+    {
+        unsigned tail = *uring->sq_tail;
+        for(size_t k = 0; k < queued; k++)
+        {
+            size_t i = queue[k];
+
+            unsigned index = tail & uring->sq_mask;
+            struct io_uring_sqe * sqe = &uring->sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_SEND_ZC;
+            sqe->fd = (int)sender_socket(sender, &targets[i]);
+            sqe->addr = (uint64_t)(uintptr_t)packet[i];
+            sqe->len = (uint32_t)wol_packet_size(&targets[i]);
+            sqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+            sqe->buf_index = buffer[i];
+            sqe->addr2 = (uint64_t)(uintptr_t)&uring->addr[i];
+            sqe->addr_len = addr_length[i];
+            sqe->user_data = i;
+
+            uring->sq_array[index] = index;
+            tail++;
+
+            // Marks the target as waiting for its completion
+            results[i].return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+            results[i].last_error = -1;
+        }
+        __atomic_store_n(uring->sq_tail, tail, __ATOMIC_RELEASE);
+
+        // Every send completes with its result and, while the kernel still holds the buffer, a later notification
+        unsigned to_submit = (unsigned)queued;
+        size_t pending_results = queued;
+        size_t pending_notifications = 0;
+        size_t refused = 0;
+        bool accepted = false;
+
+        while(0 != to_submit || 0 != pending_results || 0 != pending_notifications)
+        {
+            long entered = syscall(__NR_io_uring_enter, uring->fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if(0 > entered)
+            {
+                int error = errno;
+                if(EINTR == error)
+                {
+                    continue;
+                }
+
+                if(0 != to_submit)
+                {
+                    // The entries the kernel did not take are withdrawn
+                    __atomic_store_n(uring->sq_tail, *uring->sq_tail - to_submit, __ATOMIC_RELEASE);
+                    if(first_round && count == to_submit)
+                    {
+                        // Nothing was queued, the socket path sends the chunk
+                        return false;
+                    }
+
+                    // The queued sends are still awaited, the withdrawn ones fail
+                    for(size_t k = queued - to_submit; k < queued; k++)
+                    {
+                        results[queue[k]].return_value = WAKE_ON_LAN_ERRORS_SEND;
+                        results[queue[k]].last_error = error;
+                    }
+                    pending_results -= to_submit;
+                    to_submit = 0;
+                    continue;
+                }
+
+                // The completions can not be awaited, they would be taken for the ones of a later chunk and the
+                // kernel may still read the buffers, so the ring is given up and the waiting targets fail
+                uring->failed = true;
+                for(size_t k = 0; k < queued; k++)
+                {
+                    if(WAKE_ON_LAN_ERRORS_UNKNOWN == results[queue[k]].return_value)
+                    {
+                        results[queue[k]].return_value = WAKE_ON_LAN_ERRORS_SEND;
+                        results[queue[k]].last_error = error;
+                    }
+                }
+                for(size_t k = 0; k < refused; k++)
+                {
+                    results[no_buffer[k]].return_value = WAKE_ON_LAN_ERRORS_SEND;
+                    results[no_buffer[k]].last_error = ENOBUFS;
+                }
+                return true;
+            }
+            to_submit -= (unsigned)entered;
+
+            unsigned head = *uring->cq_head;
+            unsigned cq_tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+            for(; head != cq_tail; head++)
+            {
+                const struct io_uring_cqe * cqe = &uring->cqes[head & uring->cq_mask];
+                if(cqe->flags & IORING_CQE_F_NOTIF)
+                {
+                    pending_notifications--;
+                    continue;
+                }
+
+                if(-ENOBUFS == cqe->res)
+                {
+                    // The result is set once the backoff gives up, the target still waits until then
+                    no_buffer[refused++] = (size_t)cqe->user_data;
+                }
+                else
+                {
+                    wol_result_t * result = &results[cqe->user_data];
+                    result->return_value = (0 > cqe->res) ? WAKE_ON_LAN_ERRORS_SEND : WAKE_ON_LAN_ERRORS_NONE;
+                    result->last_error = (0 > cqe->res) ? -cqe->res : 0;
+                    accepted = accepted || (0 <= cqe->res);
+                }
+                pending_results--;
+
+                if(cqe->flags & IORING_CQE_F_MORE)
+                {
+                    pending_notifications++;
+                }
+            }
+            __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        if(accepted)
+        {
+            sender->backoff_ns = 0;
+            sender->backoff_waited_ns = 0;
+        }
+
+        // A full device queue is waited out like on the socket path, the targets only fail after the limit
+        queued = 0;
+        if(0 != refused && sender_backoff(sender))
+        {
+            wol_sleep_until_ns(wol_clock_ns() + sender->backoff_ns);
+            memcpy(queue, no_buffer, refused * sizeof(queue[0]));
+            queued = refused;
+        }
+        else
+        {
+            for(size_t k = 0; k < refused; k++)
+            {
+                results[no_buffer[k]].return_value = WAKE_ON_LAN_ERRORS_SEND;
+                results[no_buffer[k]].last_error = ENOBUFS;
+            }
+        }
+        first_round = false;
+    }
+
+    return true;
+}
+
+#endif
+
+static wake_on_lan_errors_t sender_sendto(const wake_on_lan_sender_t * sender, const uint8_t * data, size_t data_length, const wol_target_t * target, wol_result_t * result)
+{
+    if(-1 == sender_socket(sender, target))
+    {
+        result->return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+        result->last_error = -1;
+        return result->return_value;
+    }
+
+#ifdef _WIN32
+    SOCKET sockfd = (SOCKET)sender_socket(sender, target);
+    int sendto_result = SOCKET_ERROR;
+#else
+    int sockfd = (int)sender_socket(sender, target);
+    ssize_t sendto_result = -1;
+#endif
+
+    sender_address_t addr;
+    int addr_length = sender_address(sender, target, &addr);
+
+    sendto_result = sendto(sockfd, (const char *) data, data_length, 0,
+        (struct sockaddr*)(&addr), addr_length);
+
+    result->return_value = WAKE_ON_LAN_ERRORS_NONE;
+    result->last_error = 0;
+
+#ifdef _WIN32
+    if (SOCKET_ERROR == sendto_result) {
+        result->return_value = WAKE_ON_LAN_ERRORS_SEND;
+        result->last_error = WSAGetLastError();
+    }
+#else
+    if (0 > sendto_result) {
+        result->return_value = WAKE_ON_LAN_ERRORS_SEND;
+        result->last_error = errno;
+    }
+#endif
+
+    return result->return_value;
+}
+
+#if false
+
+typedef struct hex_cstr_s
+{
+    char cstr[4];
+} hex_cstr_t;
+
+static const char hex[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+
+static bool number_2_mac_cstr(int64_t number, char * mac_cstr, uint8_t sizeof_mac_cstr);
+
+static bool number_2_mac_cstr(int64_t number, char * mac_cstr, uint8_t sizeof_mac_cstr)
+{
+    int8_t i = 0;
+
+    if(NULL == mac_cstr)
+    {
+        return false;
+    }
+
+    if(INT64_C(-1) == number || 13 > sizeof_mac_cstr)
+    {
+        for(i = 0; i < 13; i++)
+        {
+            mac_cstr[i] = '\0';
+        }
+
+        return false;
+    }
+
+    for(i = 11; i >= 0; i--)
+    {
+        mac_cstr[i] = hex[number & 0x0F];
+        number >>= 4;
+    }
+    mac_cstr[12] = '\0';
+
+    return true;
+}
+
+// the low byte contains the high nibble hex ascii character of the number
+// the high byte contains the low nibble hex ascii character of the number
+hex_cstr_t number_2_hex_cstr_t(uint8_t number)
+{
+    hex_cstr_t hex_cstr;
+    hex_cstr.cstr[0] = hex[( number >> 4 ) & 0x0F];
+    hex_cstr.cstr[1] = hex[( number >> 0 ) & 0x0F];
+    hex_cstr.cstr[2] = '\0';
+    hex_cstr.cstr[3] = number;
+    return hex_cstr;
+}
+
+#endif
+
+
+static wake_on_lan_errors_t sender_open(wake_on_lan_sender_t * sender, bool ip_v4, bool ip_v6, bool uring, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+
+    if(NULL == sender)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+        return return_value;
+    }
+
+    sender->sockfd = -1;
+    sender->sockfd_v6 = -1;
+    sender->ip_v6_interface = 0;
+    sender->wsa_started = false;
+    sender->cache = NULL;
+    sender->metrics = NULL;
+    sender->pacing_interval_ns = 0;
+    sender->pacing_burst = 0;
+    sender->pacing_tat_ns = 0;
+    sender->backoff_ns = 0;
+    sender->backoff_waited_ns = 0;
+    sender->uring = NULL;
+
+#ifdef _WIN32
+    SOCKET sockfd = INVALID_SOCKET;
+#else
+    int sockfd = -1;
+#endif
+
+    do{
+
+#ifdef _WIN32
+        // Initialize Winsock
+        WSADATA wsaData;
+
+        // Use the MAKEWORD(lowbyte, highbyte) macro declared in Windef.h
+        // The highest version of Windows Sockets specification that the caller can use.
+        // The high-order byte specifies the minor version number; the low-order byte specifies the major version number.
+        uint8_t major = 2;
+        uint8_t minor = 2;
+        WORD wVersionRequested = MAKEWORD(major, minor);
+
+
+        int wsa_startup_result = WSAStartup(wVersionRequested, &wsaData);
+        if (0 != wsa_startup_result) {
+            return_value = WAKE_ON_LAN_ERRORS_WSA_STARTUP;
+            if(wol) { wol->last_error = WSAGetLastError(); }
+            break;
+        }
+        sender->wsa_started = true;
+
+        // Confirm that the WinSock DLL supports 2.2.
+        // Note that if the DLL supports versions greater than 2.2
+        // in addition to 2.2, it will still return 2.2 in wVersion
+        // since that is the version we requested.
+        uint8_t available_major = LOBYTE(wsaData.wVersion);
+        uint8_t available_minor = HIBYTE(wsaData.wVersion);
+        if ( available_major != major || available_minor != minor)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_WINSOCK;
+            if(wol) { wol->last_error = available_major << 8 | available_minor; }
+            break;
+        }
+#endif
+
+
+        if(ip_v4)
+        {
+            // AF_INET    : The Internet Protocol version 4 (IPv4) address family.
+            // SOCK_DGRAM : A socket type that supports datagrams, which are connectionless,
+            //              unreliable buffers of a fixed (typically small) maximum length.
+            //              This socket type uses the User Datagram Protocol (UDP) for the
+            //              Internet address family (AF_INET or AF_INET6).
+            // IPPROTO_UDP: The User Datagram Protocol (UDP). This is a possible value when
+            //              the af parameter is AF_INET or AF_INET6 and the type parameter
+            //              is SOCK_DGRAM.
+            sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+#ifdef _WIN32
+            if (INVALID_SOCKET == sockfd)
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+                if(wol) { wol->last_error = WSAGetLastError(); }
+                break;
+            }
+#else
+            if (0 > sockfd)
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+#endif
+            sender->sockfd = (intptr_t)sockfd;
+
+            // Set socket options.
+            const int optval = 1;
+
+#ifdef _WIN32
+            if (SOCKET_ERROR == setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, (const char *)(&optval), sizeof(optval)))
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+                if(wol) { wol->last_error = WSAGetLastError(); }
+                break;
+            }
+#else
+            if (0 > setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, (const char *)(&optval), sizeof(optval)))
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+#endif
+        }
+
+        // A host without IPv6 still sends to IPv4 targets, the IPv6 targets fail with WAKE_ON_LAN_ERRORS_SOCKET_CREATION
+        if(ip_v6)
+        {
+#ifdef _WIN32
+            SOCKET sockfd_v6 = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+            if (INVALID_SOCKET != sockfd_v6)
+            {
+                sender->sockfd_v6 = (intptr_t)sockfd_v6;
+            }
+            else if(!ip_v4)
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+                if(wol) { wol->last_error = WSAGetLastError(); }
+                break;
+            }
+#else
+            int sockfd_v6 = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+            if (0 <= sockfd_v6)
+            {
+                sender->sockfd_v6 = (intptr_t)sockfd_v6;
+            }
+            else if(!ip_v4)
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+#endif
+        }
+
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+        // Without a usable ring the sender keeps the socket path
+        sender->uring = uring ? uring_open() : NULL;
+#else
+        (void)uring;
+#endif
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        // The error of the failed step is more helpful than a possible error while closing
+        wake_on_lan_sender_close(sender, NULL);
+    }
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wake_on_lan_sender_open(wake_on_lan_sender_t * sender, wake_on_lan_t * wol)
+{
+    return sender_open(sender, true, true, true, wol);
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_open_target(wake_on_lan_sender_t * sender, const wol_target_t * target, wake_on_lan_t * wol)
+{
+    if(NULL == target)
+    {
+        if(wol) { wol->return_value = WAKE_ON_LAN_ERRORS_UNKNOWN; wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    // A few packets need neither the socket of the other address family nor a ring
+    bool ip_v6 = wol_target_is_v6(target);
+    return sender_open(sender, !ip_v6, ip_v6, false, wol);
+}
+
+wake_on_lan_errors_t wol_target_parse(wol_target_t * target, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr)
+{
+    if(NULL == target || NULL == ip_v4_cstr)
+    {
+        return WAKE_ON_LAN_ERRORS_IP;
+    }
+
+    int64_t ip_v4 = -1;
+    uint8_t ip_v6[16];
+    uint32_t scope_id = 0;
+
+    if(NULL == strchr(ip_v4_cstr, ':'))
+    {
+        ip_v4 = ip_cstr_to_number(ip_v4_cstr, 13, 0);
+        if(INT64_C(-1) == ip_v4)
+        {
+            return WAKE_ON_LAN_ERRORS_IP;
+        }
+    }
+    else if(!ip_v6_cstr_to_bytes(ip_v4_cstr, ip_v6, &scope_id))
+    {
+        return WAKE_ON_LAN_ERRORS_IP;
+    }
+
+    if(NULL == mac_cstr)
+    {
+        return WAKE_ON_LAN_ERRORS_MAC;
+    }
+
+    int64_t mac = mac_cstr_to_number(mac_cstr);
+    if(INT64_C(-1) == mac)
+    {
+        return WAKE_ON_LAN_ERRORS_MAC;
+    }
+
+    if(INT64_C(-1) == ip_v4)
+    {
+        wol_target_init_v6(target, ip_v6, scope_id, port, (uint64_t)mac);
+    }
+    else
+    {
+        wol_target_init(target, (uint32_t)ip_v4, port, (uint64_t)mac);
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+void wol_target_init(wol_target_t * target, uint32_t ip_v4, uint16_t port, uint64_t mac)
+{
+    target->ip_v4 = ip_v4;
+    target->port = port;
+    target->mac[0] = GET_BYTE_5(mac);
+    target->mac[1] = GET_BYTE_4(mac);
+    target->mac[2] = GET_BYTE_3(mac);
+    target->mac[3] = GET_BYTE_2(mac);
+    target->mac[4] = GET_BYTE_1(mac);
+    target->mac[5] = GET_BYTE_0(mac);
+    memset(target->ip_v6, 0, sizeof(target->ip_v6));
+    target->scope_id = 0;
+    memset(target->password, 0, sizeof(target->password));
+    target->password_length = 0;
+}
+
+void wol_target_init_v6(wol_target_t * target, const uint8_t ip_v6[16], uint32_t scope_id, uint16_t port, uint64_t mac)
+{
+    wol_target_init(target, 0, port, mac);
+    memcpy(target->ip_v6, ip_v6, sizeof(target->ip_v6));
+    target->scope_id = scope_id;
+}
+
+bool wol_target_is_v6(const wol_target_t * target)
+{
+    uint64_t high;
+    uint64_t low;
+    memcpy(&high, target->ip_v6, sizeof(high));
+    memcpy(&low, target->ip_v6 + sizeof(high), sizeof(low));
+    return 0 != (high | low);
+}
+
+uint64_t wol_target_mac(const wol_target_t * target)
+{
+    uint64_t mac = 0;
+    for(size_t i = 0; i < 6; i++)
+    {
+        mac = (mac << 8) | target->mac[i];
+    }
+    return mac;
+}
+
+wake_on_lan_errors_t wol_target_set_password(wol_target_t * target, const char * password_cstr)
+{
+    if(NULL == target)
+    {
+        return WAKE_ON_LAN_ERRORS_PASSWORD;
+    }
+
+    uint8_t password[WAKE_ON_LAN_PASSWORD_SIZE] = { 0 };
+    uint8_t length = 0;
+
+    if(NULL != password_cstr && NULL != strchr(password_cstr, '.'))
+    {
+        // A password of 4 bytes is usually written like an IPv4
+        struct in_addr in;
+        if(1 != inet_pton(AF_INET, password_cstr, &in))
+        {
+            return WAKE_ON_LAN_ERRORS_PASSWORD;
+        }
+        memcpy(password, &in, 4);
+        length = 4;
+    }
+    else if(NULL != password_cstr && '\0' != password_cstr[0])
+    {
+        // and one of 6 bytes like a MAC
+        int64_t number = mac_cstr_to_number(password_cstr);
+        if(INT64_C(-1) == number)
+        {
+            return WAKE_ON_LAN_ERRORS_PASSWORD;
+        }
+        for(size_t i = 0; i < WAKE_ON_LAN_PASSWORD_SIZE; i++)
+        {
+            password[i] = (uint8_t)((uint64_t)number >> (8 * (WAKE_ON_LAN_PASSWORD_SIZE - 1 - i)));
+        }
+        length = WAKE_ON_LAN_PASSWORD_SIZE;
+    }
+
+    memcpy(target->password, password, sizeof(target->password));
+    target->password_length = length;
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+size_t wol_packet_size(const wol_target_t * target)
+{
+    return WAKE_ON_LAN_PACKET_SIZE + target->password_length;
+}
+
+void wol_packet_build(uint8_t * packet, const uint8_t mac[6])
+{
+    uint64_t pattern[3];
+    packet_pattern(pattern, mac);
+
+    memset(packet, 0xFF, 6);
+
+    // The 96 bytes of MAC repetitions are the 24 byte pattern 4 times,
+    // with 16 byte stores these are 3 different vectors, each stored twice
+    uint8_t * macs = packet + 6;
+
+#if defined(WOL_PACKET_BUILD_SSE2)
+    const __m128i v0 = _mm_set_epi64x((long long)pattern[1], (long long)pattern[0]);
+    const __m128i v1 = _mm_set_epi64x((long long)pattern[0], (long long)pattern[2]);
+    const __m128i v2 = _mm_set_epi64x((long long)pattern[2], (long long)pattern[1]);
+    _mm_storeu_si128((__m128i *)(macs + 0x00), v0);
+    _mm_storeu_si128((__m128i *)(macs + 0x10), v1);
+    _mm_storeu_si128((__m128i *)(macs + 0x20), v2);
+    _mm_storeu_si128((__m128i *)(macs + 0x30), v0);
+    _mm_storeu_si128((__m128i *)(macs + 0x40), v1);
+    _mm_storeu_si128((__m128i *)(macs + 0x50), v2);
+#elif defined(WOL_PACKET_BUILD_NEON)
+    const uint8x16_t v0 = vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(pattern[0]), vcreate_u64(pattern[1])));
+    const uint8x16_t v1 = vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(pattern[2]), vcreate_u64(pattern[0])));
+    const uint8x16_t v2 = vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(pattern[1]), vcreate_u64(pattern[2])));
+    vst1q_u8(macs + 0x00, v0);
+    vst1q_u8(macs + 0x10, v1);
+    vst1q_u8(macs + 0x20, v2);
+    vst1q_u8(macs + 0x30, v0);
+    vst1q_u8(macs + 0x40, v1);
+    vst1q_u8(macs + 0x50, v2);
+#else
+    for(size_t i = 0; i < 12; i++)
+    {
+        memcpy(macs + 8 * i, &pattern[i % 3], 8);
+    }
+#endif
+}
+
+size_t wol_packet_build_target(uint8_t * packet, const wol_target_t * target)
+{
+    wol_packet_build(packet, target->mac);
+
+    memcpy(packet + WAKE_ON_LAN_PACKET_SIZE, target->password, target->password_length);
+
+    return WAKE_ON_LAN_PACKET_SIZE + target->password_length;
+}
+
+void wol_packet_build_many(uint8_t * packets, size_t stride, const wol_target_t * targets, size_t n)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        wol_packet_build_target(packets + i * stride, &targets[i]);
+    }
+}
+
+wake_on_lan_errors_t wol_packet_cache_init(wol_packet_cache_t * cache, size_t capacity)
+{
+    if(NULL == cache)
+    {
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+
+    if(0 == capacity || ( UINT32_MAX / 2 ) < capacity)
+    {
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    // At most half of the slots are used, which keeps the linear probing short
+    size_t slots = 1;
+    unsigned bits = 0;
+    while(slots < 2 * capacity)
+    {
+        slots <<= 1;
+        bits++;
+    }
+
+    size_t packets_size = capacity * WOL_PACKET_CACHE_STRIDE;
+    size_t keys_size = slots * sizeof(uint64_t);
+    size_t index_size = slots * sizeof(uint32_t);
+
+    uint8_t * allocation = malloc(WOL_CACHE_LINE_SIZE - 1 + packets_size + keys_size + index_size);
+    if(NULL == allocation)
+    {
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    uintptr_t aligned = ((uintptr_t)allocation + WOL_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(WOL_CACHE_LINE_SIZE - 1);
+
+    cache->allocation = allocation;
+    cache->packets = (uint8_t *)aligned;
+    cache->keys = (uint64_t *)(cache->packets + packets_size);
+    cache->index = (uint32_t *)((uint8_t *)cache->keys + keys_size);
+    cache->capacity = capacity;
+    cache->count = 0;
+    cache->slot_mask = slots - 1;
+    // A capacity of at least one gives at least two slots, so the shift stays below 64
+    cache->shift = 64 - bits;
+
+    memset(cache->keys, 0, keys_size);
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+void wol_packet_cache_free(wol_packet_cache_t * cache)
+{
+    if(NULL == cache)
+    {
+        return;
+    }
+
+    free(cache->allocation);
+    memset(cache, 0, sizeof(*cache));
+}
+
+void wol_packet_cache_clear(wol_packet_cache_t * cache)
+{
+    if(NULL == cache || NULL == cache->keys)
+    {
+        return;
+    }
+
+    memset(cache->keys, 0, (cache->slot_mask + 1) * sizeof(uint64_t));
+    cache->count = 0;
+}
+
+const uint8_t * wol_packet_cache_find(const wol_packet_cache_t * cache, const uint8_t mac[6])
+{
+    if(NULL == cache || NULL == cache->keys)
+    {
+        return NULL;
+    }
+
+    uint64_t key = packet_cache_key(mac, 0);
+    size_t slot = packet_cache_probe(cache, key);
+    if(key != cache->keys[slot])
+    {
+        return NULL;
+    }
+
+    return cache->packets + (size_t)cache->index[slot] * WOL_PACKET_CACHE_STRIDE;
+}
+
+const uint8_t * wol_packet_cache_get(wol_packet_cache_t * cache, const uint8_t mac[6])
+{
+    wol_target_t target;
+    memcpy(target.mac, mac, sizeof(target.mac));
+    memset(target.password, 0, sizeof(target.password));
+    target.password_length = 0;
+
+    return wol_packet_cache_get_target(cache, &target);
+}
+
+const uint8_t * wol_packet_cache_get_target(wol_packet_cache_t * cache, const wol_target_t * target)
+{
+    if(NULL == cache || NULL == cache->keys)
+    {
+        return NULL;
+    }
+
+    uint64_t key = packet_cache_key(target->mac, target->password_length);
+    size_t slot = packet_cache_probe(cache, key);
+    if(key == cache->keys[slot])
+    {
+        const uint8_t * packet = cache->packets + (size_t)cache->index[slot] * WOL_PACKET_CACHE_STRIDE;
+
+        // A cached packet is never rewritten, it may still be in flight
+        if(0 != memcmp(packet + WAKE_ON_LAN_PACKET_SIZE, target->password, target->password_length))
+        {
+            return NULL;
+        }
+        return packet;
+    }
+
+    if(cache->count >= cache->capacity)
+    {
+        return NULL;
+    }
+
+    uint8_t * packet = cache->packets + cache->count * WOL_PACKET_CACHE_STRIDE;
+    wol_packet_build_target(packet, target);
+
+    cache->keys[slot] = key;
+    cache->index[slot] = (uint32_t)cache->count;
+    cache->count++;
+
+    return packet;
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_send(wake_on_lan_sender_t * sender, wake_on_lan_t * wol, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr)
+{
+    wol_target_t target;
+
+    wake_on_lan_errors_t return_value = wol_target_parse(&target, ip_v4_cstr, port, mac_cstr);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        if(wol)
+        {
+            wol->return_value = return_value;
+            wol->last_error = -1;
+        }
+        return return_value;
+    }
+
+    return wake_on_lan_sender_send_target(sender, wol, &target);
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_send_target(wake_on_lan_sender_t * sender, wake_on_lan_t * wol, const wol_target_t * target)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+
+    uint8_t data[WAKE_ON_LAN_PACKET_MAX_SIZE];
+
+    do{
+
+        if(NULL == sender || (-1 == sender->sockfd && -1 == sender->sockfd_v6) || NULL == target)
+        {
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+        if(wol)
+        {
+            wol->ip_v4 = target->ip_v4;
+            wol->mac = (int64_t)wol_target_mac(target);
+        }
+
+        const uint8_t * packet = sender_packet(sender, data, target);
+
+        pacing_acquire(sender, 1, NULL);
+
+#if defined(WAKE_ON_LAN_METRICS)
+        uint64_t start_ns = sender->metrics ? wol_clock_ns() : 0;
+#endif
+
+        // A full device queue is waited out like in a batch, the target only fails after the limit
+        wol_result_t result;
+        return_value = sender_sendto(sender, packet, wol_packet_size(target), target, &result);
+        while(WAKE_ON_LAN_ERRORS_NONE != return_value && is_no_buffer(result.last_error) && sender_backoff(sender))
+        {
+            wol_sleep_until_ns(wol_clock_ns() + sender->backoff_ns);
+            return_value = sender_sendto(sender, packet, wol_packet_size(target), target, &result);
+        }
+        if(WAKE_ON_LAN_ERRORS_NONE == return_value)
+        {
+            sender->backoff_ns = 0;
+            sender->backoff_waited_ns = 0;
+        }
+
+#if defined(WAKE_ON_LAN_METRICS)
+        if(sender->metrics)
+        {
+#ifdef _WIN32
+            bool would_block = (WAKE_ON_LAN_ERRORS_NONE != return_value) && WSAEWOULDBLOCK == result.last_error;
+#else
+            bool would_block = (WAKE_ON_LAN_ERRORS_NONE != return_value) && (EAGAIN == result.last_error || EWOULDBLOCK == result.last_error);
+#endif
+            metrics_record(sender->metrics, target, &result, 1, would_block, wol_clock_ns() - start_ns);
+        }
+#endif
+        if(wol && WAKE_ON_LAN_ERRORS_NONE != return_value) { wol->last_error = result.last_error; }
+
+    }while(0);
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wake_on_lan_batch(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t n, wol_result_t * results)
+{
+    if(NULL == sender || -1 == sender->sockfd || (NULL == targets && 0 != n))
+    {
+        for(size_t i = 0; results && i < n; i++)
+        {
+            results[i].return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+            results[i].last_error = -1;
+        }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    return sender_batch(sender, targets, n, results, NULL);
+}
+
+wake_on_lan_errors_t wake_on_lan_batch_results(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t n, wol_results_t * results)
+{
+    if(NULL == results || (NULL == results->codes && 0 != n))
+    {
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    results->count = n;
+
+    if(NULL == sender || -1 == sender->sockfd || (NULL == targets && 0 != n))
+    {
+        memset(results->codes, WAKE_ON_LAN_ERRORS_UNKNOWN, n);
+        for(size_t i = 0; results->errors && i < n; i++)
+        {
+            results->errors[i] = -1;
+        }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    return sender_batch(sender, targets, n, NULL, results);
+}
+
+size_t wol_results_count(const wol_results_t * results, size_t counts[WAKE_ON_LAN_ERRORS_COUNT])
+{
+    if(NULL == results || NULL == counts)
+    {
+        return 0;
+    }
+
+    memset(counts, 0, WAKE_ON_LAN_ERRORS_COUNT * sizeof(*counts));
+
+    const uint8_t * codes = results->codes;
+    size_t n = codes ? results->count : 0;
+    size_t i = 0;
+    size_t failed = 0;
+
+    // Most targets succeed, a block of 16 successes costs one compare, only blocks with a failure are counted one by one
+    for(; i + 16 <= n; i += 16)
+    {
+#if defined(WOL_PACKET_BUILD_SSE2)
+        __m128i block = _mm_loadu_si128((const __m128i *)(codes + i));
+        bool successes = (0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128())));
+#elif defined(WOL_PACKET_BUILD_NEON)
+        uint8x16_t zeros = vceqq_u8(vld1q_u8(codes + i), vdupq_n_u8(0));
+  #if defined(__aarch64__) || defined(_M_ARM64)
+        // Each equal lane is 0xFF, the lowest lane tells whether all are
+        bool successes = (0xFF == vminvq_u8(zeros));
+  #else
+        // 32-bit ARM has no lane reduction, the two halves of the compare are checked as words
+        uint64x2_t words = vreinterpretq_u64_u8(zeros);
+        bool successes = (UINT64_MAX == (vgetq_lane_u64(words, 0) & vgetq_lane_u64(words, 1)));
+  #endif
+#else
+        uint64_t words[2];
+        memcpy(words, codes + i, sizeof(words));
+        bool successes = (0 == (words[0] | words[1]));
+#endif
+        if(successes)
+        {
+            counts[WAKE_ON_LAN_ERRORS_NONE] += 16;
+            continue;
+        }
+        for(size_t j = i; j < i + 16; j++)
+        {
+            failed += results_count_code(counts, codes[j]);
+        }
+    }
+
+    for(; i < n; i++)
+    {
+        failed += results_count_code(counts, codes[i]);
+    }
+
+    return failed;
+}
+
+size_t wol_error_format(char * buffer, size_t size, wake_on_lan_errors_t error, int last_error)
+{
+    if(NULL == buffer || 0 == size)
+    {
+        return 0;
+    }
+
+    const char * message = wake_on_lan_errors[((unsigned)error < WAKE_ON_LAN_ERRORS_COUNT) ? error : WAKE_ON_LAN_ERRORS_UNKNOWN];
+
+    // Only these errors carry a value of the system, the others use last_error for other values or not at all
+    bool system = (0 < last_error) && (WAKE_ON_LAN_ERRORS_WSA_STARTUP == error
+        || WAKE_ON_LAN_ERRORS_SOCKET_CREATION == error || WAKE_ON_LAN_ERRORS_SOCKET_OPTION == error
+        || WAKE_ON_LAN_ERRORS_SEND == error || WAKE_ON_LAN_ERRORS_SOCKET_CLOSE == error
+        || WAKE_ON_LAN_ERRORS_FILE == error || WAKE_ON_LAN_ERRORS_BIND == error);
+
+    int length;
+    if(system)
+    {
+        char text[128];
+        format_system_error(text, sizeof(text), last_error);
+        length = ('\0' != text[0]) ? snprintf(buffer, size, "%s (%d: %s)", message, last_error, text) : snprintf(buffer, size, "%s (%d)", message, last_error);
+    }
+    else
+    {
+        length = snprintf(buffer, size, "%s", message);
+    }
+
+    if(0 > length)
+    {
+        buffer[0] = '\0';
+        return 0;
+    }
+
+    return ((size_t)length < size) ? (size_t)length : size - 1;
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_set_nonblocking(wake_on_lan_sender_t * sender, bool nonblocking, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+
+    do{
+
+        if(NULL == sender || -1 == sender->sockfd)
+        {
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+        int error = socket_set_nonblocking(sender->sockfd, nonblocking);
+        if (0 == error && -1 != sender->sockfd_v6)
+        {
+            error = socket_set_nonblocking(sender->sockfd_v6, nonblocking);
+        }
+        if (0 != error)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+            if(wol) { wol->last_error = error; }
+            break;
+        }
+
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+        // The ring would wait for the socket itself, a non-blocking sender must report full buffers instead
+        if(sender->uring)
+        {
+            ((sender_uring_t *)sender->uring)->paused = nonblocking;
+        }
+#endif
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_send_queue_flush(wake_on_lan_sender_t * sender, wol_send_queue_t * queue)
+{
+    if(NULL == sender || -1 == sender->sockfd || NULL == queue || (NULL == queue->targets && 0 != queue->count))
+    {
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    wol_result_t chunk_results[WAKE_ON_LAN_BATCH_CHUNK];
+
+    queue->ready_at_ns = 0;
+
+    while(queue->next < queue->count)
+    {
+        size_t count = queue->count - queue->next;
+        if(WAKE_ON_LAN_BATCH_CHUNK < count)
+        {
+            count = WAKE_ON_LAN_BATCH_CHUNK;
+        }
+
+        count = pacing_acquire(sender, count, &queue->ready_at_ns);
+        if(0 == count)
+        {
+            // Paced sender without tokens, the caller arms a timer for wol_send_queue_s::ready_at_ns
+            return WAKE_ON_LAN_ERRORS_AGAIN;
+        }
+
+        wol_result_t * result = queue->results ? queue->results + queue->next : chunk_results;
+        bool would_block = false;
+
+#if defined(WAKE_ON_LAN_METRICS)
+        uint64_t start_ns = sender->metrics ? wol_clock_ns() : 0;
+#endif
+
+        size_t completed = sender_send_chunk(sender, queue->targets + queue->next, count, result, &would_block);
+
+#if defined(WAKE_ON_LAN_METRICS)
+        if(sender->metrics)
+        {
+            metrics_record(sender->metrics, queue->targets + queue->next, result, completed, would_block, wol_clock_ns() - start_ns);
+        }
+#endif
+
+        for(size_t i = 0; i < completed; i++)
+        {
+            if(WAKE_ON_LAN_ERRORS_NONE != result[i].return_value)
+            {
+                queue->failed++;
+            }
+            if(queue->callback)
+            {
+                queue->callback(queue->context, queue->next + i, &result[i]);
+            }
+        }
+        queue->next += completed;
+
+        if(would_block)
+        {
+            // The caller waits until the socket is writable again or, after a full device queue, until the backoff ended
+            pacing_release(sender, count - completed);
+            if(0 != sender->backoff_ns)
+            {
+                queue->ready_at_ns = wol_clock_ns() + sender->backoff_ns;
+            }
+            return WAKE_ON_LAN_ERRORS_AGAIN;
+        }
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_bind(wake_on_lan_sender_t * sender, uint32_t source_ip_v4, const char * device, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+
+    do{
+
+        if(NULL == sender || -1 == sender->sockfd)
+        {
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+#if defined(SO_BINDTODEVICE)
+        if(device && '\0' != device[0])
+        {
+            if (0 > setsockopt((int)sender->sockfd, SOL_SOCKET, SO_BINDTODEVICE, device, (socklen_t)strlen(device) + 1))
+            {
+                return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+        }
+#else
+        (void)device;
+#endif
+
+        struct sockaddr_in addr = { 0 };
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(source_ip_v4);
+        addr.sin_port = 0;
+
+#ifdef _WIN32
+        if (SOCKET_ERROR == bind((SOCKET)sender->sockfd, (struct sockaddr*)(&addr), sizeof(addr)))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_BIND;
+            if(wol) { wol->last_error = WSAGetLastError(); }
+            break;
+        }
+#else
+        if (0 > bind((int)sender->sockfd, (struct sockaddr*)(&addr), sizeof(addr)))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_BIND;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+#endif
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_set_ipv6(wake_on_lan_sender_t * sender, uint32_t interface_index, uint8_t hop_limit, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+
+    do{
+
+        if(NULL == sender || -1 == sender->sockfd)
+        {
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+        if(-1 == sender->sockfd_v6)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+        const int hops = hop_limit;
+        const unsigned int index = interface_index;
+
+#ifdef _WIN32
+        SOCKET sockfd = (SOCKET)sender->sockfd_v6;
+        if (SOCKET_ERROR == setsockopt(sockfd, IPPROTO_IPV6, IPV6_MULTICAST_IF, (const char *)(&index), sizeof(index))
+            || ( 0 != hops && SOCKET_ERROR == setsockopt(sockfd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (const char *)(&hops), sizeof(hops)) )
+            || ( 0 != hops && SOCKET_ERROR == setsockopt(sockfd, IPPROTO_IPV6, IPV6_UNICAST_HOPS, (const char *)(&hops), sizeof(hops)) ))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+            if(wol) { wol->last_error = WSAGetLastError(); }
+            break;
+        }
+#else
+        int sockfd = (int)sender->sockfd_v6;
+        if (0 > setsockopt(sockfd, IPPROTO_IPV6, IPV6_MULTICAST_IF, (const char *)(&index), sizeof(index))
+            || ( 0 != hops && 0 > setsockopt(sockfd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (const char *)(&hops), sizeof(hops)) )
+            || ( 0 != hops && 0 > setsockopt(sockfd, IPPROTO_IPV6, IPV6_UNICAST_HOPS, (const char *)(&hops), sizeof(hops)) ))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+#endif
+
+        sender->ip_v6_interface = interface_index;
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_set_rate(wake_on_lan_sender_t * sender, uint32_t packets_per_second, uint32_t burst, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    if(NULL == sender || -1 == sender->sockfd)
+    {
+        if(wol) { wol->return_value = WAKE_ON_LAN_ERRORS_UNKNOWN; wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    if(0 == packets_per_second)
+    {
+        sender->pacing_interval_ns = 0;
+    }
+    else
+    {
+        sender->pacing_interval_ns = NS_PER_SECOND / packets_per_second;
+        if(0 == sender->pacing_interval_ns)
+        {
+            sender->pacing_interval_ns = 1;
+        }
+    }
+    sender->pacing_burst = (0 == burst) ? 1 : burst;
+    sender->pacing_tat_ns = 0;
+
+#if defined(SO_MAX_PACING_RATE)
+    // With the fq qdisc, the kernel additionally spreads the packets of one sendmmsg() call,
+    // without it the option is accepted and has no effect
+    uint64_t bytes_per_second = (uint64_t)packets_per_second * WAKE_ON_LAN_WIRE_SIZE;
+    unsigned int pacing_rate = (0 == packets_per_second || UINT32_MAX < bytes_per_second) ? UINT32_MAX : (unsigned int)bytes_per_second;
+    if (0 > setsockopt((int)sender->sockfd, SOL_SOCKET, SO_MAX_PACING_RATE, (const char *)(&pacing_rate), sizeof(pacing_rate)))
+    {
+        return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+        if(wol) { wol->last_error = errno; }
+    }
+#endif
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_set_options(wake_on_lan_sender_t * sender, const wol_sender_options_t * options, wake_on_lan_t * wol)
+{
+    if(NULL == sender || -1 == sender->sockfd || NULL == options)
+    {
+        if(wol) { wol->return_value = WAKE_ON_LAN_ERRORS_UNKNOWN; wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    int first_error = 0;
+    int error = 0;
+
+    if(0 < options->send_buffer)
+    {
+        for(int i = 0; i < 2; i++)
+        {
+            intptr_t sockfd = (0 == i) ? sender->sockfd : sender->sockfd_v6;
+            if(-1 == sockfd)
+            {
+                continue;
+            }
+#if defined(SO_SNDBUFFORCE)
+            // Only with CAP_NET_ADMIN, otherwise the size is capped at net.core.wmem_max
+            if(0 == socket_set_option(sockfd, SOL_SOCKET, SO_SNDBUFFORCE, options->send_buffer))
+            {
+                continue;
+            }
+#endif
+            error = socket_set_option(sockfd, SOL_SOCKET, SO_SNDBUF, options->send_buffer);
+            first_error = first_error ? first_error : error;
+        }
+    }
+
+    if(0 != options->dscp)
+    {
+        // The DSCP is the upper 6 bits of the TOS/traffic class, the lower 2 bits are ECN
+        int tos = (options->dscp & 0x3F) << 2;
+        error = socket_set_option(sender->sockfd, IPPROTO_IP, IP_TOS, tos);
+        first_error = first_error ? first_error : error;
+#if defined(IPV6_TCLASS)
+        if(-1 != sender->sockfd_v6)
+        {
+            error = socket_set_option(sender->sockfd_v6, IPPROTO_IPV6, IPV6_TCLASS, tos);
+            first_error = first_error ? first_error : error;
+        }
+#endif
+    }
+
+#if defined(SO_PRIORITY)
+    if(0 != options->priority)
+    {
+        error = socket_set_option(sender->sockfd, SOL_SOCKET, SO_PRIORITY, options->priority);
+        first_error = first_error ? first_error : error;
+        if(-1 != sender->sockfd_v6)
+        {
+            error = socket_set_option(sender->sockfd_v6, SOL_SOCKET, SO_PRIORITY, options->priority);
+            first_error = first_error ? first_error : error;
+        }
+    }
+#endif
+
+    if(0 != options->ttl)
+    {
+        error = socket_set_option(sender->sockfd, IPPROTO_IP, IP_TTL, options->ttl);
+        first_error = first_error ? first_error : error;
+    }
+
+    wake_on_lan_errors_t return_value = first_error ? WAKE_ON_LAN_ERRORS_SOCKET_OPTION : WAKE_ON_LAN_ERRORS_NONE;
+
+    if(wol)
+    {
+        wol->return_value = return_value;
+        if(first_error) { wol->last_error = first_error; }
+    }
+
+    return return_value;
+}
+
+uint64_t wol_clock_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = { 0 };
+    if(0 == frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    uint64_t seconds = (uint64_t)counter.QuadPart / (uint64_t)frequency.QuadPart;
+    uint64_t rest = (uint64_t)counter.QuadPart % (uint64_t)frequency.QuadPart;
+    return seconds * NS_PER_SECOND + rest * NS_PER_SECOND / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * NS_PER_SECOND + (uint64_t)now.tv_nsec;
+#endif
+}
+
+void wol_sleep_until_ns(uint64_t deadline_ns)
+{
+    for(uint64_t now = wol_clock_ns(); now < deadline_ns; now = wol_clock_ns())
+    {
+        uint64_t remaining = deadline_ns - now;
+
+#ifdef _WIN32
+        // Sleep() has a granularity of about a millisecond, the rest is spent yielding
+        if(2000000 < remaining)
+        {
+            Sleep((DWORD)(remaining / 1000000 - 1));
+        }
+        else
+        {
+            SwitchToThread();
+        }
+#else
+        struct timespec duration;
+        duration.tv_sec = (time_t)(remaining / NS_PER_SECOND);
+        duration.tv_nsec = (long)(remaining % NS_PER_SECOND);
+        nanosleep(&duration, NULL);
+#endif
+    }
+}
+
+wake_on_lan_errors_t wake_on_lan_sender_close(wake_on_lan_sender_t * sender, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    if(NULL == sender)
+    {
+        return return_value;
+    }
+
+#ifdef _WIN32
+    if(-1 != sender->sockfd)
+    {
+        int closesocket_result = closesocket((SOCKET)sender->sockfd);
+        if (SOCKET_ERROR == closesocket_result) {
             return_value = WAKE_ON_LAN_ERRORS_SOCKET_CLOSE;
             if(wol) { wol->last_error = WSAGetLastError(); }
         }
     }
-    WSACleanup();
+    if(-1 != sender->sockfd_v6)
+    {
+        closesocket((SOCKET)sender->sockfd_v6);
+    }
+    if(sender->wsa_started)
+    {
+        WSACleanup();
+    }
 #else
-    close(sockfd);
+    if(-1 != sender->sockfd)
+    {
+        close((int)sender->sockfd);
+    }
+    if(-1 != sender->sockfd_v6)
+    {
+        close((int)sender->sockfd_v6);
+    }
 #endif
 
+    sender->sockfd = -1;
+    sender->sockfd_v6 = -1;
+    sender->wsa_started = false;
 
-    if(wol) { wol->return_value = return_value; }
+#ifdef WAKE_ON_LAN_HAVE_IO_URING
+    uring_close(sender->uring);
+    sender->uring = NULL;
+#endif
+
+    if(wol && WAKE_ON_LAN_ERRORS_NONE != return_value) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wake_on_lan(wake_on_lan_t * wol, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr)
+{
+    // A malformed IP or MAC is rejected before any socket is opened
+    wol_target_t target;
+    wake_on_lan_errors_t return_value = wol_target_parse(&target, ip_v4_cstr, port, mac_cstr);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        if(wol)
+        {
+            wol->return_value = return_value;
+            wol->last_error = -1;
+        }
+        return return_value;
+    }
+
+    wake_on_lan_sender_t sender;
+    return_value = wake_on_lan_sender_open_target(&sender, &target, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        return return_value;
+    }
+
+    return_value = wake_on_lan_sender_send_target(&sender, wol, &target);
+
+    wake_on_lan_errors_t close_result = wake_on_lan_sender_close(&sender, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != close_result)
+    {
+        return_value = close_result;
+    }
 
     return return_value;
 }
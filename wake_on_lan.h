@@ -6,6 +6,9 @@
 //! to a network card of a computer to wake up the PC.
 //!
 //! @note Under Windows, the file must be linked with the `-lws2_32` switch.
+//!
+//! @note Under Linux, the file can be compiled with `-DWAKE_ON_LAN_IO_URING` to send batches through
+//!       io_uring with zero-copy sends from registered buffers. Kernels without that support use the socket path.
 
 #ifndef INC_WAKE_ON_LAN_H_
 #define INC_WAKE_ON_LAN_H_
@@ -19,18 +22,46 @@ extern "C" {
  *  public: include files
  *---------------------------------------------------------------------*/
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 
 /*---------------------------------------------------------------------*
  *  public: define
  *---------------------------------------------------------------------*/
+
+//! @brief Size of a magic packet, 6 bytes 0xFF followed by 16 repetitions of the 6 byte MAC
+#define WAKE_ON_LAN_PACKET_SIZE ( 6 * ( 1 + 16 ) )
+
+//! @brief Largest SecureOn password, appended to the magic packet, some NICs take 4 bytes instead
+#define WAKE_ON_LAN_PASSWORD_SIZE 6
+
+//! @brief Size of the largest magic packet, the one with a password of ::WAKE_ON_LAN_PASSWORD_SIZE bytes
+#define WAKE_ON_LAN_PACKET_MAX_SIZE ( WAKE_ON_LAN_PACKET_SIZE + WAKE_ON_LAN_PASSWORD_SIZE )
+
+//! @brief Assumed size of a cache line, the storage of a ::wol_packet_cache_t is aligned to it
+#define WOL_CACHE_LINE_SIZE 64
+
+//! @brief Distance between two packets of a ::wol_packet_cache_t, a multiple of ::WOL_CACHE_LINE_SIZE
+#define WOL_PACKET_CACHE_STRIDE 128
+
+//! @brief First wait of a sender after the device queue was full (`ENOBUFS`), doubled for each further full queue
+#define WOL_SENDER_BACKOFF_MIN_NS 50000
+
+//! @brief Longest single wait of a sender after `ENOBUFS`
+#define WOL_SENDER_BACKOFF_MAX_NS 10000000
+
+//! @brief Total wait of a sender without any accepted packet after which `ENOBUFS` fails the targets
+#define WOL_SENDER_BACKOFF_LIMIT_NS 1000000000
+
 /*---------------------------------------------------------------------*
  *  public: typedefs
  *---------------------------------------------------------------------*/
 
 //! @brief Return values of the ::wake_on_lan() function
-//! @details The error value can be converted into a string using the array ::wake_on_lan_errors.
+//! @details The error value can be converted into a string using the array ::wake_on_lan_errors or,
+//!          together with the error of the system, using ::wol_error_format().
 typedef enum wake_on_lan_errors_e
 {
     WAKE_ON_LAN_ERRORS_NONE = 0,        //!< No errors
@@ -41,8 +72,18 @@ typedef enum wake_on_lan_errors_e
     WAKE_ON_LAN_ERRORS_WINSOCK,         //!< Windows only, ::wake_on_lan_s::last_error contains the main version shifted 8-fold to the left and the added secondary version
     WAKE_ON_LAN_ERRORS_SOCKET_CREATION, //!< The value of `WSAGetLastError()`/`errno` is stored in ::wake_on_lan_s::last_error
     WAKE_ON_LAN_ERRORS_SOCKET_OPTION,   //!< The value of `WSAGetLastError()`/`errno` is stored in ::wake_on_lan_s::last_error
-    WAKE_ON_LAN_ERRORS_SEND,            //!< The value of `WSAGetLastError()`/`sendto()` is stored in ::wake_on_lan_s::last_error
+    WAKE_ON_LAN_ERRORS_SEND,            //!< The value of `WSAGetLastError()`/`errno` is stored in ::wake_on_lan_s::last_error
     WAKE_ON_LAN_ERRORS_SOCKET_CLOSE,    //!< Windows only, the value of `WSAGetLastError()` is stored in ::wake_on_lan_s::last_error
+    WAKE_ON_LAN_ERRORS_MEMORY,          //!< Failed to allocate memory
+    WAKE_ON_LAN_ERRORS_PORT,            //!< Failed to convert port
+    WAKE_ON_LAN_ERRORS_LINE,            //!< Unexpected field in an inventory line
+    WAKE_ON_LAN_ERRORS_FILE,            //!< The value of `GetLastError()`/`errno` is stored in ::wake_on_lan_s::last_error
+    WAKE_ON_LAN_ERRORS_FORMAT,          //!< The file is not a compiled inventory of this version
+    WAKE_ON_LAN_ERRORS_BIND,            //!< The value of `WSAGetLastError()`/`errno` is stored in ::wake_on_lan_s::last_error
+    WAKE_ON_LAN_ERRORS_AGAIN,           //!< Not an error, the non-blocking socket is full or the pacing has no token, see ::wol_send_queue_flush()
+    WAKE_ON_LAN_ERRORS_TIMEOUT,         //!< A host did not answer the probes in time
+    WAKE_ON_LAN_ERRORS_PASSWORD,        //!< Failed to convert SecureOn password
+    WAKE_ON_LAN_ERRORS_COUNT,           //!< Not an error, the number of values, e.g. the size of the counts of ::wol_results_count()
 }wake_on_lan_errors_t;
 
 //! @brief Structure to get more information about the ::wake_on_lan() function
@@ -54,6 +95,104 @@ typedef struct wake_on_lan_s
     int  last_error;                    //!< Value of `WSAGetLastError()`/`errno` check enum ::wake_on_lan_errors_e of wake_on_lan_t::return_value
 } wake_on_lan_t;
 
+//! @brief Cache of ready-to-send magic packets keyed by MAC, see ::wol_packet_cache_init()
+//! @details The packets are stored contiguously, each one starts on its own cache line.
+//!          A packet stays at the same address until the cache is cleared or freed.
+//!          Packets with and without SecureOn password share the slots, the stride holds the largest one.
+typedef struct wol_packet_cache_s
+{
+    uint8_t * packets;                  //!< ::wol_packet_cache_s::capacity packets with a distance of ::WOL_PACKET_CACHE_STRIDE bytes
+    uint64_t * keys;                    //!< Hash slots with the MAC as number, 0 marks a free slot
+    uint32_t * index;                   //!< Packet index for each hash slot
+    size_t capacity;                    //!< Maximum number of packets
+    size_t count;                       //!< Number of cached packets
+    size_t slot_mask;                   //!< Number of hash slots minus one
+    unsigned shift;                     //!< Right shift of the hashed key to a slot, 64 minus log2 of the slots
+    void * allocation;                  //!< Start of the single allocation holding all arrays
+} wol_packet_cache_t;
+
+//! @brief Socket tuning of a sender, see ::wake_on_lan_sender_set_options(), all zero keeps the defaults of the system
+typedef struct wol_sender_options_s
+{
+    int send_buffer;                    //!< `SO_SNDBUF` of both sockets in bytes, e.g. 4 MB for bursts of thousands of packets, Linux tries `SO_SNDBUFFORCE` first to exceed `net.core.wmem_max`
+    uint8_t dscp;                       //!< DSCP from 0 to 63 as `IP_TOS` and `IPV6_TCLASS`, e.g. 46 for expedited forwarding
+    uint8_t priority;                   //!< Linux only, `SO_PRIORITY` from 1 to 6, selects the band of the queueing discipline of the device
+    uint8_t ttl;                        //!< `IP_TTL` of the IPv4 socket, directed broadcasts to remote subnets need one hop per router
+} wol_sender_options_t;
+
+//! @brief Reusable sender context, see ::wake_on_lan_sender_open()
+//! @details Keeps one broadcast-enabled UDP socket (and under Windows one Winsock initialization)
+//!          alive across any number of sends, so the setup and teardown is only paid once.
+//!          The sockets in wake_on_lan_sender_s::sockfd and wake_on_lan_sender_s::sockfd_v6 can be
+//!          registered with epoll/kqueue/IOCP, see ::wake_on_lan_sender_set_nonblocking().
+typedef struct wake_on_lan_sender_s
+{
+    intptr_t sockfd;                    //!< Under Windows the `SOCKET`, otherwise the file descriptor, -1 if the sender is closed
+    intptr_t sockfd_v6;                 //!< Socket of the IPv6 targets, -1 if the host has no IPv6
+    uint32_t ip_v6_interface;           //!< Interface index of IPv6 targets without scope, see ::wake_on_lan_sender_set_ipv6()
+    bool wsa_started;                   //!< Windows only, `WSAStartup()` was successful and `WSACleanup()` is pending
+    wol_packet_cache_t * cache;         //!< Optional packet cache, set after ::wake_on_lan_sender_open(), NULL to build every packet
+    struct wol_metrics_s * metrics;     //!< Optional instrumentation block, set after ::wake_on_lan_sender_open(), only updated if built with `WAKE_ON_LAN_METRICS`, see wake_on_lan_metrics.h
+    uint64_t pacing_interval_ns;        //!< Time between two packets, 0 if the sender is not paced, see ::wake_on_lan_sender_set_rate()
+    uint64_t pacing_burst;              //!< Number of packets that may be sent back to back
+    uint64_t pacing_tat_ns;             //!< Theoretical send time of the next packet, the state of the token bucket
+    uint64_t backoff_ns;                //!< Wait before the next send because the device queue was full (`ENOBUFS`), 0 while packets are accepted
+    uint64_t backoff_waited_ns;         //!< Sum of the waits since the last accepted packet, limited by ::WOL_SENDER_BACKOFF_LIMIT_NS
+    void * uring;                       //!< Linux built with `WAKE_ON_LAN_IO_URING` only, state of the io_uring backend, NULL if the socket path is used
+} wake_on_lan_sender_t;
+
+//! @brief A single destination of a magic packet in binary form, see ::wol_target_parse()
+//! @details Parse a target once and send it any number of times without touching string parsing again.
+//!          A target with an all-zero wol_target_s::ip_v6 is an IPv4 target, see ::wol_target_is_v6().
+//!          A target with a SecureOn password gets the password appended to its packet, see ::wol_target_set_password().
+typedef struct wol_target_s
+{
+    uint32_t ip_v4;                     //!< IP v4 address as number, not in network order, 0 for an IPv6 target
+    uint16_t port;                      //!< Port number
+    uint8_t mac[6];                     //!< MAC address, most significant byte first
+    uint8_t ip_v6[16];                  //!< IP v6 address in network order, e.g. ff02::1 for all nodes of the link, all zero for an IPv4 target
+    uint32_t scope_id;                  //!< Interface index of a link-local or multicast IPv6 target, 0 for wake_on_lan_sender_s::ip_v6_interface
+    uint8_t password[WAKE_ON_LAN_PASSWORD_SIZE]; //!< SecureOn password, the first wol_target_s::password_length bytes are used
+    uint8_t password_length;            //!< 0 without password, otherwise 4 or ::WAKE_ON_LAN_PASSWORD_SIZE
+} wol_target_t;
+
+//! @brief Result of one target of ::wake_on_lan_batch()
+typedef struct wol_result_s
+{
+    wake_on_lan_errors_t return_value;  //!< Result for this target
+    int last_error;                     //!< Value of `WSAGetLastError()`/`errno` check enum ::wake_on_lan_errors_e of wol_result_t::return_value
+} wol_result_t;
+
+//! @brief Called by ::wol_send_queue_flush() for each target that has its result
+//! @param context Value of ::wol_send_queue_s::context
+//! @param index Index of the target in ::wol_send_queue_s::targets
+//! @param result Result of the target
+typedef void (* wol_send_callback_t)(void * context, size_t index, const wol_result_t * result);
+
+//! @brief Results of a batch as structure of arrays, see ::wake_on_lan_batch_results()
+//! @details The caller provides the arrays, 5 bytes per target instead of the 8 of a ::wol_result_t, and the
+//!          codes of many targets are checked at once by ::wol_results_count().
+typedef struct wol_results_s
+{
+    uint8_t * codes;                    //!< ::wake_on_lan_errors_t of each target as one byte
+    int32_t * errors;                   //!< Value of `WSAGetLastError()`/`errno` of each target, 0 on success, can be NULL if not necessary
+    size_t count;                       //!< Number of valid results, set by ::wake_on_lan_batch_results()
+} wol_results_t;
+
+//! @brief Targets waiting to be sent by a non-blocking sender, see ::wol_send_queue_flush()
+//! @details Set the targets, count and optionally results and callback, everything else to 0.
+typedef struct wol_send_queue_s
+{
+    const wol_target_t * targets;       //!< Array of targets to send
+    size_t count;                       //!< Number of targets
+    size_t next;                        //!< Index of the next target to send, the progress of the queue
+    size_t failed;                      //!< Number of targets that failed
+    wol_result_t * results;             //!< Array of wol_send_queue_s::count results, can be NULL if not necessary
+    wol_send_callback_t callback;       //!< Called for every target with its result, can be NULL
+    void * context;                     //!< Passed to wol_send_queue_s::callback
+    uint64_t ready_at_ns;               //!< After ::WAKE_ON_LAN_ERRORS_AGAIN, the ::wol_clock_ns() time of the next pacing token or of the end of the `ENOBUFS` backoff, 0 to wait for a writable socket
+} wol_send_queue_t;
+
 
 /*---------------------------------------------------------------------*
  *  public: extern variables
@@ -74,8 +213,251 @@ extern const char * wake_on_lan_errors[];
 //! @param port Port number
 //! @param mac_cstr MAC in the standard hex format with or without colon notation
 //! @return The return value is defined by the enum ::wake_on_lan_errors_e
+//! @details Single-shot wrapper that opens a ::wake_on_lan_sender_t, sends one packet and closes it again.
+//!          Use the sender functions directly if more than one packet is sent.
 wake_on_lan_errors_t wake_on_lan(wake_on_lan_t * wol, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr);
 
+//! @brief Converts the IP and MAC strings into a binary target
+//! @param[out] target Pointer to the target to fill, only written on success
+//! @param ip_v4_cstr IPv4 in dotted decimal notation or IPv6, optionally with a scope, e.g. `ff02::1%eth0`
+//! @param port Port number
+//! @param mac_cstr MAC in the standard hex format with or without colon notation
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_IP or ::WAKE_ON_LAN_ERRORS_MAC
+wake_on_lan_errors_t wol_target_parse(wol_target_t * target, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr);
+
+//! @brief Fills a binary target from numbers, e.g. a MAC already stored as 48-bit integer
+//! @param[out] target Pointer to the target to fill
+//! @param ip_v4 IPv4 address as number, not in network order
+//! @param port Port number
+//! @param mac MAC address as number, the upper 16 bits are ignored
+void wol_target_init(wol_target_t * target, uint32_t ip_v4, uint16_t port, uint64_t mac);
+
+//! @brief Fills a binary IPv6 target from numbers
+//! @param[out] target Pointer to the target to fill
+//! @param ip_v6 IPv6 address in network order, must not be all zero
+//! @param scope_id Interface index for link-local and multicast addresses, 0 for the interface of the sender
+//! @param port Port number
+//! @param mac MAC address as number, the upper 16 bits are ignored
+void wol_target_init_v6(wol_target_t * target, const uint8_t ip_v6[16], uint32_t scope_id, uint16_t port, uint64_t mac);
+
+//! @brief Checks whether a target is sent over IPv6
+//! @param target Pointer to the target
+//! @return True if wol_target_s::ip_v6 is not all zero
+bool wol_target_is_v6(const wol_target_t * target);
+
+//! @brief Returns the MAC of a target as 48-bit number
+//! @param target Pointer to the target
+//! @return MAC address as number
+uint64_t wol_target_mac(const wol_target_t * target);
+
+//! @brief Sets or removes the SecureOn password of a target
+//! @param target Pointer to the target
+//! @param password_cstr 6 bytes in the format of a MAC, e.g. `01:02:03:04:05:06`, or 4 bytes as IPv4, e.g. `1.2.3.4`; NULL or empty removes the password
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_PASSWORD, the target is unchanged on failure
+wake_on_lan_errors_t wol_target_set_password(wol_target_t * target, const char * password_cstr);
+
+//! @brief Size of the magic packet of a target
+//! @param target Pointer to the target
+//! @return ::WAKE_ON_LAN_PACKET_SIZE plus the length of the password
+size_t wol_packet_size(const wol_target_t * target);
+
+//! @brief Builds a magic packet, 6 bytes 0xFF followed by 16 repetitions of the MAC
+//! @details The MAC repetitions are written with 16 byte stores (SSE2/NEON) or 64-bit words,
+//!          this is the builder behind the single, batch and cache paths.
+//! @param[out] packet Buffer of at least ::WAKE_ON_LAN_PACKET_SIZE bytes, no alignment required
+//! @param mac MAC address, most significant byte first
+void wol_packet_build(uint8_t * packet, const uint8_t mac[6]);
+
+//! @brief Builds the magic packet of a target, with ::wol_packet_build() and the password of the target appended
+//! @param[out] packet Buffer of at least ::wol_packet_size() bytes, no alignment required
+//! @param target Pointer to the target
+//! @return Size of the packet, see ::wol_packet_size()
+size_t wol_packet_build_target(uint8_t * packet, const wol_target_t * target);
+
+//! @brief Builds the magic packets of an array of targets into one buffer
+//! @details Targets with and without password can be mixed, every packet starts at a multiple of `stride`.
+//! @param[out] packets Buffer of at least `n * stride` bytes
+//! @param stride Distance between two packets in bytes, at least ::WAKE_ON_LAN_PACKET_MAX_SIZE
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+void wol_packet_build_many(uint8_t * packets, size_t stride, const wol_target_t * targets, size_t n);
+
+//! @brief Allocates an empty packet cache
+//! @param[out] cache Pointer to the cache to initialize
+//! @param capacity Maximum number of packets
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_MEMORY
+wake_on_lan_errors_t wol_packet_cache_init(wol_packet_cache_t * cache, size_t capacity);
+
+//! @brief Releases the storage of a packet cache
+//! @param cache Pointer to the cache
+void wol_packet_cache_free(wol_packet_cache_t * cache);
+
+//! @brief Removes all packets from the cache, the storage is kept
+//! @param cache Pointer to the cache
+void wol_packet_cache_clear(wol_packet_cache_t * cache);
+
+//! @brief Looks up the packet without password of a MAC without inserting it
+//! @param cache Pointer to the cache
+//! @param mac MAC address, most significant byte first
+//! @return Pointer to the packet of ::WAKE_ON_LAN_PACKET_SIZE bytes or NULL if the MAC is not cached
+const uint8_t * wol_packet_cache_find(const wol_packet_cache_t * cache, const uint8_t mac[6]);
+
+//! @brief Returns the packet without password of a MAC, the packet is built and inserted on the first request
+//! @param cache Pointer to the cache
+//! @param mac MAC address, most significant byte first
+//! @return Pointer to the packet of ::WAKE_ON_LAN_PACKET_SIZE bytes or NULL if the MAC is not cached and the cache is full
+const uint8_t * wol_packet_cache_get(wol_packet_cache_t * cache, const uint8_t mac[6]);
+
+//! @brief Returns the packet of a target including its password, the packet is built and inserted on the first request
+//! @details A MAC has one cached packet per password length. A target whose password differs from the cached one
+//!          of the same length gets NULL, the caller builds that packet itself.
+//! @param cache Pointer to the cache
+//! @param target Pointer to the target
+//! @return Pointer to the packet of ::wol_packet_size() bytes or NULL if it is not cached and can not be inserted
+const uint8_t * wol_packet_cache_get_target(wol_packet_cache_t * cache, const wol_target_t * target);
+
+//! @brief Opens a sender context with a broadcast-enabled UDP socket
+//! @details Under Windows, Winsock is initialized here. On failure, everything already acquired
+//!          is released again and the sender is left closed.
+//! @param[out] sender Pointer to the sender context to initialize
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+wake_on_lan_errors_t wake_on_lan_sender_open(wake_on_lan_sender_t * sender, wake_on_lan_t * wol);
+
+//! @brief Opens a sender context for a few packets to one target, like ::wake_on_lan_sender_open() but lighter
+//! @details Only the socket of the address family of the target is opened and the io_uring backend is not set up,
+//!          the other socket of the sender stays -1.
+//! @param[out] sender Pointer to the sender context to initialize
+//! @param target Pointer to the target the sender is used for
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+wake_on_lan_errors_t wake_on_lan_sender_open_target(wake_on_lan_sender_t * sender, const wol_target_t * target, wake_on_lan_t * wol);
+
+//! @brief Sends a magic packet/Wake-On-LAN (WOL) packet over an open sender context
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @param ip_v4_cstr IPv4 in dotted decimal notation
+//! @param port Port number
+//! @param mac_cstr MAC in the standard hex format with or without colon notation
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+wake_on_lan_errors_t wake_on_lan_sender_send(wake_on_lan_sender_t * sender, wake_on_lan_t * wol, const char * ip_v4_cstr, uint16_t port, const char * mac_cstr);
+
+//! @brief Sends a magic packet/Wake-On-LAN (WOL) packet to a pre-parsed target over an open sender context
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @param target Pointer to the target
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+wake_on_lan_errors_t wake_on_lan_sender_send_target(wake_on_lan_sender_t * sender, wake_on_lan_t * wol, const wol_target_t * target);
+
+//! @brief Sends a magic packet to each target over an open sender context
+//! @details The packets are taken from ::wake_on_lan_sender_s::cache if set, otherwise built on the stack. Under Linux they are handed to the kernel in chunks
+//!          with one `sendmmsg()` call per chunk, otherwise `sendto()` is called for each target.
+//!          A failing target does not stop the batch. A full device queue (`ENOBUFS`) does not fail the targets,
+//!          the batch waits with a growing backoff, see ::WOL_SENDER_BACKOFF_LIMIT_NS.
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param[out] results Array of `n` results, one for each target, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, otherwise the error of a failed target
+wake_on_lan_errors_t wake_on_lan_batch(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t n, wol_result_t * results);
+
+//! @brief Sends a magic packet to each target like ::wake_on_lan_batch() and stores the results as structure of arrays
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param[out] results Pointer to the results, wol_results_s::codes and, if set, wol_results_s::errors hold at least `n` elements
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, otherwise the error of a failed target
+wake_on_lan_errors_t wake_on_lan_batch_results(wake_on_lan_sender_t * sender, const wol_target_t * targets, size_t n, wol_results_t * results);
+
+//! @brief Counts the results of a batch by error
+//! @details Runs of successful targets are skipped 16 at a time with one compare (SSE2/NEON) or two 64-bit words, so counting costs little next to sending.
+//! @param results Pointer to the results
+//! @param[out] counts Number of targets for each ::wake_on_lan_errors_t, codes out of range are counted as ::WAKE_ON_LAN_ERRORS_UNKNOWN
+//! @return Number of failed targets
+size_t wol_results_count(const wol_results_t * results, size_t counts[WAKE_ON_LAN_ERRORS_COUNT]);
+
+//! @brief Writes the message of an error and, for errors of the system, its code and text into a buffer
+//! @details Reentrant and without allocation, e.g. `Failed to send packet (105: No buffer space available)`, without newline.
+//! @param[out] buffer Buffer of the text, always terminated
+//! @param size Size of the buffer
+//! @param error Error of a call or of wol_result_s::return_value
+//! @param last_error Value of wake_on_lan_s::last_error or wol_result_s::last_error, 0 or -1 if there is none
+//! @return Length of the text in the buffer
+size_t wol_error_format(char * buffer, size_t size, wake_on_lan_errors_t error, int last_error);
+
+//! @brief Switches the socket of a sender between blocking and non-blocking mode
+//! @details In non-blocking mode ::wol_send_queue_flush() returns instead of waiting.
+//!          ::wake_on_lan_batch() still completes the whole batch, it waits for a writable socket itself.
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param nonblocking True for non-blocking mode
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION
+wake_on_lan_errors_t wake_on_lan_sender_set_nonblocking(wake_on_lan_sender_t * sender, bool nonblocking, wake_on_lan_t * wol);
+
+//! @brief Sends as many queued targets as possible without waiting, for event loops
+//! @details Call it again when the sockets in wake_on_lan_sender_s::sockfd and wake_on_lan_sender_s::sockfd_v6 are writable (wol_send_queue_s::ready_at_ns is 0)
+//!          or when the time wol_send_queue_s::ready_at_ns has come (paced sender).
+//! @param sender Pointer to a sender context, usually in non-blocking mode
+//! @param queue Pointer to the queue, wol_send_queue_s::next holds the progress
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if the queue is empty, ::WAKE_ON_LAN_ERRORS_AGAIN if targets are left,
+//!         failed targets are counted in wol_send_queue_s::failed
+wake_on_lan_errors_t wol_send_queue_flush(wake_on_lan_sender_t * sender, wol_send_queue_t * queue);
+
+//! @brief Binds the socket of a sender to a source address and, under Linux, to a network device
+//! @details Use this to send out of a specific interface when several interfaces reach different broadcast domains.
+//!          `SO_BINDTODEVICE` can require the `CAP_NET_RAW` capability, other systems use the source address only.
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param source_ip_v4 Local IPv4 address as number, not in network order, 0 for any address
+//! @param device Name of the network device, e.g. `eth1`, NULL or empty to use the source address only
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION or ::WAKE_ON_LAN_ERRORS_BIND
+wake_on_lan_errors_t wake_on_lan_sender_bind(wake_on_lan_sender_t * sender, uint32_t source_ip_v4, const char * device, wake_on_lan_t * wol);
+
+//! @brief Sets the interface and hop limit of the IPv6 targets of a sender
+//! @details The interface is set as `IPV6_MULTICAST_IF` and is the scope of link-local targets without one.
+//!          The hop limit is set for multicast and unicast targets, 1 keeps the packets on the link.
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param interface_index Index of the network device, e.g. from `if_nametoindex()`, 0 for the default interface
+//! @param hop_limit Hop limit from 1 to 255, 0 keeps the default of the system
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION if the host has no IPv6 or ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION
+wake_on_lan_errors_t wake_on_lan_sender_set_ipv6(wake_on_lan_sender_t * sender, uint32_t interface_index, uint8_t hop_limit, wake_on_lan_t * wol);
+
+//! @brief Tunes the sockets of a sender for large bursts and for routed networks
+//! @details A burst larger than the send buffer fails with `EAGAIN`/`ENOBUFS` or makes the kernel drop packets, so
+//!          bursts of thousands of hosts need a larger `SO_SNDBUF`. Every option is set even if another one fails.
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param options Pointer to the options, zero fields are not set
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION with the error of the first failed option
+wake_on_lan_errors_t wake_on_lan_sender_set_options(wake_on_lan_sender_t * sender, const wol_sender_options_t * options, wake_on_lan_t * wol);
+
+//! @brief Paces all following sends of a sender with a token bucket
+//! @details Back-to-back broadcasts are often dropped by switches and NICs, pacing avoids expensive retry waves.
+//!          A batch is then handed to the kernel in chunks of at most `burst` packets, with high-resolution
+//!          sleeps in between. Under Linux the rate is also set as `SO_MAX_PACING_RATE`.
+//! @param sender Pointer to a sender context opened with ::wake_on_lan_sender_open()
+//! @param packets_per_second Average rate, 0 disables the pacing
+//! @param burst Number of packets that may be sent back to back, 0 is handled as 1
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION, the user space pacing is active in both cases
+wake_on_lan_errors_t wake_on_lan_sender_set_rate(wake_on_lan_sender_t * sender, uint32_t packets_per_second, uint32_t burst, wake_on_lan_t * wol);
+
+//! @brief Monotonic high-resolution clock
+//! @return Nanoseconds since an unspecified start
+uint64_t wol_clock_ns(void);
+
+//! @brief Sleeps until the monotonic clock ::wol_clock_ns() reaches a deadline
+//! @param deadline_ns Deadline in nanoseconds of ::wol_clock_ns(), returns immediately if it has passed
+void wol_sleep_until_ns(uint64_t deadline_ns);
+
+//! @brief Closes the socket of a sender context and, under Windows, releases Winsock
+//! @details Closing an already closed sender does nothing.
+//! @param sender Pointer to the sender context
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t, only written if the close fails, can be NULL if not necessary
+//! @return The return value is defined by the enum ::wake_on_lan_errors_e
+wake_on_lan_errors_t wake_on_lan_sender_close(wake_on_lan_sender_t * sender, wake_on_lan_t * wol);
+
 
 /*---------------------------------------------------------------------*
  *  public: static inline functions
@@ -0,0 +1,424 @@
+//! @file
+//! @brief The wake_on_lan C++ header file.
+//! @details Header-only C++17 layer on top of wake_on_lan.h, without further dependencies
+//!
+//! MACs and IPs already held as numbers go straight into binary targets, without formatting them
+//! into strings that ::wol_target_parse() parses again. Literals of known hosts are checked by the
+//! compiler and their targets and magic packets are built at compile time:
+//!
+//! @code
+//! using namespace wol::literals;
+//! constexpr wol_target_t gateway = wol::make_target("10.0.0.255"_ipv4, 9, "00:11:22:33:44:55"_mac);
+//! constexpr auto packet = wol::make_packet("00:11:22:33:44:55"_mac);
+//!
+//! wol::sender sender;
+//! if(sender) { sender.send(gateway); }
+//! @endcode
+//!
+//! With C++20 the literals are `consteval`, so an invalid literal never compiles, and batches take `std::span`.
+//! Nothing in this header allocates, ::wol::sender::batch() hands the caller's arrays to ::wake_on_lan_batch().
+//!
+//! @note Only the C module wake_on_lan.c has to be compiled and linked, see wake_on_lan.h.
+
+#ifndef INC_WAKE_ON_LAN_HPP_
+#define INC_WAKE_ON_LAN_HPP_
+
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if __cplusplus >= 202002L && defined(__has_include)
+  #if __has_include(<span>)
+    #include <span>
+  #endif
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief `consteval` under C++20, so literals are always evaluated by the compiler, otherwise `constexpr`
+#if defined(__cpp_consteval)
+  #define WOL_CONSTEVAL consteval
+#else
+  #define WOL_CONSTEVAL constexpr
+#endif
+
+
+namespace wol
+{
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief A magic packet without password, see ::wol::make_packet()
+using packet_t = std::array<std::uint8_t, WAKE_ON_LAN_PACKET_SIZE>;
+
+//! @brief MAC address as number, the format of ::wol_target_mac() and ::wol_target_init()
+struct mac_address
+{
+    std::uint64_t value = 0;            //!< MAC in the low 48 bits, most significant byte first on the wire
+
+    //! @brief Bytes of the MAC in wire order
+    //! @return Array of the 6 bytes
+    constexpr std::array<std::uint8_t, 6> bytes() const noexcept
+    {
+        std::array<std::uint8_t, 6> bytes{};
+        for(std::size_t i = 0; i < bytes.size(); i++)
+        {
+            bytes[i] = static_cast<std::uint8_t>(value >> (8 * (5 - i)));
+        }
+        return bytes;
+    }
+
+    friend constexpr bool operator==(mac_address a, mac_address b) noexcept { return a.value == b.value; }
+    friend constexpr bool operator!=(mac_address a, mac_address b) noexcept { return a.value != b.value; }
+};
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+namespace detail
+{
+
+//! @brief Value of a hex digit
+//! @param c Character
+//! @return 0 to 15, -1 if `c` is no hex digit
+constexpr int hex_value(char c) noexcept
+{
+    return ('0' <= c && c <= '9') ? (c - '0')
+         : ('a' <= c && c <= 'f') ? (c - 'a' + 10)
+         : ('A' <= c && c <= 'F') ? (c - 'A' + 10)
+         : -1;
+}
+
+//! @brief Never defined as `constexpr`, so calling it from a constant expression stops the compilation
+//! @details Reached at runtime only by a C++17 literal that is not used in a constant expression.
+//! @return 0
+inline std::uint64_t invalid_literal() noexcept
+{
+    return 0;
+}
+
+} // namespace detail
+
+
+/*---------------------------------------------------------------------*
+ *  public: functions
+ *---------------------------------------------------------------------*/
+
+//! @brief Parses a MAC, the same formats as ::wol_parse_mac(): `00:11:22:33:44:55`, `00-11-22-33-44-55`, `0011.2233.4455` or `001122334455`
+//! @param text MAC as text
+//! @param[out] mac Receives the MAC
+//! @return True if `text` is a complete MAC
+constexpr bool parse_mac(std::string_view text, mac_address & mac) noexcept
+{
+    // Every 3rd character is a separator with 17 characters, every 5th with 14
+    std::size_t group = 0;
+    char separator = 0;
+    switch(text.size())
+    {
+        case 17: group = 3; separator = text[2]; break;
+        case 14: group = 5; separator = '.'; break;
+        case 12: break;
+        default: return false;
+    }
+    if(17 == text.size() && ':' != separator && '-' != separator)
+    {
+        return false;
+    }
+
+    std::uint64_t value = 0;
+    for(std::size_t i = 0; i < text.size(); i++)
+    {
+        if(0 != group && group - 1 == i % group)
+        {
+            if(separator != text[i])
+            {
+                return false;
+            }
+            continue;
+        }
+        int digit = detail::hex_value(text[i]);
+        if(0 > digit)
+        {
+            return false;
+        }
+        value = (value << 4) | static_cast<std::uint64_t>(digit);
+    }
+
+    mac.value = value;
+    return true;
+}
+
+//! @brief Parses an IPv4 address in dotted decimal notation
+//! @param text IP as text, four numbers up to 255, the same format as ::wol_parse_ip_v4()
+//! @param[out] ip_v4 Receives the IP as number, not in network order
+//! @return True if `text` is a complete IPv4 address
+constexpr bool parse_ip_v4(std::string_view text, std::uint32_t & ip_v4) noexcept
+{
+    std::uint32_t value = 0;
+    std::size_t position = 0;
+
+    for(int part = 0; part < 4; part++)
+    {
+        if(0 != part)
+        {
+            if(position >= text.size() || '.' != text[position])
+            {
+                return false;
+            }
+            position++;
+        }
+
+        std::size_t start = position;
+        std::uint32_t number = 0;
+        while(position < text.size() && '0' <= text[position] && text[position] <= '9' && position - start < 3)
+        {
+            number = number * 10 + static_cast<std::uint32_t>(text[position] - '0');
+            position++;
+        }
+        if(start == position || 255 < number)
+        {
+            return false;
+        }
+        value = (value << 8) | number;
+    }
+
+    if(position != text.size())
+    {
+        return false;
+    }
+
+    ip_v4 = value;
+    return true;
+}
+
+//! @brief Binary IPv4 target, the compile-time counterpart of ::wol_target_init()
+//! @param ip_v4 IPv4 address as number, not in network order
+//! @param port Port number
+//! @param mac MAC address
+//! @return The target without password
+constexpr wol_target_t make_target(std::uint32_t ip_v4, std::uint16_t port, mac_address mac) noexcept
+{
+    wol_target_t target{};
+    target.ip_v4 = ip_v4;
+    target.port = port;
+    std::array<std::uint8_t, 6> bytes = mac.bytes();
+    for(std::size_t i = 0; i < bytes.size(); i++)
+    {
+        target.mac[i] = bytes[i];
+    }
+    return target;
+}
+
+//! @brief Magic packet of a MAC, the compile-time counterpart of ::wol_packet_build()
+//! @param mac MAC address
+//! @return 6 bytes `0xFF` followed by 16 repetitions of the MAC
+constexpr packet_t make_packet(mac_address mac) noexcept
+{
+    packet_t packet{};
+    std::array<std::uint8_t, 6> bytes = mac.bytes();
+    for(std::size_t i = 0; i < 6; i++)
+    {
+        packet[i] = 0xFF;
+    }
+    for(std::size_t i = 6; i < packet.size(); i++)
+    {
+        packet[i] = bytes[(i - 6) % 6];
+    }
+    return packet;
+}
+
+//! @brief Literals of known hosts, e.g. `"00:11:22:33:44:55"_mac` and `"10.0.0.255"_ipv4`
+namespace literals
+{
+
+//! @brief MAC literal, an invalid MAC does not compile
+WOL_CONSTEVAL mac_address operator""_mac(const char * text, std::size_t length) noexcept
+{
+    mac_address mac{};
+    if(!parse_mac(std::string_view(text, length), mac))
+    {
+        mac.value = detail::invalid_literal();
+    }
+    return mac;
+}
+
+//! @brief IPv4 literal as number, not in network order, an invalid IP does not compile
+WOL_CONSTEVAL std::uint32_t operator""_ipv4(const char * text, std::size_t length) noexcept
+{
+    std::uint32_t ip_v4 = 0;
+    if(!parse_ip_v4(std::string_view(text, length), ip_v4))
+    {
+        ip_v4 = static_cast<std::uint32_t>(detail::invalid_literal());
+    }
+    return ip_v4;
+}
+
+} // namespace literals
+
+
+/*---------------------------------------------------------------------*
+ *  public: classes
+ *---------------------------------------------------------------------*/
+
+//! @brief Owner of an open ::wake_on_lan_sender_t, closed by the destructor
+//! @details Move-only, a moved-from sender is closed. The C functions that are not wrapped, e.g.
+//!          ::wake_on_lan_sender_bind() or the packet cache, take ::wol::sender::get().
+class sender
+{
+public:
+    //! @brief Opens the sender, see ::wake_on_lan_sender_open(), check the result with ::wol::sender::error()
+    sender() noexcept
+    {
+        error_ = wake_on_lan_sender_open(&sender_, &wol_);
+    }
+
+    sender(const sender &) = delete;
+    sender & operator=(const sender &) = delete;
+
+    sender(sender && other) noexcept
+        : sender_(other.sender_), wol_(other.wol_), error_(other.error_)
+    {
+        other.release();
+    }
+
+    sender & operator=(sender && other) noexcept
+    {
+        if(this != &other)
+        {
+            close();
+            sender_ = other.sender_;
+            wol_ = other.wol_;
+            error_ = other.error_;
+            other.release();
+        }
+        return *this;
+    }
+
+    ~sender()
+    {
+        close();
+    }
+
+    //! @brief True if the sender is open
+    explicit operator bool() const noexcept
+    {
+        return -1 != sender_.sockfd;
+    }
+
+    //! @brief Result of the open or of the last failed call
+    wake_on_lan_errors_t error() const noexcept
+    {
+        return error_;
+    }
+
+    //! @brief Value of `WSAGetLastError()`/`errno` of the last failed call
+    int last_error() const noexcept
+    {
+        return wol_.last_error;
+    }
+
+    //! @brief The C context, stays owned by this object
+    wake_on_lan_sender_t * get() noexcept
+    {
+        return &sender_;
+    }
+
+    //! @brief Sends the magic packet of a target, see ::wake_on_lan_sender_send_target()
+    wake_on_lan_errors_t send(const wol_target_t & target) noexcept
+    {
+        return keep(wake_on_lan_sender_send_target(&sender_, &wol_, &target));
+    }
+
+    //! @brief Sends the magic packet of a MAC held as number, without any string
+    wake_on_lan_errors_t send(std::uint32_t ip_v4, std::uint16_t port, mac_address mac) noexcept
+    {
+        wol_target_t target = make_target(ip_v4, port, mac);
+        return send(target);
+    }
+
+    //! @brief Sends a magic packet to each target, see ::wake_on_lan_batch()
+    //! @param targets Array of `n` targets
+    //! @param n Number of targets
+    //! @param[out] results Array of `n` results, can be NULL if not necessary
+    wake_on_lan_errors_t batch(const wol_target_t * targets, std::size_t n, wol_result_t * results = nullptr) noexcept
+    {
+        return keep(wake_on_lan_batch(&sender_, targets, n, results));
+    }
+
+#if defined(__cpp_lib_span)
+    //! @brief Sends a magic packet to each target, see ::wake_on_lan_batch()
+    //! @param targets Targets, e.g. a `std::vector`, a `std::array` or a mapped ::wol_inventory_t
+    //! @param results Empty or one result for each target
+    //! @return ::WAKE_ON_LAN_ERRORS_UNKNOWN without sending if `results` has another size
+    wake_on_lan_errors_t batch(std::span<const wol_target_t> targets, std::span<wol_result_t> results = {}) noexcept
+    {
+        if(!results.empty() && results.size() != targets.size())
+        {
+            wol_.last_error = -1;
+            return keep(WAKE_ON_LAN_ERRORS_UNKNOWN);
+        }
+        return batch(targets.data(), targets.size(), results.empty() ? nullptr : results.data());
+    }
+#endif
+
+    //! @brief Paces the following sends, see ::wake_on_lan_sender_set_rate()
+    wake_on_lan_errors_t set_rate(std::uint32_t packets_per_second, std::uint32_t burst) noexcept
+    {
+        return keep(wake_on_lan_sender_set_rate(&sender_, packets_per_second, burst, &wol_));
+    }
+
+    //! @brief Closes the sender early, see ::wake_on_lan_sender_close()
+    wake_on_lan_errors_t close() noexcept
+    {
+        return keep(wake_on_lan_sender_close(&sender_, &wol_));
+    }
+
+private:
+    //! @brief Leaves the context to another owner, so that nothing is closed twice
+    void release() noexcept
+    {
+        sender_.sockfd = -1;
+        sender_.sockfd_v6 = -1;
+        sender_.wsa_started = false;
+        sender_.uring = nullptr;
+        error_ = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+    }
+
+    //! @brief Remembers an error for ::wol::sender::error()
+    wake_on_lan_errors_t keep(wake_on_lan_errors_t error) noexcept
+    {
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            error_ = error;
+        }
+        return error;
+    }
+
+    wake_on_lan_sender_t sender_{};
+    wake_on_lan_t wol_{};
+    wake_on_lan_errors_t error_ = WAKE_ON_LAN_ERRORS_NONE;
+};
+
+} // namespace wol
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+#endif /* INC_WAKE_ON_LAN_HPP_ */
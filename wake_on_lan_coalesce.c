@@ -0,0 +1,352 @@
+//! @file
+//! @brief The wake_on_lan_coalesce source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_coalesce.h"
+
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+
+  #include <windows.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Smallest number of slots of a table
+#define COALESCE_MIN_SLOTS 16
+
+//! @brief Marks a slot as used, so that the MAC 00:00:00:00:00:00 is a valid key too
+#define COALESCE_KEY_USED ( UINT64_C(1) << 48 )
+
+//! @brief Multiplier of the Fibonacci hash of the keys
+#define COALESCE_HASH UINT64_C(0x9E3779B97F4A7C15)
+
+//! @brief Time of a slot that is being taken over by another MAC, requests that see it start over
+#define COALESCE_RECLAIM UINT64_MAX
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Atomically reads a slot field with acquire order
+//! @param value Pointer to the field
+//! @return Value of the field
+static uint64_t atomic_load_u64(const uint64_t * value);
+
+//! @brief Atomically writes a slot field with release order
+//! @param value Pointer to the field
+//! @param desired New value
+static void atomic_store_u64(uint64_t * value, uint64_t desired);
+
+//! @brief Atomically replaces a slot field if it still holds the expected value
+//! @param value Pointer to the field
+//! @param expected Value the field must hold
+//! @param desired New value
+//! @return True if the field was replaced
+static bool atomic_cas_u64(uint64_t * value, uint64_t expected, uint64_t desired);
+
+//! @brief Builds the key of a MAC
+//! @param mac MAC
+//! @return Key with ::COALESCE_KEY_USED set
+static uint64_t coalesce_key(const uint8_t mac[6]);
+
+//! @brief Checks whether a time is inside the window of a slot time
+//! @param coalesce Pointer to the table
+//! @param time Time of the slot, 0 while the slot is being filled
+//! @param now_ns Current time
+//! @return True if a request at `now_ns` is merged
+static bool coalesce_inside(const wol_coalesce_t * coalesce, uint64_t time, uint64_t now_ns);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+#if defined(_MSC_VER)
+
+static uint64_t atomic_load_u64(const uint64_t * value)
+{
+    // A compare exchange with equal values never changes the field and is a full barrier
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)value, 0, 0);
+}
+
+static void atomic_store_u64(uint64_t * value, uint64_t desired)
+{
+    InterlockedExchange64((volatile LONG64 *)value, (LONG64)desired);
+}
+
+static bool atomic_cas_u64(uint64_t * value, uint64_t expected, uint64_t desired)
+{
+    return (LONG64)expected == InterlockedCompareExchange64((volatile LONG64 *)value, (LONG64)desired, (LONG64)expected);
+}
+
+#else
+
+static uint64_t atomic_load_u64(const uint64_t * value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static void atomic_store_u64(uint64_t * value, uint64_t desired)
+{
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+}
+
+static bool atomic_cas_u64(uint64_t * value, uint64_t expected, uint64_t desired)
+{
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#endif
+
+static uint64_t coalesce_key(const uint8_t mac[6])
+{
+    return COALESCE_KEY_USED
+        | (uint64_t)mac[0] << 40 | (uint64_t)mac[1] << 32 | (uint64_t)mac[2] << 24
+        | (uint64_t)mac[3] << 16 | (uint64_t)mac[4] << 8 | (uint64_t)mac[5];
+}
+
+static bool coalesce_inside(const wol_coalesce_t * coalesce, uint64_t time, uint64_t now_ns)
+{
+    // A slot being filled belongs to a request that is admitted right now, a later time to a concurrent one
+    return 0 == time || now_ns < time + coalesce->window_ns;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_coalesce_open(wol_coalesce_t * coalesce, size_t capacity, uint32_t window_ms, wake_on_lan_t * wol)
+{
+    if(NULL == coalesce)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    coalesce->keys = NULL;
+    coalesce->times = NULL;
+
+    if(0 == capacity)
+    {
+        capacity = WOL_COALESCE_CAPACITY;
+    }
+
+    // At most half of the slots are used, so the linear probes stay short
+    size_t slots = COALESCE_MIN_SLOTS;
+    unsigned bits = 4;
+    while(slots < capacity * 2)
+    {
+        if(SIZE_MAX / 2 < slots)
+        {
+            if(wol) { wol->last_error = -1; }
+            return WAKE_ON_LAN_ERRORS_MEMORY;
+        }
+        slots *= 2;
+        bits++;
+    }
+
+    coalesce->keys = calloc(slots, sizeof(*coalesce->keys));
+    coalesce->times = calloc(slots, sizeof(*coalesce->times));
+    if(NULL == coalesce->keys || NULL == coalesce->times)
+    {
+        wol_coalesce_close(coalesce);
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    coalesce->mask = slots - 1;
+    coalesce->shift = 64 - bits;
+    coalesce->window_ns = (uint64_t)window_ms * UINT64_C(1000000);
+    coalesce->suppressed = 0;
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+bool wol_coalesce_admit(wol_coalesce_t * coalesce, const uint8_t mac[6], uint64_t now_ns)
+{
+    uint64_t key = coalesce_key(mac);
+
+    // Every lost race for a slot starts the lookup over, the winner is done after two stores
+    for(;;)
+    {
+        size_t slot = (size_t)((key * COALESCE_HASH) >> coalesce->shift);
+        size_t empty = SIZE_MAX;
+        size_t expired = SIZE_MAX;
+        uint64_t expired_time = 0;
+        bool restart = false;
+
+        for(size_t probe = 0; probe <= coalesce->mask; probe++, slot = (slot + 1) & coalesce->mask)
+        {
+            uint64_t slot_key = atomic_load_u64(&coalesce->keys[slot]);
+
+            if(0 == slot_key)
+            {
+                empty = slot;
+                break;
+            }
+
+            uint64_t time = atomic_load_u64(&coalesce->times[slot]);
+            if(COALESCE_RECLAIM == time)
+            {
+                restart = true;
+                break;
+            }
+
+            if(key != slot_key)
+            {
+                // The first slot of another MAC after its window is taken over if the MAC is not in the table
+                if(SIZE_MAX == expired && !coalesce_inside(coalesce, time, now_ns))
+                {
+                    expired = slot;
+                    expired_time = time;
+                }
+                continue;
+            }
+
+            // The time may belong to a MAC that took the slot over after the key was read
+            if(key != atomic_load_u64(&coalesce->keys[slot]))
+            {
+                restart = true;
+                break;
+            }
+
+            if(coalesce_inside(coalesce, time, now_ns))
+            {
+#if defined(_MSC_VER)
+                InterlockedIncrement64((volatile LONG64 *)&coalesce->suppressed);
+#else
+                __atomic_fetch_add(&coalesce->suppressed, 1, __ATOMIC_RELAXED);
+#endif
+                return false;
+            }
+
+            // Of concurrent requests after the window, only the one that moves the time is sent
+            if(atomic_cas_u64(&coalesce->times[slot], time, now_ns))
+            {
+                return true;
+            }
+            restart = true;
+            break;
+        }
+
+        if(restart)
+        {
+            continue;
+        }
+
+        if(SIZE_MAX != expired)
+        {
+            // Requests for the old MAC start over while the time is COALESCE_RECLAIM and insert it elsewhere
+            if(atomic_cas_u64(&coalesce->times[expired], expired_time, COALESCE_RECLAIM))
+            {
+                atomic_store_u64(&coalesce->keys[expired], key);
+                atomic_store_u64(&coalesce->times[expired], (0 == now_ns) ? 1 : now_ns);
+                return true;
+            }
+            continue;
+        }
+
+        if(SIZE_MAX != empty)
+        {
+            if(atomic_cas_u64(&coalesce->keys[empty], 0, key))
+            {
+                // Until the time is written, concurrent requests for the MAC see 0 and are merged
+                atomic_store_u64(&coalesce->times[empty], (0 == now_ns) ? 1 : now_ns);
+                return true;
+            }
+            continue;
+        }
+
+        // A table full of MACs inside their window lets the request through rather than losing a wake
+        return true;
+    }
+}
+
+bool wol_coalesce_contains(const wol_coalesce_t * coalesce, const uint8_t mac[6], uint64_t now_ns)
+{
+    uint64_t key = coalesce_key(mac);
+    size_t slot = (size_t)((key * COALESCE_HASH) >> coalesce->shift);
+
+    for(size_t probe = 0; probe <= coalesce->mask; probe++, slot = (slot + 1) & coalesce->mask)
+    {
+        uint64_t slot_key = atomic_load_u64(&coalesce->keys[slot]);
+
+        if(0 == slot_key)
+        {
+            return false;
+        }
+        if(key == slot_key)
+        {
+            uint64_t time = atomic_load_u64(&coalesce->times[slot]);
+            return COALESCE_RECLAIM != time && coalesce_inside(coalesce, time, now_ns);
+        }
+    }
+
+    return false;
+}
+
+size_t wol_coalesce_filter(wol_coalesce_t * coalesce, wol_target_t * targets, size_t n, size_t * indices)
+{
+    uint64_t now_ns = wol_clock_ns();
+    size_t admitted = 0;
+
+    for(size_t i = 0; i < n; i++)
+    {
+        if(!wol_coalesce_admit(coalesce, targets[i].mac, now_ns))
+        {
+            continue;
+        }
+
+        if(admitted != i)
+        {
+            targets[admitted] = targets[i];
+        }
+        if(indices)
+        {
+            indices[admitted] = i;
+        }
+        admitted++;
+    }
+
+    return admitted;
+}
+
+void wol_coalesce_close(wol_coalesce_t * coalesce)
+{
+    if(NULL == coalesce)
+    {
+        return;
+    }
+
+    free(coalesce->times);
+    free(coalesce->keys);
+    coalesce->times = NULL;
+    coalesce->keys = NULL;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
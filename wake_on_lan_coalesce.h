@@ -0,0 +1,113 @@
+//! @file
+//! @brief The wake_on_lan_coalesce header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Suppresses duplicate wake requests. The first request for a MAC is let through and
+//! starts a window; further requests for the same MAC inside the window are merged into
+//! the first one, after the window the next request is let through again. The MACs are
+//! kept in an open-addressing hash table with a timestamp per entry. Lookups and updates
+//! use atomic operations only, so any number of threads can share one table without locks.
+//!
+//! @note A new MAC takes over the first slot on its probe path whose window is over, so the table
+//!       only has to hold the MACs requested within one window. When every slot is inside its
+//!       window, requests for new MACs are let through without coalescing.
+
+#ifndef INC_WAKE_ON_LAN_COALESCE_H_
+#define INC_WAKE_ON_LAN_COALESCE_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Default number of MACs of ::wol_coalesce_open()
+#define WOL_COALESCE_CAPACITY 65536
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Table of recently requested MACs, see ::wol_coalesce_open()
+typedef struct wol_coalesce_s
+{
+    uint64_t * keys;                    //!< MAC of each slot with bit 48 set, 0 for an empty slot
+    uint64_t * times;                   //!< ::wol_clock_ns() time of the last request let through, 0 while the slot is being filled, `UINT64_MAX` while another MAC takes it over
+    size_t mask;                        //!< Number of slots minus 1, the number of slots is a power of 2
+    unsigned shift;                     //!< Shift of the hash to get a slot index
+    uint64_t window_ns;                 //!< Length of the window
+    uint64_t suppressed;                //!< Number of requests merged into an earlier one, updated atomically
+} wol_coalesce_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Opens a coalescing table
+//! @param[out] coalesce Pointer to the table to initialize
+//! @param capacity Number of MACs the table can hold within one window, 0 for ::WOL_COALESCE_CAPACITY; the table has twice as many slots
+//! @param window_ms Length of the window in milliseconds
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_UNKNOWN
+wake_on_lan_errors_t wol_coalesce_open(wol_coalesce_t * coalesce, size_t capacity, uint32_t window_ms, wake_on_lan_t * wol);
+
+//! @brief Decides whether a request for a MAC is sent and, if so, starts a new window for it
+//! @details Safe to call from any number of threads at the same time; of concurrent requests for one MAC, exactly one is admitted.
+//! @param coalesce Pointer to an open table
+//! @param mac MAC of the request
+//! @param now_ns Current ::wol_clock_ns() time
+//! @return True if the request is sent, false if it is merged into an earlier request of the window
+bool wol_coalesce_admit(wol_coalesce_t * coalesce, const uint8_t mac[6], uint64_t now_ns);
+
+//! @brief Checks whether a MAC is inside its window without changing the table
+//! @param coalesce Pointer to an open table
+//! @param mac MAC to check
+//! @param now_ns Current ::wol_clock_ns() time
+//! @return True if a request for the MAC would be merged
+bool wol_coalesce_contains(const wol_coalesce_t * coalesce, const uint8_t mac[6], uint64_t now_ns);
+
+//! @brief Moves the admitted targets to the front of an array and keeps their order
+//! @param coalesce Pointer to an open table
+//! @param[in,out] targets Array of `n` targets, the first targets are the admitted ones afterwards
+//! @param n Number of targets
+//! @param[out] indices Array of `n` entries, receives the original index of each admitted target, can be NULL if not necessary
+//! @return Number of admitted targets
+size_t wol_coalesce_filter(wol_coalesce_t * coalesce, wol_target_t * targets, size_t n, size_t * indices);
+
+//! @brief Releases a coalescing table, no other thread may use it anymore
+//! @param coalesce Pointer to the table, a closed table is ignored
+void wol_coalesce_close(wol_coalesce_t * coalesce);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_COALESCE_H_ */
@@ -0,0 +1,866 @@
+//! @file
+//! @brief The wake_on_lan_confirm source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_confirm.h"
+
+#if defined(WAKE_ON_LAN_METRICS)
+  #include "wake_on_lan_metrics.h"
+#endif
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+
+  #include <arpa/inet.h>
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <linux/if_packet.h>
+  #include <net/if.h>
+  #include <netinet/in.h>
+  #include <poll.h>
+  #include <sys/ioctl.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Nanoseconds per millisecond
+#define NS_PER_MS UINT64_C(1000000)
+
+//! @brief Deadline of a host that is not waited for anymore
+#define CONFIRM_DONE UINT64_MAX
+
+//! @brief ICMP type of an echo request
+#define ICMP_ECHO_REQUEST 8
+
+//! @brief ICMP type of an echo reply
+#define ICMP_ECHO_REPLY 0
+
+//! @brief Size of the ICMP echo messages, header and an 8 byte payload
+#define ICMP_ECHO_SIZE 16
+
+//! @brief EtherType of ARP
+#define ARP_ETHERTYPE 0x0806
+
+//! @brief Size of an ARP message for IPv4 over Ethernet
+#define ARP_MESSAGE_SIZE 28
+
+//! @brief Size of the buffer for one received answer, enough for an IPv4 header and an ICMP echo reply
+#define CONFIRM_RECEIVE_SIZE 128
+
+//! @brief Largest number of TCP connects in flight, further due hosts wait in confirm_s::queue for a free slot
+#define CONFIRM_TCP_WINDOW 1024
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+//! @brief A probed IP together with the index of its host, sorted by IP to map answers to hosts
+typedef struct confirm_lookup_s
+{
+    uint32_t ip_v4;                     //!< Probe address of the host
+    size_t index;                       //!< Index of the host
+} confirm_lookup_t;
+
+//! @brief Probe state of one host
+typedef struct confirm_host_s
+{
+    uint64_t deadline_ns;               //!< Time of the next resend and probe, ::CONFIRM_DONE if the host answered, is not probed or timed out
+    uint64_t interval_ns;               //!< Time between the next probe and the one after it
+    uint32_t probe_ip_v4;               //!< Address of the probes, not in network order
+    uint32_t resends;                   //!< Number of magic packets resent so far
+    uint32_t max_resends;               //!< Largest number of resends, `UINT32_MAX` until the timeout
+    int tcp_fd;                         //!< Pending connect of ::WOL_PROBE_TCP, -1 if none
+    uint64_t connect_end_ns;            //!< Time the pending connect is given up to free its slot
+    bool queued;                        //!< The host waits in confirm_s::queue for a connect slot
+} confirm_host_t;
+
+//! @brief State of one ::wol_wake_and_confirm() call
+typedef struct confirm_s
+{
+    wake_on_lan_sender_t * sender;      //!< Sender of the magic packets
+    const wol_target_t * targets;       //!< Targets of the call
+    size_t n;                           //!< Number of targets
+    wol_confirm_options_t options;      //!< Options with the defaults filled in
+    wol_confirm_result_t * results;     //!< Results of the call
+    confirm_host_t * hosts;             //!< Probe state of each host
+    confirm_lookup_t * lookup;          //!< Probed hosts sorted by IP
+    size_t lookup_count;                //!< Number of entries in confirm_s::lookup
+    size_t pending;                     //!< Number of probed hosts without answer
+    size_t * active;                    //!< Indices of the hosts that may still be due, hosts that are done are dropped on the next scan
+    size_t active_count;                //!< Number of entries in confirm_s::active
+    size_t * queue;                     //!< Ring of `n` host indices waiting for a connect slot of ::WOL_PROBE_TCP
+    size_t queue_head;                  //!< First entry of confirm_s::queue
+    size_t queue_count;                 //!< Number of entries in confirm_s::queue
+    size_t connects;                    //!< Number of TCP connects in flight, at most ::CONFIRM_TCP_WINDOW
+    uint64_t start_ns;                  //!< Time of the first magic packets
+    int probe_fd;                       //!< Shared socket of ::WOL_PROBE_ICMP and ::WOL_PROBE_ARP, -1 for ::WOL_PROBE_TCP
+    bool icmp_raw;                      //!< The ICMP socket is a raw socket, answers start with the IP header
+    uint16_t icmp_id;                   //!< Identifier of the echo requests of a raw socket
+    int ifindex;                        //!< Index of the device of ::WOL_PROBE_ARP
+    uint8_t source_mac[6];              //!< MAC of the device of ::WOL_PROBE_ARP
+    uint32_t source_ip_v4;              //!< IPv4 of the device of ::WOL_PROBE_ARP, not in network order
+} confirm_t;
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+//! @brief Orders lookup entries by IP, for `qsort()`
+//! @param a Pointer to the first ::confirm_lookup_t
+//! @param b Pointer to the second ::confirm_lookup_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_lookup(const void * a, const void * b);
+
+//! @brief Opens the shared probe socket of ICMP and ARP
+//! @param confirm Pointer to the state
+//! @param[out] last_error Value of `errno` on failure
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION or ::WAKE_ON_LAN_ERRORS_BIND
+static wake_on_lan_errors_t confirm_open(confirm_t * confirm, int * last_error);
+
+//! @brief Sends a probe to a host
+//! @param confirm Pointer to the state
+//! @param index Index of the host
+//! @param now_ns Current time, answers of a connect that completes at once count from here
+static void confirm_probe(confirm_t * confirm, size_t index, uint64_t now_ns);
+
+//! @brief Starts the non-blocking connect of ::WOL_PROBE_TCP to a host
+//! @param confirm Pointer to the state
+//! @param index Index of the host, without pending connect
+//! @param now_ns Current time
+static void confirm_connect(confirm_t * confirm, size_t index, uint64_t now_ns);
+
+//! @brief Closes the pending connect of a host and frees its slot
+//! @param confirm Pointer to the state
+//! @param index Index of the host
+static void confirm_disconnect(confirm_t * confirm, size_t index);
+
+//! @brief Starts the connects of queued hosts while slots are free
+//! @param confirm Pointer to the state
+//! @param now_ns Current time
+static void confirm_fill(confirm_t * confirm, uint64_t now_ns);
+
+//! @brief Marks a host as up
+//! @param confirm Pointer to the state
+//! @param index Index of the host
+//! @param now_ns Time of the answer
+static void confirm_up(confirm_t * confirm, size_t index, uint64_t now_ns);
+
+//! @brief Reads all waiting answers of the shared probe socket
+//! @param confirm Pointer to the state
+//! @param now_ns Time of the answers
+static void confirm_receive(confirm_t * confirm, uint64_t now_ns);
+
+//! @brief Marks every host with the probe address as up
+//! @param confirm Pointer to the state
+//! @param ip_v4 Source of an answer, not in network order
+//! @param now_ns Time of the answer
+static void confirm_answer(confirm_t * confirm, uint32_t ip_v4, uint64_t now_ns);
+
+//! @brief Internet checksum of RFC 1071
+//! @param data Message
+//! @param length Number of bytes of the message
+//! @return Checksum to store into the message
+static uint16_t checksum(const uint8_t * data, size_t length);
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+static int compare_lookup(const void * a, const void * b)
+{
+    const confirm_lookup_t * lookup_a = a;
+    const confirm_lookup_t * lookup_b = b;
+
+    if(lookup_a->ip_v4 != lookup_b->ip_v4)
+    {
+        return (lookup_a->ip_v4 < lookup_b->ip_v4) ? -1 : 1;
+    }
+
+    return (lookup_a->index < lookup_b->index) ? -1 : (lookup_a->index > lookup_b->index);
+}
+
+static wake_on_lan_errors_t confirm_open(confirm_t * confirm, int * last_error)
+{
+    if(WOL_PROBE_ICMP == confirm->options.probe)
+    {
+        // A ping socket needs no privileges, the kernel fills in the identifier and the checksum
+        confirm->probe_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_ICMP);
+        if(0 > confirm->probe_fd)
+        {
+            confirm->probe_fd = socket(AF_INET, SOCK_RAW | SOCK_NONBLOCK, IPPROTO_ICMP);
+            confirm->icmp_raw = true;
+        }
+        if(0 > confirm->probe_fd)
+        {
+            *last_error = errno;
+            return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+        }
+
+        confirm->icmp_id = (uint16_t)getpid();
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    if(WOL_PROBE_ARP == confirm->options.probe)
+    {
+        if(NULL == confirm->options.device || IFNAMSIZ <= strlen(confirm->options.device))
+        {
+            *last_error = -1;
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+
+        confirm->probe_fd = socket(AF_PACKET, SOCK_DGRAM | SOCK_NONBLOCK, htons(ARP_ETHERTYPE));
+        if(0 > confirm->probe_fd)
+        {
+            *last_error = errno;
+            return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+        }
+
+        struct ifreq request;
+        memset(&request, 0, sizeof(request));
+        strncpy(request.ifr_name, confirm->options.device, IFNAMSIZ - 1);
+
+        if (0 > ioctl(confirm->probe_fd, SIOCGIFINDEX, &request))
+        {
+            *last_error = errno;
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+        confirm->ifindex = request.ifr_ifindex;
+
+        if (0 > ioctl(confirm->probe_fd, SIOCGIFHWADDR, &request))
+        {
+            *last_error = errno;
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+        memcpy(confirm->source_mac, request.ifr_hwaddr.sa_data, 6);
+
+        request.ifr_addr.sa_family = AF_INET;
+        if (0 > ioctl(confirm->probe_fd, SIOCGIFADDR, &request))
+        {
+            *last_error = errno;
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+        confirm->source_ip_v4 = ntohl(((const struct sockaddr_in *)&request.ifr_addr)->sin_addr.s_addr);
+
+        struct sockaddr_ll addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(ARP_ETHERTYPE);
+        addr.sll_ifindex = confirm->ifindex;
+
+        if (0 > bind(confirm->probe_fd, (const struct sockaddr *)&addr, sizeof(addr)))
+        {
+            *last_error = errno;
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    // TCP opens one socket per probe
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static void confirm_probe(confirm_t * confirm, size_t index, uint64_t now_ns)
+{
+    confirm_host_t * host = &confirm->hosts[index];
+
+    if(WOL_PROBE_ICMP == confirm->options.probe)
+    {
+        uint8_t message[ICMP_ECHO_SIZE] = { 0 };
+        message[0] = ICMP_ECHO_REQUEST;
+        message[4] = (uint8_t)(confirm->icmp_id >> 8);
+        message[5] = (uint8_t)(confirm->icmp_id & 0xFF);
+        message[6] = (uint8_t)(index >> 8);
+        message[7] = (uint8_t)(index & 0xFF);
+
+        uint16_t sum = checksum(message, sizeof(message));
+        message[2] = (uint8_t)(sum >> 8);
+        message[3] = (uint8_t)(sum & 0xFF);
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(host->probe_ip_v4);
+
+        // A probe lost to a full socket buffer is repeated at the next deadline
+        sendto(confirm->probe_fd, message, sizeof(message), 0, (const struct sockaddr *)&addr, sizeof(addr));
+    }
+    else if(WOL_PROBE_ARP == confirm->options.probe)
+    {
+        uint8_t message[ARP_MESSAGE_SIZE] = { 0 };
+        message[1] = 1;                                 // Ethernet
+        message[2] = 0x08;                              // IPv4
+        message[4] = 6;
+        message[5] = 4;
+        message[7] = 1;                                 // Request
+        memcpy(message + 8, confirm->source_mac, 6);
+        message[14] = (uint8_t)(confirm->source_ip_v4 >> 24);
+        message[15] = (uint8_t)(confirm->source_ip_v4 >> 16);
+        message[16] = (uint8_t)(confirm->source_ip_v4 >> 8);
+        message[17] = (uint8_t)(confirm->source_ip_v4 >> 0);
+        message[24] = (uint8_t)(host->probe_ip_v4 >> 24);
+        message[25] = (uint8_t)(host->probe_ip_v4 >> 16);
+        message[26] = (uint8_t)(host->probe_ip_v4 >> 8);
+        message[27] = (uint8_t)(host->probe_ip_v4 >> 0);
+
+        struct sockaddr_ll addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(ARP_ETHERTYPE);
+        addr.sll_ifindex = confirm->ifindex;
+        addr.sll_halen = 6;
+        memset(addr.sll_addr, 0xFF, 6);
+
+        sendto(confirm->probe_fd, message, sizeof(message), 0, (const struct sockaddr *)&addr, sizeof(addr));
+    }
+    else
+    {
+        // A due host restarts its connect, unless the window is full or other hosts wait for it already
+        confirm_disconnect(confirm, index);
+
+        if(CONFIRM_TCP_WINDOW > confirm->connects && 0 == confirm->queue_count)
+        {
+            confirm_connect(confirm, index, now_ns);
+        }
+        else if(!host->queued)
+        {
+            confirm->queue[(confirm->queue_head + confirm->queue_count) % confirm->n] = index;
+            confirm->queue_count++;
+            host->queued = true;
+        }
+    }
+}
+
+static void confirm_connect(confirm_t * confirm, size_t index, uint64_t now_ns)
+{
+    confirm_host_t * host = &confirm->hosts[index];
+
+    int tcp_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+    if(0 > tcp_fd)
+    {
+        // Out of descriptors, the host is probed again at its next deadline
+        return;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(host->probe_ip_v4);
+    addr.sin_port = htons(confirm->options.tcp_port);
+
+    if(0 == connect(tcp_fd, (const struct sockaddr *)&addr, sizeof(addr)) || ECONNREFUSED == errno)
+    {
+        close(tcp_fd);
+        confirm_up(confirm, index, now_ns);
+    }
+    else if(EINPROGRESS == errno)
+    {
+        host->tcp_fd = tcp_fd;
+        host->connect_end_ns = now_ns + (uint64_t)confirm->options.interval_ms * NS_PER_MS;
+        confirm->connects++;
+    }
+    else
+    {
+        close(tcp_fd);
+    }
+}
+
+static void confirm_disconnect(confirm_t * confirm, size_t index)
+{
+    confirm_host_t * host = &confirm->hosts[index];
+
+    if(-1 != host->tcp_fd)
+    {
+        close(host->tcp_fd);
+        host->tcp_fd = -1;
+        confirm->connects--;
+    }
+}
+
+static void confirm_fill(confirm_t * confirm, uint64_t now_ns)
+{
+    while(CONFIRM_TCP_WINDOW > confirm->connects && 0 != confirm->queue_count)
+    {
+        size_t index = confirm->queue[confirm->queue_head];
+        confirm->queue_head = (confirm->queue_head + 1) % confirm->n;
+        confirm->queue_count--;
+        confirm->hosts[index].queued = false;
+
+        if(CONFIRM_DONE != confirm->hosts[index].deadline_ns)
+        {
+            confirm_connect(confirm, index, now_ns);
+        }
+    }
+}
+
+static void confirm_up(confirm_t * confirm, size_t index, uint64_t now_ns)
+{
+    confirm_host_t * host = &confirm->hosts[index];
+    wol_confirm_result_t * result = &confirm->results[index];
+
+    if(result->up || CONFIRM_DONE == host->deadline_ns)
+    {
+        return;
+    }
+
+    confirm_disconnect(confirm, index);
+
+    result->up = true;
+    result->latency_ns = now_ns - confirm->start_ns;
+    host->deadline_ns = CONFIRM_DONE;
+    confirm->pending--;
+}
+
+static void confirm_receive(confirm_t * confirm, uint64_t now_ns)
+{
+    uint8_t buffer[CONFIRM_RECEIVE_SIZE];
+
+    for(;;)
+    {
+        struct sockaddr_storage from;
+        socklen_t from_length = sizeof(from);
+
+        ssize_t length = recvfrom(confirm->probe_fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&from, &from_length);
+        if(0 > length)
+        {
+            if(EINTR == errno)
+            {
+                continue;
+            }
+            break;
+        }
+
+        if(WOL_PROBE_ICMP == confirm->options.probe)
+        {
+            const uint8_t * message = buffer;
+            size_t message_length = (size_t)length;
+
+            if(confirm->icmp_raw)
+            {
+                // A raw socket receives every ICMP message of the host together with its IP header
+                size_t header_length = (0 < length) ? (size_t)(buffer[0] & 0x0F) * 4 : 0;
+                if(message_length < header_length + 8)
+                {
+                    continue;
+                }
+                message += header_length;
+                message_length -= header_length;
+
+                uint16_t id = (uint16_t)(message[4] << 8 | message[5]);
+                if(id != confirm->icmp_id)
+                {
+                    continue;
+                }
+            }
+
+            if(8 > message_length || ICMP_ECHO_REPLY != message[0] || AF_INET != from.ss_family)
+            {
+                continue;
+            }
+
+            confirm_answer(confirm, ntohl(((const struct sockaddr_in *)&from)->sin_addr.s_addr), now_ns);
+        }
+        else
+        {
+            // Any ARP message from a probed address shows the host is up, replies and gratuitous announcements alike
+            if(ARP_MESSAGE_SIZE > length || 0x08 != buffer[2] || 0x00 != buffer[3] || 6 != buffer[4] || 4 != buffer[5])
+            {
+                continue;
+            }
+
+            uint32_t sender_ip_v4 = (uint32_t)buffer[14] << 24 | (uint32_t)buffer[15] << 16 | (uint32_t)buffer[16] << 8 | buffer[17];
+            confirm_answer(confirm, sender_ip_v4, now_ns);
+        }
+    }
+}
+
+static void confirm_answer(confirm_t * confirm, uint32_t ip_v4, uint64_t now_ns)
+{
+    size_t low = 0;
+    size_t high = confirm->lookup_count;
+
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if(confirm->lookup[middle].ip_v4 < ip_v4)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for(; low < confirm->lookup_count && ip_v4 == confirm->lookup[low].ip_v4; low++)
+    {
+        confirm_up(confirm, confirm->lookup[low].index, now_ns);
+    }
+}
+
+static uint16_t checksum(const uint8_t * data, size_t length)
+{
+    uint32_t sum = 0;
+
+    for(size_t i = 0; i + 1 < length; i += 2)
+    {
+        sum += (uint32_t)data[i] << 8 | data[i + 1];
+    }
+    if(length & 1)
+    {
+        sum += (uint32_t)data[length - 1] << 8;
+    }
+
+    while(sum >> 16)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+
+    return (uint16_t)~sum;
+}
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_wake_and_confirm(wake_on_lan_sender_t * sender, const wol_target_t * targets, const uint32_t * probe_ip_v4, size_t n, const wol_confirm_options_t * options, wol_confirm_result_t * results)
+{
+    if(NULL == sender || (-1 == sender->sockfd && -1 == sender->sockfd_v6) || NULL == results || (NULL == targets && 0 != n))
+    {
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        memset(&results[i], 0, sizeof(results[i]));
+    }
+
+    if(0 == n)
+    {
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+#if defined(__linux__)
+    static const wol_confirm_options_t default_options = { 0 };
+
+    confirm_t confirm;
+    memset(&confirm, 0, sizeof(confirm));
+    confirm.sender = sender;
+    confirm.targets = targets;
+    confirm.n = n;
+    confirm.options = options ? *options : default_options;
+    confirm.results = results;
+    confirm.probe_fd = -1;
+
+    if(0 == confirm.options.interval_ms)     { confirm.options.interval_ms = WOL_CONFIRM_INTERVAL_MS; }
+    if(0 == confirm.options.max_interval_ms) { confirm.options.max_interval_ms = WOL_CONFIRM_MAX_INTERVAL_MS; }
+    if(0 == confirm.options.timeout_ms)      { confirm.options.timeout_ms = WOL_CONFIRM_TIMEOUT_MS; }
+
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+    int last_error = 0;
+
+    confirm.hosts = malloc(n * sizeof(*confirm.hosts));
+    confirm.lookup = malloc(n * sizeof(*confirm.lookup));
+    wol_target_t * resend = malloc(n * sizeof(*resend));
+    size_t * resend_index = malloc(n * sizeof(*resend_index));
+    wol_result_t * resend_results = malloc(n * sizeof(*resend_results));
+    size_t descriptor_size = ((CONFIRM_TCP_WINDOW < n) ? CONFIRM_TCP_WINDOW : n) + 1;
+    struct pollfd * descriptors = malloc(descriptor_size * sizeof(*descriptors));
+    size_t * descriptor_index = malloc(descriptor_size * sizeof(*descriptor_index));
+    confirm.active = malloc(n * sizeof(*confirm.active));
+    confirm.queue = malloc(n * sizeof(*confirm.queue));
+
+    do{
+
+        if(NULL == confirm.hosts || NULL == confirm.lookup || NULL == resend || NULL == resend_index
+            || NULL == resend_results || NULL == descriptors || NULL == descriptor_index
+            || NULL == confirm.active || NULL == confirm.queue)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+            last_error = -1;
+            break;
+        }
+
+        return_value = confirm_open(&confirm, &last_error);
+        if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+        {
+            break;
+        }
+
+        confirm.start_ns = wol_clock_ns();
+        wake_on_lan_batch(sender, targets, n, resend_results);
+
+        for(size_t i = 0; i < n; i++)
+        {
+            confirm_host_t * host = &confirm.hosts[i];
+            host->probe_ip_v4 = probe_ip_v4 ? probe_ip_v4[i] : targets[i].ip_v4;
+            host->interval_ns = (uint64_t)confirm.options.interval_ms * NS_PER_MS;
+            host->resends = 0;
+            host->max_resends = confirm.options.resend_limits ? confirm.options.resend_limits[i]
+                : (0 == confirm.options.max_resends) ? UINT32_MAX : confirm.options.max_resends;
+            host->tcp_fd = -1;
+            host->queued = false;
+            host->deadline_ns = (0 == host->probe_ip_v4) ? CONFIRM_DONE : confirm.start_ns;
+
+            results[i].return_value = resend_results[i].return_value;
+            results[i].last_error = resend_results[i].last_error;
+            results[i].packets = 1;
+
+            if(CONFIRM_DONE != host->deadline_ns)
+            {
+                confirm.lookup[confirm.lookup_count].ip_v4 = host->probe_ip_v4;
+                confirm.lookup[confirm.lookup_count].index = i;
+                confirm.lookup_count++;
+                confirm.active[confirm.active_count++] = i;
+                confirm.pending++;
+            }
+        }
+        qsort(confirm.lookup, confirm.lookup_count, sizeof(*confirm.lookup), compare_lookup);
+
+        uint64_t end_ns = confirm.start_ns + (uint64_t)confirm.options.timeout_ms * NS_PER_MS;
+        uint64_t max_interval_ns = (uint64_t)confirm.options.max_interval_ms * NS_PER_MS;
+
+        for(uint64_t now_ns = confirm.start_ns; 0 != confirm.pending && now_ns < end_ns; now_ns = wol_clock_ns())
+        {
+            // Due hosts get the magic packet again, except at their first deadline, and a new probe
+            size_t resend_count = 0;
+            uint64_t next_ns = end_ns;
+
+            // Only the hosts still pending are scanned, the list is compacted on the way
+            size_t active_count = 0;
+            for(size_t k = 0; k < confirm.active_count; k++)
+            {
+                size_t i = confirm.active[k];
+                confirm_host_t * host = &confirm.hosts[i];
+                if(CONFIRM_DONE == host->deadline_ns)
+                {
+                    continue;
+                }
+
+                // A connect without answer until the end of the first interval gives its slot to the queue
+                if(-1 != host->tcp_fd && host->connect_end_ns <= now_ns)
+                {
+                    confirm_disconnect(&confirm, i);
+                }
+
+                if(host->deadline_ns <= now_ns)
+                {
+                    bool first_probe = (host->deadline_ns == confirm.start_ns);
+                    if(!first_probe && (UINT32_MAX == host->max_resends || host->resends < host->max_resends))
+                    {
+                        resend[resend_count] = targets[i];
+                        resend_index[resend_count] = i;
+                        resend_count++;
+                        host->resends++;
+                    }
+
+                    host->deadline_ns = now_ns + host->interval_ns;
+                    if(!first_probe)
+                    {
+                        host->interval_ns = (2 * host->interval_ns < max_interval_ns) ? 2 * host->interval_ns : max_interval_ns;
+                    }
+
+                    confirm_probe(&confirm, i, now_ns);
+                    if(CONFIRM_DONE == host->deadline_ns)
+                    {
+                        continue;
+                    }
+                }
+
+                confirm.active[active_count++] = i;
+                if(host->deadline_ns < next_ns)
+                {
+                    next_ns = host->deadline_ns;
+                }
+            }
+            confirm.active_count = active_count;
+
+            if(0 != resend_count)
+            {
+                wake_on_lan_batch(sender, resend, resend_count, resend_results);
+                for(size_t i = 0; i < resend_count; i++)
+                {
+                    wol_confirm_result_t * result = &results[resend_index[i]];
+                    result->return_value = resend_results[i].return_value;
+                    result->last_error = resend_results[i].last_error;
+                    result->packets++;
+                }
+            }
+
+            if(WOL_PROBE_TCP == confirm.options.probe)
+            {
+                confirm_fill(&confirm, now_ns);
+            }
+
+            size_t descriptor_count = 0;
+            if(-1 != confirm.probe_fd)
+            {
+                descriptors[descriptor_count].fd = confirm.probe_fd;
+                descriptors[descriptor_count].events = POLLIN;
+                descriptors[descriptor_count].revents = 0;
+                descriptor_index[descriptor_count] = SIZE_MAX;
+                descriptor_count++;
+            }
+            for(size_t k = 0; WOL_PROBE_TCP == confirm.options.probe && k < confirm.active_count; k++)
+            {
+                size_t i = confirm.active[k];
+                if(-1 != confirm.hosts[i].tcp_fd)
+                {
+                    descriptors[descriptor_count].fd = confirm.hosts[i].tcp_fd;
+                    if(confirm.hosts[i].connect_end_ns < next_ns)
+                    {
+                        next_ns = confirm.hosts[i].connect_end_ns;
+                    }
+                    descriptors[descriptor_count].events = POLLOUT;
+                    descriptors[descriptor_count].revents = 0;
+                    descriptor_index[descriptor_count] = i;
+                    descriptor_count++;
+                }
+            }
+
+            now_ns = wol_clock_ns();
+            int timeout_ms = 0;
+            if(next_ns > now_ns)
+            {
+                uint64_t wait_ms = (next_ns - now_ns + NS_PER_MS - 1) / NS_PER_MS;
+                timeout_ms = (INT32_MAX < wait_ms) ? INT32_MAX : (int)wait_ms;
+            }
+
+            int ready = poll(descriptors, descriptor_count, timeout_ms);
+            if(0 >= ready)
+            {
+                continue;
+            }
+
+            now_ns = wol_clock_ns();
+            for(size_t i = 0; i < descriptor_count; i++)
+            {
+                if(0 == descriptors[i].revents)
+                {
+                    continue;
+                }
+
+                if(SIZE_MAX == descriptor_index[i])
+                {
+                    confirm_receive(&confirm, now_ns);
+                    continue;
+                }
+
+                // A refused connection is an answer too, only unreachable hosts and timeouts are not
+                size_t index = descriptor_index[i];
+                int error = 0;
+                socklen_t error_length = sizeof(error);
+                getsockopt(descriptors[i].fd, SOL_SOCKET, SO_ERROR, &error, &error_length);
+
+                if(0 == error || ECONNREFUSED == error)
+                {
+                    confirm_up(&confirm, index, now_ns);
+                }
+                else
+                {
+                    confirm_disconnect(&confirm, index);
+                }
+            }
+        }
+
+        for(size_t i = 0; i < n; i++)
+        {
+            if(-1 != confirm.hosts[i].tcp_fd)
+            {
+                close(confirm.hosts[i].tcp_fd);
+            }
+            if(CONFIRM_DONE != confirm.hosts[i].deadline_ns && WAKE_ON_LAN_ERRORS_NONE == results[i].return_value)
+            {
+                results[i].return_value = WAKE_ON_LAN_ERRORS_TIMEOUT;
+            }
+#if defined(WAKE_ON_LAN_METRICS)
+            if(sender->metrics && results[i].up)
+            {
+                wol_histogram_record(&sender->metrics->confirm_ns, results[i].latency_ns);
+            }
+#endif
+        }
+
+        return_value = (0 == confirm.pending) ? WAKE_ON_LAN_ERRORS_NONE : WAKE_ON_LAN_ERRORS_TIMEOUT;
+
+    }while(0);
+
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value && WAKE_ON_LAN_ERRORS_TIMEOUT != return_value)
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            results[i].return_value = return_value;
+            results[i].last_error = last_error;
+        }
+    }
+
+    if(-1 != confirm.probe_fd)
+    {
+        close(confirm.probe_fd);
+    }
+
+    free(confirm.queue);
+    free(confirm.active);
+    free(descriptor_index);
+    free(descriptors);
+    free(resend_results);
+    free(resend_index);
+    free(resend);
+    free(confirm.lookup);
+    free(confirm.hosts);
+
+    return return_value;
+#else
+    (void)probe_ip_v4;
+    (void)options;
+
+    for(size_t i = 0; i < n; i++)
+    {
+        results[i].return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+        results[i].last_error = -1;
+    }
+
+    return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+#endif
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,119 @@
+//! @file
+//! @brief The wake_on_lan_confirm header file.
+//! @details The module can be used in C and C++ under Linux
+//!
+//! Wakes hosts and waits until they answer. Each host is probed right after its magic
+//! packet; hosts that do not answer get the magic packet and the probe again with an
+//! exponentially growing interval. Hosts that answered are left alone, so no packet is
+//! resent to a host that is already up, and the time until each host answered is reported.
+//!
+//! @note ICMP probes use an unprivileged ping socket if `net.ipv4.ping_group_range` allows it,
+//!       otherwise a raw socket, ARP probes always need the capability `CAP_NET_RAW`.
+//!       Under Windows, ::wol_wake_and_confirm() fails with ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION.
+
+#ifndef INC_WAKE_ON_LAN_CONFIRM_H_
+#define INC_WAKE_ON_LAN_CONFIRM_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Default of wol_confirm_options_s::interval_ms
+#define WOL_CONFIRM_INTERVAL_MS 1000
+
+//! @brief Default of wol_confirm_options_s::max_interval_ms
+#define WOL_CONFIRM_MAX_INTERVAL_MS 16000
+
+//! @brief Default of wol_confirm_options_s::timeout_ms
+#define WOL_CONFIRM_TIMEOUT_MS 120000
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief How a host is asked whether it is up
+typedef enum wol_probe_e
+{
+    WOL_PROBE_ICMP = 0,                 //!< ICMP echo request
+    WOL_PROBE_TCP,                      //!< TCP connect to wol_confirm_options_s::tcp_port, an accepted or refused connection both count as answer
+    WOL_PROBE_ARP,                      //!< ARP request on wol_confirm_options_s::device, for hosts that drop ICMP and TCP
+} wol_probe_t;
+
+//! @brief Options of ::wol_wake_and_confirm(), all zero is a valid default with ICMP probes
+typedef struct wol_confirm_options_s
+{
+    wol_probe_t probe;                  //!< Kind of the probes
+    uint16_t tcp_port;                  //!< Port of ::WOL_PROBE_TCP
+    const char * device;                //!< Network device of ::WOL_PROBE_ARP, the probed hosts must be on its link
+    uint32_t interval_ms;               //!< Time until the first resend, doubled after every resend, 0 for ::WOL_CONFIRM_INTERVAL_MS
+    uint32_t max_interval_ms;           //!< Largest time between two resends, 0 for ::WOL_CONFIRM_MAX_INTERVAL_MS
+    uint32_t timeout_ms;                //!< Time until hosts without answer are given up, 0 for ::WOL_CONFIRM_TIMEOUT_MS
+    uint32_t max_resends;               //!< Largest number of magic packets resent to one host, 0 resends until the timeout; the probes continue
+    const uint32_t * resend_limits;     //!< Array of `n` resend limits used instead of wol_confirm_options_s::max_resends, 0 resends nothing and `UINT32_MAX` until the timeout, can be NULL
+} wol_confirm_options_t;
+
+//! @brief Result of one host of ::wol_wake_and_confirm()
+typedef struct wol_confirm_result_s
+{
+    wake_on_lan_errors_t return_value;  //!< Result of the last magic packet, ::WAKE_ON_LAN_ERRORS_TIMEOUT if it was sent but the host did not answer
+    int last_error;                     //!< Value of `errno` of the last magic packet
+    bool up;                            //!< The host answered a probe
+    uint32_t packets;                   //!< Number of magic packets sent to the host
+    uint64_t latency_ns;                //!< Time from the first magic packet until the answer, 0 if the host did not answer
+} wol_confirm_result_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Wakes the targets and waits until they answer the probes
+//! @details The magic packets are sent with ::wake_on_lan_batch() over the given sender, so its pacing, cache
+//!          and binding apply to the resends too. The probes of all hosts share one socket (ICMP and ARP)
+//!          or use one non-blocking connect per host (TCP), the answers are awaited with `poll()`. At most 1024
+//!          connects are in flight, further due hosts wait for a free slot.
+//! @param sender Pointer to an open sender context
+//! @param targets Array of `n` targets
+//! @param probe_ip_v4 Array of `n` IPv4 addresses of the hosts, not in network order, the target IP is usually a broadcast;
+//!                    NULL probes the target IPs, a 0 entry sends one magic packet to the host without probing it
+//! @param n Number of targets
+//! @param options Pointer to the options, can be NULL for the defaults
+//! @param[out] results Array of `n` results, one for each target
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every probed host answered, ::WAKE_ON_LAN_ERRORS_TIMEOUT if not,
+//!         otherwise the error of the probe socket, e.g. ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION without permission
+wake_on_lan_errors_t wol_wake_and_confirm(wake_on_lan_sender_t * sender, const wol_target_t * targets, const uint32_t * probe_ip_v4, size_t n, const wol_confirm_options_t * options, wol_confirm_result_t * results);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_CONFIRM_H_ */
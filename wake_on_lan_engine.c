@@ -0,0 +1,509 @@
+//! @file
+//! @brief The wake_on_lan_engine source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_engine.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WAKE_ON_LAN_METRICS)
+  #include "wake_on_lan_metrics.h"
+#endif
+
+#ifdef _WIN32
+
+  #include <windows.h>
+
+#else
+
+  #include <pthread.h>
+  #include <unistd.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+// @brief Lock-free counter to hand out the groups to the workers.
+#if defined(_MSC_VER)
+  #define ENGINE_FETCH_INCREMENT(COUNTER) ( (size_t)InterlockedIncrement(COUNTER) - 1 )
+#else
+  #define ENGINE_FETCH_INCREMENT(COUNTER) ( (size_t)__atomic_fetch_add(COUNTER, 1, __ATOMIC_RELAXED) )
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+#ifdef _WIN32
+typedef HANDLE engine_thread_t;
+#else
+typedef pthread_t engine_thread_t;
+#endif
+
+//! @brief A target index together with its sort key
+typedef struct engine_entry_s
+{
+    uint32_t ip_v4;                     //!< Destination IP of the target, 0 for an IPv6 target
+    uint32_t scope_id;                  //!< Interface index of an IPv6 target
+    uint8_t ip_v6[16];                  //!< Destination IP of an IPv6 target, all zero for an IPv4 target
+    size_t index;                       //!< Index of the target in the array passed to ::wol_engine_send()
+} engine_entry_t;
+
+//! @brief A range of ::engine_entry_t with the same destination IP
+typedef struct engine_group_s
+{
+    uint32_t ip_v4;                     //!< Destination IP of all targets of the group
+    size_t first;                       //!< Index of the first entry
+    size_t count;                       //!< Number of entries
+    wake_on_lan_errors_t return_value;  //!< Result of the group, only written by the worker that sends the group
+} engine_group_t;
+
+//! @brief Shared state of all workers of one ::wol_engine_send() call
+typedef struct engine_s
+{
+    const wol_target_t * targets;       //!< Targets passed to ::wol_engine_send()
+    wol_result_t * results;             //!< Results passed to ::wol_engine_send(), can be NULL
+    const wol_engine_options_t * options; //!< Options passed to ::wol_engine_send()
+    const engine_entry_t * entries;     //!< Targets sorted by destination IP
+    engine_group_t * groups;            //!< Groups of entries
+    size_t group_count;                 //!< Number of groups
+#if defined(_MSC_VER)
+    volatile LONG next_group;           //!< Index of the next group that is not taken by a worker
+#else
+    size_t next_group;                  //!< Index of the next group that is not taken by a worker
+#endif
+} engine_t;
+
+//! @brief Sender of a worker for all its groups without binding
+typedef struct engine_sender_s
+{
+    wake_on_lan_sender_t sender;        //!< Sender, only valid if engine_sender_s::open is set
+    bool open;                          //!< The sender is open
+    struct wol_metrics_s * metrics;     //!< Block of the worker, merged into wol_engine_options_s::metrics at its end, can be NULL
+} engine_sender_t;
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Orders entries by destination IP and keeps the order of the targets inside a group, for `qsort()`
+//! @details IPv6 targets are ordered by their address and scope after the IPv4 targets.
+//! @param a Pointer to the first ::engine_entry_t
+//! @param b Pointer to the second ::engine_entry_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_entry(const void * a, const void * b);
+
+//! @brief True if two sorted entries belong to the same group
+//! @param a Pointer to the first entry
+//! @param b Pointer to the second entry
+//! @return True if both have the same destination
+static bool same_destination(const engine_entry_t * a, const engine_entry_t * b);
+
+//! @brief Takes groups until none is left and sends them
+//! @param engine Pointer to the shared state
+static void engine_work(engine_t * engine);
+
+//! @brief Sends all targets of a group, over a bound sender of its own if the group has a binding, otherwise over the sender of the worker
+//! @param engine Pointer to the shared state
+//! @param group Pointer to the group, owned by the calling worker
+//! @param shared Pointer to the sender of the calling worker, opened on its first use
+static void engine_send_group(const engine_t * engine, engine_group_t * group, engine_sender_t * shared);
+
+//! @brief Opens a sender and applies the rate and the socket tuning of the options
+//! @param engine Pointer to the shared state
+//! @param[out] sender Pointer to the sender
+//! @param metrics Instrumentation block of the sender, can be NULL
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t of the error
+//! @return Return value of ::wake_on_lan_sender_open()
+static wake_on_lan_errors_t engine_sender_open(const engine_t * engine, wake_on_lan_sender_t * sender, struct wol_metrics_s * metrics, wake_on_lan_t * wol);
+
+//! @brief Searches the binding of a destination IP
+//! @param options Pointer to the options
+//! @param ip_v4 Destination IP
+//! @return Pointer to the binding or NULL if the destination IP has none
+static const wol_engine_binding_t * engine_binding(const wol_engine_options_t * options, uint32_t ip_v4);
+
+//! @brief Number of processors for the default number of workers
+//! @return Online processors, at least 1
+static size_t engine_processors(void);
+
+//! @brief Starts a worker thread running engine_work()
+//! @param[out] thread Handle of the new thread
+//! @param engine Pointer to the shared state
+//! @return True if the thread was started
+static bool engine_thread_start(engine_thread_t * thread, engine_t * engine);
+
+//! @brief Waits for the end of a worker thread and releases it
+//! @param thread Handle of the thread
+static void engine_thread_join(engine_thread_t thread);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static int compare_entry(const void * a, const void * b)
+{
+    const engine_entry_t * entry_a = a;
+    const engine_entry_t * entry_b = b;
+
+    if(entry_a->ip_v4 != entry_b->ip_v4)
+    {
+        return (entry_a->ip_v4 < entry_b->ip_v4) ? -1 : 1;
+    }
+
+    int ip_v6 = memcmp(entry_a->ip_v6, entry_b->ip_v6, sizeof(entry_a->ip_v6));
+    if(0 != ip_v6)
+    {
+        return ip_v6;
+    }
+
+    if(entry_a->scope_id != entry_b->scope_id)
+    {
+        return (entry_a->scope_id < entry_b->scope_id) ? -1 : 1;
+    }
+
+    return (entry_a->index < entry_b->index) ? -1 : (entry_a->index > entry_b->index);
+}
+
+static bool same_destination(const engine_entry_t * a, const engine_entry_t * b)
+{
+    return a->ip_v4 == b->ip_v4 && a->scope_id == b->scope_id && 0 == memcmp(a->ip_v6, b->ip_v6, sizeof(a->ip_v6));
+}
+
+static void engine_work(engine_t * engine)
+{
+    engine_sender_t shared = { 0 };
+
+#if defined(WAKE_ON_LAN_METRICS)
+    // Every worker counts into its own block without contention and merges it once at the end
+    shared.metrics = engine->options->metrics ? calloc(1, sizeof(*shared.metrics)) : NULL;
+#endif
+
+    for(size_t group = ENGINE_FETCH_INCREMENT(&engine->next_group); group < engine->group_count; group = ENGINE_FETCH_INCREMENT(&engine->next_group))
+    {
+        engine_send_group(engine, &engine->groups[group], &shared);
+    }
+
+    if(shared.open)
+    {
+        wake_on_lan_sender_close(&shared.sender, NULL);
+    }
+
+#if defined(WAKE_ON_LAN_METRICS)
+    if(shared.metrics)
+    {
+        wol_metrics_merge(engine->options->metrics, shared.metrics);
+        free(shared.metrics);
+    }
+#endif
+}
+
+static void engine_send_group(const engine_t * engine, engine_group_t * group, engine_sender_t * shared)
+{
+    const engine_entry_t * entries = engine->entries + group->first;
+    wake_on_lan_t wol = { 0 };
+
+    // The batch needs contiguous arrays, the group gathers its targets and scatters the results afterwards
+    wol_target_t * targets = malloc(group->count * (sizeof(wol_target_t) + sizeof(wol_result_t)));
+    wol_result_t * results = (wol_result_t *)(targets + group->count);
+
+    // Only a bound group needs a sender of its own, the others share the sender of the worker
+    const wol_engine_binding_t * binding = engine_binding(engine->options, group->ip_v4);
+    wake_on_lan_sender_t bound;
+    wake_on_lan_sender_t * sender = binding ? &bound : &shared->sender;
+    bool bound_open = false;
+    bool sent = false;
+
+    do{
+
+        if(NULL == targets)
+        {
+            group->return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+            wol.last_error = -1;
+            break;
+        }
+
+        if(binding)
+        {
+            group->return_value = engine_sender_open(engine, &bound, shared->metrics, &wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != group->return_value)
+            {
+                break;
+            }
+            bound_open = true;
+
+            group->return_value = wake_on_lan_sender_bind(&bound, binding->source_ip_v4, binding->device, &wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != group->return_value)
+            {
+                break;
+            }
+        }
+        else if(!shared->open)
+        {
+            // A failed open is tried again by the next group, e.g. after other workers released descriptors
+            group->return_value = engine_sender_open(engine, &shared->sender, shared->metrics, &wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != group->return_value)
+            {
+                break;
+            }
+            shared->open = true;
+        }
+
+        for(size_t i = 0; i < group->count; i++)
+        {
+            targets[i] = engine->targets[entries[i].index];
+        }
+
+        group->return_value = wake_on_lan_batch(sender, targets, group->count, results);
+        sent = true;
+
+        for(size_t i = 0; engine->results && i < group->count; i++)
+        {
+            engine->results[entries[i].index] = results[i];
+        }
+
+    }while(0);
+
+    if(bound_open)
+    {
+        wake_on_lan_sender_close(&bound, NULL);
+    }
+
+    if(!sent)
+    {
+        // The group could not be sent at all, every target gets the error of the setup
+        for(size_t i = 0; engine->results && i < group->count; i++)
+        {
+            engine->results[entries[i].index].return_value = group->return_value;
+            engine->results[entries[i].index].last_error = wol.last_error;
+        }
+    }
+
+    free(targets);
+}
+
+static wake_on_lan_errors_t engine_sender_open(const engine_t * engine, wake_on_lan_sender_t * sender, struct wol_metrics_s * metrics, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = wake_on_lan_sender_open(sender, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        return return_value;
+    }
+
+    sender->metrics = metrics;
+
+    if(0 != engine->options->packets_per_second)
+    {
+        // The pacing also works in user space if the socket option is not available
+        wake_on_lan_sender_set_rate(sender, engine->options->packets_per_second, engine->options->burst, NULL);
+    }
+
+    if(engine->options->sender_options)
+    {
+        // A refused tuning keeps the defaults of the system, the worker still sends
+        wake_on_lan_sender_set_options(sender, engine->options->sender_options, NULL);
+    }
+
+    return return_value;
+}
+
+static const wol_engine_binding_t * engine_binding(const wol_engine_options_t * options, uint32_t ip_v4)
+{
+    for(size_t i = 0; options->bindings && i < options->binding_count; i++)
+    {
+        if(ip_v4 == options->bindings[i].ip_v4)
+        {
+            return &options->bindings[i];
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef _WIN32
+
+static size_t engine_processors(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return (0 < info.dwNumberOfProcessors) ? (size_t)info.dwNumberOfProcessors : 1;
+}
+
+//! @brief Thread function of a worker under Windows
+//! @param argument Pointer to the shared state
+//! @return Always 0
+static DWORD WINAPI engine_thread(LPVOID argument)
+{
+    engine_work((engine_t *)argument);
+    return 0;
+}
+
+static bool engine_thread_start(engine_thread_t * thread, engine_t * engine)
+{
+    *thread = CreateThread(NULL, 0, engine_thread, engine, 0, NULL);
+    return NULL != *thread;
+}
+
+static void engine_thread_join(engine_thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+#else
+
+static size_t engine_processors(void)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (0 < processors) ? (size_t)processors : 1;
+}
+
+//! @brief Thread function of a worker under POSIX
+//! @param argument Pointer to the shared state
+//! @return Always NULL
+static void * engine_thread(void * argument)
+{
+    engine_work((engine_t *)argument);
+    return NULL;
+}
+
+static bool engine_thread_start(engine_thread_t * thread, engine_t * engine)
+{
+    return 0 == pthread_create(thread, NULL, engine_thread, engine);
+}
+
+static void engine_thread_join(engine_thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_engine_send(const wol_target_t * targets, size_t n, wol_result_t * results, const wol_engine_options_t * options)
+{
+    static const wol_engine_options_t default_options = { 0 };
+
+    if(NULL == targets && 0 != n)
+    {
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    if(0 == n)
+    {
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    engine_entry_t * entries = malloc(n * sizeof(*entries));
+    engine_group_t * groups = malloc(n * sizeof(*groups));
+    if(NULL == entries || NULL == groups)
+    {
+        free(entries);
+        free(groups);
+        for(size_t i = 0; results && i < n; i++)
+        {
+            results[i].return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+            results[i].last_error = -1;
+        }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        entries[i].ip_v4 = targets[i].ip_v4;
+        entries[i].scope_id = targets[i].scope_id;
+        memcpy(entries[i].ip_v6, targets[i].ip_v6, sizeof(entries[i].ip_v6));
+        entries[i].index = i;
+    }
+    qsort(entries, n, sizeof(*entries), compare_entry);
+
+    size_t group_count = 0;
+    for(size_t i = 0; i < n; i++)
+    {
+        if(0 == group_count || !same_destination(&entries[i], &entries[i - 1]))
+        {
+            groups[group_count].ip_v4 = entries[i].ip_v4;
+            groups[group_count].first = i;
+            groups[group_count].count = 0;
+            groups[group_count].return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+            group_count++;
+        }
+        groups[group_count - 1].count++;
+    }
+
+    engine_t engine;
+    engine.targets = targets;
+    engine.results = results;
+    engine.options = options ? options : &default_options;
+    engine.entries = entries;
+    engine.groups = groups;
+    engine.group_count = group_count;
+    engine.next_group = 0;
+
+    // A unicast inventory has a group per host, the workers are bounded by the processors and not by the groups
+    size_t thread_count = (0 != engine.options->max_threads) ? engine.options->max_threads : engine_processors();
+    if(group_count < thread_count)
+    {
+        thread_count = group_count;
+    }
+
+    // The calling thread is one of the workers, so the groups are sent even if no thread can be started
+    engine_thread_t * threads = malloc(thread_count * sizeof(*threads));
+    size_t started = 0;
+    while(threads && started + 1 < thread_count && engine_thread_start(&threads[started], &engine))
+    {
+        started++;
+    }
+
+    engine_work(&engine);
+
+    for(size_t i = 0; i < started; i++)
+    {
+        engine_thread_join(threads[i]);
+    }
+
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+    for(size_t i = 0; i < group_count; i++)
+    {
+        if(WAKE_ON_LAN_ERRORS_NONE != groups[i].return_value)
+        {
+            return_value = groups[i].return_value;
+        }
+    }
+
+    free(threads);
+    free(groups);
+    free(entries);
+
+    return return_value;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
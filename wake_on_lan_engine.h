@@ -0,0 +1,96 @@
+//! @file
+//! @brief The wake_on_lan_engine header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Sends large target sets across several broadcast domains in parallel. The targets are
+//! split by destination IP, IPv6 targets by address and scope, and the groups are spread over
+//! a pool of worker threads. A group with a binding is sent by its own sender bound to the
+//! interface of that broadcast domain, the other groups of a worker share one sender.
+//!
+//! @note Under Linux, the file must be linked with the `-pthread` switch.
+
+#ifndef INC_WAKE_ON_LAN_ENGINE_H_
+#define INC_WAKE_ON_LAN_ENGINE_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Maximum length of a network device name including the terminating zero, the size of `IFNAMSIZ` under Linux
+#define WOL_DEVICE_NAME_SIZE 16
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Source interface for all targets with a specific destination IP, see ::wake_on_lan_sender_bind()
+typedef struct wol_engine_binding_s
+{
+    uint32_t ip_v4;                     //!< Destination IP, usually the directed broadcast of a subnet
+    uint32_t source_ip_v4;              //!< Local address to bind to, 0 for any address
+    char device[WOL_DEVICE_NAME_SIZE];  //!< Network device to bind to, empty to use the source address only
+} wol_engine_binding_t;
+
+//! @brief Options of ::wol_engine_send(), all zero is a valid default
+typedef struct wol_engine_options_s
+{
+    size_t max_threads;                         //!< Maximum number of worker threads, 0 for one per online processor, never more than destination IPs
+    uint32_t packets_per_second;                //!< Rate of each worker, 0 sends without pacing, see ::wake_on_lan_sender_set_rate()
+    uint32_t burst;                             //!< Burst of each worker
+    const wol_engine_binding_t * bindings;      //!< Source interfaces per destination IP, can be NULL
+    size_t binding_count;                       //!< Number of elements in wol_engine_options_s::bindings
+    const wol_sender_options_t * sender_options; //!< Socket tuning of each worker, see ::wake_on_lan_sender_set_options(), can be NULL
+    struct wol_metrics_s * metrics;             //!< Optional block that receives the sum of the blocks of all workers, only filled if built with `WAKE_ON_LAN_METRICS`, can be NULL
+} wol_engine_options_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Sends a magic packet to each target, grouped by destination IP and spread over worker threads
+//! @details Every worker opens and paces its own senders and writes only the results of its own
+//!          targets, so no lock is shared between the workers. Idle workers take the next waiting group,
+//!          so a failing or slow interface only delays its own worker; if the sender of a group can not be
+//!          opened or bound, all targets of the group get that error. Unicast targets form one group per host,
+//!          so their number of threads and sockets is bounded by wol_engine_options_s::max_threads, not by the hosts.
+//! @param targets Array of `n` targets, in any order
+//! @param n Number of targets
+//! @param[out] results Array of `n` results, one for each target in the order of `targets`, can be NULL if not necessary
+//! @param options Pointer to the options, can be NULL for the defaults
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, otherwise the error of a failed target
+wake_on_lan_errors_t wol_engine_send(const wol_target_t * targets, size_t n, wol_result_t * results, const wol_engine_options_t * options);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_ENGINE_H_ */
@@ -0,0 +1,952 @@
+//! @file
+//! @brief The wake_on_lan_history source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_history.h"
+#include "wake_on_lan_inventory.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+
+  #include <windows.h>
+
+#else
+
+  #include <pthread.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Multiplier of the Fibonacci hash of the MACs
+#define HISTORY_HASH UINT64_C(0x9E3779B97F4A7C15)
+
+//! @brief Hash slots of a new history, doubled whenever the table becomes half full
+#define HISTORY_SLOTS_MIN 64
+
+//! @brief Buffer of the log, the records of a large batch are written with few system calls
+#define HISTORY_LOG_BUFFER ( 64 * 1024 )
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION history_mutex_t;
+typedef HANDLE history_thread_t;
+#else
+typedef pthread_mutex_t history_mutex_t;
+typedef pthread_t history_thread_t;
+#endif
+
+//! @brief Snapshot of the records handed to the background compaction thread
+typedef struct history_job_s
+{
+    wol_history_t * history;            //!< History to compact
+    wol_history_record_t * snapshot;    //!< Copy of the records, owned by the job
+    size_t count;                       //!< Number of records in the snapshot
+} history_job_t;
+
+//! @brief A target of ::wol_history_plan() with its sort key
+typedef struct history_plan_entry_s
+{
+    uint32_t rank;                      //!< 0 for hosts that answered or have no history, 1 for hosts with a failure streak
+    uint32_t value;                     //!< Order inside the rank, the free time until the slowest boot or the failure streak
+    size_t index;                       //!< Index of the target
+} history_plan_entry_t;
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Converts a MAC into the key of the hash table
+//! @param mac MAC address, most significant byte first
+//! @return MAC in the low 48 bits
+static uint64_t history_key(const uint8_t mac[6]);
+
+//! @brief Finds the slot of a MAC or the free slot where it belongs
+//! @param history Pointer to the history
+//! @param key MAC as key, see history_key()
+//! @return Index of the slot
+static size_t history_slot(const wol_history_t * history, uint64_t key);
+
+//! @brief Replaces the hash slots by a larger table and inserts all records again
+//! @param history Pointer to the history
+//! @param slots New number of slots, a power of two
+//! @return True on success, the old table stays on failure
+static bool history_rehash(wol_history_t * history, size_t slots);
+
+//! @brief Returns the record of a MAC, a new MAC gets an empty record
+//! @param history Pointer to the locked history
+//! @param mac MAC address
+//! @return Pointer to the record, valid until the next insert, NULL without memory
+static wol_history_record_t * history_insert(wol_history_t * history, const uint8_t mac[6]);
+
+//! @brief Appends a record to the log and, during a compaction, to the tail of the new log
+//! @param history Pointer to the locked history
+//! @param record Pointer to the record
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_FILE
+static wake_on_lan_errors_t history_append(wol_history_t * history, const wol_history_record_t * record);
+
+//! @brief Starts a background compaction if the log holds ::WOL_HISTORY_COMPACT_RATIO records per MAC
+//! @param history Pointer to the locked history
+static void history_compact_start(wol_history_t * history);
+
+//! @brief Lets the next compaction wait for another ::WOL_HISTORY_COMPACT_RATIO records per MAC after a failed one
+//! @param history Pointer to the locked history
+static void history_compact_defer(wol_history_t * history);
+
+//! @brief Writes a snapshot into a temporary file with the tail appended meanwhile and replaces the log by it
+//! @details wol_history_s::compacting must be set by the caller, it is cleared at the end.
+//! @param history Pointer to the history, not locked
+//! @param snapshot Copy of the records, freed by the function
+//! @param count Number of records in the snapshot
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE or ::WAKE_ON_LAN_ERRORS_MEMORY
+static wake_on_lan_errors_t history_compact_write(wol_history_t * history, wol_history_record_t * snapshot, size_t count, wake_on_lan_t * wol);
+
+//! @brief Writes the header of a new log
+//! @param stream Stream at the start of an empty file
+//! @return True on success
+static bool history_write_header(FILE * stream);
+
+//! @brief Orders the entries of ::wol_history_plan(), for `qsort()`
+//! @param a Pointer to the first ::history_plan_entry_t
+//! @param b Pointer to the second ::history_plan_entry_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_plan_entry(const void * a, const void * b);
+
+//! @brief Runs a compaction job and releases it
+//! @param job Pointer to the job
+static void history_job_run(history_job_t * job);
+
+//! @brief Locks the fields of a history
+//! @param history Pointer to the history
+static void history_lock(wol_history_t * history);
+
+//! @brief Unlocks the fields of a history
+//! @param history Pointer to the history
+static void history_unlock(wol_history_t * history);
+
+//! @brief Creates the mutex of a history
+//! @param history Pointer to the history
+//! @return True on success
+static bool history_mutex_create(wol_history_t * history);
+
+//! @brief Releases the mutex of a history
+//! @param history Pointer to the history
+static void history_mutex_destroy(wol_history_t * history);
+
+//! @brief Starts a thread running history_job_run()
+//! @param[out] thread Handle of the new thread
+//! @param job Pointer to the job
+//! @return True if the thread was started
+static bool history_thread_start(history_thread_t * thread, history_job_t * job);
+
+//! @brief Waits for the end of a thread and releases it
+//! @param thread Handle of the thread
+static void history_thread_join(history_thread_t thread);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static uint64_t history_key(const uint8_t mac[6])
+{
+    uint64_t key = 0;
+    for(size_t i = 0; i < 6; i++)
+    {
+        key = (key << 8) | mac[i];
+    }
+
+    return key;
+}
+
+static size_t history_slot(const wol_history_t * history, uint64_t key)
+{
+    size_t slot = (size_t)((key * HISTORY_HASH) >> history->shift);
+
+    // The table is at most half full, so there is always a free slot
+    while(0 != history->slots[slot] && key != history_key(history->records[history->slots[slot] - 1].mac))
+    {
+        slot = (slot + 1) & history->mask;
+    }
+
+    return slot;
+}
+
+static bool history_rehash(wol_history_t * history, size_t slots)
+{
+    uint32_t * table = calloc(slots, sizeof(*table));
+    if(NULL == table)
+    {
+        return false;
+    }
+
+    unsigned bits = 0;
+    while(((size_t)1 << bits) < slots)
+    {
+        bits++;
+    }
+
+    free(history->slots);
+    history->slots = table;
+    history->mask = slots - 1;
+    history->shift = 64u - bits;
+
+    for(size_t i = 0; i < history->count; i++)
+    {
+        history->slots[history_slot(history, history_key(history->records[i].mac))] = (uint32_t)(i + 1);
+    }
+
+    return true;
+}
+
+static wol_history_record_t * history_insert(wol_history_t * history, const uint8_t mac[6])
+{
+    uint64_t key = history_key(mac);
+    size_t slot = history_slot(history, key);
+    if(0 != history->slots[slot])
+    {
+        return &history->records[history->slots[slot] - 1];
+    }
+
+    if(history->count == history->capacity)
+    {
+        size_t capacity = history->capacity ? history->capacity * 2 : HISTORY_SLOTS_MIN / 2;
+        wol_history_record_t * records = realloc(history->records, capacity * sizeof(*records));
+        if(NULL == records)
+        {
+            return NULL;
+        }
+        history->records = records;
+        history->capacity = capacity;
+    }
+
+    if((history->count + 1) * 2 > history->mask + 1)
+    {
+        if(UINT32_MAX <= history->count || !history_rehash(history, (history->mask + 1) * 2))
+        {
+            return NULL;
+        }
+        slot = history_slot(history, key);
+    }
+
+    wol_history_record_t * record = &history->records[history->count];
+    memset(record, 0, sizeof(*record));
+    memcpy(record->mac, mac, sizeof(record->mac));
+    history->slots[slot] = (uint32_t)(++history->count);
+
+    return record;
+}
+
+static wake_on_lan_errors_t history_append(wol_history_t * history, const wol_history_record_t * record)
+{
+    if(history->compacting)
+    {
+        if(history->tail_count == history->tail_capacity)
+        {
+            size_t capacity = history->tail_capacity ? history->tail_capacity * 2 : HISTORY_SLOTS_MIN;
+            wol_history_record_t * tail = realloc(history->tail, capacity * sizeof(*tail));
+            if(NULL == tail)
+            {
+                return WAKE_ON_LAN_ERRORS_MEMORY;
+            }
+            history->tail = tail;
+            history->tail_capacity = capacity;
+        }
+        history->tail[history->tail_count++] = *record;
+    }
+
+    if(NULL == history->log || 1 != fwrite(record, sizeof(*record), 1, history->log))
+    {
+        return WAKE_ON_LAN_ERRORS_FILE;
+    }
+    history->log_records++;
+
+    history_compact_start(history);
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static void history_compact_start(wol_history_t * history)
+{
+    if(history->compacting || history->log_records < WOL_HISTORY_COMPACT_MIN || history->log_records < history->count * WOL_HISTORY_COMPACT_RATIO
+        || history->log_records < history->compact_after)
+    {
+        return;
+    }
+
+    history_job_t * job = malloc(sizeof(*job));
+    wol_history_record_t * snapshot = malloc((history->count ? history->count : 1) * sizeof(*snapshot));
+    history_thread_t * thread = history->compaction ? history->compaction : malloc(sizeof(*thread));
+    if(NULL == job || NULL == snapshot || NULL == thread)
+    {
+        // The log only grows until the next try finds memory
+        free(job);
+        free(snapshot);
+        if(thread != history->compaction)
+        {
+            free(thread);
+        }
+        history_compact_defer(history);
+        return;
+    }
+
+    // The last thread cleared the flag before it released the lock, so it ends without waiting for it
+    if(history->compaction)
+    {
+        history_thread_join(*thread);
+        history->compaction = NULL;
+    }
+
+    memcpy(snapshot, history->records, history->count * sizeof(*snapshot));
+    job->history = history;
+    job->snapshot = snapshot;
+    job->count = history->count;
+    history->compacting = true;
+    history->tail_count = 0;
+
+    if(!history_thread_start(thread, job))
+    {
+        history->compacting = false;
+        free(snapshot);
+        free(job);
+        free(thread);
+        history_compact_defer(history);
+        return;
+    }
+    history->compaction = thread;
+}
+
+static void history_compact_defer(wol_history_t * history)
+{
+    size_t records = (history->count > WOL_HISTORY_COMPACT_MIN / WOL_HISTORY_COMPACT_RATIO) ? history->count : WOL_HISTORY_COMPACT_MIN / WOL_HISTORY_COMPACT_RATIO;
+    history->compact_after = history->log_records + records * WOL_HISTORY_COMPACT_RATIO;
+}
+
+static wake_on_lan_errors_t history_compact_write(wol_history_t * history, wol_history_record_t * snapshot, size_t count, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_FILE;
+
+    size_t length = strlen(history->path);
+    char * temporary = (char *)malloc(length + sizeof(".tmp"));
+    FILE * stream = NULL;
+
+    do{
+
+        if(NULL == temporary)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+            if(wol) { wol->last_error = ENOMEM; }
+            break;
+        }
+        memcpy(temporary, history->path, length);
+        memcpy(temporary + length, ".tmp", sizeof(".tmp"));
+
+        // The snapshot is written without the lock, the changes go on into the old log and the tail
+        stream = fopen(temporary, "wb");
+        if(NULL == stream || !history_write_header(stream) || count != fwrite(snapshot, sizeof(*snapshot), count, stream))
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    history_lock(history);
+
+    if(WAKE_ON_LAN_ERRORS_NONE == return_value)
+    {
+        bool written = (0 == history->tail_count) || (history->tail_count == fwrite(history->tail, sizeof(*history->tail), history->tail_count, stream));
+        written = (0 == fclose(stream)) && written;
+        stream = NULL;
+
+        if(!written)
+        {
+            if(wol) { wol->last_error = errno; }
+            return_value = WAKE_ON_LAN_ERRORS_FILE;
+        }
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE == return_value)
+    {
+        // The old log is closed first, Windows can not replace an open file
+        if(history->log)
+        {
+            fclose(history->log);
+            history->log = NULL;
+        }
+
+#ifdef _WIN32
+        if(!MoveFileExA(temporary, history->path, MOVEFILE_REPLACE_EXISTING))
+        {
+            if(wol) { wol->last_error = (int)GetLastError(); }
+            return_value = WAKE_ON_LAN_ERRORS_FILE;
+        }
+#else
+        if(0 != rename(temporary, history->path))
+        {
+            if(wol) { wol->last_error = errno; }
+            return_value = WAKE_ON_LAN_ERRORS_FILE;
+        }
+#endif
+        if(WAKE_ON_LAN_ERRORS_NONE == return_value)
+        {
+            history->log_records = count + history->tail_count;
+            history->compact_after = 0;
+        }
+
+        // Either the new log or, if it could not replace the old one, the old log that holds every change too
+        history->log = fopen(history->path, "ab");
+        if(history->log)
+        {
+            setvbuf(history->log, NULL, _IOFBF, HISTORY_LOG_BUFFER);
+        }
+        else if(WAKE_ON_LAN_ERRORS_NONE == return_value)
+        {
+            if(wol) { wol->last_error = errno; }
+            return_value = WAKE_ON_LAN_ERRORS_FILE;
+        }
+    }
+
+    if(stream)
+    {
+        fclose(stream);
+    }
+    if(temporary && WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        remove(temporary);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        // Each append would otherwise copy the records and start a thread that fails the same way
+        history_compact_defer(history);
+    }
+
+    history->tail_count = 0;
+    history->compacting = false;
+    history_unlock(history);
+
+    free(temporary);
+    free(snapshot);
+
+    return return_value;
+}
+
+static bool history_write_header(FILE * stream)
+{
+    wol_history_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WOL_HISTORY_MAGIC, sizeof(header.magic));
+    header.version = WOL_HISTORY_VERSION;
+    header.byte_order = WOL_HISTORY_BYTE_ORDER;
+    header.record_size = sizeof(wol_history_record_t);
+
+    return 1 == fwrite(&header, sizeof(header), 1, stream);
+}
+
+static int compare_plan_entry(const void * a, const void * b)
+{
+    const history_plan_entry_t * entry_a = a;
+    const history_plan_entry_t * entry_b = b;
+
+    if(entry_a->rank != entry_b->rank)
+    {
+        return (entry_a->rank < entry_b->rank) ? -1 : 1;
+    }
+    if(entry_a->value != entry_b->value)
+    {
+        return (entry_a->value < entry_b->value) ? -1 : 1;
+    }
+
+    return (entry_a->index < entry_b->index) ? -1 : (entry_a->index > entry_b->index);
+}
+
+static void history_job_run(history_job_t * job)
+{
+    history_compact_write(job->history, job->snapshot, job->count, NULL);
+    free(job);
+}
+
+#ifdef _WIN32
+
+static void history_lock(wol_history_t * history)
+{
+    EnterCriticalSection((history_mutex_t *)history->lock);
+}
+
+static void history_unlock(wol_history_t * history)
+{
+    LeaveCriticalSection((history_mutex_t *)history->lock);
+}
+
+static bool history_mutex_create(wol_history_t * history)
+{
+    history_mutex_t * mutex = malloc(sizeof(*mutex));
+    if(NULL == mutex)
+    {
+        return false;
+    }
+
+    InitializeCriticalSection(mutex);
+    history->lock = mutex;
+
+    return true;
+}
+
+static void history_mutex_destroy(wol_history_t * history)
+{
+    DeleteCriticalSection((history_mutex_t *)history->lock);
+    free(history->lock);
+    history->lock = NULL;
+}
+
+//! @brief Thread function of a compaction under Windows
+//! @param argument Pointer to the job
+//! @return Always 0
+static DWORD WINAPI history_thread(LPVOID argument)
+{
+    history_job_run((history_job_t *)argument);
+    return 0;
+}
+
+static bool history_thread_start(history_thread_t * thread, history_job_t * job)
+{
+    *thread = CreateThread(NULL, 0, history_thread, job, 0, NULL);
+    return NULL != *thread;
+}
+
+static void history_thread_join(history_thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+#else
+
+static void history_lock(wol_history_t * history)
+{
+    pthread_mutex_lock((history_mutex_t *)history->lock);
+}
+
+static void history_unlock(wol_history_t * history)
+{
+    pthread_mutex_unlock((history_mutex_t *)history->lock);
+}
+
+static bool history_mutex_create(wol_history_t * history)
+{
+    history_mutex_t * mutex = malloc(sizeof(*mutex));
+    if(NULL == mutex || 0 != pthread_mutex_init(mutex, NULL))
+    {
+        free(mutex);
+        return false;
+    }
+
+    history->lock = mutex;
+
+    return true;
+}
+
+static void history_mutex_destroy(wol_history_t * history)
+{
+    pthread_mutex_destroy((history_mutex_t *)history->lock);
+    free(history->lock);
+    history->lock = NULL;
+}
+
+//! @brief Thread function of a compaction under POSIX
+//! @param argument Pointer to the job
+//! @return Always NULL
+static void * history_thread(void * argument)
+{
+    history_job_run((history_job_t *)argument);
+    return NULL;
+}
+
+static bool history_thread_start(history_thread_t * thread, history_job_t * job)
+{
+    return 0 == pthread_create(thread, NULL, history_thread, job);
+}
+
+static void history_thread_join(history_thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_history_open(wol_history_t * history, const char * path, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+
+    if(NULL == history || NULL == path)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    memset(history, 0, sizeof(*history));
+
+    wol_file_map_t map = { 0 };
+    bool mapped = false;
+    bool damaged = false;
+
+    do{
+
+        size_t length = strlen(path);
+        history->path = malloc(length + 1);
+        if(NULL == history->path || !history_mutex_create(history) || !history_rehash(history, HISTORY_SLOTS_MIN))
+        {
+            if(wol) { wol->last_error = ENOMEM; }
+            break;
+        }
+        memcpy(history->path, path, length + 1);
+
+        wake_on_lan_t load = { 0 };
+        return_value = wol_file_map_open(&map, path, &load);
+#ifdef _WIN32
+        bool missing = (WAKE_ON_LAN_ERRORS_FILE == return_value && ERROR_FILE_NOT_FOUND == load.last_error);
+#else
+        bool missing = (WAKE_ON_LAN_ERRORS_FILE == return_value && ENOENT == load.last_error);
+#endif
+        if(WAKE_ON_LAN_ERRORS_NONE != return_value && !missing)
+        {
+            if(wol) { wol->last_error = load.last_error; }
+            break;
+        }
+        mapped = !missing;
+
+        if(mapped && 0 != map.length)
+        {
+            wol_history_header_t header;
+            if(map.length < sizeof(header))
+            {
+                return_value = WAKE_ON_LAN_ERRORS_FORMAT;
+                break;
+            }
+
+            memcpy(&header, map.data, sizeof(header));
+            if(0 != memcmp(header.magic, WOL_HISTORY_MAGIC, sizeof(header.magic)) || WOL_HISTORY_VERSION != header.version
+                || WOL_HISTORY_BYTE_ORDER != header.byte_order || sizeof(wol_history_record_t) != header.record_size)
+            {
+                return_value = WAKE_ON_LAN_ERRORS_FORMAT;
+                break;
+            }
+
+            // A later record of a MAC replaces the earlier ones
+            size_t records = (map.length - sizeof(header)) / sizeof(wol_history_record_t);
+            damaged = (0 != (map.length - sizeof(header)) % sizeof(wol_history_record_t));
+            for(size_t i = 0; i < records; i++)
+            {
+                wol_history_record_t record;
+                memcpy(&record, map.data + sizeof(header) + i * sizeof(record), sizeof(record));
+
+                wol_history_record_t * entry = history_insert(history, record.mac);
+                if(NULL == entry)
+                {
+                    return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+                    if(wol) { wol->last_error = ENOMEM; }
+                    break;
+                }
+                *entry = record;
+            }
+            if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+            {
+                break;
+            }
+            history->log_records = records;
+        }
+
+        history->log = fopen(path, "ab");
+        if(NULL == history->log)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_FILE;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+        setvbuf(history->log, NULL, _IOFBF, HISTORY_LOG_BUFFER);
+
+        if(!mapped || 0 == map.length)
+        {
+            if(!history_write_header(history->log) || 0 != fflush(history->log))
+            {
+                return_value = WAKE_ON_LAN_ERRORS_FILE;
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+        }
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    if(mapped)
+    {
+        wol_file_map_close(&map);
+    }
+
+    // Records appended after a cut off record would be misaligned, the log is written again first
+    if(WAKE_ON_LAN_ERRORS_NONE == return_value && damaged)
+    {
+        return_value = wol_history_compact(history, wol);
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        if(history->log)
+        {
+            fclose(history->log);
+        }
+        if(history->lock)
+        {
+            history_mutex_destroy(history);
+        }
+        free(history->slots);
+        free(history->records);
+        free(history->path);
+        memset(history, 0, sizeof(*history));
+    }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_history_attempt(wol_history_t * history, const uint8_t mac[6], int64_t now)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+
+    history_lock(history);
+
+    wol_history_record_t * record = history_insert(history, mac);
+    if(record)
+    {
+        record->attempts++;
+        record->last_attempt = now;
+        return_value = history_append(history, record);
+    }
+
+    history_unlock(history);
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_history_result(wol_history_t * history, const uint8_t mac[6], bool up, uint32_t latency_ms, int64_t now)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+
+    history_lock(history);
+
+    wol_history_record_t * record = history_insert(history, mac);
+    if(record)
+    {
+        if(up)
+        {
+            record->failure_streak = 0;
+            record->latency_ms = latency_ms;
+            record->last_confirmed = now;
+        }
+        else if(UINT32_MAX != record->failure_streak)
+        {
+            record->failure_streak++;
+        }
+        return_value = history_append(history, record);
+    }
+
+    history_unlock(history);
+
+    return return_value;
+}
+
+bool wol_history_get(wol_history_t * history, const uint8_t mac[6], wol_history_record_t * record)
+{
+    history_lock(history);
+
+    uint32_t entry = history->slots[history_slot(history, history_key(mac))];
+    if(0 != entry && record)
+    {
+        *record = history->records[entry - 1];
+    }
+
+    history_unlock(history);
+
+    return 0 != entry;
+}
+
+size_t wol_history_plan(wol_history_t * history, const wol_target_t * targets, size_t n, const wol_history_plan_options_t * options, size_t * order, size_t * responsive)
+{
+    static const wol_history_plan_options_t default_options = { 0 };
+
+    options = options ? options : &default_options;
+    uint32_t skip_streak = options->skip_streak ? options->skip_streak : WOL_HISTORY_SKIP_STREAK;
+    int64_t recheck_s = options->recheck_s ? options->recheck_s : WOL_HISTORY_RECHECK_S;
+    int64_t now = options->now ? options->now : (int64_t)time(NULL);
+
+    history_plan_entry_t * entries = malloc((n ? n : 1) * sizeof(*entries));
+    if(NULL == entries)
+    {
+        // Without memory every target is woken in its order
+        for(size_t i = 0; i < n; i++)
+        {
+            order[i] = i;
+        }
+        if(responsive) { *responsive = n; }
+        return n;
+    }
+
+    size_t count = 0;
+    size_t first_rank = 0;
+
+    history_lock(history);
+
+    for(size_t i = 0; i < n; i++)
+    {
+        uint32_t entry = history->slots[history_slot(history, history_key(targets[i].mac))];
+        const wol_history_record_t * record = entry ? &history->records[entry - 1] : NULL;
+
+        history_plan_entry_t * plan = &entries[count];
+        plan->index = i;
+
+        if(NULL == record || 0 == record->failure_streak)
+        {
+            // The slowest boot first, hosts without a confirmed wake are assumed to be the slowest
+            plan->rank = 0;
+            plan->value = (record && 0 != record->latency_ms) ? UINT32_MAX - record->latency_ms : 0;
+            first_rank++;
+        }
+        else if(skip_streak <= record->failure_streak && now - record->last_attempt < recheck_s)
+        {
+            continue;
+        }
+        else
+        {
+            plan->rank = 1;
+            plan->value = record->failure_streak;
+        }
+        count++;
+    }
+
+    history_unlock(history);
+
+    qsort(entries, count, sizeof(*entries), compare_plan_entry);
+    for(size_t i = 0; i < count; i++)
+    {
+        order[i] = entries[i].index;
+    }
+    free(entries);
+
+    if(responsive) { *responsive = first_rank; }
+
+    return count;
+}
+
+wake_on_lan_errors_t wol_history_flush(wol_history_t * history, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    history_lock(history);
+
+    if(NULL == history->log || 0 != fflush(history->log))
+    {
+        if(wol) { wol->last_error = errno; }
+        return_value = WAKE_ON_LAN_ERRORS_FILE;
+    }
+
+    history_unlock(history);
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_history_compact(wol_history_t * history, wake_on_lan_t * wol)
+{
+    history_lock(history);
+
+    if(history->compacting)
+    {
+        history_unlock(history);
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    size_t count = history->count;
+    wol_history_record_t * snapshot = malloc((count ? count : 1) * sizeof(*snapshot));
+    if(NULL == snapshot)
+    {
+        history_unlock(history);
+        if(wol) { wol->last_error = ENOMEM; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+    memcpy(snapshot, history->records, count * sizeof(*snapshot));
+    history->compacting = true;
+    history->tail_count = 0;
+
+    history_unlock(history);
+
+    return history_compact_write(history, snapshot, count, wol);
+}
+
+void wol_history_close(wol_history_t * history)
+{
+    if(NULL == history || NULL == history->lock)
+    {
+        return;
+    }
+
+    history_lock(history);
+    history_thread_t * thread = history->compaction;
+    history->compaction = NULL;
+    history_unlock(history);
+
+    // The compaction needs the lock to replace the log
+    if(thread)
+    {
+        history_thread_join(*thread);
+        free(thread);
+    }
+
+    if(history->log)
+    {
+        fclose(history->log);
+    }
+    history_mutex_destroy(history);
+    free(history->tail);
+    free(history->slots);
+    free(history->records);
+    free(history->path);
+    memset(history, 0, sizeof(*history));
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,203 @@
+//! @file
+//! @brief The wake_on_lan_history header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Remembers for each MAC when it was last woken, how long its last confirmed wake took and how
+//! many wakes in a row got no answer, so that hosts that were decommissioned or never wake because
+//! of a BIOS setting stop costing packets, and the others are woken in the order of their boot time.
+//!
+//! The history is an append-only log of fixed records, a newer record of a MAC replaces the older
+//! ones. At open the log is mapped and indexed into a hash table, every change appends one record.
+//! When the log holds ::WOL_HISTORY_COMPACT_RATIO times more records than MACs, a background thread
+//! writes each MAC once into a temporary file that replaces the log, while the changes go on.
+//! After a failed compaction, e.g. on a full disk, the next one waits for as many records again.
+//!
+//! @note Under Linux, the file must be linked with the `-pthread` switch.
+
+#ifndef INC_WAKE_ON_LAN_HISTORY_H_
+#define INC_WAKE_ON_LAN_HISTORY_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief First bytes of a history file, see ::wol_history_header_t
+#define WOL_HISTORY_MAGIC "WOLHIS"
+
+//! @brief Version of the history format
+#define WOL_HISTORY_VERSION 1
+
+//! @brief Written into ::wol_history_header_s::byte_order, a file with a different value was written on a machine with another byte order
+#define WOL_HISTORY_BYTE_ORDER UINT32_C(0x01020304)
+
+//! @brief Default of wol_history_plan_options_s::skip_streak
+#define WOL_HISTORY_SKIP_STREAK 5
+
+//! @brief Default of wol_history_plan_options_s::recheck_s, one day
+#define WOL_HISTORY_RECHECK_S 86400
+
+//! @brief Records in the log before a compaction is considered
+#define WOL_HISTORY_COMPACT_MIN 4096
+
+//! @brief The log is compacted when it holds this many records per MAC
+#define WOL_HISTORY_COMPACT_RATIO 4
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Header at the start of a history file, followed by ::wol_history_record_t until the end of the file
+typedef struct wol_history_header_s
+{
+    char magic[6];                      //!< ::WOL_HISTORY_MAGIC without the terminating zero
+    uint16_t version;                   //!< ::WOL_HISTORY_VERSION
+    uint32_t byte_order;                //!< ::WOL_HISTORY_BYTE_ORDER
+    uint16_t record_size;               //!< `sizeof(wol_history_record_t)`
+    uint16_t reserved;                  //!< Written as 0
+} wol_history_header_t;
+
+//! @brief What is known about the wakes of one MAC
+typedef struct wol_history_record_s
+{
+    uint8_t mac[6];                     //!< MAC address, most significant byte first
+    uint16_t reserved;                  //!< Written as 0
+    uint32_t failure_streak;            //!< Wakes in a row that got no answer, 0 after a confirmed wake
+    uint32_t latency_ms;                //!< Time from the first magic packet until the answer of the last confirmed wake, 0 if none was confirmed
+    uint32_t attempts;                  //!< Number of wakes
+    uint32_t flags;                     //!< Written as 0
+    int64_t last_attempt;               //!< Unix time in seconds of the last wake, 0 if none
+    int64_t last_confirmed;             //!< Unix time in seconds of the last confirmed wake, 0 if none
+} wol_history_record_t;
+
+//! @brief History of a log file, see ::wol_history_open()
+//! @details The functions can be called from several threads at the same time.
+typedef struct wol_history_s
+{
+    char * path;                        //!< Copy of the path of the log
+    FILE * log;                         //!< Log the changes are appended to
+    wol_history_record_t * records;     //!< Latest record of each MAC
+    size_t count;                       //!< Number of MACs
+    size_t capacity;                    //!< Number of elements available in wol_history_s::records
+    uint32_t * slots;                   //!< Hash slots, index of the record plus one, 0 for a free slot
+    size_t mask;                        //!< Number of slots minus one
+    unsigned shift;                     //!< Right shift of the hash to a slot
+    size_t log_records;                 //!< Records in the log including the replaced ones
+    size_t compact_after;               //!< Records in the log before the next compaction is tried, pushed out after a failed one
+    wol_history_record_t * tail;        //!< Records appended while a compaction writes the new log
+    size_t tail_count;                  //!< Number of records in wol_history_s::tail
+    size_t tail_capacity;               //!< Number of elements available in wol_history_s::tail
+    bool compacting;                    //!< A compaction writes the new log
+    void * lock;                        //!< Allocated mutex of all fields
+    void * compaction;                  //!< Allocated handle of the last background compaction thread, NULL if none was started
+} wol_history_t;
+
+//! @brief Options of ::wol_history_plan(), all zero is a valid default
+typedef struct wol_history_plan_options_s
+{
+    uint32_t skip_streak;               //!< Hosts without answer to this many wakes in a row are skipped, 0 for ::WOL_HISTORY_SKIP_STREAK
+    int64_t recheck_s;                  //!< A skipped host is woken again once this long after its last wake, 0 for ::WOL_HISTORY_RECHECK_S
+    int64_t now;                        //!< Unix time in seconds, 0 for the current time
+} wol_history_plan_options_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Maps and indexes a history log, a missing file is created
+//! @details A record cut off at the end, e.g. by a crash during a write, is dropped by compacting the log at once.
+//! @param[out] history Pointer to the history to initialize
+//! @param path Path of the log
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_FORMAT if the file is no history
+wake_on_lan_errors_t wol_history_open(wol_history_t * history, const char * path, wake_on_lan_t * wol);
+
+//! @brief Records a wake of a MAC
+//! @param history Pointer to an open history
+//! @param mac MAC address, most significant byte first
+//! @param now Unix time in seconds, e.g. `time(NULL)`
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_FILE if the record could not be appended
+wake_on_lan_errors_t wol_history_attempt(wol_history_t * history, const uint8_t mac[6], int64_t now);
+
+//! @brief Records whether a wake of a MAC was answered, e.g. with the results of ::wol_wake_and_confirm()
+//! @param history Pointer to an open history
+//! @param mac MAC address, most significant byte first
+//! @param up The host answered, resets the failure streak, otherwise it grows by one
+//! @param latency_ms Time from the first magic packet until the answer, only used if `up` is set
+//! @param now Unix time in seconds, e.g. `time(NULL)`
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_FILE if the record could not be appended
+wake_on_lan_errors_t wol_history_result(wol_history_t * history, const uint8_t mac[6], bool up, uint32_t latency_ms, int64_t now);
+
+//! @brief Copies the record of a MAC
+//! @param history Pointer to an open history
+//! @param mac MAC address, most significant byte first
+//! @param[out] record Pointer to the copy, only written if the MAC is known
+//! @return True if the MAC is in the history
+bool wol_history_get(wol_history_t * history, const uint8_t mac[6], wol_history_record_t * record);
+
+//! @brief Orders targets for a wake by their history
+//! @details Hosts that answered their last wake or have no history come first, the slowest expected boot first, so
+//!          the whole set is up as early as possible; hosts without history count as slowest. Hosts whose last wakes
+//!          got no answer follow, the shortest failure streak first. Hosts without answer to wol_history_plan_options_s::skip_streak
+//!          wakes are left out, unless their last wake is older than wol_history_plan_options_s::recheck_s.
+//! @param history Pointer to an open history
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param options Pointer to the options, can be NULL for the defaults
+//! @param[out] order Array of at least `n` indices into `targets`, the planned targets in the order of the wake
+//! @param[out] responsive Number of planned targets before the first one with a failure streak, can be NULL if not necessary
+//! @return Number of planned targets in `order`, `n` minus the skipped targets
+size_t wol_history_plan(wol_history_t * history, const wol_target_t * targets, size_t n, const wol_history_plan_options_t * options, size_t * order, size_t * responsive);
+
+//! @brief Writes the appended records to the file
+//! @param history Pointer to an open history
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_FILE
+wake_on_lan_errors_t wol_history_flush(wol_history_t * history, wake_on_lan_t * wol);
+
+//! @brief Replaces the log by one record per MAC, like the background compaction but in the calling thread
+//! @details Changes made during the compaction are kept. Returns at once if another compaction is running.
+//! @param history Pointer to an open history
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE or ::WAKE_ON_LAN_ERRORS_MEMORY, the old log stays on failure
+wake_on_lan_errors_t wol_history_compact(wol_history_t * history, wake_on_lan_t * wol);
+
+//! @brief Waits for a running compaction, writes the appended records and releases a history
+//! @param history Pointer to the history, a closed history is ignored
+void wol_history_close(wol_history_t * history);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_HISTORY_H_ */
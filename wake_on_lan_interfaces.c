@@ -0,0 +1,524 @@
+//! @file
+//! @brief The wake_on_lan_interfaces source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_interfaces.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+  #include <iphlpapi.h>
+
+  #ifdef _MSC_VER
+    #pragma comment(lib, "ws2_32.lib")
+    #pragma comment(lib, "iphlpapi.lib")
+  #endif
+
+#else
+
+  #include <arpa/inet.h>
+  #include <ifaddrs.h>
+  #include <net/if.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+
+  #include <errno.h>
+  #include <unistd.h>
+
+#endif
+
+#if defined(__linux__)
+
+  #include <linux/netlink.h>
+  #include <linux/rtnetlink.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Size of the buffer that drains the netlink notifications
+#define INTERFACES_NOTIFY_SIZE 8192
+
+//! @brief Longest prefix of a subnet with a directed broadcast, /31 and /32 have none
+#define INTERFACES_MAX_PREFIX 30
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Orders subnets by network and prefix length, for `qsort()`
+//! @param a Pointer to the first ::wol_interface_t
+//! @param b Pointer to the second ::wol_interface_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_interface(const void * a, const void * b);
+
+//! @brief Appends a subnet to a growing array
+//! @param[in,out] entries Pointer to the array, reallocated as needed
+//! @param[in,out] count Pointer to the number of entries
+//! @param[in,out] capacity Pointer to the number of allocated entries
+//! @param address Local address as number
+//! @param prefix Prefix length
+//! @param index Interface index
+//! @param device Name of the device, can be NULL
+//! @return False if the memory could not be allocated
+static bool interfaces_add(wol_interface_t ** entries, size_t * count, size_t * capacity, uint32_t address, unsigned prefix, uint32_t index, const char * device);
+
+//! @brief Enumerates the subnets of the system into a new sorted array
+//! @param[out] entries Receives the allocated array, must be freed by the caller
+//! @param[out] count Receives the number of subnets
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get the error, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION
+static wake_on_lan_errors_t interfaces_enumerate(wol_interface_t ** entries, size_t * count, wake_on_lan_t * wol);
+
+//! @brief Subscribes to the changes of addresses and routes
+//! @param interfaces Pointer to the table
+static void interfaces_notify_open(wol_interfaces_t * interfaces);
+
+//! @brief Checks without blocking whether a change was reported and subscribes again
+//! @param interfaces Pointer to the table
+//! @return True if a change was reported
+static bool interfaces_notify_pending(wol_interfaces_t * interfaces);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static int compare_interface(const void * a, const void * b)
+{
+    const wol_interface_t * interface_a = a;
+    const wol_interface_t * interface_b = b;
+
+    if(interface_a->network != interface_b->network)
+    {
+        return (interface_a->network < interface_b->network) ? -1 : 1;
+    }
+
+    return (int)interface_a->prefix - (int)interface_b->prefix;
+}
+
+static bool interfaces_add(wol_interface_t ** entries, size_t * count, size_t * capacity, uint32_t address, unsigned prefix, uint32_t index, const char * device)
+{
+    if(0 == prefix || INTERFACES_MAX_PREFIX < prefix)
+    {
+        return true;
+    }
+
+    if(*count == *capacity)
+    {
+        size_t grown = *capacity ? *capacity * 2 : 8;
+        wol_interface_t * resized = realloc(*entries, grown * sizeof(*resized));
+        if(NULL == resized)
+        {
+            return false;
+        }
+        *entries = resized;
+        *capacity = grown;
+    }
+
+    wol_interface_t * entry = &(*entries)[(*count)++];
+    memset(entry, 0, sizeof(*entry));
+    entry->mask = UINT32_C(0xFFFFFFFF) << (32 - prefix);
+    entry->network = address & entry->mask;
+    entry->address = address;
+    entry->broadcast = entry->network | ~entry->mask;
+    entry->prefix = (uint8_t)prefix;
+    entry->index = index;
+    if(device)
+    {
+        strncpy(entry->device, device, sizeof(entry->device) - 1);
+    }
+
+    return true;
+}
+
+static wake_on_lan_errors_t interfaces_enumerate(wol_interface_t ** entries, size_t * count, wake_on_lan_t * wol)
+{
+    size_t capacity = 0;
+    bool memory = true;
+
+    *entries = NULL;
+    *count = 0;
+
+#ifdef _WIN32
+    ULONG flags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER | GAA_FLAG_SKIP_FRIENDLY_NAME;
+    ULONG size = 16 * 1024;
+    IP_ADAPTER_ADDRESSES * adapters = NULL;
+    ULONG result = ERROR_BUFFER_OVERFLOW;
+
+    // The list can grow between the two calls, so the size is asked again until it fits
+    for(int attempt = 0; attempt < 4 && ERROR_BUFFER_OVERFLOW == result; attempt++)
+    {
+        free(adapters);
+        adapters = malloc(size);
+        if(NULL == adapters)
+        {
+            if(wol) { wol->last_error = -1; }
+            return WAKE_ON_LAN_ERRORS_MEMORY;
+        }
+        result = GetAdaptersAddresses(AF_INET, flags, NULL, adapters, &size);
+    }
+
+    if(NO_ERROR != result)
+    {
+        free(adapters);
+        if(wol) { wol->last_error = (int)result; }
+        return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+    }
+
+    for(const IP_ADAPTER_ADDRESSES * adapter = adapters; adapter && memory; adapter = adapter->Next)
+    {
+        if(IfOperStatusUp != adapter->OperStatus || IF_TYPE_SOFTWARE_LOOPBACK == adapter->IfType || IF_TYPE_PPP == adapter->IfType)
+        {
+            continue;
+        }
+
+        for(const IP_ADAPTER_UNICAST_ADDRESS * unicast = adapter->FirstUnicastAddress; unicast && memory; unicast = unicast->Next)
+        {
+            if(AF_INET != unicast->Address.lpSockaddr->sa_family)
+            {
+                continue;
+            }
+
+            const struct sockaddr_in * addr = (const struct sockaddr_in *)unicast->Address.lpSockaddr;
+            memory = interfaces_add(entries, count, &capacity, ntohl(addr->sin_addr.s_addr), unicast->OnLinkPrefixLength, adapter->IfIndex, NULL);
+        }
+    }
+
+    free(adapters);
+#else
+    struct ifaddrs * list = NULL;
+    if(0 != getifaddrs(&list))
+    {
+        if(wol) { wol->last_error = errno; }
+        return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+    }
+
+    for(const struct ifaddrs * ifa = list; ifa && memory; ifa = ifa->ifa_next)
+    {
+        if(NULL == ifa->ifa_addr || NULL == ifa->ifa_netmask || AF_INET != ifa->ifa_addr->sa_family)
+        {
+            continue;
+        }
+        if(0 == (ifa->ifa_flags & IFF_UP) || 0 == (ifa->ifa_flags & IFF_BROADCAST) || 0 != (ifa->ifa_flags & (IFF_LOOPBACK | IFF_POINTOPOINT)))
+        {
+            continue;
+        }
+
+        uint32_t address = ntohl(((const struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr);
+        uint32_t mask = ntohl(((const struct sockaddr_in *)ifa->ifa_netmask)->sin_addr.s_addr);
+
+        unsigned prefix = 0;
+        while(prefix < 32 && 0 != (mask & (UINT32_C(0x80000000) >> prefix)))
+        {
+            prefix++;
+        }
+
+        memory = interfaces_add(entries, count, &capacity, address, prefix, if_nametoindex(ifa->ifa_name), ifa->ifa_name);
+    }
+
+    freeifaddrs(list);
+#endif
+
+    if(!memory)
+    {
+        free(*entries);
+        *entries = NULL;
+        *count = 0;
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    if(*count)
+    {
+        qsort(*entries, *count, sizeof(**entries), compare_interface);
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static void interfaces_notify_open(wol_interfaces_t * interfaces)
+{
+#ifdef _WIN32
+    OVERLAPPED * overlapped = calloc(1, sizeof(*overlapped));
+    if(NULL == overlapped)
+    {
+        return;
+    }
+
+    overlapped->hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    HANDLE handle = NULL;
+    if(NULL == overlapped->hEvent || ERROR_IO_PENDING != NotifyAddrChange(&handle, overlapped))
+    {
+        if(overlapped->hEvent)
+        {
+            CloseHandle(overlapped->hEvent);
+        }
+        free(overlapped);
+        return;
+    }
+
+    interfaces->notify = overlapped;
+#elif defined(__linux__)
+    int sockfd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if(0 > sockfd)
+    {
+        return;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE;
+
+    if(0 != bind(sockfd, (const struct sockaddr *)&addr, sizeof(addr)))
+    {
+        close(sockfd);
+        return;
+    }
+
+    interfaces->notify = sockfd;
+#else
+    (void)interfaces;
+#endif
+}
+
+static bool interfaces_notify_pending(wol_interfaces_t * interfaces)
+{
+#ifdef _WIN32
+    OVERLAPPED * overlapped = interfaces->notify;
+    if(NULL == overlapped || WAIT_OBJECT_0 != WaitForSingleObject(overlapped->hEvent, 0))
+    {
+        return false;
+    }
+
+    // The notification fires once, it is armed again for the next change
+    ResetEvent(overlapped->hEvent);
+    HANDLE handle = NULL;
+    if(ERROR_IO_PENDING != NotifyAddrChange(&handle, overlapped))
+    {
+        CloseHandle(overlapped->hEvent);
+        free(overlapped);
+        interfaces->notify = NULL;
+    }
+
+    return true;
+#elif defined(__linux__)
+    if(0 > interfaces->notify)
+    {
+        return false;
+    }
+
+    // Only the fact of a change matters, the messages themselves are dropped
+    uint8_t buffer[INTERFACES_NOTIFY_SIZE];
+    bool changed = false;
+    for(;;)
+    {
+        ssize_t length = recv(interfaces->notify, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if(0 < length)
+        {
+            changed = true;
+            continue;
+        }
+
+        // An overrun lost messages, so something changed
+        if(0 > length && ENOBUFS == errno)
+        {
+            changed = true;
+            continue;
+        }
+
+        break;
+    }
+
+    return changed;
+#else
+    (void)interfaces;
+    return false;
+#endif
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_interfaces_open(wol_interfaces_t * interfaces, wake_on_lan_t * wol)
+{
+    if(NULL == interfaces)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    memset(interfaces, 0, sizeof(*interfaces));
+#ifndef _WIN32
+    interfaces->notify = -1;
+#endif
+
+    // Subscribing first, so that a change during the enumeration is not missed
+    interfaces_notify_open(interfaces);
+
+    wake_on_lan_errors_t return_value = interfaces_enumerate(&interfaces->entries, &interfaces->count, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        wol_interfaces_close(interfaces);
+    }
+
+    return return_value;
+}
+
+bool wol_interfaces_refresh(wol_interfaces_t * interfaces, wake_on_lan_t * wol)
+{
+    if(NULL == interfaces || !interfaces_notify_pending(interfaces))
+    {
+        return false;
+    }
+
+    wol_interface_t * entries;
+    size_t count;
+    if(WAKE_ON_LAN_ERRORS_NONE != interfaces_enumerate(&entries, &count, wol))
+    {
+        return false;
+    }
+
+    free(interfaces->entries);
+    interfaces->entries = entries;
+    interfaces->count = count;
+    interfaces->generation++;
+
+    return true;
+}
+
+const wol_interface_t * wol_interfaces_lookup(const wol_interfaces_t * interfaces, uint32_t ip_v4)
+{
+    if(NULL == interfaces || 0 == interfaces->count)
+    {
+        return NULL;
+    }
+
+    // Last subnet whose network is not above the address
+    size_t low = 0;
+    size_t high = interfaces->count;
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if(interfaces->entries[middle].network <= ip_v4)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    // Subnets that contain the address are nested, the more specific one is sorted behind the wider one,
+    // so the first match walking back is the most specific subnet
+    for(size_t i = low; i > 0; i--)
+    {
+        const wol_interface_t * entry = &interfaces->entries[i - 1];
+        if((ip_v4 & entry->mask) == entry->network)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+size_t wol_interfaces_resolve(const wol_interfaces_t * interfaces, wol_target_t * targets, size_t n)
+{
+    size_t changed = 0;
+
+    for(size_t i = 0; targets && i < n; i++)
+    {
+        if(wol_target_is_v6(&targets[i]))
+        {
+            continue;
+        }
+
+        const wol_interface_t * entry = wol_interfaces_lookup(interfaces, targets[i].ip_v4);
+        if(entry && entry->broadcast != targets[i].ip_v4)
+        {
+            targets[i].ip_v4 = entry->broadcast;
+            changed++;
+        }
+    }
+
+    return changed;
+}
+
+size_t wol_interfaces_bindings(const wol_interfaces_t * interfaces, wol_engine_binding_t * bindings, size_t max)
+{
+    size_t count = 0;
+
+    for(size_t i = 0; interfaces && bindings && i < interfaces->count && count < max; i++)
+    {
+        const wol_interface_t * entry = &interfaces->entries[i];
+
+        memset(&bindings[count], 0, sizeof(bindings[count]));
+        bindings[count].ip_v4 = entry->broadcast;
+        bindings[count].source_ip_v4 = entry->address;
+        memcpy(bindings[count].device, entry->device, sizeof(bindings[count].device));
+        count++;
+    }
+
+    return count;
+}
+
+void wol_interfaces_close(wol_interfaces_t * interfaces)
+{
+    if(NULL == interfaces)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    OVERLAPPED * overlapped = interfaces->notify;
+    if(overlapped)
+    {
+        CancelIPChangeNotify(overlapped);
+        CloseHandle(overlapped->hEvent);
+        free(overlapped);
+        interfaces->notify = NULL;
+    }
+#else
+    if(0 <= interfaces->notify)
+    {
+        close(interfaces->notify);
+        interfaces->notify = -1;
+    }
+#endif
+
+    free(interfaces->entries);
+    interfaces->entries = NULL;
+    interfaces->count = 0;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
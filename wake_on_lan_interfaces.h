@@ -0,0 +1,129 @@
+//! @file
+//! @brief The wake_on_lan_interfaces header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Finds the directed broadcast of a host from the IPv4 subnets of the local interfaces, so
+//! that a target only needs the IP of the host or of its subnet instead of the right broadcast.
+//! The interfaces are enumerated once into a table sorted by network, every lookup is a binary
+//! search in memory without a system call. The table is only enumerated again after the system
+//! reported a change of the addresses or routes, on Linux by netlink, on Windows by `NotifyAddrChange()`,
+//! see ::wol_interfaces_refresh().
+//!
+//! Only interfaces that are up, support broadcasts and are not loopback or point-to-point are used.
+//!
+//! @note Under Windows, the file must be linked with `-liphlpapi`.
+
+#ifndef INC_WAKE_ON_LAN_INTERFACES_H_
+#define INC_WAKE_ON_LAN_INTERFACES_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+#include "wake_on_lan_engine.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief One IPv4 subnet of a local interface
+typedef struct wol_interface_s
+{
+    uint32_t network;                   //!< Network address as number, not in network order
+    uint32_t mask;                      //!< Subnet mask as number
+    uint32_t address;                   //!< Local address of the interface in the subnet, the source of its packets
+    uint32_t broadcast;                 //!< Directed broadcast of the subnet
+    uint8_t prefix;                     //!< Prefix length of the subnet
+    uint32_t index;                     //!< Interface index
+    char device[WOL_DEVICE_NAME_SIZE];  //!< Name of the network device, empty under Windows
+} wol_interface_t;
+
+//! @brief Table of the local subnets, see ::wol_interfaces_open()
+typedef struct wol_interfaces_s
+{
+    wol_interface_t * entries;          //!< Subnets sorted by network and prefix length
+    size_t count;                       //!< Number of subnets
+    uint32_t generation;                //!< Incremented whenever the table was enumerated again
+#ifdef _WIN32
+    void * notify;                      //!< Allocated `OVERLAPPED` of `NotifyAddrChange()` with its event, NULL without notifications
+#else
+    int notify;                         //!< Netlink socket of the change notifications, -1 without notifications
+#endif
+} wol_interfaces_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Enumerates the local subnets and subscribes to address and route changes
+//! @details Without notifications, e.g. in a container without netlink, the table stays as enumerated.
+//! @param[out] interfaces Pointer to the table to initialize
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION if the interfaces could not be read
+wake_on_lan_errors_t wol_interfaces_open(wol_interfaces_t * interfaces, wake_on_lan_t * wol);
+
+//! @brief Enumerates the subnets again if the system reported a change since the last call
+//! @details Does not block and costs one system call if nothing changed, call it before a batch, not per packet.
+//! @param interfaces Pointer to an open table
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return True if the table was enumerated again, the old table stays if that failed
+bool wol_interfaces_refresh(wol_interfaces_t * interfaces, wake_on_lan_t * wol);
+
+//! @brief Finds the most specific subnet of an address
+//! @param interfaces Pointer to an open table
+//! @param ip_v4 IPv4 address as number, not in network order
+//! @return Pointer to the subnet, valid until the next refresh, NULL if no local subnet contains the address
+const wol_interface_t * wol_interfaces_lookup(const wol_interfaces_t * interfaces, uint32_t ip_v4);
+
+//! @brief Replaces the IP of targets in a local subnet by the directed broadcast of the subnet
+//! @details The IP can be any host of the subnet or the network address as subnet tag.
+//!          IPv6 targets and addresses outside of the local subnets, e.g. `255.255.255.255`, are not changed.
+//! @param interfaces Pointer to an open table
+//! @param[in,out] targets Array of `n` targets
+//! @param n Number of targets
+//! @return Number of changed targets
+size_t wol_interfaces_resolve(const wol_interfaces_t * interfaces, wol_target_t * targets, size_t n);
+
+//! @brief Writes one binding for each subnet, so that ::wol_engine_send() sends each broadcast out of its interface
+//! @param interfaces Pointer to an open table
+//! @param[out] bindings Array of at least `max` bindings
+//! @param max Size of `bindings`
+//! @return Number of written bindings, see wol_engine_options_s::bindings
+size_t wol_interfaces_bindings(const wol_interfaces_t * interfaces, wol_engine_binding_t * bindings, size_t max);
+
+//! @brief Releases a table and ends the notifications
+//! @param interfaces Pointer to the table, a closed table is ignored
+void wol_interfaces_close(wol_interfaces_t * interfaces);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_INTERFACES_H_ */
@@ -0,0 +1,1290 @@
+//! @file
+//! @brief The wake_on_lan_inventory source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_inventory.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+  #include <windows.h>
+
+#else
+
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Marks a character that is not a hexadecimal digit in ::hex_values
+#define HEX_INVALID 0xFF
+
+//! @brief Shortest host line, a MAC without separators
+#define INVENTORY_LINE_MIN 12
+
+//! @brief Initial allocation for an inventory read from a pipe
+#define INVENTORY_READ_CHUNK ( 64 * 1024 )
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+
+//! @brief Value of each character as hexadecimal digit, ::HEX_INVALID for all other characters
+//! @details A table lookup instead of range compares keeps the MAC parsing free of branches.
+static const uint8_t hex_values[256] =
+{
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Checks if a character separates two fields, only commas and semicolons can delimit empty fields
+//! @param c Character to check
+//! @return True for spaces, tabs, commas and semicolons
+static inline bool is_separator(char c);
+
+//! @brief Checks if a character is white space inside a line
+//! @param c Character to check
+//! @return True for spaces, tabs and carriage returns
+static inline bool is_blank(char c);
+
+//! @brief Strictly parses a decimal port
+//! @param text Port text, does not need to be null-terminated
+//! @param length Number of characters of the port
+//! @param[out] port Port number, only written on success
+//! @return True if the text is a number from 1 to 65535
+static bool parse_port(const char * text, size_t length, uint16_t * port);
+
+//! @brief Reads a stream that cannot be mapped, e.g. a pipe on stdin, into an allocation
+//! @param[out] map Pointer to the mapping to fill
+//! @param stream Stream to read until its end
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE or ::WAKE_ON_LAN_ERRORS_MEMORY
+static wake_on_lan_errors_t file_read_stream(wol_file_map_t * map, FILE * stream, wake_on_lan_t * wol);
+
+//! @brief Orders targets by IP and MAC for `qsort()`
+//! @param a Pointer to the first ::wol_target_t
+//! @param b Pointer to the second ::wol_target_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_ip_mac(const void * a, const void * b);
+
+//! @brief Orders targets by MAC for `qsort()`
+//! @param a Pointer to the first ::wol_target_t
+//! @param b Pointer to the second ::wol_target_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_mac(const void * a, const void * b);
+
+//! @brief Writes zero bytes until the stream position is a multiple of ::WOL_INVENTORY_ALIGNMENT
+//! @param stream Stream to write
+//! @param position Current position
+//! @return New position
+static uint64_t write_padding(FILE * stream, uint64_t position);
+
+//! @brief Parses one inventory line without the line end
+//! @param parse Pointer to the parser state, provides the defaults
+//! @param line Start of the line
+//! @param length Number of characters of the line
+//! @param[out] target Parsed target, only valid if `is_host` is set
+//! @param[out] group Group of the target, see ::wol_parse_group(), only valid if `is_host` is set
+//! @param[out] is_host Set if the line describes a host, cleared for empty lines and comments
+//! @param[out] column Column of the failing field, only written on failure
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or the error of the failing field
+static wake_on_lan_errors_t parse_line(const wol_parse_t * parse, const char * line, size_t length, wol_target_t * target, uint32_t * group, bool * is_host, size_t * column);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static inline bool is_separator(char c)
+{
+    return ' ' == c || '\t' == c || ',' == c || ';' == c;
+}
+
+static inline bool is_blank(char c)
+{
+    return ' ' == c || '\t' == c || '\r' == c;
+}
+
+static bool parse_port(const char * text, size_t length, uint16_t * port)
+{
+    if(0 == length || 5 < length)
+    {
+        return false;
+    }
+
+    uint32_t number = 0;
+    for(size_t i = 0; i < length; i++)
+    {
+        uint8_t digit = (uint8_t)(text[i] - '0');
+        if(9 < digit)
+        {
+            return false;
+        }
+        number = number * 10 + digit;
+    }
+
+    if(0 == number || UINT16_MAX < number)
+    {
+        return false;
+    }
+
+    *port = (uint16_t)number;
+    return true;
+}
+
+static wake_on_lan_errors_t file_read_stream(wol_file_map_t * map, FILE * stream, wake_on_lan_t * wol)
+{
+    size_t capacity = INVENTORY_READ_CHUNK;
+    size_t length = 0;
+    char * data = malloc(capacity);
+
+    while(data)
+    {
+        length += fread(data + length, 1, capacity - length, stream);
+        if(length < capacity)
+        {
+            break;
+        }
+
+        char * larger = realloc(data, 2 * capacity);
+        if(NULL == larger)
+        {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = larger;
+        capacity *= 2;
+    }
+
+    if(NULL == data)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    if(ferror(stream))
+    {
+        free(data);
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_FILE;
+    }
+
+    map->data = data;
+    map->length = length;
+    map->mapped = false;
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static int compare_ip_mac(const void * a, const void * b)
+{
+    const wol_target_t * target_a = a;
+    const wol_target_t * target_b = b;
+
+    if(target_a->ip_v4 != target_b->ip_v4)
+    {
+        return (target_a->ip_v4 < target_b->ip_v4) ? -1 : 1;
+    }
+
+    // IPv6 targets share the IPv4 0, they are grouped by address inside that section
+    int compare_v6 = memcmp(target_a->ip_v6, target_b->ip_v6, sizeof(target_a->ip_v6));
+    if(0 != compare_v6)
+    {
+        return compare_v6;
+    }
+
+    return memcmp(target_a->mac, target_b->mac, sizeof(target_a->mac));
+}
+
+static int compare_mac(const void * a, const void * b)
+{
+    const wol_target_t * target_a = a;
+    const wol_target_t * target_b = b;
+
+    return memcmp(target_a->mac, target_b->mac, sizeof(target_a->mac));
+}
+
+static uint64_t write_padding(FILE * stream, uint64_t position)
+{
+    static const uint8_t zeros[WOL_INVENTORY_ALIGNMENT] = { 0 };
+
+    size_t padding = (size_t)((WOL_INVENTORY_ALIGNMENT - position % WOL_INVENTORY_ALIGNMENT) % WOL_INVENTORY_ALIGNMENT);
+    fwrite(zeros, 1, padding, stream);
+
+    return position + padding;
+}
+
+static wake_on_lan_errors_t parse_line(const wol_parse_t * parse, const char * line, size_t length, wol_target_t * target, uint32_t * group, bool * is_host, size_t * column)
+{
+    size_t i = 0;
+    while(i < length && is_blank(line[i]))
+    {
+        i++;
+    }
+
+    *is_host = false;
+    if(i == length || '#' == line[i])
+    {
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    *is_host = true;
+    target->ip_v4 = parse->default_ip_v4;
+    target->port = parse->default_port;
+    memset(target->ip_v6, 0, sizeof(target->ip_v6));
+    target->scope_id = 0;
+    memset(target->password, 0, sizeof(target->password));
+    target->password_length = 0;
+    *group = 0;
+
+    for(size_t field = 0; i < length; field++)
+    {
+        size_t start = i;
+        while(i < length && !is_separator(line[i]) && '\r' != line[i])
+        {
+            i++;
+        }
+        size_t field_length = i - start;
+
+        // Blanks around a field are ignored, a single comma or semicolon ends the field
+        while(i < length && is_blank(line[i]))
+        {
+            i++;
+        }
+        if(i < length && (',' == line[i] || ';' == line[i]))
+        {
+            i++;
+            while(i < length && is_blank(line[i]))
+            {
+                i++;
+            }
+        }
+
+        const char * text = line + start;
+        *column = start + 1;
+
+        switch(field)
+        {
+            case 0:
+                if(!wol_parse_mac(text, field_length, target->mac))
+                {
+                    return WAKE_ON_LAN_ERRORS_MAC;
+                }
+                break;
+
+            case 1:
+                if(0 != field_length && NULL != memchr(text, ':', field_length))
+                {
+                    if(!wol_parse_ip_v6(text, field_length, target->ip_v6, &target->scope_id))
+                    {
+                        return WAKE_ON_LAN_ERRORS_IP;
+                    }
+                    target->ip_v4 = 0;
+                }
+                else if(0 != field_length && !wol_parse_ip_v4(text, field_length, &target->ip_v4))
+                {
+                    return WAKE_ON_LAN_ERRORS_IP;
+                }
+                break;
+
+            case 2:
+                if(0 != field_length && !parse_port(text, field_length, &target->port))
+                {
+                    return WAKE_ON_LAN_ERRORS_PORT;
+                }
+                break;
+
+            case 3:
+                *group = wol_parse_group(text, field_length);
+                break;
+
+            case 4:
+                if(0 != field_length && wol_parse_mac(text, field_length, target->password))
+                {
+                    target->password_length = WAKE_ON_LAN_PASSWORD_SIZE;
+                }
+                else if(0 != field_length)
+                {
+                    uint32_t password;
+                    if(!wol_parse_ip_v4(text, field_length, &password))
+                    {
+                        return WAKE_ON_LAN_ERRORS_PASSWORD;
+                    }
+                    for(size_t j = 0; j < 4; j++)
+                    {
+                        target->password[j] = (uint8_t)(password >> (24 - 8 * j));
+                    }
+                    target->password_length = 4;
+                }
+                break;
+
+            default:
+                return WAKE_ON_LAN_ERRORS_LINE;
+        }
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_file_map_open(wol_file_map_t * map, const char * path, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_FILE;
+
+    if(NULL == map || NULL == path)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+        return return_value;
+    }
+
+    map->data = NULL;
+    map->length = 0;
+    map->mapped = false;
+
+    bool is_stdin = (0 == strcmp(path, "-"));
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+
+    do{
+
+#ifdef _WIN32
+        if(is_stdin)
+        {
+            file = GetStdHandle(STD_INPUT_HANDLE);
+        }
+        else
+        {
+            file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        }
+        if(INVALID_HANDLE_VALUE == file || NULL == file)
+        {
+            if(wol) { wol->last_error = (int)GetLastError(); }
+            break;
+        }
+
+        if(FILE_TYPE_DISK != GetFileType(file))
+        {
+            FILE * stream = is_stdin ? stdin : fopen(path, "rb");
+            if(NULL == stream)
+            {
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+            return_value = file_read_stream(map, stream, wol);
+            if(!is_stdin) { fclose(stream); }
+            break;
+        }
+
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size) || (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX)
+        {
+            if(wol) { wol->last_error = (int)GetLastError(); }
+            break;
+        }
+
+        if(0 == size.QuadPart)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_NONE;
+            break;
+        }
+
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(NULL == mapping)
+        {
+            if(wol) { wol->last_error = (int)GetLastError(); }
+            break;
+        }
+
+        // The view keeps the mapping object alive, the handle is closed below
+        const void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(NULL == view)
+        {
+            if(wol) { wol->last_error = (int)GetLastError(); }
+            break;
+        }
+
+        map->data = view;
+        map->length = (size_t)size.QuadPart;
+        map->mapped = true;
+#else
+        fd = is_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+        if(0 > fd)
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        struct stat st;
+        if(0 > fstat(fd, &st))
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        if(!S_ISREG(st.st_mode))
+        {
+            // Pipes and terminals can not be mapped
+            FILE * stream = is_stdin ? stdin : fdopen(fd, "rb");
+            if(NULL == stream)
+            {
+                if(wol) { wol->last_error = errno; }
+                break;
+            }
+            return_value = file_read_stream(map, stream, wol);
+            if(!is_stdin) { fclose(stream); fd = -1; }
+            break;
+        }
+
+        if(0 == st.st_size)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_NONE;
+            break;
+        }
+
+        if((uint64_t)st.st_size > (uint64_t)SIZE_MAX)
+        {
+            if(wol) { wol->last_error = EFBIG; }
+            break;
+        }
+
+        void * view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(MAP_FAILED == view)
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        // The inventory is parsed front to back exactly once
+        madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+        map->data = view;
+        map->length = (size_t)st.st_size;
+        map->mapped = true;
+#endif
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+#ifdef _WIN32
+    if(NULL != mapping)
+    {
+        CloseHandle(mapping);
+    }
+    if(!is_stdin && INVALID_HANDLE_VALUE != file && NULL != file)
+    {
+        CloseHandle(file);
+    }
+#else
+    if(!is_stdin && 0 <= fd)
+    {
+        close(fd);
+    }
+#endif
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+void wol_file_map_close(wol_file_map_t * map)
+{
+    if(NULL == map)
+    {
+        return;
+    }
+
+    if(map->mapped)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(map->data);
+#else
+        munmap((void *)map->data, map->length);
+#endif
+    }
+    else
+    {
+        free((void *)map->data);
+    }
+
+    map->data = NULL;
+    map->length = 0;
+    map->mapped = false;
+}
+
+wake_on_lan_errors_t wol_inventory_write(const char * path, wol_target_t * targets, size_t n, bool per_subnet, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_FILE;
+
+    if(NULL == path || (NULL == targets && 0 != n) || UINT32_MAX < n)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+        return return_value;
+    }
+
+    if(0 != n)
+    {
+        qsort(targets, n, sizeof(*targets), per_subnet ? compare_ip_mac : compare_mac);
+    }
+
+    // One pass to count the sections, one to write them
+    size_t section_count = (0 != n) ? 1 : 0;
+    for(size_t i = 1; per_subnet && i < n; i++)
+    {
+        if(targets[i].ip_v4 != targets[i - 1].ip_v4)
+        {
+            section_count++;
+        }
+    }
+
+    FILE * stream = fopen(path, "wb");
+    if(NULL == stream)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = errno; }
+        return return_value;
+    }
+
+    wol_inventory_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WOL_INVENTORY_MAGIC, sizeof(header.magic));
+    header.version = WOL_INVENTORY_VERSION;
+    header.byte_order = WOL_INVENTORY_BYTE_ORDER;
+    header.record_size = sizeof(wol_target_t);
+    header.section_size = sizeof(wol_inventory_section_t);
+    header.section_count = (uint32_t)section_count;
+    header.record_count = (uint32_t)n;
+
+    uint64_t position = sizeof(header);
+    position += (WOL_INVENTORY_ALIGNMENT - position % WOL_INVENTORY_ALIGNMENT) % WOL_INVENTORY_ALIGNMENT;
+    header.sections_offset = position;
+    position += section_count * sizeof(wol_inventory_section_t);
+    position += (WOL_INVENTORY_ALIGNMENT - position % WOL_INVENTORY_ALIGNMENT) % WOL_INVENTORY_ALIGNMENT;
+    header.records_offset = position;
+
+    position = fwrite(&header, 1, sizeof(header), stream);
+    position = write_padding(stream, position);
+
+    wol_inventory_section_t section = { 0 };
+    for(size_t i = 0; i < n; i++)
+    {
+        if(0 != section.count && per_subnet && targets[i].ip_v4 != section.ip_v4)
+        {
+            position += fwrite(&section, 1, sizeof(section), stream);
+            section.count = 0;
+        }
+        if(0 == section.count)
+        {
+            section.ip_v4 = per_subnet ? targets[i].ip_v4 : 0;
+            section.first = (uint32_t)i;
+        }
+        section.count++;
+    }
+    if(0 != section.count)
+    {
+        position += fwrite(&section, 1, sizeof(section), stream);
+    }
+    position = write_padding(stream, position);
+
+    fwrite(targets, sizeof(*targets), n, stream);
+
+    bool failed = ferror(stream);
+    failed = (0 != fclose(stream)) || failed;
+    if(failed)
+    {
+        if(wol) { wol->last_error = errno; }
+    }
+    else
+    {
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_inventory_merge(const char * path, const wol_target_t * targets, size_t n, wol_inventory_merge_t * merge, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_FILE;
+
+    wol_inventory_merge_t counts;
+    memset(&counts, 0, sizeof(counts));
+    if(merge) { *merge = counts; }
+
+    if(NULL == path || 0 == strcmp(path, "-") || (NULL == targets && 0 != n))
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+        return return_value;
+    }
+
+    wake_on_lan_t load = { 0 };
+    wol_inventory_t inventory = { 0 };
+    return_value = wol_inventory_load(&inventory, path, &load);
+#ifdef _WIN32
+    bool missing = (WAKE_ON_LAN_ERRORS_FILE == return_value && ERROR_FILE_NOT_FOUND == load.last_error);
+#else
+    bool missing = (WAKE_ON_LAN_ERRORS_FILE == return_value && ENOENT == load.last_error);
+#endif
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value && !missing)
+    {
+        if(wol) { *wol = load; }
+        return return_value;
+    }
+
+    // A file with per subnet sections has section IPs, a file without has one section with IP 0
+    bool per_subnet = missing || 1 < inventory.section_count || (1 == inventory.section_count && 0 != inventory.sections[0].ip_v4);
+    size_t count = inventory.count;
+    uint64_t records_offset = missing ? 0 : (uint64_t)((const char *)inventory.targets - inventory.map.data);
+
+    wol_target_t * incoming = NULL;
+    wol_target_t * all = NULL;
+    size_t * patches = NULL;
+    size_t patch_count = 0;
+    size_t total = count;
+    return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+
+    do{
+        if(SIZE_MAX / sizeof(*all) - count <= n || UINT32_MAX < count + n)
+        {
+            if(wol) { wol->last_error = E2BIG; }
+            break;
+        }
+
+        incoming = (wol_target_t *)malloc((n + 1) * sizeof(*incoming));
+        all = (wol_target_t *)malloc((count + n + 1) * sizeof(*all));
+        patches = (size_t *)malloc((n + 1) * sizeof(*patches));
+        if(NULL == incoming || NULL == all || NULL == patches)
+        {
+            if(wol) { wol->last_error = ENOMEM; }
+            break;
+        }
+
+        if(0 != n)
+        {
+            memcpy(incoming, targets, n * sizeof(*incoming));
+            qsort(incoming, n, sizeof(*incoming), compare_mac);
+        }
+        if(0 != count)
+        {
+            memcpy(all, inventory.targets, count * sizeof(*all));
+        }
+
+        for(size_t i = 0; i < n; i++)
+        {
+            if(0 != i && 0 == memcmp(incoming[i].mac, incoming[i - 1].mac, sizeof(incoming[i].mac)))
+            {
+                continue;
+            }
+
+            const wol_target_t * record = missing ? NULL : wol_inventory_find(&inventory, incoming[i].mac);
+            if(NULL == record)
+            {
+                all[total++] = incoming[i];
+                counts.added++;
+                continue;
+            }
+
+            wol_target_t * target = &all[record - inventory.targets];
+            if(target->ip_v4 == incoming[i].ip_v4
+                && target->scope_id == incoming[i].scope_id
+                && 0 == memcmp(target->ip_v6, incoming[i].ip_v6, sizeof(target->ip_v6)))
+            {
+                counts.unchanged++;
+                continue;
+            }
+
+            target->ip_v4 = incoming[i].ip_v4;
+            target->scope_id = incoming[i].scope_id;
+            memcpy(target->ip_v6, incoming[i].ip_v6, sizeof(target->ip_v6));
+            patches[patch_count++] = (size_t)(target - all);
+            counts.updated++;
+        }
+
+        // The records stay readable by others until the file is written, the mapping is not needed any more
+        wol_inventory_close(&inventory);
+
+        if(0 == counts.added && 0 == counts.updated && !missing)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_NONE;
+            break;
+        }
+
+        // Records are sorted by MAC inside their section, a new MAC or a new section IP changes the layout
+        if(0 != counts.added || per_subnet || missing)
+        {
+            size_t length = strlen(path);
+            char * temporary = (char *)malloc(length + sizeof(".tmp"));
+            if(NULL == temporary)
+            {
+                if(wol) { wol->last_error = ENOMEM; }
+                break;
+            }
+            memcpy(temporary, path, length);
+            memcpy(temporary + length, ".tmp", sizeof(".tmp"));
+
+            return_value = wol_inventory_write(temporary, all, total, per_subnet, wol);
+            if(WAKE_ON_LAN_ERRORS_NONE == return_value)
+            {
+#ifdef _WIN32
+                if(!MoveFileExA(temporary, path, MOVEFILE_REPLACE_EXISTING))
+                {
+                    if(wol) { wol->last_error = (int)GetLastError(); }
+                    return_value = WAKE_ON_LAN_ERRORS_FILE;
+                }
+#else
+                if(0 != rename(temporary, path))
+                {
+                    if(wol) { wol->last_error = errno; }
+                    return_value = WAKE_ON_LAN_ERRORS_FILE;
+                }
+#endif
+            }
+            if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+            {
+                remove(temporary);
+            }
+            free(temporary);
+            counts.rewritten = (WAKE_ON_LAN_ERRORS_NONE == return_value);
+            break;
+        }
+
+        return_value = WAKE_ON_LAN_ERRORS_FILE;
+        FILE * stream = fopen(path, "r+b");
+        if(NULL == stream)
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        bool failed = false;
+        for(size_t i = 0; i < patch_count && !failed; i++)
+        {
+            uint64_t position = records_offset + (uint64_t)patches[i] * sizeof(*all);
+#ifdef _WIN32
+            failed = (0 != _fseeki64(stream, (__int64)position, SEEK_SET));
+#else
+            failed = (0 != fseeko(stream, (off_t)position, SEEK_SET));
+#endif
+            failed = failed || (1 != fwrite(&all[patches[i]], sizeof(*all), 1, stream));
+        }
+
+        failed = (0 != fclose(stream)) || failed;
+        if(failed)
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    }while(0);
+
+    wol_inventory_close(&inventory);
+    free(incoming);
+    free(all);
+    free(patches);
+
+    if(merge) { *merge = counts; }
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_inventory_from_map(wol_inventory_t * inventory, const wol_file_map_t * map)
+{
+    if(NULL == inventory || NULL == map || map->length < sizeof(wol_inventory_header_t))
+    {
+        return WAKE_ON_LAN_ERRORS_FORMAT;
+    }
+
+    wol_inventory_header_t header;
+    memcpy(&header, map->data, sizeof(header));
+
+    if(0 != memcmp(header.magic, WOL_INVENTORY_MAGIC, sizeof(header.magic))
+        || WOL_INVENTORY_VERSION != header.version
+        || WOL_INVENTORY_BYTE_ORDER != header.byte_order
+        || sizeof(wol_target_t) != header.record_size
+        || sizeof(wol_inventory_section_t) != header.section_size
+        || 0 != header.sections_offset % WOL_INVENTORY_ALIGNMENT
+        || 0 != header.records_offset % WOL_INVENTORY_ALIGNMENT
+        || header.sections_offset > map->length
+        || header.records_offset > map->length
+        || header.section_count > (map->length - header.sections_offset) / sizeof(wol_inventory_section_t)
+        || header.record_count > (map->length - header.records_offset) / sizeof(wol_target_t))
+    {
+        return WAKE_ON_LAN_ERRORS_FORMAT;
+    }
+
+    const wol_inventory_section_t * sections = (const wol_inventory_section_t *)(map->data + header.sections_offset);
+    for(size_t i = 0; i < header.section_count; i++)
+    {
+        if(sections[i].first > header.record_count || sections[i].count > header.record_count - sections[i].first)
+        {
+            return WAKE_ON_LAN_ERRORS_FORMAT;
+        }
+    }
+
+    inventory->map = *map;
+    inventory->sections = sections;
+    inventory->section_count = header.section_count;
+    inventory->targets = (const wol_target_t *)(map->data + header.records_offset);
+    inventory->count = header.record_count;
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+wake_on_lan_errors_t wol_inventory_load(wol_inventory_t * inventory, const char * path, wake_on_lan_t * wol)
+{
+    wol_file_map_t map;
+
+    wake_on_lan_errors_t return_value = wol_file_map_open(&map, path, wol);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        return return_value;
+    }
+
+    return_value = wol_inventory_from_map(inventory, &map);
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        wol_file_map_close(&map);
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+    }
+
+    return return_value;
+}
+
+void wol_inventory_close(wol_inventory_t * inventory)
+{
+    if(NULL == inventory)
+    {
+        return;
+    }
+
+    wol_file_map_close(&inventory->map);
+    inventory->sections = NULL;
+    inventory->section_count = 0;
+    inventory->targets = NULL;
+    inventory->count = 0;
+}
+
+const wol_target_t * wol_inventory_find(const wol_inventory_t * inventory, const uint8_t mac[6])
+{
+    if(NULL == inventory)
+    {
+        return NULL;
+    }
+
+    for(size_t s = 0; s < inventory->section_count; s++)
+    {
+        const wol_target_t * records = inventory->targets + inventory->sections[s].first;
+        size_t low = 0;
+        size_t high = inventory->sections[s].count;
+
+        while(low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            int order = memcmp(records[middle].mac, mac, sizeof(records[middle].mac));
+            if(0 == order)
+            {
+                return &records[middle];
+            }
+            else if(0 > order)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+size_t wol_parse_targets_bound(size_t length)
+{
+    // n lines need at least n * 12 characters and n - 1 line ends
+    return (length + 1) / (INVENTORY_LINE_MIN + 1) + 1;
+}
+
+bool wol_parse_mac(const char * text, size_t length, uint8_t mac[6])
+{
+    // Positions of the 12 hexadecimal digits for each accepted length
+    static const uint8_t colon_positions[12] = { 0, 1, 3, 4, 6, 7, 9, 10, 12, 13, 15, 16 };
+    static const uint8_t dot_positions[12]   = { 0, 1, 2, 3, 5, 6, 7, 8, 10, 11, 12, 13 };
+    static const uint8_t plain_positions[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    const uint8_t * positions;
+    switch(length)
+    {
+        case 17:
+        {
+            char separator = text[2];
+            if(':' != separator && '-' != separator)
+            {
+                return false;
+            }
+            for(size_t i = 2; i < 17; i += 3)
+            {
+                if(separator != text[i])
+                {
+                    return false;
+                }
+            }
+            positions = colon_positions;
+            break;
+        }
+
+        case 14:
+            if('.' != text[4] || '.' != text[9])
+            {
+                return false;
+            }
+            positions = dot_positions;
+            break;
+
+        case 12:
+            positions = plain_positions;
+            break;
+
+        default:
+            return false;
+    }
+
+    uint8_t bytes[6];
+    uint8_t invalid = 0;
+    for(size_t i = 0; i < 6; i++)
+    {
+        uint8_t high = hex_values[(uint8_t)text[positions[2 * i + 0]]];
+        uint8_t low  = hex_values[(uint8_t)text[positions[2 * i + 1]]];
+        invalid |= high | low;
+        bytes[i] = (uint8_t)((high << 4) | (low & 0x0F));
+    }
+
+    // Valid digits never set the upper nibble, ::HEX_INVALID does
+    if(0 != (invalid & 0xF0))
+    {
+        return false;
+    }
+
+    memcpy(mac, bytes, sizeof(bytes));
+    return true;
+}
+
+bool wol_parse_ip_v4(const char * text, size_t length, uint32_t * ip_v4)
+{
+    if(7 > length || 15 < length)
+    {
+        return false;
+    }
+
+    uint32_t ip = 0;
+    uint32_t octet = 0;
+    uint8_t digits = 0;
+    uint8_t dots = 0;
+
+    for(size_t i = 0; i < length; i++)
+    {
+        char c = text[i];
+        if('0' <= c && '9' >= c)
+        {
+            // A leading zero is rejected, other parsers read such octets as octal
+            if(1 == digits && 0 == octet)
+            {
+                return false;
+            }
+            octet = octet * 10 + (uint32_t)(c - '0');
+            digits++;
+            if(3 < digits || 255 < octet)
+            {
+                return false;
+            }
+        }
+        else if('.' == c && 0 != digits && 3 > dots)
+        {
+            ip = (ip << 8) | octet;
+            octet = 0;
+            digits = 0;
+            dots++;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if(3 != dots || 0 == digits)
+    {
+        return false;
+    }
+
+    *ip_v4 = (ip << 8) | octet;
+    return true;
+}
+
+bool wol_parse_ip_v6(const char * text, size_t length, uint8_t ip_v6[16], uint32_t * scope_id)
+{
+    size_t address_length = length;
+    uint32_t scope = 0;
+
+    const char * percent = memchr(text, '%', length);
+    if(percent)
+    {
+        address_length = (size_t)(percent - text);
+
+        size_t digits = length - address_length - 1;
+        if(0 == digits || 10 < digits)
+        {
+            return false;
+        }
+
+        uint64_t value = 0;
+        for(size_t i = address_length + 1; i < length; i++)
+        {
+            if('0' > text[i] || '9' < text[i])
+            {
+                return false;
+            }
+            value = value * 10 + (uint64_t)(text[i] - '0');
+        }
+        if(UINT32_MAX < value)
+        {
+            return false;
+        }
+        scope = (uint32_t)value;
+    }
+
+    if(2 > address_length || 39 < address_length)
+    {
+        return false;
+    }
+
+    uint16_t groups[8];
+    size_t count = 0;
+    size_t gap = SIZE_MAX;
+    size_t i = 0;
+
+    if(':' == text[0])
+    {
+        if(':' != text[1])
+        {
+            return false;
+        }
+        gap = 0;
+        i = 2;
+    }
+
+    while(i < address_length)
+    {
+        if(8 == count)
+        {
+            return false;
+        }
+
+        uint32_t value = 0;
+        size_t digits = 0;
+        while(i < address_length && HEX_INVALID != hex_values[(uint8_t)text[i]])
+        {
+            value = (value << 4) | hex_values[(uint8_t)text[i]];
+            digits++;
+            i++;
+        }
+        if(0 == digits || 4 < digits)
+        {
+            return false;
+        }
+        groups[count++] = (uint16_t)value;
+
+        if(i == address_length)
+        {
+            break;
+        }
+        if(':' != text[i])
+        {
+            return false;
+        }
+        i++;
+
+        if(i < address_length && ':' == text[i])
+        {
+            if(SIZE_MAX != gap)
+            {
+                return false;
+            }
+            gap = count;
+            i++;
+        }
+        else if(i == address_length)
+        {
+            return false;
+        }
+    }
+
+    // Without `::` all 8 groups are needed, with `::` at least one group is left out
+    if((SIZE_MAX == gap) ? (8 != count) : (7 < count))
+    {
+        return false;
+    }
+
+    uint8_t bytes[16] = { 0 };
+    size_t tail = (SIZE_MAX == gap) ? 0 : count - gap;
+    size_t head = count - tail;
+    for(size_t group = 0; group < head; group++)
+    {
+        bytes[2 * group] = (uint8_t)(groups[group] >> 8);
+        bytes[2 * group + 1] = (uint8_t)(groups[group] & 0xFF);
+    }
+    for(size_t group = 0; group < tail; group++)
+    {
+        size_t position = 8 - tail + group;
+        bytes[2 * position] = (uint8_t)(groups[head + group] >> 8);
+        bytes[2 * position + 1] = (uint8_t)(groups[head + group] & 0xFF);
+    }
+
+    // The unspecified address marks IPv4 targets
+    static const uint8_t unspecified[16] = { 0 };
+    if(0 == memcmp(bytes, unspecified, sizeof(bytes)))
+    {
+        return false;
+    }
+
+    memcpy(ip_v6, bytes, sizeof(bytes));
+    *scope_id = scope;
+    return true;
+}
+
+uint32_t wol_parse_group(const char * text, size_t length)
+{
+    if(NULL == text || 0 == length)
+    {
+        return 0;
+    }
+
+    // FNV-1a, the group names of an inventory are few and short
+    uint32_t hash = UINT32_C(2166136261);
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)text[i];
+        hash *= UINT32_C(16777619);
+    }
+
+    return (0 == hash) ? 1 : hash;
+}
+
+size_t wol_parse_targets(wol_parse_t * parse, const char * buffer, size_t length)
+{
+    size_t offset = 0;
+
+    if(NULL == parse || NULL == buffer)
+    {
+        return offset;
+    }
+
+    while(offset < length)
+    {
+        const char * line = buffer + offset;
+        size_t rest = length - offset;
+
+        // memchr() is vectorized by the C library, this is the only scan over the whole buffer
+        const char * newline = memchr(line, '\n', rest);
+        size_t line_length = newline ? (size_t)(newline - line) : rest;
+        size_t next = offset + line_length + (newline ? 1 : 0);
+
+        wol_target_t target;
+        uint32_t group = 0;
+        bool is_host = false;
+        size_t column = 0;
+        wake_on_lan_errors_t error = parse_line(parse, line, line_length, &target, &group, &is_host, &column);
+
+        if(WAKE_ON_LAN_ERRORS_NONE == error && is_host)
+        {
+            if(parse->targets_count >= parse->targets_capacity)
+            {
+                // The line is parsed again by the next call
+                break;
+            }
+            if(parse->groups)
+            {
+                parse->groups[parse->targets_count] = group;
+            }
+            parse->targets[parse->targets_count++] = target;
+        }
+
+        parse->line++;
+
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            if(parse->errors && parse->errors_count < parse->errors_capacity)
+            {
+                wol_parse_error_t * parse_error = &parse->errors[parse->errors_count];
+                parse_error->line = parse->line;
+                parse_error->column = column;
+                parse_error->error = error;
+            }
+            parse->errors_count++;
+        }
+
+        offset = next;
+    }
+
+    return offset;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,267 @@
+//! @file
+//! @brief The wake_on_lan_inventory header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Loads host inventories, lists of MAC/IP/port lines, into arrays of ::wol_target_t
+//! that can be handed to ::wake_on_lan_batch().
+
+#ifndef INC_WAKE_ON_LAN_INVENTORY_H_
+#define INC_WAKE_ON_LAN_INVENTORY_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief First bytes of a compiled inventory file, see ::wol_inventory_header_t
+#define WOL_INVENTORY_MAGIC "WOLBIN"
+
+//! @brief Version of the compiled inventory format
+#define WOL_INVENTORY_VERSION 3
+
+//! @brief Written into ::wol_inventory_header_s::byte_order, a file with a different value was written on a machine with another byte order
+#define WOL_INVENTORY_BYTE_ORDER UINT32_C(0x01020304)
+
+//! @brief Alignment of the sections and records inside a compiled inventory file
+#define WOL_INVENTORY_ALIGNMENT 64
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Location and reason of a line that could not be parsed by ::wol_parse_targets()
+typedef struct wol_parse_error_s
+{
+    size_t line;                        //!< Line number, the first line is 1
+    size_t column;                      //!< Column of the failing field, the first column is 1
+    wake_on_lan_errors_t error;         //!< ::WAKE_ON_LAN_ERRORS_MAC, ::WAKE_ON_LAN_ERRORS_IP, ::WAKE_ON_LAN_ERRORS_PORT or ::WAKE_ON_LAN_ERRORS_LINE
+} wol_parse_error_t;
+
+//! @brief A read-only file mapped into memory, see ::wol_file_map_open()
+typedef struct wol_file_map_s
+{
+    const char * data;                  //!< Content of the file, not null-terminated, NULL for an empty file
+    size_t length;                      //!< Number of bytes in wol_file_map_s::data
+    bool mapped;                        //!< The data is a memory mapping, otherwise it was read into an allocation (stdin)
+} wol_file_map_t;
+
+//! @brief Header at the start of a compiled inventory file, see ::wol_inventory_write()
+//! @details The header is followed by wol_inventory_header_s::section_count ::wol_inventory_section_t and
+//!          wol_inventory_header_s::record_count ::wol_target_t, both at the given offsets. The records are
+//!          stored in the memory layout of ::wol_target_t so that the mapped file can be used without parsing.
+typedef struct wol_inventory_header_s
+{
+    char magic[6];                      //!< ::WOL_INVENTORY_MAGIC without the terminating zero
+    uint16_t version;                   //!< ::WOL_INVENTORY_VERSION
+    uint32_t byte_order;                //!< ::WOL_INVENTORY_BYTE_ORDER
+    uint16_t record_size;               //!< `sizeof(wol_target_t)`
+    uint16_t section_size;              //!< `sizeof(wol_inventory_section_t)`
+    uint32_t section_count;             //!< Number of sections
+    uint32_t record_count;              //!< Number of records
+    uint64_t sections_offset;           //!< Offset of the first section from the start of the file
+    uint64_t records_offset;            //!< Offset of the first record from the start of the file
+} wol_inventory_header_t;
+
+//! @brief A range of records of a compiled inventory with one destination IP, sorted by MAC
+typedef struct wol_inventory_section_s
+{
+    uint32_t ip_v4;                     //!< IP of all records of the section, 0 if the file is not split per subnet
+    uint32_t first;                     //!< Index of the first record
+    uint32_t count;                     //!< Number of records
+    uint32_t reserved;                  //!< Written as 0
+} wol_inventory_section_t;
+
+//! @brief A compiled inventory mapped into memory, see ::wol_inventory_load()
+typedef struct wol_inventory_s
+{
+    wol_file_map_t map;                         //!< Mapping of the whole file
+    const wol_inventory_section_t * sections;   //!< Sections inside the mapping
+    size_t section_count;                       //!< Number of sections
+    const wol_target_t * targets;               //!< Records inside the mapping, can be handed to ::wake_on_lan_batch() directly
+    size_t count;                               //!< Number of records
+} wol_inventory_t;
+
+//! @brief Counts of ::wol_inventory_merge()
+typedef struct wol_inventory_merge_s
+{
+    size_t added;                       //!< Targets with a MAC that was not in the file
+    size_t updated;                     //!< Records whose IP was replaced
+    size_t unchanged;                   //!< Targets that matched their record
+    bool rewritten;                     //!< The file was written again as a whole, otherwise at most the updated records were written in place
+} wol_inventory_merge_t;
+
+//! @brief State of ::wol_parse_targets(), the caller provides the output arrays
+//! @details Set the arrays, capacities and defaults, everything else to 0. The state can be
+//!          passed to several calls, e.g. to continue after the targets array was full.
+typedef struct wol_parse_s
+{
+    wol_target_t * targets;             //!< Output array of parsed targets
+    size_t targets_capacity;            //!< Number of elements available in wol_parse_s::targets
+    size_t targets_count;               //!< Number of targets written so far
+    uint32_t * groups;                  //!< Output array of wol_parse_s::targets_capacity groups, the group of each target, can be NULL if not necessary
+    wol_parse_error_t * errors;         //!< Output array of parse errors, can be NULL if not necessary
+    size_t errors_capacity;             //!< Number of elements available in wol_parse_s::errors
+    size_t errors_count;                //!< Number of failed lines so far, can be larger than wol_parse_s::errors_capacity
+    size_t line;                        //!< Number of lines read so far
+    uint32_t default_ip_v4;             //!< IP used for lines without IP, as number, not in network order
+    uint16_t default_port;              //!< Port used for lines without port
+} wol_parse_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Maps a file read-only into memory
+//! @details Uses `mmap()` or `MapViewOfFile()`, the file can be parsed directly from the mapping without copies.
+//!          The path `-` reads stdin, which is mapped as well if it is a regular file and read into an allocation otherwise.
+//! @param[out] map Pointer to the mapping to initialize
+//! @param path Path of the file or `-` for stdin
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE or ::WAKE_ON_LAN_ERRORS_MEMORY
+wake_on_lan_errors_t wol_file_map_open(wol_file_map_t * map, const char * path, wake_on_lan_t * wol);
+
+//! @brief Unmaps or frees the content of a file opened with ::wol_file_map_open()
+//! @param map Pointer to the mapping
+void wol_file_map_close(wol_file_map_t * map);
+
+//! @brief Upper bound of the number of hosts in an inventory buffer, without reading the buffer
+//! @details Every host line is at least 12 characters long plus a line end.
+//! @param length Number of bytes of the inventory
+//! @return Number of targets that ::wol_parse_targets() can produce at most
+size_t wol_parse_targets_bound(size_t length);
+
+//! @brief Writes targets as compiled inventory file
+//! @details The targets are sorted in place, by IP first if `per_subnet` is set and by MAC second.
+//! @param path Path of the file to create or overwrite
+//! @param[in,out] targets Array of `n` targets, sorted on return
+//! @param n Number of targets
+//! @param per_subnet Writes one section per destination IP, otherwise one section with all targets
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE or ::WAKE_ON_LAN_ERRORS_MEMORY
+wake_on_lan_errors_t wol_inventory_write(const char * path, wol_target_t * targets, size_t n, bool per_subnet, wake_on_lan_t * wol);
+
+//! @brief Merges targets into a compiled inventory file, keyed by MAC
+//! @details A target with a new MAC is added with all its fields, a target with a known MAC only replaces the IP of
+//!          its record, the port and password of the record are kept. Only what changed is written: a file without
+//!          changes is not touched, updated records that keep their place in the sort order are written in place,
+//!          and only new records or records that move to another section write the file again, into a temporary
+//!          file that replaces the old one, so readers never see half a file. A missing file is created with one
+//!          section per subnet.
+//! @param path Path of the compiled inventory
+//! @param targets Array of `n` targets, e.g. harvested by ::wol_neighbors_read(), only one of equal MACs is used
+//! @param n Number of targets
+//! @param[out] merge Pointer to the counts of the merge, can be NULL if not necessary
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_FORMAT if the file is no compiled inventory
+wake_on_lan_errors_t wol_inventory_merge(const char * path, const wol_target_t * targets, size_t n, wol_inventory_merge_t * merge, wake_on_lan_t * wol);
+
+//! @brief Maps a compiled inventory file, the records are used in place without parsing
+//! @param[out] inventory Pointer to the inventory to initialize
+//! @param path Path of the file or `-` for stdin
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_FILE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_FORMAT
+wake_on_lan_errors_t wol_inventory_load(wol_inventory_t * inventory, const char * path, wake_on_lan_t * wol);
+
+//! @brief Uses an already mapped file as compiled inventory
+//! @details On success the inventory takes over the mapping and ::wol_inventory_close() releases it,
+//!          on failure the mapping is left untouched, e.g. to parse it as text instead.
+//! @param[out] inventory Pointer to the inventory to initialize
+//! @param map Pointer to a mapping opened with ::wol_file_map_open()
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or ::WAKE_ON_LAN_ERRORS_FORMAT
+wake_on_lan_errors_t wol_inventory_from_map(wol_inventory_t * inventory, const wol_file_map_t * map);
+
+//! @brief Releases the mapping of a compiled inventory
+//! @param inventory Pointer to the inventory
+void wol_inventory_close(wol_inventory_t * inventory);
+
+//! @brief Looks up a MAC with a binary search in each section
+//! @param inventory Pointer to the inventory
+//! @param mac MAC address, most significant byte first
+//! @return Pointer to the record or NULL if the MAC is not in the inventory
+const wol_target_t * wol_inventory_find(const wol_inventory_t * inventory, const uint8_t mac[6]);
+
+//! @brief Parses an inventory buffer with one `mac [ip] [port] [group] [password]` host per line in one linear pass
+//! @details Fields are separated by spaces, tabs, commas or semicolons, so CSV exports can be read
+//!          directly. Empty lines and lines starting with `#` are skipped, `\r\n` line ends are accepted.
+//!
+//!          The fields are validated strictly:
+//!
+//!          - MAC  `aa:bb:cc:dd:ee:ff`, `aa-bb-cc-dd-ee-ff`, `aabb.ccdd.eeff` or `aabbccddeeff`
+//!          - IP   Dotted-quad IPv4 with 4 decimal octets from 0 to 255 or IPv6, see ::wol_parse_ip_v6()
+//!          - Port Decimal number from 1 to 65535
+//!          - Group Any name, e.g. the rack or PDU of the host, see ::wol_parse_group()
+//!          - Password SecureOn password of 6 bytes in a MAC format or of 4 bytes as dotted-quad
+//!
+//!          A line with an invalid field is reported in wol_parse_s::errors and produces no target,
+//!          parsing continues with the next line.
+//!
+//! @param parse Pointer to the parser state
+//! @param buffer Inventory text, does not need to be null-terminated
+//! @param length Number of bytes in `buffer`, the end of the buffer also ends the last line
+//! @return Number of bytes consumed, less than `length` if wol_parse_s::targets is full, the rest starts at a line
+size_t wol_parse_targets(wol_parse_t * parse, const char * buffer, size_t length);
+
+//! @brief Converts the name of a group into the number stored in wol_parse_s::groups
+//! @details The number is a 32-bit FNV-1a hash of the name, so equal names give equal numbers without a name table.
+//! @param text Name, does not need to be null-terminated
+//! @param length Number of characters of the name
+//! @return Number of the group, 0 only for an empty name
+uint32_t wol_parse_group(const char * text, size_t length);
+
+//! @brief Strictly parses a MAC, see ::wol_parse_targets() for the accepted formats
+//! @param text MAC text, does not need to be null-terminated
+//! @param length Number of characters of the MAC
+//! @param[out] mac MAC address, most significant byte first, only written on success
+//! @return True if the text is a valid MAC
+bool wol_parse_mac(const char * text, size_t length, uint8_t mac[6]);
+
+//! @brief Strictly parses a dotted-quad IPv4
+//! @details Octets are decimal without leading zeros, `010.001.1.1` is rejected.
+//! @param text IP text, does not need to be null-terminated
+//! @param length Number of characters of the IP
+//! @param[out] ip_v4 IPv4 address as number, not in network order, only written on success
+//! @return True if the text is a valid IPv4
+bool wol_parse_ip_v4(const char * text, size_t length, uint32_t * ip_v4);
+
+//! @brief Strictly parses an IPv6 in hexadecimal groups, `::` shortens one run of zero groups
+//! @details An interface index can follow as decimal after a `%`, e.g. `ff02::1%2`.
+//!          Embedded IPv4 notation and the unspecified address `::` are rejected.
+//! @param text IP text, does not need to be null-terminated
+//! @param length Number of characters of the IP
+//! @param[out] ip_v6 IPv6 address in network order, only written on success
+//! @param[out] scope_id Interface index, 0 without scope, only written on success
+//! @return True if the text is a valid IPv6
+bool wol_parse_ip_v6(const char * text, size_t length, uint8_t ip_v6[16], uint32_t * scope_id);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_INVENTORY_H_ */
@@ -0,0 +1,709 @@
+//! @file
+//! @brief The wake_on_lan_listen source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+// @brief `WSAPoll()` needs Windows Vista or newer and must be requested before the first system header
+#if defined(_WIN32) && ( !defined(_WIN32_WINNT) || ( _WIN32_WINNT < 0x0600 ) )
+  #undef _WIN32_WINNT
+  #define _WIN32_WINNT 0x0600
+#endif
+
+// @brief `recvmmsg()` is a GNU extension of glibc
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE
+#endif
+
+#include "wake_on_lan_listen.h"
+#include "wake_on_lan_raw.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+
+  #ifdef _MSC_VER
+    #pragma comment(lib, "ws2_32.lib")
+  #endif
+
+#else
+
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <unistd.h>
+
+#endif
+
+#if defined(__linux__)
+
+  #include <linux/if_packet.h>
+  #include <net/if.h>
+  #include <sys/ioctl.h>
+
+#endif
+
+// @brief Wide compares for wol_listen_validate(), SSE2 on x86 and `memcmp()` otherwise
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && ( 2 <= _M_IX86_FP ) )
+  #include <emmintrin.h>
+  #define LISTEN_VALIDATE_SSE2
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Smallest number of slots of a table
+#define LISTEN_MIN_SLOTS 16
+
+//! @brief Marks a slot as used, so that the MAC 00:00:00:00:00:00 is a valid key too
+#define LISTEN_KEY_USED ( UINT64_C(1) << 48 )
+
+//! @brief Marks the MAC of a slot as expected
+#define LISTEN_KEY_EXPECTED ( UINT64_C(1) << 49 )
+
+//! @brief Mask of the MAC of a key
+#define LISTEN_MAC_MASK ( LISTEN_KEY_USED - 1 )
+
+//! @brief Multiplier of the Fibonacci hash of the keys
+#define LISTEN_HASH UINT64_C(0x9E3779B97F4A7C15)
+
+//! @brief Time between two checks of wol_listen_options_s::stop
+#define LISTEN_STOP_CHECK_MS 500
+
+//! @brief Receive buffer of one packet, larger packets are truncated and invalid
+#define LISTEN_FRAME_SIZE 256
+
+//! @brief Largest number of batches read from one socket before the other one gets its turn
+#define LISTEN_BATCHES_PER_ROUND 16
+
+//! @brief Index of the UDP socket and of the raw socket of a ::listen_receive_t
+#define LISTEN_UDP 0
+#define LISTEN_RAW 1
+#define LISTEN_SOCKETS 2
+
+// @brief The socket calls differ in names and types between Winsock and POSIX
+#ifdef _WIN32
+  #define LISTEN_INVALID_SOCKET INVALID_SOCKET
+  #define LISTEN_CLOSE(SOCKFD) closesocket(SOCKFD)
+  #define LISTEN_POLL(FDS, COUNT, TIMEOUT) WSAPoll(FDS, (ULONG)(COUNT), TIMEOUT)
+  #define LISTEN_LAST_ERROR() WSAGetLastError()
+#else
+  #define LISTEN_INVALID_SOCKET (-1)
+  #define LISTEN_CLOSE(SOCKFD) close(SOCKFD)
+  #define LISTEN_POLL(FDS, COUNT, TIMEOUT) poll(FDS, (nfds_t)(COUNT), TIMEOUT)
+  #define LISTEN_LAST_ERROR() errno
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+#ifdef _WIN32
+typedef SOCKET listen_socket_t;
+typedef WSAPOLLFD listen_pollfd_t;
+#else
+typedef int listen_socket_t;
+typedef struct pollfd listen_pollfd_t;
+#endif
+
+//! @brief Sockets and receive buffers of one ::wol_listen_run() call
+typedef struct listen_receive_s
+{
+    listen_pollfd_t fds[LISTEN_SOCKETS]; //!< UDP and raw socket, ::LISTEN_INVALID_SOCKET if not used
+    uint32_t dropped[LISTEN_SOCKETS];   //!< Last drop counter reported by each socket
+    uint8_t buffers[WOL_LISTEN_BATCH][LISTEN_FRAME_SIZE]; //!< One buffer for each packet of a batch
+#if defined(__linux__)
+    struct mmsghdr messages[WOL_LISTEN_BATCH]; //!< Messages of `recvmmsg()`
+    struct iovec iov[WOL_LISTEN_BATCH]; //!< One buffer for each message
+    uint8_t control[WOL_LISTEN_BATCH][CMSG_SPACE(sizeof(uint32_t))]; //!< Drop counter of each message
+#endif
+} listen_receive_t;
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+
+//! @brief Header of every magic packet
+static const uint8_t listen_header[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Finds the slot of a MAC or the free slot where it belongs
+//! @param listener Pointer to the listener
+//! @param mac MAC as number
+//! @return Index of the slot
+static size_t listen_slot(const wol_listen_t * listener, uint64_t mac);
+
+//! @brief Allocates the slots of a table, the old slots are not copied
+//! @param listener Pointer to the listener
+//! @param slots Number of slots, a power of 2
+//! @return True on success, the listener is unchanged on failure
+static bool listen_allocate(wol_listen_t * listener, size_t slots);
+
+//! @brief Doubles the slots of a table and moves every used slot
+//! @param listener Pointer to the listener
+//! @return True on success, the listener is unchanged on failure
+static bool listen_grow(wol_listen_t * listener);
+
+//! @brief Opens a non-blocking socket, UDP on wol_listen_options_s::port or raw on wol_listen_options_s::device
+//! @param options Pointer to the options
+//! @param raw True for the raw socket
+//! @param[out] sockfd Receives the socket, ::LISTEN_INVALID_SOCKET on failure
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get the error, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or the error of the failing step
+static wake_on_lan_errors_t listen_socket(const wol_listen_options_t * options, bool raw, listen_socket_t * sockfd, wake_on_lan_t * wol);
+
+//! @brief Reads the waiting packets of a socket and counts them
+//! @param listener Pointer to the listener
+//! @param receive Pointer to the sockets and buffers
+//! @param index Index of the socket, ::LISTEN_UDP or ::LISTEN_RAW
+//! @return Number of read packets, 0 if the socket had none
+static size_t listen_drain(wol_listen_t * listener, listen_receive_t * receive, size_t index);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static size_t listen_slot(const wol_listen_t * listener, uint64_t mac)
+{
+    size_t slot = (size_t)((mac * LISTEN_HASH) >> listener->shift);
+
+    // The table is at most half full, so there is always a free slot
+    while(0 != listener->keys[slot] && mac != (listener->keys[slot] & LISTEN_MAC_MASK))
+    {
+        slot = (slot + 1) & listener->mask;
+    }
+
+    return slot;
+}
+
+static bool listen_allocate(wol_listen_t * listener, size_t slots)
+{
+    uint64_t * keys = calloc(slots, sizeof(*keys));
+    uint32_t * hits = calloc(slots, sizeof(*hits));
+    if(NULL == keys || NULL == hits)
+    {
+        free(hits);
+        free(keys);
+        return false;
+    }
+
+    unsigned bits = 0;
+    while(((size_t)1 << bits) < slots)
+    {
+        bits++;
+    }
+
+    listener->keys = keys;
+    listener->hits = hits;
+    listener->mask = slots - 1;
+    listener->shift = 64u - bits;
+
+    return true;
+}
+
+static bool listen_grow(wol_listen_t * listener)
+{
+    wol_listen_t old = *listener;
+
+    if(!listen_allocate(listener, (old.mask + 1) * 2))
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i <= old.mask; i++)
+    {
+        if(0 != old.keys[i])
+        {
+            size_t slot = listen_slot(listener, old.keys[i] & LISTEN_MAC_MASK);
+            listener->keys[slot] = old.keys[i];
+            listener->hits[slot] = old.hits[i];
+        }
+    }
+
+    free(old.hits);
+    free(old.keys);
+
+    return true;
+}
+
+static wake_on_lan_errors_t listen_socket(const wol_listen_options_t * options, bool raw, listen_socket_t * sockfd, wake_on_lan_t * wol)
+{
+#if defined(__linux__)
+    *sockfd = raw ? socket(AF_PACKET, SOCK_DGRAM, htons(WOL_ETHERTYPE)) : socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#else
+    if(raw)
+    {
+        *sockfd = LISTEN_INVALID_SOCKET;
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+    }
+    *sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+    if(LISTEN_INVALID_SOCKET == *sockfd)
+    {
+        if(wol) { wol->last_error = LISTEN_LAST_ERROR(); }
+        return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+    }
+
+    // A large buffer keeps the bursts of the sender, without it the listener drops first
+    int receive_buffer = options->receive_buffer ? options->receive_buffer : WOL_LISTEN_RECEIVE_BUFFER;
+#if defined(__linux__)
+    if(0 != setsockopt(*sockfd, SOL_SOCKET, SO_RCVBUFFORCE, &receive_buffer, sizeof(receive_buffer)))
+#endif
+    {
+        setsockopt(*sockfd, SOL_SOCKET, SO_RCVBUF, (const char *)&receive_buffer, sizeof(receive_buffer));
+    }
+
+#if defined(__linux__)
+    int overflow = 1;
+    setsockopt(*sockfd, SOL_SOCKET, SO_RXQ_OVFL, &overflow, sizeof(overflow));
+
+    if(raw)
+    {
+        struct ifreq request;
+        memset(&request, 0, sizeof(request));
+        if(IFNAMSIZ <= strlen(options->device))
+        {
+            if(wol) { wol->last_error = -1; }
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+        strncpy(request.ifr_name, options->device, IFNAMSIZ - 1);
+        if(0 > ioctl(*sockfd, SIOCGIFINDEX, &request))
+        {
+            if(wol) { wol->last_error = errno; }
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+
+        struct sockaddr_ll addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(WOL_ETHERTYPE);
+        addr.sll_ifindex = request.ifr_ifindex;
+
+        if(0 != bind(*sockfd, (const struct sockaddr *)&addr, sizeof(addr)))
+        {
+            if(wol) { wol->last_error = errno; }
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+    }
+    else
+#endif
+    {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(options->port);
+
+        if(0 != bind(*sockfd, (const struct sockaddr *)&addr, sizeof(addr)))
+        {
+            if(wol) { wol->last_error = LISTEN_LAST_ERROR(); }
+            return WAKE_ON_LAN_ERRORS_BIND;
+        }
+    }
+
+#ifdef _WIN32
+    u_long mode = 1;
+    if(SOCKET_ERROR == ioctlsocket(*sockfd, FIONBIO, &mode))
+#else
+    int flags = fcntl(*sockfd, F_GETFL, 0);
+    if(0 > flags || 0 != fcntl(*sockfd, F_SETFL, flags | O_NONBLOCK))
+#endif
+    {
+        if(wol) { wol->last_error = LISTEN_LAST_ERROR(); }
+        return WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static size_t listen_drain(wol_listen_t * listener, listen_receive_t * receive, size_t index)
+{
+    listen_socket_t sockfd = receive->fds[index].fd;
+    size_t total = 0;
+    bool valid = false;
+
+    for(size_t batch = 0; batch < LISTEN_BATCHES_PER_ROUND; batch++)
+    {
+#if defined(__linux__)
+        for(size_t i = 0; i < WOL_LISTEN_BATCH; i++)
+        {
+            receive->iov[i].iov_base = receive->buffers[i];
+            receive->iov[i].iov_len = LISTEN_FRAME_SIZE;
+            memset(&receive->messages[i].msg_hdr, 0, sizeof(receive->messages[i].msg_hdr));
+            receive->messages[i].msg_hdr.msg_iov = &receive->iov[i];
+            receive->messages[i].msg_hdr.msg_iovlen = 1;
+            receive->messages[i].msg_hdr.msg_control = receive->control[i];
+            receive->messages[i].msg_hdr.msg_controllen = sizeof(receive->control[i]);
+        }
+
+        int count = recvmmsg(sockfd, receive->messages, WOL_LISTEN_BATCH, MSG_DONTWAIT, NULL);
+        if(0 >= count)
+        {
+            break;
+        }
+
+        for(int i = 0; i < count; i++)
+        {
+            const struct msghdr * message = &receive->messages[i].msg_hdr;
+            if(0 != (message->msg_flags & MSG_TRUNC))
+            {
+                listener->packets++;
+                listener->invalid++;
+            }
+            else
+            {
+                valid |= wol_listen_count(listener, receive->buffers[i], receive->messages[i].msg_len);
+            }
+
+            // The counter of the socket comes with the packets, the last one is the current total
+            for(const struct cmsghdr * cmsg = CMSG_FIRSTHDR(message); cmsg; cmsg = CMSG_NXTHDR((struct msghdr *)message, (struct cmsghdr *)cmsg))
+            {
+                if(SOL_SOCKET == cmsg->cmsg_level && SO_RXQ_OVFL == cmsg->cmsg_type)
+                {
+                    memcpy(&receive->dropped[index], CMSG_DATA(cmsg), sizeof(uint32_t));
+                }
+            }
+        }
+#else
+        int count = 0;
+        for(; count < WOL_LISTEN_BATCH; count++)
+        {
+            int length = (int)recvfrom(sockfd, (char *)receive->buffers[count], LISTEN_FRAME_SIZE, 0, NULL, NULL);
+            if(0 > length)
+            {
+                break;
+            }
+            valid |= wol_listen_count(listener, receive->buffers[count], (size_t)length);
+        }
+        if(0 == count)
+        {
+            break;
+        }
+#endif
+
+        total += (size_t)count;
+        if(WOL_LISTEN_BATCH > count)
+        {
+            break;
+        }
+    }
+
+    if(valid)
+    {
+        listener->last_ns = wol_clock_ns();
+        if(0 == listener->first_ns)
+        {
+            listener->first_ns = listener->last_ns;
+        }
+    }
+
+    return total;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+bool wol_listen_validate(const uint8_t * data, size_t length, uint8_t mac[6])
+{
+    if(NULL == data || (WAKE_ON_LAN_PACKET_SIZE != length && WAKE_ON_LAN_PACKET_SIZE + 4 != length && WAKE_ON_LAN_PACKET_MAX_SIZE != length))
+    {
+        return false;
+    }
+
+    if(0 != memcmp(data, listen_header, sizeof(listen_header)))
+    {
+        return false;
+    }
+
+    // 16 equal MACs are a period of 6 bytes, so every byte of the repetitions equals the byte 6 bytes later
+#if defined(LISTEN_VALIDATE_SSE2)
+    static const size_t offsets[] = { 6, 22, 38, 54, 70, 80 };
+    __m128i equal = _mm_set1_epi8((char)0xFF);
+    for(size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + offsets[i]));
+        __m128i b = _mm_loadu_si128((const __m128i *)(data + offsets[i] + 6));
+        equal = _mm_and_si128(equal, _mm_cmpeq_epi8(a, b));
+    }
+    if(0xFFFF != _mm_movemask_epi8(equal))
+    {
+        return false;
+    }
+#else
+    if(0 != memcmp(data + 6, data + 12, WAKE_ON_LAN_PACKET_SIZE - 12))
+    {
+        return false;
+    }
+#endif
+
+    if(mac)
+    {
+        memcpy(mac, data + 6, 6);
+    }
+
+    return true;
+}
+
+wake_on_lan_errors_t wol_listen_open(wol_listen_t * listener, const wol_target_t * expected, size_t n, wake_on_lan_t * wol)
+{
+    if(NULL == listener || (NULL == expected && 0 != n))
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    memset(listener, 0, sizeof(*listener));
+
+    size_t slots = LISTEN_MIN_SLOTS;
+    while(slots / 2 < n)
+    {
+        slots *= 2;
+    }
+
+    if(!listen_allocate(listener, slots))
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        uint64_t mac = wol_target_mac(&expected[i]);
+        size_t slot = listen_slot(listener, mac);
+        if(0 == listener->keys[slot])
+        {
+            listener->keys[slot] = mac | LISTEN_KEY_USED | LISTEN_KEY_EXPECTED;
+            listener->used++;
+            listener->expected++;
+        }
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+bool wol_listen_count(wol_listen_t * listener, const uint8_t * data, size_t length)
+{
+    uint8_t mac[6];
+
+    listener->packets++;
+    if(!wol_listen_validate(data, length, mac))
+    {
+        listener->invalid++;
+        return false;
+    }
+    listener->valid++;
+
+    uint64_t key = (uint64_t)mac[0] << 40 | (uint64_t)mac[1] << 32 | (uint64_t)mac[2] << 24 |
+                   (uint64_t)mac[3] << 16 | (uint64_t)mac[4] << 8 | (uint64_t)mac[5];
+
+    size_t slot = listen_slot(listener, key);
+    if(0 == listener->keys[slot])
+    {
+        // Without memory for more slots the MAC is only counted in the totals
+        if(listener->used + 1 > (listener->mask + 1) / 2)
+        {
+            if(!listen_grow(listener))
+            {
+                listener->unexpected += (0 != listener->expected);
+                return true;
+            }
+            slot = listen_slot(listener, key);
+        }
+        listener->keys[slot] = key | LISTEN_KEY_USED;
+        listener->used++;
+    }
+
+    if(0 == (listener->keys[slot] & LISTEN_KEY_EXPECTED))
+    {
+        listener->unexpected += (0 != listener->expected);
+    }
+    else if(0 == listener->hits[slot])
+    {
+        listener->expected_seen++;
+    }
+
+    if(0 != listener->hits[slot])
+    {
+        listener->duplicates++;
+    }
+    if(UINT32_MAX != listener->hits[slot])
+    {
+        listener->hits[slot]++;
+    }
+
+    return true;
+}
+
+wake_on_lan_errors_t wol_listen_run(wol_listen_t * listener, const wol_listen_options_t * options, wake_on_lan_t * wol)
+{
+    if(NULL == listener || NULL == listener->keys || NULL == options || (0 == options->port && NULL == options->device))
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    listen_receive_t * receive = malloc(sizeof(*receive));
+    if(NULL == receive)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+    memset(receive->dropped, 0, sizeof(receive->dropped));
+    for(size_t i = 0; i < LISTEN_SOCKETS; i++)
+    {
+        receive->fds[i].fd = LISTEN_INVALID_SOCKET;
+        receive->fds[i].events = POLLIN;
+        receive->fds[i].revents = 0;
+    }
+
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if(0 != WSAStartup(MAKEWORD(2, 2), &wsa_data))
+    {
+        if(wol) { wol->last_error = WSAGetLastError(); }
+        free(receive);
+        return WAKE_ON_LAN_ERRORS_WSA_STARTUP;
+    }
+#endif
+
+    do{
+
+        if(0 != options->port)
+        {
+            return_value = listen_socket(options, false, &receive->fds[LISTEN_UDP].fd, wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+            {
+                break;
+            }
+        }
+
+        if(NULL != options->device)
+        {
+            return_value = listen_socket(options, true, &receive->fds[LISTEN_RAW].fd, wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+            {
+                break;
+            }
+        }
+
+        uint64_t idle_ns = (uint64_t)(options->idle_ms ? options->idle_ms : WOL_LISTEN_IDLE_MS) * UINT64_C(1000000);
+        uint64_t last_packet_ns = 0;
+
+        while(NULL == options->stop || !*options->stop)
+        {
+            int timeout_ms = LISTEN_STOP_CHECK_MS;
+            if(0 != last_packet_ns)
+            {
+                uint64_t now_ns = wol_clock_ns();
+                if(now_ns - last_packet_ns >= idle_ns)
+                {
+                    break;
+                }
+
+                uint64_t left_ms = (last_packet_ns + idle_ns - now_ns + UINT64_C(999999)) / UINT64_C(1000000);
+                if(left_ms < (uint64_t)timeout_ms)
+                {
+                    timeout_ms = (int)left_ms;
+                }
+            }
+
+            // Only the open sockets go to poll(), with one of them it is always the first entry of its slot
+            listen_pollfd_t * fds = (LISTEN_INVALID_SOCKET == receive->fds[LISTEN_UDP].fd) ? &receive->fds[LISTEN_RAW] : &receive->fds[LISTEN_UDP];
+            size_t fd_count = (LISTEN_INVALID_SOCKET == receive->fds[LISTEN_UDP].fd || LISTEN_INVALID_SOCKET == receive->fds[LISTEN_RAW].fd) ? 1 : 2;
+
+            int ready = LISTEN_POLL(fds, fd_count, timeout_ms);
+            if(0 >= ready)
+            {
+                continue;
+            }
+
+            bool received = false;
+            for(size_t i = 0; i < LISTEN_SOCKETS; i++)
+            {
+                if(LISTEN_INVALID_SOCKET != receive->fds[i].fd && 0 != (receive->fds[i].revents & POLLIN))
+                {
+                    received |= (0 != listen_drain(listener, receive, i));
+                }
+            }
+            if(received)
+            {
+                last_packet_ns = wol_clock_ns();
+            }
+        }
+
+    }while(0);
+
+    for(size_t i = 0; i < LISTEN_SOCKETS; i++)
+    {
+        if(LISTEN_INVALID_SOCKET != receive->fds[i].fd)
+        {
+            LISTEN_CLOSE(receive->fds[i].fd);
+        }
+        listener->dropped += receive->dropped[i];
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    free(receive);
+
+    return return_value;
+}
+
+uint32_t wol_listen_hits(const wol_listen_t * listener, uint64_t mac)
+{
+    if(NULL == listener || NULL == listener->keys)
+    {
+        return 0;
+    }
+
+    size_t slot = listen_slot(listener, mac & LISTEN_MAC_MASK);
+
+    return (0 == listener->keys[slot]) ? 0 : listener->hits[slot];
+}
+
+void wol_listen_close(wol_listen_t * listener)
+{
+    if(NULL == listener)
+    {
+        return;
+    }
+
+    free(listener->hits);
+    free(listener->keys);
+    listener->keys = NULL;
+    listener->hits = NULL;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
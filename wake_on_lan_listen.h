@@ -0,0 +1,143 @@
+//! @file
+//! @brief The wake_on_lan_listen header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Receiving end of a throughput test. A listener takes magic packets from a UDP port and,
+//! on Linux, raw Ethernet frames with the EtherType ::WOL_ETHERTYPE from a device, checks the
+//! 6 bytes `0xFF` and the 16 repetitions of the MAC of each packet and counts the hits of each
+//! MAC in a compact hash table.
+//!
+//! The MACs of an expected inventory are put into the table before the test, so that after the
+//! test every expected MAC without hit is a lost wake. On Linux the packets are read in batches
+//! with `recvmmsg()` and the sockets report the packets the kernel dropped because the listener
+//! was too slow, so that losses of the network and of the listener can be told apart.
+
+#ifndef INC_WAKE_ON_LAN_LISTEN_H_
+#define INC_WAKE_ON_LAN_LISTEN_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Default of wol_listen_options_s::idle_ms
+#define WOL_LISTEN_IDLE_MS 2000
+
+//! @brief Default of wol_listen_options_s::receive_buffer
+#define WOL_LISTEN_RECEIVE_BUFFER ( 8 * 1024 * 1024 )
+
+//! @brief Largest number of packets read with one system call
+#define WOL_LISTEN_BATCH 64
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Options of ::wol_listen_run(), all zero is a valid default without any socket
+typedef struct wol_listen_options_s
+{
+    uint16_t port;                      //!< UDP port of the magic packets, 0 for no UDP socket
+    const char * device;                //!< Network device of raw Ethernet frames, Linux only, NULL for no raw socket
+    uint32_t idle_ms;                   //!< The test ends after this time without packets once the first one arrived, 0 for ::WOL_LISTEN_IDLE_MS
+    int receive_buffer;                 //!< Receive buffer of each socket in bytes, 0 for ::WOL_LISTEN_RECEIVE_BUFFER
+    const volatile bool * stop;         //!< The listener returns soon after this becomes true, can be NULL
+} wol_listen_options_t;
+
+//! @brief Hit counts and totals of a test, see ::wol_listen_open()
+typedef struct wol_listen_s
+{
+    uint64_t * keys;                    //!< Hash slots, MAC in the low 48 bits and flags above, 0 for a free slot
+    uint32_t * hits;                    //!< Number of valid packets of the MAC of each slot
+    size_t mask;                        //!< Number of slots minus one
+    unsigned shift;                     //!< Right shift of the hash to a slot
+    size_t used;                        //!< Number of used slots
+    size_t expected;                    //!< Number of different expected MACs
+    size_t expected_seen;               //!< Number of expected MACs with at least one hit
+    uint64_t packets;                   //!< Received packets and frames
+    uint64_t valid;                     //!< Received magic packets with a valid structure
+    uint64_t invalid;                   //!< Received packets with a wrong size, header or MAC repetition
+    uint64_t duplicates;                //!< Valid packets of a MAC that had a hit before
+    uint64_t unexpected;                //!< Valid packets of a MAC that was not expected, 0 if nothing was expected
+    uint64_t dropped;                   //!< Packets the kernel dropped because the receive buffer was full, Linux only
+    uint64_t first_ns;                  //!< ::wol_clock_ns() time of the first batch with a valid packet, 0 before, set by ::wol_listen_run()
+    uint64_t last_ns;                   //!< ::wol_clock_ns() time of the last batch with a valid packet, set by ::wol_listen_run()
+} wol_listen_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Checks the structure of a magic packet
+//! @param data Received UDP payload or Ethernet payload
+//! @param length Number of received bytes, 102 or with SecureOn password 106 or 108
+//! @param[out] mac Receives the MAC of a valid packet, can be NULL if not necessary
+//! @return True if `data` starts with 6 bytes `0xFF` followed by 16 times the same MAC
+bool wol_listen_validate(const uint8_t * data, size_t length, uint8_t mac[6]);
+
+//! @brief Initializes a listener with the MACs that are expected to be woken
+//! @param[out] listener Pointer to the listener to initialize
+//! @param expected Array of the expected targets, can be NULL to count every MAC without expectation
+//! @param n Number of expected targets
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_UNKNOWN
+wake_on_lan_errors_t wol_listen_open(wol_listen_t * listener, const wol_target_t * expected, size_t n, wake_on_lan_t * wol);
+
+//! @brief Validates and counts one received packet
+//! @param listener Pointer to an open listener
+//! @param data Received UDP payload or Ethernet payload
+//! @param length Number of received bytes
+//! @return True if the packet was a valid magic packet
+bool wol_listen_count(wol_listen_t * listener, const uint8_t * data, size_t length);
+
+//! @brief Receives and counts magic packets until the sender is idle or wol_listen_options_s::stop becomes true
+//! @details Can be called again on the same listener to continue counting.
+//! @param listener Pointer to an open listener
+//! @param options Pointer to the options, at least a port or a device
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, otherwise the error of the setup, e.g. ::WAKE_ON_LAN_ERRORS_BIND if the port is in use
+wake_on_lan_errors_t wol_listen_run(wol_listen_t * listener, const wol_listen_options_t * options, wake_on_lan_t * wol);
+
+//! @brief Number of valid packets of a MAC
+//! @param listener Pointer to an open listener
+//! @param mac MAC as number, see ::wol_target_mac()
+//! @return Number of hits, 0 if the MAC was not received
+uint32_t wol_listen_hits(const wol_listen_t * listener, uint64_t mac);
+
+//! @brief Releases a listener
+//! @param listener Pointer to the listener, a closed listener is ignored
+void wol_listen_close(wol_listen_t * listener);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_LISTEN_H_ */
@@ -0,0 +1,226 @@
+//! @file
+//! @brief The wake_on_lan_metrics source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_metrics.h"
+
+#if defined(_MSC_VER)
+
+  #include <windows.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Atomically reads a counter
+//! @param counter Pointer to the counter
+//! @return Value of the counter
+static uint64_t metrics_load(const uint64_t * counter);
+
+//! @brief Atomically adds to a counter that may have several writers
+//! @param counter Pointer to the counter
+//! @param value Value to add
+static void metrics_fetch_add(uint64_t * counter, uint64_t value);
+
+//! @brief Atomically raises a maximum that may have several writers
+//! @param counter Pointer to the maximum
+//! @param value New value, ignored if it is not larger
+static void metrics_fetch_max(uint64_t * counter, uint64_t value);
+
+//! @brief Copies a histogram, see ::wol_metrics_snapshot()
+//! @param histogram Pointer to the histogram
+//! @param[out] snapshot Pointer to the copy
+static void histogram_snapshot(const wol_histogram_t * histogram, wol_histogram_t * snapshot);
+
+//! @brief Adds a histogram to another one, see ::wol_metrics_merge()
+//! @param[in,out] target Pointer to the histogram that receives the sum
+//! @param source Pointer to the histogram to add
+static void histogram_merge(wol_histogram_t * target, const wol_histogram_t * source);
+
+//! @brief Largest time of a bucket
+//! @param bucket Index of the bucket, see ::wol_histogram_bucket()
+//! @return Upper bound of the bucket in nanoseconds
+static uint64_t histogram_upper_ns(size_t bucket);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+#if defined(_MSC_VER)
+
+static uint64_t metrics_load(const uint64_t * counter)
+{
+    return *(const volatile uint64_t *)counter;
+}
+
+static void metrics_fetch_add(uint64_t * counter, uint64_t value)
+{
+    InterlockedExchangeAdd64((volatile LONG64 *)counter, (LONG64)value);
+}
+
+static void metrics_fetch_max(uint64_t * counter, uint64_t value)
+{
+    LONG64 current = *(volatile LONG64 *)counter;
+    while((uint64_t)current < value)
+    {
+        LONG64 seen = InterlockedCompareExchange64((volatile LONG64 *)counter, (LONG64)value, current);
+        if(seen == current)
+        {
+            break;
+        }
+        current = seen;
+    }
+}
+
+#else
+
+static uint64_t metrics_load(const uint64_t * counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static void metrics_fetch_add(uint64_t * counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static void metrics_fetch_max(uint64_t * counter, uint64_t value)
+{
+    uint64_t current = __atomic_load_n(counter, __ATOMIC_RELAXED);
+    while(current < value && !__atomic_compare_exchange_n(counter, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+#endif
+
+static void histogram_snapshot(const wol_histogram_t * histogram, wol_histogram_t * snapshot)
+{
+    snapshot->count = metrics_load(&histogram->count);
+    snapshot->sum_ns = metrics_load(&histogram->sum_ns);
+    snapshot->max_ns = metrics_load(&histogram->max_ns);
+    for(size_t i = 0; i < WOL_HISTOGRAM_BUCKETS; i++)
+    {
+        snapshot->buckets[i] = metrics_load(&histogram->buckets[i]);
+    }
+}
+
+static void histogram_merge(wol_histogram_t * target, const wol_histogram_t * source)
+{
+    metrics_fetch_add(&target->count, source->count);
+    metrics_fetch_add(&target->sum_ns, source->sum_ns);
+    metrics_fetch_max(&target->max_ns, source->max_ns);
+    for(size_t i = 0; i < WOL_HISTOGRAM_BUCKETS; i++)
+    {
+        if(0 != source->buckets[i])
+        {
+            metrics_fetch_add(&target->buckets[i], source->buckets[i]);
+        }
+    }
+}
+
+static uint64_t histogram_upper_ns(size_t bucket)
+{
+    if(bucket < WOL_HISTOGRAM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    unsigned exponent = (unsigned)(bucket / WOL_HISTOGRAM_SUB_BUCKETS) + 1;
+    uint64_t lower = (uint64_t)(WOL_HISTOGRAM_SUB_BUCKETS + bucket % WOL_HISTOGRAM_SUB_BUCKETS) << (exponent - 2);
+
+    return lower + (UINT64_C(1) << (exponent - 2)) - 1;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+void wol_metrics_snapshot(const wol_metrics_t * metrics, wol_metrics_t * snapshot)
+{
+    snapshot->packets = metrics_load(&metrics->packets);
+    snapshot->bytes = metrics_load(&metrics->bytes);
+    snapshot->again = metrics_load(&metrics->again);
+    for(size_t i = 0; i < WOL_METRICS_ERRORS; i++)
+    {
+        snapshot->errors[i] = metrics_load(&metrics->errors[i]);
+    }
+
+    histogram_snapshot(&metrics->send_ns, &snapshot->send_ns);
+    histogram_snapshot(&metrics->batch_ns, &snapshot->batch_ns);
+    histogram_snapshot(&metrics->confirm_ns, &snapshot->confirm_ns);
+}
+
+void wol_metrics_merge(wol_metrics_t * target, const wol_metrics_t * source)
+{
+    metrics_fetch_add(&target->packets, source->packets);
+    metrics_fetch_add(&target->bytes, source->bytes);
+    metrics_fetch_add(&target->again, source->again);
+    for(size_t i = 0; i < WOL_METRICS_ERRORS; i++)
+    {
+        if(0 != source->errors[i])
+        {
+            metrics_fetch_add(&target->errors[i], source->errors[i]);
+        }
+    }
+
+    histogram_merge(&target->send_ns, &source->send_ns);
+    histogram_merge(&target->batch_ns, &source->batch_ns);
+    histogram_merge(&target->confirm_ns, &source->confirm_ns);
+}
+
+uint64_t wol_histogram_percentile(const wol_histogram_t * histogram, double percent)
+{
+    if(0 == histogram->count)
+    {
+        return 0;
+    }
+
+    // The rank of the percentile, at least the first recorded time
+    double rank = (double)histogram->count * percent / 100.0;
+    uint64_t wanted = (rank < 1.0) ? 1 : (uint64_t)rank;
+    if(wanted > histogram->count)
+    {
+        wanted = histogram->count;
+    }
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < WOL_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if(seen >= wanted)
+        {
+            uint64_t upper = histogram_upper_ns(i);
+            return (upper < histogram->max_ns) ? upper : histogram->max_ns;
+        }
+    }
+
+    return histogram->max_ns;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,178 @@
+//! @file
+//! @brief The wake_on_lan_metrics header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Optional instrumentation of a sender. A ::wol_metrics_t set in wake_on_lan_sender_s::metrics
+//! counts the packets, bytes, would-block events and errors of the sender and keeps log-linear
+//! histograms of the time of each hand-over to the kernel, of each ::wake_on_lan_batch() call and
+//! of the time until a host answered ::wol_wake_and_confirm().
+//!
+//! The counters are only updated if wake_on_lan.c and wake_on_lan_confirm.c are compiled with
+//! `-DWAKE_ON_LAN_METRICS`, otherwise the send paths contain no instrumentation at all.
+//!
+//! A block has one writer, the thread of its sender, and is updated without locks. Any thread can
+//! read it at any time with ::wol_metrics_snapshot(), and the blocks of several threads are added
+//! up with ::wol_metrics_merge(), which any number of threads can call on the same target block.
+
+#ifndef INC_WAKE_ON_LAN_METRICS_H_
+#define INC_WAKE_ON_LAN_METRICS_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+
+  #include <intrin.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Number of buckets of each power of 2 of a histogram, the relative error of a bucket is at most 25 percent
+#define WOL_HISTOGRAM_SUB_BUCKETS 4
+
+//! @brief Number of buckets of a histogram, enough for any 64-bit time in nanoseconds
+#define WOL_HISTOGRAM_BUCKETS ( 63 * WOL_HISTOGRAM_SUB_BUCKETS )
+
+//! @brief Number of error counters, one for each ::wake_on_lan_errors_t, larger values share the last one
+#define WOL_METRICS_ERRORS 32
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Log-linear histogram of times in nanoseconds
+typedef struct wol_histogram_s
+{
+    uint64_t count;                     //!< Number of recorded times
+    uint64_t sum_ns;                    //!< Sum of the recorded times
+    uint64_t max_ns;                    //!< Largest recorded time
+    uint64_t buckets[WOL_HISTOGRAM_BUCKETS]; //!< Number of times of each bucket, see ::wol_histogram_bucket()
+} wol_histogram_t;
+
+//! @brief Instrumentation block of a sender, all zero is an empty block
+typedef struct wol_metrics_s
+{
+    uint64_t packets;                   //!< Packets handed to the kernel successfully
+    uint64_t bytes;                     //!< Payload bytes of wol_metrics_s::packets
+    uint64_t again;                     //!< Times the socket was full, `EAGAIN`/`EWOULDBLOCK`
+    uint64_t errors[WOL_METRICS_ERRORS]; //!< Failed packets by ::wake_on_lan_errors_t
+    wol_histogram_t send_ns;            //!< Time of each hand-over to the kernel, a single packet or one chunk of a batch
+    wol_histogram_t batch_ns;           //!< Time of each ::wake_on_lan_batch() call
+    wol_histogram_t confirm_ns;         //!< Time from the first packet until the host answered, see ::wol_wake_and_confirm()
+} wol_metrics_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Copies a block that may be updated at the same time, every counter is read atomically
+//! @param metrics Pointer to the block
+//! @param[out] snapshot Pointer to the copy
+void wol_metrics_snapshot(const wol_metrics_t * metrics, wol_metrics_t * snapshot);
+
+//! @brief Adds a block to another one
+//! @details The counters of `target` are added atomically, so the workers of one job can merge into one block
+//!          at the same time, the maximum times stay a maximum.
+//! @param[in,out] target Pointer to the block that receives the sum
+//! @param source Pointer to the block to add, must not be updated at the same time
+void wol_metrics_merge(wol_metrics_t * target, const wol_metrics_t * source);
+
+//! @brief Estimates a percentile of a histogram
+//! @param histogram Pointer to the histogram
+//! @param percent Percentile from 0 to 100
+//! @return Upper bound of the bucket of the percentile, at most wol_histogram_s::max_ns, 0 for an empty histogram
+uint64_t wol_histogram_percentile(const wol_histogram_t * histogram, double percent);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+
+//! @brief Adds to a counter of a block, only the writer of the block may call it
+//! @param counter Pointer to the counter
+//! @param value Value to add
+static inline void wol_metrics_add(uint64_t * counter, uint64_t value)
+{
+#if defined(_MSC_VER)
+    // Aligned 64-bit loads and stores are atomic, with only one writer no locked add is needed
+    *(volatile uint64_t *)counter += value;
+#else
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+#endif
+}
+
+//! @brief Bucket of a time, the first ::WOL_HISTOGRAM_SUB_BUCKETS buckets are exact, then each power of 2 has ::WOL_HISTOGRAM_SUB_BUCKETS buckets
+//! @param ns Time in nanoseconds
+//! @return Index of the bucket
+static inline size_t wol_histogram_bucket(uint64_t ns)
+{
+    if(ns < WOL_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (size_t)ns;
+    }
+
+#if defined(_MSC_VER)
+    unsigned long exponent;
+    _BitScanReverse64(&exponent, ns);
+#else
+    unsigned exponent = 63u - (unsigned)__builtin_clzll(ns);
+#endif
+
+    // The two bits below the highest one select the sub-bucket
+    return (size_t)(exponent - 1) * WOL_HISTOGRAM_SUB_BUCKETS + (size_t)((ns >> (exponent - 2)) & (WOL_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+//! @brief Records a time, only the writer of the block may call it
+//! @param histogram Pointer to the histogram
+//! @param ns Time in nanoseconds
+static inline void wol_histogram_record(wol_histogram_t * histogram, uint64_t ns)
+{
+    wol_metrics_add(&histogram->count, 1);
+    wol_metrics_add(&histogram->sum_ns, ns);
+    wol_metrics_add(&histogram->buckets[wol_histogram_bucket(ns)], 1);
+    if(ns > histogram->max_ns)
+    {
+        wol_metrics_add(&histogram->max_ns, ns - histogram->max_ns);
+    }
+}
+
+//! @brief Counts a failed packet, only the writer of the block may call it
+//! @param metrics Pointer to the block
+//! @param error Error of the packet
+static inline void wol_metrics_error(wol_metrics_t * metrics, wake_on_lan_errors_t error)
+{
+    size_t index = ((size_t)error < WOL_METRICS_ERRORS) ? (size_t)error : WOL_METRICS_ERRORS - 1;
+    wol_metrics_add(&metrics->errors[index], 1);
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_METRICS_H_ */
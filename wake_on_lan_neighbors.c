@@ -0,0 +1,307 @@
+//! @file
+//! @brief The wake_on_lan_neighbors source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_neighbors.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+  #include <iphlpapi.h>
+  #include <netioapi.h>
+
+  #ifdef _MSC_VER
+    #pragma comment(lib, "ws2_32.lib")
+    #pragma comment(lib, "iphlpapi.lib")
+  #endif
+
+#else
+
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+
+  #include <errno.h>
+  #include <unistd.h>
+
+#endif
+
+#if defined(__linux__)
+
+  #include <linux/neighbour.h>
+  #include <linux/netlink.h>
+  #include <linux/rtnetlink.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Size of the buffer that receives the parts of the netlink dump
+#define NEIGHBORS_RECEIVE_SIZE 32768
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Appends a neighbor to a growing array, MACs that cannot be woken are skipped
+//! @param[in,out] neighbors Pointer to the array, reallocated as needed
+//! @param[in,out] count Pointer to the number of entries
+//! @param[in,out] capacity Pointer to the number of allocated entries
+//! @param ip_v4 Address as number
+//! @param mac MAC of the neighbor
+//! @param index Interface index
+//! @return False if the memory could not be allocated
+static bool neighbors_add(wol_neighbor_t ** neighbors, size_t * count, size_t * capacity, uint32_t ip_v4, const uint8_t mac[6], uint32_t index);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static bool neighbors_add(wol_neighbor_t ** neighbors, size_t * count, size_t * capacity, uint32_t ip_v4, const uint8_t mac[6], uint32_t index)
+{
+    static const uint8_t zero[6] = { 0 };
+
+    // The group bit is set for broadcast and multicast, no network card has one of these
+    if(0 == ip_v4 || 0 != (mac[0] & 0x01) || 0 == memcmp(mac, zero, sizeof(zero)))
+    {
+        return true;
+    }
+
+    if(*count == *capacity)
+    {
+        size_t grown = *capacity ? *capacity * 2 : 64;
+        wol_neighbor_t * resized = realloc(*neighbors, grown * sizeof(*resized));
+        if(NULL == resized)
+        {
+            return false;
+        }
+        *neighbors = resized;
+        *capacity = grown;
+    }
+
+    wol_neighbor_t * neighbor = &(*neighbors)[(*count)++];
+    neighbor->ip_v4 = ip_v4;
+    memcpy(neighbor->mac, mac, sizeof(neighbor->mac));
+    neighbor->index = index;
+
+    return true;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_neighbors_read(wol_neighbor_t ** neighbors, size_t * count, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+
+    if(NULL == neighbors || NULL == count)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+        return return_value;
+    }
+
+    *neighbors = NULL;
+    *count = 0;
+    size_t capacity = 0;
+    bool memory = true;
+
+#ifdef _WIN32
+    MIB_IPNET_TABLE2 * table = NULL;
+    DWORD result = GetIpNetTable2(AF_INET, &table);
+    if(NO_ERROR != result)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = (int)result; }
+        return return_value;
+    }
+
+    for(ULONG i = 0; i < table->NumEntries && memory; i++)
+    {
+        const MIB_IPNET_ROW2 * row = &table->Table[i];
+        if(6 != row->PhysicalAddressLength
+            || NlnsUnreachable == row->State
+            || NlnsIncomplete == row->State)
+        {
+            continue;
+        }
+        memory = neighbors_add(neighbors, count, &capacity, ntohl(row->Address.Ipv4.sin_addr.s_addr), row->PhysicalAddress, (uint32_t)row->InterfaceIndex);
+    }
+
+    FreeMibTable(table);
+    return_value = WAKE_ON_LAN_ERRORS_NONE;
+#elif defined(__linux__)
+    int sockfd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if(0 > sockfd)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = errno; }
+        return return_value;
+    }
+
+    uint8_t * buffer = NULL;
+
+    do{
+        struct
+        {
+            struct nlmsghdr header;
+            struct ndmsg message;
+        } request;
+        memset(&request, 0, sizeof(request));
+        request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.message));
+        request.header.nlmsg_type = RTM_GETNEIGH;
+        request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        request.header.nlmsg_seq = 1;
+        request.message.ndm_family = AF_INET;
+
+        struct sockaddr_nl kernel;
+        memset(&kernel, 0, sizeof(kernel));
+        kernel.nl_family = AF_NETLINK;
+
+        if(0 > sendto(sockfd, &request, request.header.nlmsg_len, 0, (const struct sockaddr *)&kernel, sizeof(kernel)))
+        {
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        buffer = malloc(NEIGHBORS_RECEIVE_SIZE);
+        if(NULL == buffer)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+        // The dump arrives in several datagrams and ends with NLMSG_DONE, an error of the kernel ends it early
+        bool done = false;
+        bool failed = false;
+        while(!done && memory)
+        {
+            ssize_t received = recv(sockfd, buffer, NEIGHBORS_RECEIVE_SIZE, 0);
+            if(0 > received && EINTR == errno)
+            {
+                continue;
+            }
+            if(0 >= received)
+            {
+                if(wol) { wol->last_error = (0 > received) ? errno : -1; }
+                break;
+            }
+
+            size_t length = (size_t)received;
+            for(const struct nlmsghdr * header = (const struct nlmsghdr *)buffer; NLMSG_OK(header, length); header = NLMSG_NEXT(header, length))
+            {
+                if(NLMSG_DONE == header->nlmsg_type)
+                {
+                    done = true;
+                    break;
+                }
+                if(NLMSG_ERROR == header->nlmsg_type)
+                {
+                    // Only an acknowledgement with error 0 ends the dump, otherwise the table is partial
+                    const struct nlmsgerr * error = (const struct nlmsgerr *)NLMSG_DATA(header);
+                    if(0 != error->error)
+                    {
+                        if(wol) { wol->last_error = -error->error; }
+                        failed = true;
+                    }
+                    done = true;
+                    break;
+                }
+                if(RTM_NEWNEIGH != header->nlmsg_type)
+                {
+                    continue;
+                }
+
+                const struct ndmsg * message = (const struct ndmsg *)NLMSG_DATA(header);
+                if(AF_INET != message->ndm_family
+                    || 0 == (message->ndm_state & (NUD_REACHABLE | NUD_STALE | NUD_DELAY | NUD_PROBE | NUD_PERMANENT | NUD_NOARP)))
+                {
+                    continue;
+                }
+
+                uint32_t ip_v4 = 0;
+                const uint8_t * mac = NULL;
+                int attributes = (int)(header->nlmsg_len - NLMSG_LENGTH(sizeof(*message)));
+                for(const struct rtattr * attribute = (const struct rtattr *)((const uint8_t *)message + NLMSG_ALIGN(sizeof(*message))); RTA_OK(attribute, attributes); attribute = RTA_NEXT(attribute, attributes))
+                {
+                    if(NDA_DST == attribute->rta_type && sizeof(ip_v4) == RTA_PAYLOAD(attribute))
+                    {
+                        memcpy(&ip_v4, RTA_DATA(attribute), sizeof(ip_v4));
+                        ip_v4 = ntohl(ip_v4);
+                    }
+                    else if(NDA_LLADDR == attribute->rta_type && 6 == RTA_PAYLOAD(attribute))
+                    {
+                        mac = (const uint8_t *)RTA_DATA(attribute);
+                    }
+                }
+
+                if(mac)
+                {
+                    memory = neighbors_add(neighbors, count, &capacity, ip_v4, mac, (uint32_t)message->ndm_ifindex);
+                }
+            }
+        }
+
+        if(failed)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+        }
+        else if(done)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_NONE;
+        }
+
+    }while(0);
+
+    free(buffer);
+    close(sockfd);
+#else
+    if(wol) { wol->last_error = ENOSYS; }
+#endif
+
+    if(!memory)
+    {
+        return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+        if(wol) { wol->last_error = -1; }
+    }
+
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        free(*neighbors);
+        *neighbors = NULL;
+        *count = 0;
+    }
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
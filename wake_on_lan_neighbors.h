@@ -0,0 +1,78 @@
+//! @file
+//! @brief The wake_on_lan_neighbors header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Reads the IPv4 neighbor table of the system, the ARP cache, so that an inventory can be
+//! harvested from the hosts that were seen on the local subnets instead of being typed in.
+//! On Linux the table is dumped with one netlink `RTM_GETNEIGH` request, on Windows it is
+//! read with `GetIpNetTable2()`. Together with ::wol_inventory_merge() a periodic harvest
+//! only writes the records that changed.
+//!
+//! Only entries with a confirmed or static MAC are returned, incomplete and failed entries
+//! as well as broadcast and multicast MACs are skipped.
+//!
+//! @note Under Windows, the file must be linked with `-liphlpapi`.
+
+#ifndef INC_WAKE_ON_LAN_NEIGHBORS_H_
+#define INC_WAKE_ON_LAN_NEIGHBORS_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief One entry of the neighbor table
+typedef struct wol_neighbor_s
+{
+    uint32_t ip_v4;                     //!< IPv4 address of the host as number, not in network order
+    uint8_t mac[6];                     //!< MAC address, most significant byte first
+    uint32_t index;                     //!< Index of the interface the host was seen on
+} wol_neighbor_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Reads the IPv4 neighbor table
+//! @param[out] neighbors Receives the allocated array of the entries, must be released with `free()`, NULL if there is none
+//! @param[out] count Receives the number of entries
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY, ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION if the table could not be read
+//!         or ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION if the kernel ended the dump with an error, e.g. `EPERM` or `EBUSY`
+wake_on_lan_errors_t wol_neighbors_read(wol_neighbor_t ** neighbors, size_t * count, wake_on_lan_t * wol);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_NEIGHBORS_H_ */
@@ -0,0 +1,755 @@
+//! @file
+//! @brief The wake_on_lan_pipeline source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_pipeline.h"
+#include "wake_on_lan_interfaces.h"
+#include "wake_on_lan_inventory.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WAKE_ON_LAN_METRICS)
+  #include "wake_on_lan_metrics.h"
+#endif
+
+#ifdef _WIN32
+
+  #include <windows.h>
+
+#else
+
+  #include <pthread.h>
+  #include <unistd.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+// @brief Positions of the rings, acquire loads and release stores between one parser and one sender.
+// @details The chunks are handed out by a lock-free counter like the groups of ::wol_engine_send().
+#if defined(_MSC_VER)
+  #define PIPELINE_LOAD(POSITION) ( (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)(POSITION), 0, 0) )
+  #define PIPELINE_STORE(POSITION, VALUE) InterlockedExchange64((volatile LONG64 *)(POSITION), (LONG64)(VALUE))
+  #define PIPELINE_FETCH_INCREMENT(COUNTER) ( (size_t)InterlockedIncrement(COUNTER) - 1 )
+  #define PIPELINE_PAUSE() YieldProcessor()
+#else
+  #define PIPELINE_LOAD(POSITION) __atomic_load_n(POSITION, __ATOMIC_ACQUIRE)
+  #define PIPELINE_STORE(POSITION, VALUE) __atomic_store_n(POSITION, VALUE, __ATOMIC_RELEASE)
+  #define PIPELINE_FETCH_INCREMENT(COUNTER) ( (size_t)__atomic_fetch_add(COUNTER, 1, __ATOMIC_RELAXED) )
+  #if defined(__i386__) || defined(__x86_64__)
+    #define PIPELINE_PAUSE() __builtin_ia32_pause()
+  #else
+    #define PIPELINE_PAUSE() do{ }while(0)
+  #endif
+#endif
+
+//! @brief Size of a cache line, the positions of a ring written by different threads are kept apart by it
+#define PIPELINE_CACHE_LINE 64
+
+//! @brief Targets a parser collects before it routes them into its rings
+#define PIPELINE_PARSE_BLOCK 256
+
+//! @brief Largest number of targets a sender takes from a ring with one batch
+#define PIPELINE_SEND_BLOCK 256
+
+//! @brief Polls of an empty or full ring before the thread starts to sleep
+#define PIPELINE_SPINS 64
+
+//! @brief Sleep of a thread that waits for a ring after ::PIPELINE_SPINS polls
+#define PIPELINE_IDLE_NS 20000
+
+//! @brief Largest ring, keeps the slots of all rings addressable
+#define PIPELINE_RING_SIZE_MAX ( (size_t)1 << 20 )
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+#ifdef _WIN32
+typedef HANDLE pipeline_thread_t;
+#else
+typedef pthread_t pipeline_thread_t;
+#endif
+
+//! @brief Ring of targets from one parser to the sender of one interface
+//! @details The parser fills slots up to pipeline_ring_s::pending and publishes them with pipeline_ring_s::head,
+//!          the sender sends them in place and returns them with pipeline_ring_s::tail. The positions only grow,
+//!          the slot of a position is `position & mask`.
+typedef struct pipeline_ring_s
+{
+    wol_target_t * slots;               //!< Slots of the ring, written before the threads start
+    uint64_t mask;                      //!< Number of slots minus one
+    char padding_slots[PIPELINE_CACHE_LINE - sizeof(wol_target_t *) - sizeof(uint64_t)];
+
+    uint64_t head;                      //!< Position after the last published target, written by the parser
+    uint64_t done;                      //!< 1 after the parser published its last target
+    char padding_head[PIPELINE_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+    uint64_t pending;                   //!< Position after the last written target, parser only
+    uint64_t tail_cache;                //!< Last pipeline_ring_s::tail the parser read, parser only
+    char padding_pending[PIPELINE_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+    uint64_t tail;                      //!< Position after the last sent target, written by the sender
+    char padding_tail[PIPELINE_CACHE_LINE - sizeof(uint64_t)];
+} pipeline_ring_t;
+
+//! @brief Shared state of all threads of one ::wol_pipeline_run() call
+typedef struct pipeline_s
+{
+    const char * buffer;                //!< Inventory passed to ::wol_pipeline_run()
+    size_t length;                      //!< Length of the inventory
+    const wol_pipeline_options_t * options; //!< Options passed to ::wol_pipeline_run()
+    wol_engine_binding_t * bindings;    //!< Copy of the bindings sorted by destination IP, binding `i` is sent by ring `i`
+    size_t binding_count;               //!< Number of bindings
+    size_t ring_count;                  //!< Rings of each parser, one per binding and the last one for all other targets
+    size_t parser_count;                //!< Number of parsers
+    pipeline_ring_t * rings;            //!< Ring `r` of parser `p` at `p * ring_count + r`
+    size_t chunk_count;                 //!< Number of chunks of ::WOL_PIPELINE_CHUNK_SIZE bytes
+#if defined(_MSC_VER)
+    volatile LONG next_chunk;           //!< Index of the next chunk that is not taken by a parser
+#else
+    size_t next_chunk;                  //!< Index of the next chunk that is not taken by a parser
+#endif
+    uint64_t start_ns;                  //!< ::wol_clock_ns() time of the start
+} pipeline_t;
+
+//! @brief A parser or sender thread with its own totals, merged after all threads ended
+typedef struct pipeline_worker_s
+{
+    pipeline_t * pipeline;              //!< Shared state
+    bool sender;                        //!< The worker sends the rings of one interface, otherwise it parses chunks
+    size_t index;                       //!< Index of the parser or of the ring of the sender
+    bool started;                       //!< A thread was started for the parser
+    size_t targets;                     //!< Parsed targets, parser only
+    size_t parse_errors;                //!< Failed lines, parser only
+    size_t sent;                        //!< Targets handed to the kernel, sender only
+    size_t failed;                      //!< Targets with an error, sender only
+    uint64_t first_send_ns;             //!< Time from the start until the first sent batch, 0 before, sender only
+    wake_on_lan_errors_t return_value;  //!< Error of the last failed target, sender only
+} pipeline_worker_t;
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Orders bindings by destination IP, for `qsort()`
+//! @param a Pointer to the first ::wol_engine_binding_t
+//! @param b Pointer to the second ::wol_engine_binding_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_binding(const void * a, const void * b);
+
+//! @brief Runs a worker as parser or sender
+//! @param worker Pointer to the worker
+static void pipeline_work(pipeline_worker_t * worker);
+
+//! @brief Takes chunks until none is left, parses them and routes the targets into the rings of the parser
+//! @param worker Pointer to the parser
+static void pipeline_parse(pipeline_worker_t * worker);
+
+//! @brief Sends the targets of one interface from the rings of all parsers until every parser is done
+//! @param worker Pointer to the sender
+static void pipeline_send(pipeline_worker_t * worker);
+
+//! @brief Offset of the first line of a chunk, the line that crosses the start of the chunk belongs to the chunk before
+//! @param pipeline Pointer to the shared state
+//! @param chunk Index of the chunk, pipeline_s::chunk_count gives the end of the inventory
+//! @return Offset in the inventory
+static size_t pipeline_chunk_start(const pipeline_t * pipeline, size_t chunk);
+
+//! @brief Searches the ring of a destination IP
+//! @param pipeline Pointer to the shared state
+//! @param ip_v4 Destination IP
+//! @return Index of the binding of the IP or the last ring if the IP has none
+static size_t pipeline_ring_index(const pipeline_t * pipeline, uint32_t ip_v4);
+
+//! @brief Writes a target into a ring of the calling parser, waits for the sender while the ring is full
+//! @param ring Pointer to the ring
+//! @param target Pointer to the target
+static void pipeline_push(pipeline_ring_t * ring, const wol_target_t * target);
+
+//! @brief Hands the written targets of a ring to the sender
+//! @param ring Pointer to a ring of the calling parser
+static void pipeline_publish(pipeline_ring_t * ring);
+
+//! @brief Waits a little for the other side of a ring, polls at first and sleeps after ::PIPELINE_SPINS polls
+//! @param[in,out] spins Polls so far, reset by the caller after progress
+static void pipeline_wait(unsigned * spins);
+
+//! @brief Number of processors for the default number of parsers
+//! @return Online processors, at least 1
+static size_t pipeline_processors(void);
+
+//! @brief Starts a thread running pipeline_work()
+//! @param[out] thread Handle of the new thread
+//! @param worker Pointer to the worker
+//! @return True if the thread was started
+static bool pipeline_thread_start(pipeline_thread_t * thread, pipeline_worker_t * worker);
+
+//! @brief Waits for the end of a thread and releases it
+//! @param thread Handle of the thread
+static void pipeline_thread_join(pipeline_thread_t thread);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static int compare_binding(const void * a, const void * b)
+{
+    const wol_engine_binding_t * binding_a = a;
+    const wol_engine_binding_t * binding_b = b;
+
+    return (binding_a->ip_v4 < binding_b->ip_v4) ? -1 : (binding_a->ip_v4 > binding_b->ip_v4);
+}
+
+static void pipeline_work(pipeline_worker_t * worker)
+{
+    if(worker->sender)
+    {
+        pipeline_send(worker);
+    }
+    else
+    {
+        pipeline_parse(worker);
+    }
+}
+
+static void pipeline_parse(pipeline_worker_t * worker)
+{
+    pipeline_t * pipeline = worker->pipeline;
+    pipeline_ring_t * rings = pipeline->rings + worker->index * pipeline->ring_count;
+    const wol_pipeline_options_t * options = pipeline->options;
+
+    wol_target_t targets[PIPELINE_PARSE_BLOCK];
+
+    for(size_t chunk = PIPELINE_FETCH_INCREMENT(&pipeline->next_chunk); chunk < pipeline->chunk_count; chunk = PIPELINE_FETCH_INCREMENT(&pipeline->next_chunk))
+    {
+        size_t offset = pipeline_chunk_start(pipeline, chunk);
+        size_t end = pipeline_chunk_start(pipeline, chunk + 1);
+
+        wol_parse_t parse = { 0 };
+        parse.targets = targets;
+        parse.targets_capacity = PIPELINE_PARSE_BLOCK;
+        parse.default_ip_v4 = options->default_ip_v4;
+        parse.default_port = options->default_port;
+
+        while(offset < end)
+        {
+            parse.targets_count = 0;
+            offset += wol_parse_targets(&parse, pipeline->buffer + offset, end - offset);
+
+            if(options->interfaces)
+            {
+                wol_interfaces_resolve(options->interfaces, targets, parse.targets_count);
+            }
+
+            for(size_t i = 0; i < parse.targets_count; i++)
+            {
+                pipeline_push(&rings[pipeline_ring_index(pipeline, targets[i].ip_v4)], &targets[i]);
+            }
+
+            // One release per block and ring, the sender starts on the first block of the inventory
+            for(size_t r = 0; r < pipeline->ring_count; r++)
+            {
+                pipeline_publish(&rings[r]);
+            }
+            worker->targets += parse.targets_count;
+        }
+
+        worker->parse_errors += parse.errors_count;
+    }
+
+    for(size_t r = 0; r < pipeline->ring_count; r++)
+    {
+        PIPELINE_STORE(&rings[r].done, 1);
+    }
+}
+
+static void pipeline_send(pipeline_worker_t * worker)
+{
+    pipeline_t * pipeline = worker->pipeline;
+    const wol_pipeline_options_t * options = pipeline->options;
+    const wol_engine_binding_t * binding = (worker->index < pipeline->binding_count) ? &pipeline->bindings[worker->index] : NULL;
+
+    wake_on_lan_t wol = { 0 };
+    wake_on_lan_sender_t sender;
+    bool sender_open = false;
+    wake_on_lan_errors_t setup_error;
+
+#if defined(WAKE_ON_LAN_METRICS)
+    // Every sender counts into its own block without contention and merges it once at the end
+    wol_metrics_t * metrics = options->metrics ? calloc(1, sizeof(*metrics)) : NULL;
+#endif
+
+    do{
+
+        setup_error = wake_on_lan_sender_open(&sender, &wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != setup_error)
+        {
+            break;
+        }
+        sender_open = true;
+
+#if defined(WAKE_ON_LAN_METRICS)
+        sender.metrics = metrics;
+#endif
+
+        if(binding)
+        {
+            setup_error = wake_on_lan_sender_bind(&sender, binding->source_ip_v4, binding->device, &wol);
+            if(WAKE_ON_LAN_ERRORS_NONE != setup_error)
+            {
+                break;
+            }
+        }
+
+        if(0 != options->packets_per_second)
+        {
+            // The pacing also works in user space if the socket option is not available
+            wake_on_lan_sender_set_rate(&sender, options->packets_per_second, options->burst, NULL);
+        }
+
+        if(options->sender_options)
+        {
+            // A refused tuning keeps the defaults of the system, the sender still sends
+            wake_on_lan_sender_set_options(&sender, options->sender_options, NULL);
+        }
+
+    }while(0);
+
+    wol_result_t results[PIPELINE_SEND_BLOCK];
+    unsigned spins = 0;
+
+    for(;;)
+    {
+        bool progress = false;
+        bool finished = true;
+
+        for(size_t p = 0; p < pipeline->parser_count; p++)
+        {
+            pipeline_ring_t * ring = &pipeline->rings[p * pipeline->ring_count + worker->index];
+
+            // The flag is read before the position, a done parser has published everything before the flag
+            bool done = (0 != PIPELINE_LOAD(&ring->done));
+            uint64_t head = PIPELINE_LOAD(&ring->head);
+            uint64_t tail = ring->tail;
+            if(head == tail)
+            {
+                finished = finished && done;
+                continue;
+            }
+            progress = true;
+
+            // The batch takes the slots in place, up to the end of the ring
+            size_t slot = (size_t)(tail & ring->mask);
+            size_t count = (size_t)(head - tail);
+            if((size_t)ring->mask + 1 - slot < count)
+            {
+                count = (size_t)ring->mask + 1 - slot;
+            }
+            if(PIPELINE_SEND_BLOCK < count)
+            {
+                count = PIPELINE_SEND_BLOCK;
+            }
+            const wol_target_t * targets = &ring->slots[slot];
+
+            if(WAKE_ON_LAN_ERRORS_NONE == setup_error)
+            {
+                wake_on_lan_batch(&sender, targets, count, results);
+                if(0 == worker->first_send_ns)
+                {
+                    worker->first_send_ns = wol_clock_ns() - pipeline->start_ns;
+                }
+            }
+            else
+            {
+                // The interface could not be set up, every target of it gets the error of the setup
+                for(size_t i = 0; i < count; i++)
+                {
+                    results[i].return_value = setup_error;
+                    results[i].last_error = wol.last_error;
+                }
+            }
+
+            for(size_t i = 0; i < count; i++)
+            {
+                if(WAKE_ON_LAN_ERRORS_NONE == results[i].return_value)
+                {
+                    worker->sent++;
+                }
+                else
+                {
+                    worker->failed++;
+                    worker->return_value = results[i].return_value;
+                }
+
+                if(options->callback)
+                {
+                    options->callback(options->context, &targets[i], &results[i]);
+                }
+            }
+
+            PIPELINE_STORE(&ring->tail, tail + count);
+        }
+
+        if(progress)
+        {
+            spins = 0;
+        }
+        else if(finished)
+        {
+            break;
+        }
+        else
+        {
+            pipeline_wait(&spins);
+        }
+    }
+
+    if(sender_open)
+    {
+        wake_on_lan_sender_close(&sender, NULL);
+    }
+
+#if defined(WAKE_ON_LAN_METRICS)
+    if(metrics)
+    {
+        wol_metrics_merge(options->metrics, metrics);
+        free(metrics);
+    }
+#endif
+}
+
+static size_t pipeline_chunk_start(const pipeline_t * pipeline, size_t chunk)
+{
+    if(0 == chunk)
+    {
+        return 0;
+    }
+
+    size_t offset = chunk * WOL_PIPELINE_CHUNK_SIZE;
+    if(pipeline->length <= offset)
+    {
+        return pipeline->length;
+    }
+
+    // The chunk starts after the first line end at or after the last byte of the chunk before
+    const char * line_end = memchr(pipeline->buffer + offset - 1, '\n', pipeline->length - offset + 1);
+
+    return line_end ? (size_t)(line_end - pipeline->buffer) + 1 : pipeline->length;
+}
+
+static size_t pipeline_ring_index(const pipeline_t * pipeline, uint32_t ip_v4)
+{
+    size_t low = 0;
+    size_t high = pipeline->binding_count;
+
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if(pipeline->bindings[middle].ip_v4 < ip_v4)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if(low < pipeline->binding_count && ip_v4 == pipeline->bindings[low].ip_v4)
+    {
+        return low;
+    }
+
+    return pipeline->binding_count;
+}
+
+static void pipeline_push(pipeline_ring_t * ring, const wol_target_t * target)
+{
+    if(ring->pending - ring->tail_cache > ring->mask)
+    {
+        unsigned spins = 0;
+        ring->tail_cache = PIPELINE_LOAD(&ring->tail);
+
+        while(ring->pending - ring->tail_cache > ring->mask)
+        {
+            // The sender can only free slots it was handed
+            pipeline_publish(ring);
+            pipeline_wait(&spins);
+            ring->tail_cache = PIPELINE_LOAD(&ring->tail);
+        }
+    }
+
+    ring->slots[ring->pending & ring->mask] = *target;
+    ring->pending++;
+}
+
+static void pipeline_publish(pipeline_ring_t * ring)
+{
+    // Only the parser writes the head, so it can read it without synchronization
+    if(ring->head != ring->pending)
+    {
+        PIPELINE_STORE(&ring->head, ring->pending);
+    }
+}
+
+static void pipeline_wait(unsigned * spins)
+{
+    if(*spins < PIPELINE_SPINS)
+    {
+        (*spins)++;
+        PIPELINE_PAUSE();
+        return;
+    }
+
+    wol_sleep_until_ns(wol_clock_ns() + PIPELINE_IDLE_NS);
+}
+
+#ifdef _WIN32
+
+static size_t pipeline_processors(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return (0 < info.dwNumberOfProcessors) ? (size_t)info.dwNumberOfProcessors : 1;
+}
+
+//! @brief Thread function of a worker under Windows
+//! @param argument Pointer to the worker
+//! @return Always 0
+static DWORD WINAPI pipeline_thread(LPVOID argument)
+{
+    pipeline_work((pipeline_worker_t *)argument);
+    return 0;
+}
+
+static bool pipeline_thread_start(pipeline_thread_t * thread, pipeline_worker_t * worker)
+{
+    *thread = CreateThread(NULL, 0, pipeline_thread, worker, 0, NULL);
+    return NULL != *thread;
+}
+
+static void pipeline_thread_join(pipeline_thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+#else
+
+static size_t pipeline_processors(void)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (0 < processors) ? (size_t)processors : 1;
+}
+
+//! @brief Thread function of a worker under POSIX
+//! @param argument Pointer to the worker
+//! @return Always NULL
+static void * pipeline_thread(void * argument)
+{
+    pipeline_work((pipeline_worker_t *)argument);
+    return NULL;
+}
+
+static bool pipeline_thread_start(pipeline_thread_t * thread, pipeline_worker_t * worker)
+{
+    return 0 == pthread_create(thread, NULL, pipeline_thread, worker);
+}
+
+static void pipeline_thread_join(pipeline_thread_t thread)
+{
+    pthread_join(thread, NULL);
+}
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_pipeline_run(const char * buffer, size_t length, const wol_pipeline_options_t * options, wol_pipeline_stats_t * stats)
+{
+    static const wol_pipeline_options_t default_options = { 0 };
+
+    if(stats)
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+
+    if((NULL == buffer && 0 != length) || (options && NULL == options->bindings && 0 != options->binding_count))
+    {
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    if(0 == length)
+    {
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    pipeline_t pipeline;
+    pipeline.buffer = buffer;
+    pipeline.length = length;
+    pipeline.options = options ? options : &default_options;
+    pipeline.binding_count = pipeline.options->binding_count;
+    pipeline.ring_count = pipeline.binding_count + 1;
+    pipeline.chunk_count = (length - 1) / WOL_PIPELINE_CHUNK_SIZE + 1;
+    pipeline.next_chunk = 0;
+    pipeline.start_ns = wol_clock_ns();
+
+    pipeline.parser_count = pipeline.options->parser_threads ? pipeline.options->parser_threads : pipeline_processors();
+    if(pipeline.chunk_count < pipeline.parser_count)
+    {
+        pipeline.parser_count = pipeline.chunk_count;
+    }
+
+    size_t ring_size = 1;
+    size_t requested = pipeline.options->ring_size ? pipeline.options->ring_size : WOL_PIPELINE_RING_SIZE;
+    while(ring_size < requested && ring_size < PIPELINE_RING_SIZE_MAX)
+    {
+        ring_size <<= 1;
+    }
+
+    size_t ring_total = pipeline.parser_count * pipeline.ring_count;
+    size_t worker_count = pipeline.parser_count + pipeline.ring_count;
+
+    pipeline.bindings = malloc(pipeline.ring_count * sizeof(*pipeline.bindings));
+    pipeline.rings = calloc(ring_total, sizeof(*pipeline.rings));
+    wol_target_t * slots = (SIZE_MAX / sizeof(*slots) / ring_size < ring_total) ? NULL : malloc(ring_total * ring_size * sizeof(*slots));
+    pipeline_worker_t * workers = calloc(worker_count, sizeof(*workers));
+    pipeline_thread_t * threads = malloc(worker_count * sizeof(*threads));
+
+    if(NULL == pipeline.bindings || NULL == pipeline.rings || NULL == slots || NULL == workers || NULL == threads)
+    {
+        free(threads);
+        free(workers);
+        free(slots);
+        free(pipeline.rings);
+        free(pipeline.bindings);
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    if(0 != pipeline.binding_count)
+    {
+        memcpy(pipeline.bindings, pipeline.options->bindings, pipeline.binding_count * sizeof(*pipeline.bindings));
+        qsort(pipeline.bindings, pipeline.binding_count, sizeof(*pipeline.bindings), compare_binding);
+    }
+
+    for(size_t i = 0; i < ring_total; i++)
+    {
+        pipeline.rings[i].slots = slots + i * ring_size;
+        pipeline.rings[i].mask = ring_size - 1;
+    }
+
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        workers[i].pipeline = &pipeline;
+        workers[i].sender = (pipeline.parser_count <= i);
+        workers[i].index = workers[i].sender ? i - pipeline.parser_count : i;
+        workers[i].return_value = WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    // The senders start first, they wait on empty rings until the parsers fill them
+    size_t senders_started = 0;
+    while(senders_started < pipeline.ring_count && pipeline_thread_start(&threads[pipeline.parser_count + senders_started], &workers[pipeline.parser_count + senders_started]))
+    {
+        senders_started++;
+    }
+
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    if(senders_started < pipeline.ring_count)
+    {
+        // Without a sender for every interface nothing is sent, the started ones end on empty rings
+        for(size_t i = 0; i < ring_total; i++)
+        {
+            PIPELINE_STORE(&pipeline.rings[i].done, 1);
+        }
+        return_value = WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+    else
+    {
+        // The calling thread is parser 0, the chunks of a parser that can not be started are taken by the others
+        for(size_t p = 1; p < pipeline.parser_count; p++)
+        {
+            workers[p].started = pipeline_thread_start(&threads[p], &workers[p]);
+            for(size_t r = 0; !workers[p].started && r < pipeline.ring_count; r++)
+            {
+                PIPELINE_STORE(&pipeline.rings[p * pipeline.ring_count + r].done, 1);
+            }
+        }
+
+        pipeline_work(&workers[0]);
+
+        for(size_t p = 1; p < pipeline.parser_count; p++)
+        {
+            if(workers[p].started)
+            {
+                pipeline_thread_join(threads[p]);
+            }
+        }
+    }
+
+    for(size_t i = 0; i < senders_started; i++)
+    {
+        pipeline_thread_join(threads[pipeline.parser_count + i]);
+    }
+
+    wol_pipeline_stats_t totals = { 0 };
+    for(size_t i = 0; i < worker_count; i++)
+    {
+        totals.targets += workers[i].targets;
+        totals.parse_errors += workers[i].parse_errors;
+        totals.sent += workers[i].sent;
+        totals.failed += workers[i].failed;
+        if(0 != workers[i].first_send_ns && (0 == totals.first_send_ns || workers[i].first_send_ns < totals.first_send_ns))
+        {
+            totals.first_send_ns = workers[i].first_send_ns;
+        }
+        if(WAKE_ON_LAN_ERRORS_NONE != workers[i].return_value && WAKE_ON_LAN_ERRORS_NONE == return_value)
+        {
+            return_value = workers[i].return_value;
+        }
+    }
+    totals.duration_ns = wol_clock_ns() - pipeline.start_ns;
+
+    if(stats)
+    {
+        *stats = totals;
+    }
+
+    free(threads);
+    free(workers);
+    free(slots);
+    free(pipeline.rings);
+    free(pipeline.bindings);
+
+    return return_value;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
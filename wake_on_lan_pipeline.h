@@ -0,0 +1,125 @@
+//! @file
+//! @brief The wake_on_lan_pipeline header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Parses and sends a text inventory at the same time, so the first hosts are woken while the
+//! rest of a large inventory is still being parsed. The inventory is split on line boundaries
+//! into chunks that parser threads take in turn. Each parser writes its targets into one
+//! lock-free single-producer single-consumer ring per outbound interface, and one sender thread
+//! per interface drains the rings of all parsers with ::wake_on_lan_batch() straight from the
+//! ring memory, i.e. with `sendmmsg()` or io_uring.
+//!
+//! The interface of a target is chosen by its destination IP, see wol_pipeline_options_s::bindings;
+//! targets without a binding go to a sender that is not bound to any interface.
+//!
+//! @note Under Linux, the file must be linked with the `-pthread` switch.
+
+#ifndef INC_WAKE_ON_LAN_PIPELINE_H_
+#define INC_WAKE_ON_LAN_PIPELINE_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+#include "wake_on_lan_engine.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Default of wol_pipeline_options_s::ring_size, targets per ring
+#define WOL_PIPELINE_RING_SIZE 4096
+
+//! @brief Bytes of the inventory a parser takes at once, lines are never split between chunks
+#define WOL_PIPELINE_CHUNK_SIZE ( 256 * 1024 )
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Called by the sender threads with the result of each target
+//! @details The senders call it concurrently, one call per target, so it must be thread-safe.
+//! @param context Value of wol_pipeline_options_s::context
+//! @param target Target that was sent, only valid during the call
+//! @param result Result of the target
+typedef void (* wol_pipeline_callback_t)(void * context, const wol_target_t * target, const wol_result_t * result);
+
+//! @brief Options of ::wol_pipeline_run(), all zero is a valid default
+typedef struct wol_pipeline_options_s
+{
+    size_t parser_threads;                      //!< Number of parser threads including the calling thread, 0 for one per processor
+    size_t ring_size;                           //!< Targets per ring, rounded up to a power of two, 0 for ::WOL_PIPELINE_RING_SIZE
+    uint32_t default_ip_v4;                     //!< IP used for lines without IP, as number, not in network order, see wol_parse_s::default_ip_v4
+    uint16_t default_port;                      //!< Port used for lines without port
+    const wol_engine_binding_t * bindings;      //!< Outbound interfaces by destination IP, one sender thread each, e.g. from ::wol_interfaces_bindings(), can be NULL
+    size_t binding_count;                       //!< Number of elements in wol_pipeline_options_s::bindings
+    const struct wol_interfaces_s * interfaces; //!< Replaces the IP of each parsed target like ::wol_interfaces_resolve() before it is queued, can be NULL
+    uint32_t packets_per_second;                //!< Rate of each sender, 0 sends without pacing, see ::wake_on_lan_sender_set_rate()
+    uint32_t burst;                             //!< Burst of each sender
+    const wol_sender_options_t * sender_options; //!< Socket tuning of each sender, see ::wake_on_lan_sender_set_options(), can be NULL
+    wol_pipeline_callback_t callback;           //!< Receives the result of each target, can be NULL
+    void * context;                             //!< Passed to wol_pipeline_options_s::callback
+    struct wol_metrics_s * metrics;             //!< Optional block that receives the sum of the blocks of all senders, only filled if built with `WAKE_ON_LAN_METRICS`, can be NULL
+} wol_pipeline_options_t;
+
+//! @brief Totals of ::wol_pipeline_run()
+typedef struct wol_pipeline_stats_s
+{
+    size_t targets;                     //!< Parsed targets
+    size_t parse_errors;                //!< Lines that could not be parsed, see ::wol_parse_targets()
+    size_t sent;                        //!< Targets handed to the kernel
+    size_t failed;                      //!< Targets with an error
+    uint64_t first_send_ns;             //!< Time from the start until the first packet was handed to the kernel, 0 if none was
+    uint64_t duration_ns;               //!< Time from the start until the last sender finished
+} wol_pipeline_stats_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Parses an inventory buffer and sends a magic packet to each of its hosts in a pipeline
+//! @details The buffer is usually a mapping of ::wol_file_map_open(). The lines are parsed like
+//!          ::wol_parse_targets(), but without groups and parse error locations, only the number
+//!          of failed lines is counted. The order of the packets follows the inventory per parser
+//!          and interface, not across them.
+//!
+//!          A parser that finds a full ring waits for the sender, so memory stays bounded by the
+//!          rings. If the sender of an interface can not be opened or bound, its targets get that
+//!          error and the other interfaces are not delayed.
+//! @param buffer Inventory text, does not need to be null-terminated
+//! @param length Number of bytes in `buffer`
+//! @param options Pointer to the options, can be NULL for the defaults
+//! @param[out] stats Pointer to the totals, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every parsed target was sent, ::WAKE_ON_LAN_ERRORS_MEMORY if the pipeline
+//!         could not be set up, otherwise the error of a failed target
+wake_on_lan_errors_t wol_pipeline_run(const char * buffer, size_t length, const wol_pipeline_options_t * options, wol_pipeline_stats_t * stats);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_PIPELINE_H_ */
@@ -0,0 +1,383 @@
+//! @file
+//! @brief The wake_on_lan_raw source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_raw.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__linux__)
+
+  #include <arpa/inet.h>
+  #include <errno.h>
+  #include <linux/if_packet.h>
+  #include <net/if.h>
+  #include <sys/ioctl.h>
+  #include <sys/mman.h>
+  #include <sys/socket.h>
+  #include <unistd.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Distance between two frames of the ring, a multiple of `TPACKET_ALIGNMENT` that holds the frame header and a frame
+#define RAW_FRAME_SLOT_SIZE 256
+
+//! @brief Number of frames of the ring, the largest number of frames flushed with one `sendto()`
+#define RAW_FRAME_COUNT 1024
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+//! @brief Maps a `PACKET_TX_RING` for a raw sender
+//! @param raw Pointer to a raw sender with an open socket
+//! @return True if the ring is mapped, otherwise the frames are sent one by one
+static bool raw_ring_open(wol_raw_sender_t * raw);
+
+//! @brief Writes the Ethernet header and the magic packet of a target
+//! @param raw Pointer to the raw sender, the source of the frame
+//! @param frame Buffer of ::WOL_RAW_FRAME_SIZE bytes
+//! @param target Pointer to the target, its MAC is the destination of the frame
+//! @return Size of the frame
+static size_t raw_frame_build(const wol_raw_sender_t * raw, uint8_t * frame, const wol_target_t * target);
+
+//! @brief Sends the targets through the ring, see ::wol_raw_send()
+//! @param raw Pointer to an open raw sender with a ring
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param[out] results Array of `n` results, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or the error of a failed target
+static wake_on_lan_errors_t raw_send_ring(wol_raw_sender_t * raw, const wol_target_t * targets, size_t n, wol_result_t * results);
+
+//! @brief Sends the targets with one `sendto()` each, see ::wol_raw_send()
+//! @param raw Pointer to an open raw sender without a ring
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param[out] results Array of `n` results, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE or the error of a failed target
+static wake_on_lan_errors_t raw_send_single(wol_raw_sender_t * raw, const wol_target_t * targets, size_t n, wol_result_t * results);
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+#if defined(__linux__)
+
+static bool raw_ring_open(wol_raw_sender_t * raw)
+{
+    int version = TPACKET_V2;
+    if (0 > setsockopt((int)raw->sockfd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)))
+    {
+        return false;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    uint32_t block_size = (0 < page_size && RAW_FRAME_SLOT_SIZE <= page_size) ? (uint32_t)page_size : 4096;
+
+    struct tpacket_req request;
+    request.tp_block_size = block_size;
+    request.tp_frame_size = RAW_FRAME_SLOT_SIZE;
+    request.tp_frame_nr = RAW_FRAME_COUNT;
+    request.tp_block_nr = RAW_FRAME_COUNT / (block_size / RAW_FRAME_SLOT_SIZE);
+
+    if (0 > setsockopt((int)raw->sockfd, SOL_PACKET, PACKET_TX_RING, &request, sizeof(request)))
+    {
+        return false;
+    }
+
+    size_t ring_size = (size_t)request.tp_block_size * request.tp_block_nr;
+    void * ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, (int)raw->sockfd, 0);
+    if (MAP_FAILED == ring)
+    {
+        return false;
+    }
+
+    raw->ring = ring;
+    raw->ring_size = ring_size;
+    raw->frame_size = RAW_FRAME_SLOT_SIZE;
+    raw->frame_count = RAW_FRAME_COUNT;
+    raw->next_frame = 0;
+
+    return true;
+}
+
+static size_t raw_frame_build(const wol_raw_sender_t * raw, uint8_t * frame, const wol_target_t * target)
+{
+    memcpy(frame, target->mac, 6);
+    memcpy(frame + 6, raw->source_mac, 6);
+    frame[12] = (uint8_t)(WOL_ETHERTYPE >> 8);
+    frame[13] = (uint8_t)(WOL_ETHERTYPE & 0xFF);
+    return 14 + wol_packet_build_target(frame + 14, target);
+}
+
+static wake_on_lan_errors_t raw_send_ring(wol_raw_sender_t * raw, const wol_target_t * targets, size_t n, wol_result_t * results)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    // Without PACKET_TX_HAS_OFF the kernel takes the frame right behind the header
+    const size_t data_offset = TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+
+    for(size_t done = 0; done < n; )
+    {
+        size_t first = done;
+        uint32_t first_frame = raw->next_frame;
+
+        // The flush below blocks until the kernel has transmitted the ring, so every frame is available again
+        for(; done < n && done - first < raw->frame_count; done++)
+        {
+            uint8_t * slot = raw->ring + (size_t)raw->next_frame * raw->frame_size;
+            struct tpacket2_hdr * header = (struct tpacket2_hdr *)slot;
+
+            header->tp_len = (uint32_t)raw_frame_build(raw, slot + data_offset, &targets[done]);
+            __atomic_store_n(&header->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+            raw->next_frame = (raw->next_frame + 1) % raw->frame_count;
+        }
+
+        ssize_t sendto_result;
+        do{
+            sendto_result = sendto((int)raw->sockfd, NULL, 0, 0, NULL, 0);
+        }while(0 > sendto_result && EINTR == errno);
+        int send_error = (0 > sendto_result) ? errno : 0;
+
+        uint32_t frame = first_frame;
+        for(size_t i = first; i < done; i++)
+        {
+            struct tpacket2_hdr * header = (struct tpacket2_hdr *)(raw->ring + (size_t)frame * raw->frame_size);
+            uint32_t status = __atomic_load_n(&header->tp_status, __ATOMIC_ACQUIRE);
+
+            wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_NONE;
+            int last_error = 0;
+            if(TP_STATUS_AVAILABLE != status)
+            {
+                // Rejected by the kernel or not transmitted because the flush failed, the frame is reclaimed
+                error = WAKE_ON_LAN_ERRORS_SEND;
+                last_error = send_error ? send_error : -1;
+                __atomic_store_n(&header->tp_status, TP_STATUS_AVAILABLE, __ATOMIC_RELEASE);
+            }
+
+            if(results)
+            {
+                results[i].return_value = error;
+                results[i].last_error = last_error;
+            }
+            if(WAKE_ON_LAN_ERRORS_NONE != error)
+            {
+                return_value = error;
+            }
+
+            frame = (frame + 1) % raw->frame_count;
+        }
+    }
+
+    return return_value;
+}
+
+static wake_on_lan_errors_t raw_send_single(wol_raw_sender_t * raw, const wol_target_t * targets, size_t n, wol_result_t * results)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(WOL_ETHERTYPE);
+    addr.sll_ifindex = raw->ifindex;
+    addr.sll_halen = 6;
+
+    uint8_t frame[WOL_RAW_FRAME_SIZE];
+
+    for(size_t i = 0; i < n; i++)
+    {
+        size_t frame_size = raw_frame_build(raw, frame, &targets[i]);
+        memcpy(addr.sll_addr, targets[i].mac, 6);
+
+        wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_NONE;
+        int last_error = 0;
+        if (0 > sendto((int)raw->sockfd, frame, frame_size, 0, (const struct sockaddr *)&addr, sizeof(addr)))
+        {
+            error = WAKE_ON_LAN_ERRORS_SEND;
+            last_error = errno;
+            return_value = error;
+        }
+
+        if(results)
+        {
+            results[i].return_value = error;
+            results[i].last_error = last_error;
+        }
+    }
+
+    return return_value;
+}
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_raw_sender_open(wol_raw_sender_t * raw, const char * device, wake_on_lan_t * wol)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+
+    if(NULL == raw)
+    {
+        if(wol) { wol->return_value = return_value; wol->last_error = -1; }
+        return return_value;
+    }
+
+    memset(raw, 0, sizeof(*raw));
+    raw->sockfd = -1;
+
+    do{
+
+#if defined(__linux__)
+        if(NULL == device || IFNAMSIZ <= strlen(device))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_BIND;
+            if(wol) { wol->last_error = -1; }
+            break;
+        }
+
+        int sockfd = socket(AF_PACKET, SOCK_RAW, htons(WOL_ETHERTYPE));
+        if (0 > sockfd)
+        {
+            return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+        raw->sockfd = sockfd;
+
+        struct ifreq request;
+        memset(&request, 0, sizeof(request));
+        strncpy(request.ifr_name, device, IFNAMSIZ - 1);
+
+        if (0 > ioctl(sockfd, SIOCGIFINDEX, &request))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_BIND;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+        raw->ifindex = request.ifr_ifindex;
+
+        if (0 > ioctl(sockfd, SIOCGIFHWADDR, &request))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_BIND;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+        memcpy(raw->source_mac, request.ifr_hwaddr.sa_data, 6);
+
+        struct sockaddr_ll addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sll_family = AF_PACKET;
+        addr.sll_protocol = htons(WOL_ETHERTYPE);
+        addr.sll_ifindex = raw->ifindex;
+
+        if (0 > bind(sockfd, (const struct sockaddr *)&addr, sizeof(addr)))
+        {
+            return_value = WAKE_ON_LAN_ERRORS_BIND;
+            if(wol) { wol->last_error = errno; }
+            break;
+        }
+
+        // A kernel without TX ring support still sends, one system call per frame
+        raw_ring_open(raw);
+
+        return_value = WAKE_ON_LAN_ERRORS_NONE;
+#else
+        (void)device;
+        return_value = WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+        if(wol) { wol->last_error = -1; }
+#endif
+
+    }while(0);
+
+    if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+    {
+        wol_raw_sender_close(raw);
+    }
+
+    if(wol) { wol->return_value = return_value; }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_raw_send(wol_raw_sender_t * raw, const wol_target_t * targets, size_t n, wol_result_t * results)
+{
+    if(NULL == raw || -1 == raw->sockfd || (NULL == targets && 0 != n))
+    {
+        for(size_t i = 0; results && i < n; i++)
+        {
+            results[i].return_value = WAKE_ON_LAN_ERRORS_UNKNOWN;
+            results[i].last_error = -1;
+        }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+#if defined(__linux__)
+    if(raw->ring)
+    {
+        return raw_send_ring(raw, targets, n, results);
+    }
+
+    return raw_send_single(raw, targets, n, results);
+#else
+    return WAKE_ON_LAN_ERRORS_UNKNOWN;
+#endif
+}
+
+void wol_raw_sender_close(wol_raw_sender_t * raw)
+{
+    if(NULL == raw)
+    {
+        return;
+    }
+
+#if defined(__linux__)
+    if(raw->ring)
+    {
+        munmap(raw->ring, raw->ring_size);
+    }
+    if(-1 != raw->sockfd)
+    {
+        close((int)raw->sockfd);
+    }
+#endif
+
+    raw->ring = NULL;
+    raw->ring_size = 0;
+    raw->sockfd = -1;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,102 @@
+//! @file
+//! @brief The wake_on_lan_raw header file.
+//! @details The module can be used in C and C++ under Linux
+//!
+//! Sends magic packets as raw Ethernet frames with the EtherType ::WOL_ETHERTYPE instead
+//! of UDP datagrams. The frames need neither an IP address nor a broadcast route and are
+//! addressed to the MAC of each target, so the switches do not flood them to every port.
+//! The frames are queued in a `PACKET_TX_RING` shared with the kernel and are flushed
+//! with one `sendto()` call per ring.
+//!
+//! @note Needs the capability `CAP_NET_RAW`. Under Windows, opening a raw sender fails with
+//!       ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION.
+
+#ifndef INC_WAKE_ON_LAN_RAW_H_
+#define INC_WAKE_ON_LAN_RAW_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief EtherType of a Wake-on-LAN frame
+#define WOL_ETHERTYPE 0x0842
+
+//! @brief Size of the largest Wake-on-LAN frame, the Ethernet header followed by the magic packet and a SecureOn password
+#define WOL_RAW_FRAME_SIZE ( 14 + WAKE_ON_LAN_PACKET_MAX_SIZE )
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Raw Ethernet sender bound to one network device, see ::wol_raw_sender_open()
+typedef struct wol_raw_sender_s
+{
+    intptr_t sockfd;                    //!< File descriptor of the `AF_PACKET` socket, -1 if the sender is closed
+    int ifindex;                        //!< Index of the network device
+    uint8_t source_mac[6];              //!< MAC of the network device, the source of the frames
+    uint8_t * ring;                     //!< Mapping of the `PACKET_TX_RING`, NULL if the kernel refused the ring and every frame is sent on its own
+    size_t ring_size;                   //!< Size of wol_raw_sender_s::ring
+    uint32_t frame_size;                //!< Distance between two frames of the ring
+    uint32_t frame_count;               //!< Number of frames of the ring
+    uint32_t next_frame;                //!< Index of the next frame to fill
+} wol_raw_sender_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Opens a raw sender on a network device
+//! @param[out] raw Pointer to the sender to initialize
+//! @param device Name of the network device, e.g. `eth0`
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION or ::WAKE_ON_LAN_ERRORS_BIND
+wake_on_lan_errors_t wol_raw_sender_open(wol_raw_sender_t * raw, const char * device, wake_on_lan_t * wol);
+
+//! @brief Sends one frame to the MAC of each target, the IP and port of the targets are ignored
+//! @details The frames are written into the ring until it is full and the whole ring is handed to the
+//!          kernel with one `sendto()`, which returns when every frame of the ring was transmitted.
+//! @param raw Pointer to an open raw sender
+//! @param targets Array of `n` targets
+//! @param n Number of targets
+//! @param[out] results Array of `n` results, one for each target, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, otherwise the error of a failed target
+wake_on_lan_errors_t wol_raw_send(wol_raw_sender_t * raw, const wol_target_t * targets, size_t n, wol_result_t * results);
+
+//! @brief Releases the ring and closes the socket of a raw sender
+//! @param raw Pointer to the sender, a closed sender is ignored
+void wol_raw_sender_close(wol_raw_sender_t * raw);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_RAW_H_ */
@@ -0,0 +1,950 @@
+//! @file
+//! @brief The wake_on_lan_relay source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+// @brief `WSAPoll()` needs Windows Vista or newer and must be requested before the first system header
+#if defined(_WIN32) && ( !defined(_WIN32_WINNT) || ( _WIN32_WINNT < 0x0600 ) )
+  #undef _WIN32_WINNT
+  #define _WIN32_WINNT 0x0600
+#endif
+
+#include "wake_on_lan_relay.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+
+  #ifdef _MSC_VER
+    #pragma comment(lib, "ws2_32.lib")
+  #endif
+
+#else
+
+  #include <arpa/inet.h>
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <poll.h>
+  #include <unistd.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Largest number of UDP datagrams read in one round, so that TCP clients are not starved
+#define RELAY_UDP_PER_ROUND 64
+
+//! @brief Largest number of UDP requests being sent at the same time, further datagrams wait in the socket buffer
+#define RELAY_UDP_JOBS 16
+
+//! @brief Number of request slots that take turns on the sender, one per TCP client and UDP job
+#define RELAY_JOBS ( WOL_RELAY_MAX_CLIENTS + RELAY_UDP_JOBS )
+
+//! @brief Time between two checks of wol_relay_options_s::stop
+#define RELAY_STOP_CHECK_MS 500
+
+//! @brief The burst of a paced relay is the number of packets of this fraction of a second
+#define RELAY_BURSTS_PER_SECOND 100
+
+//! @brief Largest burst of a paced relay
+#define RELAY_BURST_MAX 64
+
+// @brief The socket calls differ in names and types between Winsock and POSIX
+#ifdef _WIN32
+  #define RELAY_INVALID_SOCKET INVALID_SOCKET
+  #define RELAY_CLOSE(SOCKFD) closesocket(SOCKFD)
+  #define RELAY_POLL(FDS, COUNT, TIMEOUT) WSAPoll(FDS, (ULONG)(COUNT), TIMEOUT)
+  #define RELAY_LAST_ERROR() WSAGetLastError()
+  #define RELAY_WOULD_BLOCK(ERROR) ( WSAEWOULDBLOCK == (ERROR) )
+#else
+  #define RELAY_INVALID_SOCKET (-1)
+  #define RELAY_CLOSE(SOCKFD) close(SOCKFD)
+  #define RELAY_POLL(FDS, COUNT, TIMEOUT) poll(FDS, (nfds_t)(COUNT), TIMEOUT)
+  #define RELAY_LAST_ERROR() errno
+  #define RELAY_WOULD_BLOCK(ERROR) ( EAGAIN == (ERROR) || EWOULDBLOCK == (ERROR) || EINTR == (ERROR) )
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+#ifdef _WIN32
+typedef SOCKET relay_socket_t;
+typedef WSAPOLLFD relay_pollfd_t;
+#else
+typedef int relay_socket_t;
+typedef struct pollfd relay_pollfd_t;
+#endif
+
+//! @brief A request that is being sent or replied
+typedef struct relay_job_s
+{
+    void * memory;                      //!< Single allocation of the arrays of the job, NULL if the slot is free
+    wol_target_t * targets;             //!< Valid records of the request, the admitted ones first
+    size_t * records;                   //!< Record of each target
+    size_t * admitted;                  //!< Index into relay_job_s::targets of each admitted target, from ::wol_coalesce_filter()
+    wol_result_t * results;             //!< Result of each admitted target
+    uint8_t * reply;                    //!< Header and one result byte per record
+    size_t reply_length;                //!< Size of the reply
+    size_t reply_sent;                  //!< Number of reply bytes written to a TCP client
+    wol_send_queue_t queue;             //!< Admitted targets and their progress
+    bool sending;                       //!< Targets of the queue are left, otherwise the reply is complete
+} relay_job_t;
+
+//! @brief A TCP connection of a client
+typedef struct relay_client_s
+{
+    relay_socket_t sockfd;              //!< Socket of the connection, ::RELAY_INVALID_SOCKET if the slot is free
+    uint8_t * buffer;                   //!< Received bytes of the next requests, ::WOL_RELAY_MAX_REQUEST_SIZE bytes
+    size_t length;                      //!< Number of bytes in relay_client_s::buffer
+    relay_job_t job;                    //!< Request being served, one at a time so that the replies keep the order of the requests
+} relay_client_t;
+
+//! @brief A UDP request being served
+typedef struct relay_datagram_s
+{
+    relay_job_t job;                    //!< Request being served
+    struct sockaddr_in from;            //!< Client of the request
+    socklen_t from_length;              //!< Size of relay_datagram_s::from
+} relay_datagram_t;
+
+//! @brief State of one ::wol_relay_run() call
+typedef struct relay_s
+{
+    const wol_relay_options_t * options; //!< Options of the relay
+    wake_on_lan_sender_t sender;        //!< Pooled non-blocking sender of all magic packets
+    bool sender_full;                   //!< The sender socket was full, the jobs wait until it is writable
+    size_t next_job;                    //!< Job that sends first in the next round, the jobs take turns
+    relay_socket_t udp;                 //!< UDP control socket
+    relay_socket_t tcp;                 //!< Listening TCP control socket
+    relay_client_t clients[WOL_RELAY_MAX_CLIENTS]; //!< TCP connections
+    relay_datagram_t datagrams[RELAY_UDP_JOBS]; //!< UDP requests
+    uint8_t datagram[WOL_RELAY_MAX_REQUEST_SIZE + 1]; //!< Received UDP datagram, one byte more to detect oversized ones
+} relay_t;
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Creates, binds and switches a control socket to non-blocking mode
+//! @param relay Pointer to the state
+//! @param type `SOCK_DGRAM` or `SOCK_STREAM`
+//! @param[out] sockfd The new socket
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_SOCKET_CREATION, ::WAKE_ON_LAN_ERRORS_BIND or ::WAKE_ON_LAN_ERRORS_SOCKET_OPTION
+static wake_on_lan_errors_t relay_listen(relay_t * relay, int type, relay_socket_t * sockfd, wake_on_lan_t * wol);
+
+//! @brief Switches a socket to non-blocking mode
+//! @param sockfd Socket
+//! @return True on success
+static bool relay_set_nonblocking(relay_socket_t sockfd);
+
+//! @brief Checks whether a client may use the relay
+//! @param relay Pointer to the state
+//! @param addr Address of the client
+//! @return True if the address is inside the allowed network
+static bool relay_allowed(const relay_t * relay, const struct sockaddr_in * addr);
+
+//! @brief Decodes one record of a request into a target
+//! @param relay Pointer to the state
+//! @param record Record
+//! @param record_size ::WOL_RELAY_RECORD_SIZE or ::WOL_RELAY_RECORD_SIZE_V1
+//! @param[out] target Target of the record
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_LINE for a nonzero reserved byte or ::WAKE_ON_LAN_ERRORS_PASSWORD for an invalid password length
+static wake_on_lan_errors_t relay_decode(const relay_t * relay, const uint8_t * record, size_t record_size, wol_target_t * target);
+
+//! @brief Starts a job for a complete request, its targets are sent by ::relay_pump()
+//! @param relay Pointer to the state
+//! @param job Pointer to a free job
+//! @param request Request, its header must be valid
+//! @param count Number of records of the request
+//! @return False if the memory of the job could not be allocated
+static bool relay_start(relay_t * relay, relay_job_t * job, const uint8_t * request, size_t count);
+
+//! @brief Releases a job and frees its slot
+//! @param job Pointer to the job
+static void relay_free(relay_job_t * job);
+
+//! @brief Lets every job that has targets left send as much as the sender takes without waiting, and answers the finished ones
+//! @param relay Pointer to the state
+static void relay_pump(relay_t * relay);
+
+//! @brief Writes as much of the reply of a TCP client as the socket takes, frees the job once all is written
+//! @param client Pointer to the client
+static void relay_write(relay_client_t * client);
+
+//! @brief Starts the next complete request of a TCP client that has no job, closes the connection on errors
+//! @param relay Pointer to the state
+//! @param client Pointer to the client
+static void relay_next(relay_t * relay, relay_client_t * client);
+
+//! @brief Starts jobs for the waiting UDP datagrams while UDP jobs are free
+//! @param relay Pointer to the state
+static void relay_read_udp(relay_t * relay);
+
+//! @brief Accepts the waiting TCP connections into free client slots
+//! @param relay Pointer to the state
+static void relay_accept(relay_t * relay);
+
+//! @brief Reads from a TCP client without job and starts its next request, closes the connection on errors
+//! @param relay Pointer to the state
+//! @param client Pointer to the client
+static void relay_read_tcp(relay_t * relay, relay_client_t * client);
+
+//! @brief Closes a TCP connection, drops its job and frees its slot
+//! @param client Pointer to the client
+static void relay_drop(relay_client_t * client);
+
+//! @brief Writes a 16-bit number in network order
+//! @param buffer Destination
+//! @param value Number
+static void put_u16(uint8_t * buffer, uint16_t value);
+
+//! @brief Writes a 32-bit number in network order
+//! @param buffer Destination
+//! @param value Number
+static void put_u32(uint8_t * buffer, uint32_t value);
+
+//! @brief Reads a 16-bit number in network order
+//! @param buffer Source
+//! @return Number
+static uint16_t get_u16(const uint8_t * buffer);
+
+//! @brief Reads a 32-bit number in network order
+//! @param buffer Source
+//! @return Number
+static uint32_t get_u32(const uint8_t * buffer);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static wake_on_lan_errors_t relay_listen(relay_t * relay, int type, relay_socket_t * sockfd, wake_on_lan_t * wol)
+{
+    *sockfd = socket(AF_INET, type, (SOCK_DGRAM == type) ? IPPROTO_UDP : IPPROTO_TCP);
+    if(RELAY_INVALID_SOCKET == *sockfd)
+    {
+        if(wol) { wol->last_error = RELAY_LAST_ERROR(); }
+        return WAKE_ON_LAN_ERRORS_SOCKET_CREATION;
+    }
+
+    if(SOCK_STREAM == type)
+    {
+        // A restarted relay gets its port back while old connections are in TIME_WAIT
+        int reuse = 1;
+        setsockopt(*sockfd, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(relay->options->listen_ip_v4);
+    addr.sin_port = htons(relay->options->port);
+
+    if(0 != bind(*sockfd, (const struct sockaddr *)&addr, sizeof(addr))
+        || (SOCK_STREAM == type && 0 != listen(*sockfd, SOMAXCONN)))
+    {
+        if(wol) { wol->last_error = RELAY_LAST_ERROR(); }
+        return WAKE_ON_LAN_ERRORS_BIND;
+    }
+
+    if(!relay_set_nonblocking(*sockfd))
+    {
+        if(wol) { wol->last_error = RELAY_LAST_ERROR(); }
+        return WAKE_ON_LAN_ERRORS_SOCKET_OPTION;
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static bool relay_set_nonblocking(relay_socket_t sockfd)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return SOCKET_ERROR != ioctlsocket(sockfd, FIONBIO, &mode);
+#else
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    return 0 <= flags && 0 == fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+static bool relay_allowed(const relay_t * relay, const struct sockaddr_in * addr)
+{
+    uint8_t prefix = relay->options->allow_prefix;
+    if(0 == prefix)
+    {
+        return true;
+    }
+
+    uint32_t mask = (32 <= prefix) ? UINT32_MAX : ~(UINT32_MAX >> prefix);
+    return (ntohl(addr->sin_addr.s_addr) & mask) == (relay->options->allow_ip_v4 & mask);
+}
+
+static wake_on_lan_errors_t relay_decode(const relay_t * relay, const uint8_t * record, size_t record_size, wol_target_t * target)
+{
+    uint32_t ip_v4 = get_u32(record + 6);
+    uint16_t port = get_u16(record + 10);
+    if(0 == port)
+    {
+        port = relay->options->default_port;
+    }
+
+    wol_target_init(target, (0 == ip_v4) ? relay->options->default_ip_v4 : ip_v4, port, 0);
+    memcpy(target->mac, record, 6);
+
+    if(WOL_RELAY_RECORD_SIZE_V1 == record_size)
+    {
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    // A record with IPv6 goes out of the default interface of the relay, the scope of the client means nothing here
+    memcpy(target->ip_v6, record + 12, sizeof(target->ip_v6));
+    if(wol_target_is_v6(target))
+    {
+        target->ip_v4 = 0;
+    }
+
+    // The reserved byte stays zero so that a later version can give it a meaning
+    if(0 != record[29])
+    {
+        return WAKE_ON_LAN_ERRORS_LINE;
+    }
+
+    uint8_t password_length = record[28];
+    if(0 != password_length && 4 != password_length && WAKE_ON_LAN_PASSWORD_SIZE != password_length)
+    {
+        return WAKE_ON_LAN_ERRORS_PASSWORD;
+    }
+    memcpy(target->password, record + 30, password_length);
+    target->password_length = password_length;
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+static bool relay_start(relay_t * relay, relay_job_t * job, const uint8_t * request, size_t count)
+{
+    size_t record_size = wol_relay_record_size(request[4]);
+
+    // One allocation per request, the arrays are sized for its records and the reply
+    size_t reply_length = WOL_RELAY_HEADER_SIZE + count;
+    size_t size = count * (sizeof(*job->targets) + 2 * sizeof(*job->records) + sizeof(*job->results)) + reply_length;
+    job->memory = malloc(size);
+    if(NULL == job->memory)
+    {
+        return false;
+    }
+
+    // The arrays with the strictest alignment come first
+    job->records = (size_t *)job->memory;
+    job->admitted = job->records + count;
+    job->results = (wol_result_t *)(job->admitted + count);
+    job->targets = (wol_target_t *)(job->results + count);
+    job->reply = (uint8_t *)(job->targets + count);
+    job->reply_length = reply_length;
+    job->reply_sent = 0;
+
+    // The reply repeats the header, so clients match it by the request ID
+    memcpy(job->reply, request, WOL_RELAY_HEADER_SIZE);
+    memset(job->reply + WOL_RELAY_HEADER_SIZE, WAKE_ON_LAN_ERRORS_NONE, count);
+
+    size_t valid = 0;
+    const uint8_t * record = request + WOL_RELAY_HEADER_SIZE;
+    for(size_t i = 0; i < count; i++, record += record_size)
+    {
+        wake_on_lan_errors_t error = relay_decode(relay, record, record_size, &job->targets[valid]);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            job->reply[WOL_RELAY_HEADER_SIZE + i] = (uint8_t)error;
+            continue;
+        }
+        job->records[valid++] = i;
+    }
+
+    size_t admitted = valid;
+    if(relay->options->coalesce)
+    {
+        // Merged records share the packet of the earlier request and are answered as successful
+        admitted = wol_coalesce_filter(relay->options->coalesce, job->targets, valid, job->admitted);
+        for(size_t i = 0; i < admitted; i++)
+        {
+            job->records[i] = job->records[job->admitted[i]];
+        }
+    }
+
+    memset(&job->queue, 0, sizeof(job->queue));
+    job->queue.targets = job->targets;
+    job->queue.count = admitted;
+    job->queue.results = job->results;
+    job->sending = true;
+
+    return true;
+}
+
+static void relay_free(relay_job_t * job)
+{
+    free(job->memory);
+    job->memory = NULL;
+    job->sending = false;
+}
+
+static void relay_pump(relay_t * relay)
+{
+    for(size_t turn = 0; turn < RELAY_JOBS && !relay->sender_full; turn++)
+    {
+        size_t index = (relay->next_job + turn) % RELAY_JOBS;
+        relay_client_t * client = (WOL_RELAY_MAX_CLIENTS > index) ? &relay->clients[index] : NULL;
+        relay_datagram_t * datagram = client ? NULL : &relay->datagrams[index - WOL_RELAY_MAX_CLIENTS];
+        relay_job_t * job = client ? &client->job : &datagram->job;
+
+        if(!job->sending)
+        {
+            continue;
+        }
+
+        // A paced sender hands out one burst per call, so the next job gets the next burst
+        if(WAKE_ON_LAN_ERRORS_AGAIN == wol_send_queue_flush(&relay->sender, &job->queue))
+        {
+            relay->sender_full = (0 == job->queue.ready_at_ns);
+            continue;
+        }
+
+        for(size_t i = 0; i < job->queue.count; i++)
+        {
+            job->reply[WOL_RELAY_HEADER_SIZE + job->records[i]] = (uint8_t)job->results[i].return_value;
+        }
+        job->sending = false;
+
+        if(client)
+        {
+            relay_write(client);
+            relay_next(relay, client);
+        }
+        else
+        {
+            // A reply lost to a full socket buffer is lost like the datagram itself could have been
+            sendto(relay->udp, (const char *)job->reply, (int)job->reply_length, 0, (const struct sockaddr *)&datagram->from, datagram->from_length);
+            relay_free(job);
+        }
+    }
+
+    relay->next_job = (relay->next_job + 1) % RELAY_JOBS;
+}
+
+static void relay_write(relay_client_t * client)
+{
+    while(client->job.reply_sent < client->job.reply_length)
+    {
+        int length = (int)send(client->sockfd, (const char *)client->job.reply + client->job.reply_sent,
+            (int)(client->job.reply_length - client->job.reply_sent), 0);
+        if(0 > length && RELAY_WOULD_BLOCK(RELAY_LAST_ERROR()))
+        {
+            // The rest is written when the socket is writable again
+            return;
+        }
+        if(0 >= length)
+        {
+            relay_drop(client);
+            return;
+        }
+        client->job.reply_sent += (size_t)length;
+    }
+
+    relay_free(&client->job);
+}
+
+static void relay_next(relay_t * relay, relay_client_t * client)
+{
+    if(RELAY_INVALID_SOCKET == client->sockfd || client->job.memory)
+    {
+        return;
+    }
+
+    size_t count = 0;
+    if(WOL_RELAY_HEADER_SIZE > client->length)
+    {
+        return;
+    }
+    if(!wol_relay_header(client->buffer, client->length, &count, NULL))
+    {
+        relay_drop(client);
+        return;
+    }
+
+    size_t request_length = WOL_RELAY_HEADER_SIZE + count * wol_relay_record_size(client->buffer[4]);
+    if(request_length > client->length)
+    {
+        return;
+    }
+
+    if(!relay_start(relay, &client->job, client->buffer, count))
+    {
+        relay_drop(client);
+        return;
+    }
+
+    // Pipelined requests stay in the buffer until the reply of this one is written
+    memmove(client->buffer, client->buffer + request_length, client->length - request_length);
+    client->length -= request_length;
+}
+
+static void relay_read_udp(relay_t * relay)
+{
+    for(unsigned round = 0; round < RELAY_UDP_PER_ROUND; round++)
+    {
+        relay_datagram_t * datagram = NULL;
+        for(size_t i = 0; NULL == datagram && i < RELAY_UDP_JOBS; i++)
+        {
+            if(NULL == relay->datagrams[i].job.memory)
+            {
+                datagram = &relay->datagrams[i];
+            }
+        }
+        if(NULL == datagram)
+        {
+            break;
+        }
+
+        struct sockaddr_in from;
+        socklen_t from_length = sizeof(from);
+
+        int length = (int)recvfrom(relay->udp, (char *)relay->datagram, sizeof(relay->datagram), 0, (struct sockaddr *)&from, &from_length);
+        if(0 > length)
+        {
+            if(RELAY_WOULD_BLOCK(RELAY_LAST_ERROR()))
+            {
+                break;
+            }
+            // ICMP errors of earlier replies are reported here, the next datagram is unaffected
+            continue;
+        }
+
+        size_t count = 0;
+        if(!relay_allowed(relay, &from) || !wol_relay_header(relay->datagram, (size_t)length, &count, NULL)
+            || (size_t)length != WOL_RELAY_HEADER_SIZE + count * wol_relay_record_size(relay->datagram[4]))
+        {
+            continue;
+        }
+
+        if(!relay_start(relay, &datagram->job, relay->datagram, count))
+        {
+            break;
+        }
+        datagram->from = from;
+        datagram->from_length = from_length;
+    }
+}
+
+static void relay_accept(relay_t * relay)
+{
+    for(;;)
+    {
+        relay_client_t * client = NULL;
+        for(size_t i = 0; NULL == client && i < WOL_RELAY_MAX_CLIENTS; i++)
+        {
+            if(RELAY_INVALID_SOCKET == relay->clients[i].sockfd)
+            {
+                client = &relay->clients[i];
+            }
+        }
+        if(NULL == client)
+        {
+            break;
+        }
+
+        struct sockaddr_in from;
+        socklen_t from_length = sizeof(from);
+        relay_socket_t sockfd = accept(relay->tcp, (struct sockaddr *)&from, &from_length);
+        if(RELAY_INVALID_SOCKET == sockfd)
+        {
+            break;
+        }
+
+        if(!relay_allowed(relay, &from) || !relay_set_nonblocking(sockfd))
+        {
+            RELAY_CLOSE(sockfd);
+            continue;
+        }
+
+        if(NULL == client->buffer)
+        {
+            client->buffer = malloc(WOL_RELAY_MAX_REQUEST_SIZE);
+            if(NULL == client->buffer)
+            {
+                RELAY_CLOSE(sockfd);
+                break;
+            }
+        }
+
+        client->sockfd = sockfd;
+        client->length = 0;
+    }
+}
+
+static void relay_read_tcp(relay_t * relay, relay_client_t * client)
+{
+    int length = (int)recv(client->sockfd, (char *)client->buffer + client->length, (int)(WOL_RELAY_MAX_REQUEST_SIZE - client->length), 0);
+    if(0 > length && RELAY_WOULD_BLOCK(RELAY_LAST_ERROR()))
+    {
+        return;
+    }
+    if(0 >= length)
+    {
+        relay_drop(client);
+        return;
+    }
+    client->length += (size_t)length;
+
+    relay_next(relay, client);
+}
+
+static void relay_drop(relay_client_t * client)
+{
+    RELAY_CLOSE(client->sockfd);
+    client->sockfd = RELAY_INVALID_SOCKET;
+    client->length = 0;
+    relay_free(&client->job);
+}
+
+static void put_u16(uint8_t * buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value >> 8);
+    buffer[1] = (uint8_t)(value >> 0);
+}
+
+static void put_u32(uint8_t * buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)(value >> 16);
+    buffer[2] = (uint8_t)(value >> 8);
+    buffer[3] = (uint8_t)(value >> 0);
+}
+
+static uint16_t get_u16(const uint8_t * buffer)
+{
+    return (uint16_t)(buffer[0] << 8 | buffer[1]);
+}
+
+static uint32_t get_u32(const uint8_t * buffer)
+{
+    return (uint32_t)buffer[0] << 24 | (uint32_t)buffer[1] << 16 | (uint32_t)buffer[2] << 8 | buffer[3];
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+size_t wol_relay_encode(uint8_t * buffer, uint32_t request_id, const wol_target_t * targets, size_t n)
+{
+    if(NULL == buffer || (NULL == targets && 0 != n) || WOL_RELAY_MAX_RECORDS < n)
+    {
+        return 0;
+    }
+
+    memcpy(buffer, WOL_RELAY_MAGIC, 4);
+    buffer[4] = WOL_RELAY_VERSION;
+    buffer[5] = 0;
+    put_u16(buffer + 6, (uint16_t)n);
+    put_u32(buffer + 8, request_id);
+
+    uint8_t * record = buffer + WOL_RELAY_HEADER_SIZE;
+    for(size_t i = 0; i < n; i++, record += WOL_RELAY_RECORD_SIZE)
+    {
+        memset(record, 0, WOL_RELAY_RECORD_SIZE);
+        memcpy(record, targets[i].mac, 6);
+        put_u32(record + 6, wol_target_is_v6(&targets[i]) ? 0 : targets[i].ip_v4);
+        put_u16(record + 10, targets[i].port);
+        memcpy(record + 12, targets[i].ip_v6, sizeof(targets[i].ip_v6));
+        record[28] = targets[i].password_length;
+        memcpy(record + 30, targets[i].password, targets[i].password_length);
+    }
+
+    return WOL_RELAY_HEADER_SIZE + n * WOL_RELAY_RECORD_SIZE;
+}
+
+bool wol_relay_header(const uint8_t * buffer, size_t length, size_t * count, uint32_t * request_id)
+{
+    if(NULL == buffer || WOL_RELAY_HEADER_SIZE > length || 0 != memcmp(buffer, WOL_RELAY_MAGIC, 4)
+        || 0 == wol_relay_record_size(buffer[4]) || 0 != buffer[5])
+    {
+        return false;
+    }
+
+    size_t records = get_u16(buffer + 6);
+    if(((WOL_RELAY_VERSION_1 == buffer[4]) ? WOL_RELAY_MAX_RECORDS_V1 : WOL_RELAY_MAX_RECORDS) < records)
+    {
+        return false;
+    }
+
+    if(count) { *count = records; }
+    if(request_id) { *request_id = get_u32(buffer + 8); }
+
+    return true;
+}
+
+size_t wol_relay_record_size(uint8_t version)
+{
+    switch(version)
+    {
+        case WOL_RELAY_VERSION:   return WOL_RELAY_RECORD_SIZE;
+        case WOL_RELAY_VERSION_1: return WOL_RELAY_RECORD_SIZE_V1;
+        default:                  return 0;
+    }
+}
+
+wake_on_lan_errors_t wol_relay_run(const wol_relay_options_t * options, wake_on_lan_t * wol)
+{
+    if(NULL == options)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    relay_t * relay = malloc(sizeof(*relay));
+    if(NULL == relay)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    memset(relay, 0, sizeof(*relay));
+    relay->options = options;
+    relay->udp = RELAY_INVALID_SOCKET;
+    relay->tcp = RELAY_INVALID_SOCKET;
+    for(size_t i = 0; i < WOL_RELAY_MAX_CLIENTS; i++)
+    {
+        relay->clients[i].sockfd = RELAY_INVALID_SOCKET;
+    }
+
+    bool sender_open = false;
+    wake_on_lan_errors_t return_value;
+
+    do{
+
+        // The sender comes first, under Windows it starts Winsock for the control sockets too
+        return_value = wake_on_lan_sender_open(&relay->sender, wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+        {
+            break;
+        }
+        sender_open = true;
+
+        if(0 != options->packets_per_second)
+        {
+            uint32_t burst = options->packets_per_second / RELAY_BURSTS_PER_SECOND;
+            burst = (0 == burst) ? 1 : (RELAY_BURST_MAX < burst) ? RELAY_BURST_MAX : burst;
+            wake_on_lan_sender_set_rate(&relay->sender, options->packets_per_second, burst, NULL);
+        }
+
+        if(options->sender_options)
+        {
+            // A tuning the system refuses, e.g. a send buffer above the limit, does not stop the relay
+            wake_on_lan_sender_set_options(&relay->sender, options->sender_options, NULL);
+        }
+
+        return_value = wake_on_lan_sender_set_nonblocking(&relay->sender, true, wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+        {
+            break;
+        }
+
+        return_value = relay_listen(relay, SOCK_DGRAM, &relay->udp, wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+        {
+            break;
+        }
+
+        return_value = relay_listen(relay, SOCK_STREAM, &relay->tcp, wol);
+        if(WAKE_ON_LAN_ERRORS_NONE != return_value)
+        {
+            break;
+        }
+
+        int stop_ms = options->stop ? RELAY_STOP_CHECK_MS : -1;
+        relay_pollfd_t descriptors[4 + WOL_RELAY_MAX_CLIENTS];
+        relay_client_t * polled[4 + WOL_RELAY_MAX_CLIENTS];
+
+        while(NULL == options->stop || !*options->stop)
+        {
+            size_t count = 0;
+            bool slot_free = false;
+            bool datagram_free = false;
+            uint64_t ready_at_ns = UINT64_MAX;
+
+            for(size_t i = 0; i < RELAY_UDP_JOBS; i++)
+            {
+                relay_job_t * job = &relay->datagrams[i].job;
+                datagram_free |= (NULL == job->memory);
+                if(job->sending && 0 != job->queue.ready_at_ns && job->queue.ready_at_ns < ready_at_ns)
+                {
+                    ready_at_ns = job->queue.ready_at_ns;
+                }
+            }
+
+            // Without a free UDP job new datagrams wait in the socket buffer
+            if(datagram_free)
+            {
+                descriptors[count].fd = relay->udp;
+                descriptors[count].events = POLLIN;
+                polled[count++] = NULL;
+            }
+
+            for(size_t i = 0; i < WOL_RELAY_MAX_CLIENTS; i++)
+            {
+                relay_client_t * client = &relay->clients[i];
+                if(RELAY_INVALID_SOCKET == client->sockfd)
+                {
+                    slot_free = true;
+                    continue;
+                }
+
+                if(client->job.sending)
+                {
+                    // A client with a request in flight is not read, its next requests wait in the socket
+                    if(0 != client->job.queue.ready_at_ns && client->job.queue.ready_at_ns < ready_at_ns)
+                    {
+                        ready_at_ns = client->job.queue.ready_at_ns;
+                    }
+                    continue;
+                }
+
+                descriptors[count].fd = client->sockfd;
+                descriptors[count].events = client->job.memory ? POLLOUT : POLLIN;
+                polled[count++] = client;
+            }
+
+            // Without a free slot new connections wait in the backlog of the kernel
+            if(slot_free)
+            {
+                descriptors[count].fd = relay->tcp;
+                descriptors[count].events = POLLIN;
+                polled[count++] = NULL;
+            }
+
+            // A full sender socket is waited for, otherwise the next pacing token or the end of a backoff
+            size_t sender_first = count;
+            int timeout_ms = stop_ms;
+            if(relay->sender_full)
+            {
+                descriptors[count].fd = (relay_socket_t)relay->sender.sockfd;
+                descriptors[count].events = POLLOUT;
+                polled[count++] = NULL;
+                if(-1 != relay->sender.sockfd_v6)
+                {
+                    descriptors[count].fd = (relay_socket_t)relay->sender.sockfd_v6;
+                    descriptors[count].events = POLLOUT;
+                    polled[count++] = NULL;
+                }
+            }
+            else if(UINT64_MAX != ready_at_ns)
+            {
+                uint64_t now_ns = wol_clock_ns();
+                uint64_t wait_ms = (ready_at_ns > now_ns) ? (ready_at_ns - now_ns + 999999) / 1000000 : 0;
+                if(0 > timeout_ms || (uint64_t)timeout_ms > wait_ms)
+                {
+                    timeout_ms = (int)wait_ms;
+                }
+            }
+
+            for(size_t i = 0; i < count; i++)
+            {
+                descriptors[i].revents = 0;
+            }
+
+            if(0 < RELAY_POLL(descriptors, count, timeout_ms))
+            {
+                for(size_t i = 0; i < count; i++)
+                {
+                    if(0 == descriptors[i].revents)
+                    {
+                        continue;
+                    }
+
+                    if(sender_first <= i)
+                    {
+                        relay->sender_full = false;
+                    }
+                    else if(polled[i] && polled[i]->job.memory)
+                    {
+                        relay_write(polled[i]);
+                        relay_next(relay, polled[i]);
+                    }
+                    else if(polled[i])
+                    {
+                        relay_read_tcp(relay, polled[i]);
+                    }
+                    else if(relay->udp == descriptors[i].fd)
+                    {
+                        relay_read_udp(relay);
+                    }
+                    else
+                    {
+                        relay_accept(relay);
+                    }
+                }
+            }
+
+            relay_pump(relay);
+        }
+
+    }while(0);
+
+    for(size_t i = 0; i < WOL_RELAY_MAX_CLIENTS; i++)
+    {
+        if(RELAY_INVALID_SOCKET != relay->clients[i].sockfd)
+        {
+            RELAY_CLOSE(relay->clients[i].sockfd);
+        }
+        relay_free(&relay->clients[i].job);
+        free(relay->clients[i].buffer);
+    }
+    for(size_t i = 0; i < RELAY_UDP_JOBS; i++)
+    {
+        relay_free(&relay->datagrams[i].job);
+    }
+    if(RELAY_INVALID_SOCKET != relay->tcp)
+    {
+        RELAY_CLOSE(relay->tcp);
+    }
+    if(RELAY_INVALID_SOCKET != relay->udp)
+    {
+        RELAY_CLOSE(relay->udp);
+    }
+    if(sender_open)
+    {
+        wake_on_lan_sender_close(&relay->sender, NULL);
+    }
+
+    free(relay);
+
+    return return_value;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,164 @@
+//! @file
+//! @brief The wake_on_lan_relay header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! A relay runs on a host of a network segment and sends magic packets on behalf of
+//! hosts on other segments, where directed broadcasts do not reach. It listens on one
+//! port for UDP and TCP and accepts batches of targets in a compact binary message:
+//!
+//! | Offset | Size | Field                                                        |
+//! |:-------|:-----|:-------------------------------------------------------------|
+//! | 0      | 4    | ::WOL_RELAY_MAGIC                                            |
+//! | 4      | 1    | ::WOL_RELAY_VERSION                                          |
+//! | 5      | 1    | 0                                                            |
+//! | 6      | 2    | Number of records, at most ::WOL_RELAY_MAX_RECORDS           |
+//! | 8      | 4    | Request ID, copied into the reply                            |
+//! | 12     | 36   | Records, see below                                           |
+//!
+//! | Offset | Size | Field of a record                                            |
+//! |:-------|:-----|:-------------------------------------------------------------|
+//! | 0      | 6    | MAC                                                          |
+//! | 6      | 4    | IPv4, 0 for the default of the relay                         |
+//! | 10     | 2    | Port, 0 for the default of the relay                         |
+//! | 12     | 16   | IPv6, all zero for an IPv4 record, sent out of the default interface of the relay |
+//! | 28     | 1    | Length of the SecureOn password, 0, 4 or 6                   |
+//! | 29     | 1    | 0, a record with another value fails with ::WAKE_ON_LAN_ERRORS_LINE |
+//! | 30     | 6    | SecureOn password, the unused bytes are 0                    |
+//!
+//! All numbers are in network order. The relay answers with the same header followed by one
+//! byte ::wake_on_lan_errors_t per record, a record merged into an earlier request is successful.
+//! Requests of ::WOL_RELAY_VERSION_1 with the 12 byte records MAC, IPv4 and port are still accepted.
+//! A UDP datagram holds exactly one request, a TCP connection any number of requests one after
+//! another, and every request is answered as soon as it is sent, so any number of clients can
+//! have requests in flight.
+//!
+//! @note Anyone who can reach the port can wake the hosts of the segment, restrict the clients
+//!       with wol_relay_options_s::allow_ip_v4 and wol_relay_options_s::allow_prefix.
+
+#ifndef INC_WAKE_ON_LAN_RELAY_H_
+#define INC_WAKE_ON_LAN_RELAY_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+#include "wake_on_lan_coalesce.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief First 4 bytes of every relay message
+#define WOL_RELAY_MAGIC "WOLR"
+
+//! @brief Version of the relay messages written by ::wol_relay_encode()
+#define WOL_RELAY_VERSION 2
+
+//! @brief First version of the relay messages, records without IPv6 and password
+#define WOL_RELAY_VERSION_1 1
+
+//! @brief Size of the header of a relay message
+#define WOL_RELAY_HEADER_SIZE 12
+
+//! @brief Size of one record of a request
+#define WOL_RELAY_RECORD_SIZE 36
+
+//! @brief Size of one record of a request of ::WOL_RELAY_VERSION_1
+#define WOL_RELAY_RECORD_SIZE_V1 12
+
+//! @brief Largest number of records of one request, a request still fits into one UDP datagram
+#define WOL_RELAY_MAX_RECORDS 1536
+
+//! @brief Largest number of records of one request of ::WOL_RELAY_VERSION_1
+#define WOL_RELAY_MAX_RECORDS_V1 4096
+
+//! @brief Size of the largest request, of ::WOL_RELAY_VERSION_1 too
+#define WOL_RELAY_MAX_REQUEST_SIZE ( WOL_RELAY_HEADER_SIZE + WOL_RELAY_MAX_RECORDS * WOL_RELAY_RECORD_SIZE )
+
+//! @brief Largest number of TCP connections served at the same time, further connections wait in the backlog
+#define WOL_RELAY_MAX_CLIENTS 64
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Options of ::wol_relay_run()
+typedef struct wol_relay_options_s
+{
+    uint16_t port;                      //!< Control port for UDP and TCP
+    uint32_t listen_ip_v4;              //!< Address to listen on, not in network order, 0 for all
+    uint32_t allow_ip_v4;               //!< Network of the allowed clients, not in network order
+    uint8_t allow_prefix;               //!< Prefix length of wol_relay_options_s::allow_ip_v4, 0 allows all clients
+    uint32_t default_ip_v4;             //!< IP of records with IP 0, not in network order, usually the broadcast of the segment
+    uint16_t default_port;              //!< Port of records with port 0
+    uint32_t packets_per_second;        //!< Rate of the magic packets, 0 sends without pacing
+    const wol_sender_options_t * sender_options; //!< Socket tuning of the sender, see ::wake_on_lan_sender_set_options(), can be NULL
+    wol_coalesce_t * coalesce;          //!< Merges repeated requests for a MAC into the first one, can be NULL to send every request
+    const volatile bool * stop;         //!< The relay returns soon after this becomes true, can be NULL to run forever
+} wol_relay_options_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Writes a relay request
+//! @param[out] buffer Buffer of at least `WOL_RELAY_HEADER_SIZE + n * WOL_RELAY_RECORD_SIZE` bytes
+//! @param request_id ID copied into the reply
+//! @param targets Array of `n` targets, the scope of IPv6 targets is not sent
+//! @param n Number of targets, at most ::WOL_RELAY_MAX_RECORDS
+//! @return Size of the request, 0 if `n` is too large
+size_t wol_relay_encode(uint8_t * buffer, uint32_t request_id, const wol_target_t * targets, size_t n);
+
+//! @brief Checks the header of a relay request or reply
+//! @param buffer Received bytes
+//! @param length Number of received bytes
+//! @param[out] count Number of records of the message
+//! @param[out] request_id Request ID of the message, can be NULL if not necessary
+//! @return True if `buffer` starts with a valid header, the message may still be incomplete
+bool wol_relay_header(const uint8_t * buffer, size_t length, size_t * count, uint32_t * request_id);
+
+//! @brief Returns the size of one record of a request
+//! @param version Version byte of the header
+//! @return ::WOL_RELAY_RECORD_SIZE, ::WOL_RELAY_RECORD_SIZE_V1 or 0 for an unknown version
+size_t wol_relay_record_size(uint8_t version);
+
+//! @brief Runs a relay until wol_relay_options_s::stop becomes true
+//! @details The magic packets of all requests go out over one non-blocking sender that stays open while the relay runs.
+//!          The requests take turns on the sender, so a long paced batch does not hold up the other clients.
+//!          The relay waits for UDP datagrams, TCP data and the sender with `poll()` and answers each request after its
+//!          batch was sent; a reply the client does not read at once is kept for its connection until it is written.
+//! @param options Pointer to the options
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE after a stop, otherwise the error of the setup, e.g. ::WAKE_ON_LAN_ERRORS_BIND if the port is in use
+wake_on_lan_errors_t wol_relay_run(const wol_relay_options_t * options, wake_on_lan_t * wol);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_RELAY_H_ */
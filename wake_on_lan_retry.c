@@ -0,0 +1,533 @@
+//! @file
+//! @brief The wake_on_lan_retry source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_retry.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+
+  #include <intrin.h>
+
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Number of bits of a slot index
+#define RETRY_SLOT_BITS 6
+
+//! @brief Mask of a slot index
+#define RETRY_SLOT_MASK ( WOL_RETRY_SLOTS - 1 )
+
+//! @brief Largest distance of a deadline from the current tick, later deadlines are clamped
+#define RETRY_MAX_DELTA ( ( UINT64_C(1) << ( RETRY_SLOT_BITS * WOL_RETRY_LEVELS ) ) - 1 )
+
+//! @brief End of a slot list
+#define RETRY_NONE UINT32_MAX
+
+//! @brief wol_retry_node_s::slot of a target that is not scheduled
+#define RETRY_IDLE UINT16_MAX
+
+//! @brief wol_retry_node_s::slot of a target that expired and waits in wol_retry_s::due to be sent
+#define RETRY_DUE ( UINT16_MAX - 1 )
+
+//! @brief Number of due targets gathered for one ::wake_on_lan_batch() call
+#define RETRY_GATHER 64
+
+//! @brief Index of the lowest set bit of a non-zero value
+#if defined(_MSC_VER)
+  #define RETRY_LOWEST_BIT(VALUE) retry_lowest_bit(VALUE)
+#else
+  #define RETRY_LOWEST_BIT(VALUE) ( (uint64_t)__builtin_ctzll(VALUE) )
+#endif
+
+#if ( WOL_RETRY_SLOTS != ( 1 << RETRY_SLOT_BITS ) ) || ( WOL_RETRY_SLOTS > 64 )
+#   error WOL_RETRY_SLOTS must be 2 ^ RETRY_SLOT_BITS and fit into the 64 bits of wol_retry_s::occupied
+#endif
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Schedule of one target, linked into a slot of the wheel by index
+struct wol_retry_node_s
+{
+    uint64_t expires;                   //!< Tick of the next packet
+    uint32_t next;                      //!< Next node of the slot, ::RETRY_NONE at the end
+    uint32_t prev;                      //!< Previous node of the slot, ::RETRY_NONE at the head
+    uint32_t interval;                  //!< Ticks from the next packet until the resend after it, without jitter
+    uint32_t budget;                    //!< Packets left after the next one
+    uint16_t slot;                      //!< Index into wol_retry_s::heads, ::RETRY_IDLE or ::RETRY_DUE
+};
+
+
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+#if defined(_MSC_VER)
+//! @brief Index of the lowest set bit for MSVC
+//! @param value Non-zero value
+//! @return Index of the bit
+static uint64_t retry_lowest_bit(uint64_t value);
+#endif
+
+//! @brief Links a node into the slot of its deadline
+//! @details The level is chosen by the distance from the current tick, like in the timer wheel of the Linux kernel:
+//!          level 0 holds the next ::WOL_RETRY_SLOTS ticks, each higher level slots that are ::WOL_RETRY_SLOTS times longer.
+//! @param retry Pointer to the scheduler
+//! @param index Index of the node, must not be linked
+//! @param expires Tick of the deadline, earlier ticks than the current one are moved to the current one
+static void retry_insert(wol_retry_t * retry, uint32_t index, uint64_t expires);
+
+//! @brief Unlinks a node from its slot
+//! @param retry Pointer to the scheduler
+//! @param index Index of the node, must be linked
+static void retry_unlink(wol_retry_t * retry, uint32_t index);
+
+//! @brief Moves the nodes of the current slot of a level into the lower levels
+//! @param retry Pointer to the scheduler
+//! @param level Level of the slot, at least 1
+//! @return Index of the slot inside the level, 0 if the next level has to be cascaded as well
+static uint64_t retry_cascade(wol_retry_t * retry, unsigned level);
+
+//! @brief Earliest tick at which the wheel may have work, a slot of level 0 or the next cascade
+//! @param retry Pointer to the scheduler
+//! @return Tick, not before wol_retry_s::current
+static uint64_t retry_next_tick(const wol_retry_t * retry);
+
+//! @brief The current tick of the clock
+//! @param retry Pointer to the scheduler
+//! @return Number of whole ticks since wol_retry_s::start_ns
+static uint64_t retry_now_tick(const wol_retry_t * retry);
+
+//! @brief Applies the jitter of the options to a delay
+//! @param retry Pointer to the scheduler
+//! @param ticks Delay without jitter
+//! @return Delay with jitter, at least one tick
+static uint64_t retry_jitter(wol_retry_t * retry, uint64_t ticks);
+
+//! @brief Sends the targets of wol_retry_s::due and schedules their resends
+//! @param retry Pointer to the scheduler
+//! @param sender Pointer to the sender
+//! @param count Number of entries of wol_retry_s::due
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every packet was sent, otherwise the error of a failed packet
+static wake_on_lan_errors_t retry_send_due(wol_retry_t * retry, wake_on_lan_sender_t * sender, size_t count);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+#if defined(_MSC_VER)
+static uint64_t retry_lowest_bit(uint64_t value)
+{
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+}
+#endif
+
+static void retry_insert(wol_retry_t * retry, uint32_t index, uint64_t expires)
+{
+    struct wol_retry_node_s * node = &retry->nodes[index];
+
+    if(expires < retry->current)
+    {
+        expires = retry->current;
+    }
+    if(RETRY_MAX_DELTA < expires - retry->current)
+    {
+        expires = retry->current + RETRY_MAX_DELTA;
+    }
+
+    uint64_t delta = expires - retry->current;
+    unsigned level = 0;
+    while(level + 1 < WOL_RETRY_LEVELS && 0 != (delta >> (RETRY_SLOT_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    uint64_t slot = (expires >> (RETRY_SLOT_BITS * level)) & RETRY_SLOT_MASK;
+    uint32_t * head = &retry->heads[level * WOL_RETRY_SLOTS + slot];
+
+    node->expires = expires;
+    node->slot = (uint16_t)(level * WOL_RETRY_SLOTS + slot);
+    node->prev = RETRY_NONE;
+    node->next = *head;
+    if(RETRY_NONE != *head)
+    {
+        retry->nodes[*head].prev = index;
+    }
+    *head = index;
+    retry->occupied[level] |= UINT64_C(1) << slot;
+}
+
+static void retry_unlink(wol_retry_t * retry, uint32_t index)
+{
+    struct wol_retry_node_s * node = &retry->nodes[index];
+    uint32_t * head = &retry->heads[node->slot];
+
+    if(RETRY_NONE != node->prev)
+    {
+        retry->nodes[node->prev].next = node->next;
+    }
+    else
+    {
+        *head = node->next;
+    }
+    if(RETRY_NONE != node->next)
+    {
+        retry->nodes[node->next].prev = node->prev;
+    }
+
+    if(RETRY_NONE == *head)
+    {
+        retry->occupied[node->slot / WOL_RETRY_SLOTS] &= ~(UINT64_C(1) << (node->slot % WOL_RETRY_SLOTS));
+    }
+    node->slot = RETRY_IDLE;
+}
+
+static uint64_t retry_cascade(wol_retry_t * retry, unsigned level)
+{
+    uint64_t slot = (retry->current >> (RETRY_SLOT_BITS * level)) & RETRY_SLOT_MASK;
+    uint32_t * head = &retry->heads[level * WOL_RETRY_SLOTS + slot];
+    uint32_t index = *head;
+
+    *head = RETRY_NONE;
+    retry->occupied[level] &= ~(UINT64_C(1) << slot);
+
+    // The deadlines of the slot are now closer than the range of the level and land in lower levels
+    while(RETRY_NONE != index)
+    {
+        uint32_t next = retry->nodes[index].next;
+        retry_insert(retry, index, retry->nodes[index].expires);
+        index = next;
+    }
+
+    return slot;
+}
+
+static uint64_t retry_next_tick(const wol_retry_t * retry)
+{
+    uint64_t slot = retry->current & RETRY_SLOT_MASK;
+    uint64_t ahead = retry->occupied[0] >> slot;
+
+    // The first tick of a round is never skipped, it cascades the higher levels
+    if(0 == slot)
+    {
+        return retry->current;
+    }
+
+    if(0 != ahead)
+    {
+        return retry->current + RETRY_LOWEST_BIT(ahead);
+    }
+
+    // Slots of level 0 behind the current one belong to the next round, which starts with a cascade
+    return (retry->current | RETRY_SLOT_MASK) + 1;
+}
+
+static uint64_t retry_now_tick(const wol_retry_t * retry)
+{
+    return (wol_clock_ns() - retry->start_ns) / retry->tick_ns;
+}
+
+static uint64_t retry_jitter(wol_retry_t * retry, uint64_t ticks)
+{
+    uint64_t spread = ticks * retry->options.jitter_percent / 100;
+
+    if(0 != spread)
+    {
+        // xorshift64, the jitter only has to break the lockstep of the hosts
+        retry->random ^= retry->random << 13;
+        retry->random ^= retry->random >> 7;
+        retry->random ^= retry->random << 17;
+
+        ticks = ticks - spread + retry->random % (2 * spread + 1);
+    }
+
+    return (0 == ticks) ? 1 : ticks;
+}
+
+static wake_on_lan_errors_t retry_send_due(wol_retry_t * retry, wake_on_lan_sender_t * sender, size_t count)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+    wol_target_t targets[RETRY_GATHER];
+    wol_result_t results[RETRY_GATHER];
+    uint32_t indices[RETRY_GATHER];
+
+    for(size_t done = 0; done < count; )
+    {
+        // Targets confirmed or rescheduled by the callback of an earlier gather are skipped
+        size_t gathered = 0;
+        for(; done < count && gathered < RETRY_GATHER; done++)
+        {
+            uint32_t index = retry->due[done];
+            if(RETRY_DUE == retry->nodes[index].slot)
+            {
+                targets[gathered] = retry->targets[index];
+                indices[gathered] = index;
+                gathered++;
+            }
+        }
+
+        if(0 == gathered)
+        {
+            break;
+        }
+
+        wake_on_lan_errors_t error = wake_on_lan_batch(sender, targets, gathered, results);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            return_value = error;
+        }
+        retry->sent += gathered;
+
+        uint64_t now_tick = retry_now_tick(retry);
+        for(size_t i = 0; i < gathered; i++)
+        {
+            struct wol_retry_node_s * node = &retry->nodes[indices[i]];
+
+            if(RETRY_DUE == node->slot)
+            {
+                if(0 != node->budget)
+                {
+                    uint64_t max_interval = retry->options.max_interval_ms / retry->options.tick_ms;
+
+                    node->budget--;
+                    retry_insert(retry, indices[i], now_tick + retry_jitter(retry, node->interval));
+                    node->interval = (2 * (uint64_t)node->interval < max_interval) ? 2 * node->interval : (uint32_t)max_interval;
+                }
+                else
+                {
+                    node->slot = RETRY_IDLE;
+                    retry->pending--;
+                    retry->exhausted++;
+                }
+            }
+
+            if(retry->options.callback)
+            {
+                retry->options.callback(retry->options.context, indices[i], &results[i]);
+            }
+        }
+    }
+
+    return return_value;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_retry_open(wol_retry_t * retry, const wol_target_t * targets, size_t n, const wol_retry_options_t * options, wake_on_lan_t * wol)
+{
+    static const wol_retry_options_t default_options = { 0 };
+
+    if(NULL == retry || (NULL == targets && 0 != n) || UINT32_MAX <= n)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    memset(retry, 0, sizeof(*retry));
+    retry->targets = targets;
+    retry->count = n;
+    retry->options = options ? *options : default_options;
+    retry->nodes = malloc((n ? n : 1) * sizeof(*retry->nodes));
+    retry->due = malloc((n ? n : 1) * sizeof(*retry->due));
+
+    if(NULL == retry->nodes || NULL == retry->due)
+    {
+        wol_retry_close(retry);
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    if(0 == retry->options.interval_ms)     { retry->options.interval_ms = WOL_RETRY_INTERVAL_MS; }
+    if(0 == retry->options.max_interval_ms) { retry->options.max_interval_ms = WOL_RETRY_MAX_INTERVAL_MS; }
+    if(0 == retry->options.retries)         { retry->options.retries = WOL_RETRY_RETRIES; }
+    if(0 == retry->options.tick_ms)         { retry->options.tick_ms = WOL_RETRY_TICK_MS; }
+    if(100 < retry->options.jitter_percent) { retry->options.jitter_percent = 100; }
+
+    memset(retry->heads, 0xFF, sizeof(retry->heads));
+    retry->tick_ns = (uint64_t)retry->options.tick_ms * UINT64_C(1000000);
+    retry->start_ns = wol_clock_ns();
+    retry->random = retry->start_ns ^ (uint64_t)(uintptr_t)retry ^ UINT64_C(0x9E3779B97F4A7C15);
+
+    for(size_t i = 0; i < n; i++)
+    {
+        retry->nodes[i].slot = RETRY_IDLE;
+        wol_retry_schedule(retry, i, 0, retry->options.retries);
+    }
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+void wol_retry_schedule(wol_retry_t * retry, size_t index, uint32_t delay_ms, uint32_t retries)
+{
+    if(NULL == retry || NULL == retry->nodes || retry->count <= index)
+    {
+        return;
+    }
+
+    struct wol_retry_node_s * node = &retry->nodes[index];
+
+    if(RETRY_IDLE == node->slot)
+    {
+        retry->pending++;
+    }
+    else if(RETRY_DUE != node->slot)
+    {
+        retry_unlink(retry, (uint32_t)index);
+    }
+
+    uint64_t interval = retry->options.interval_ms / retry->options.tick_ms;
+    node->interval = (0 == interval) ? 1 : (uint32_t)interval;
+    node->budget = retries;
+
+    uint64_t delay = ((uint64_t)delay_ms + retry->options.tick_ms - 1) / retry->options.tick_ms;
+    retry_insert(retry, (uint32_t)index, retry_now_tick(retry) + delay);
+}
+
+void wol_retry_confirm(wol_retry_t * retry, size_t index)
+{
+    if(NULL == retry || NULL == retry->nodes || retry->count <= index)
+    {
+        return;
+    }
+
+    struct wol_retry_node_s * node = &retry->nodes[index];
+
+    if(RETRY_IDLE == node->slot)
+    {
+        return;
+    }
+
+    if(RETRY_DUE != node->slot)
+    {
+        retry_unlink(retry, (uint32_t)index);
+    }
+    node->slot = RETRY_IDLE;
+    retry->pending--;
+}
+
+wake_on_lan_errors_t wol_retry_poll(wol_retry_t * retry, wake_on_lan_sender_t * sender, uint64_t * next_ns)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    if(NULL == retry || NULL == retry->nodes)
+    {
+        if(next_ns) { *next_ns = UINT64_MAX; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    uint64_t now_tick = retry_now_tick(retry);
+
+    while(0 != retry->pending && retry->current <= now_tick)
+    {
+        // Empty ticks are skipped up to the next occupied slot or the next cascade
+        uint64_t tick = retry_next_tick(retry);
+        if(now_tick < tick)
+        {
+            retry->current = now_tick + 1;
+            break;
+        }
+        retry->current = tick;
+
+        if(0 == (retry->current & RETRY_SLOT_MASK))
+        {
+            for(unsigned level = 1; level < WOL_RETRY_LEVELS && 0 == retry_cascade(retry, level); level++)
+            {
+            }
+        }
+
+        // The slot is emptied before sending, so the callback can schedule into any slot
+        uint64_t slot = retry->current & RETRY_SLOT_MASK;
+        size_t count = 0;
+        for(uint32_t index = retry->heads[slot]; RETRY_NONE != index; index = retry->nodes[index].next)
+        {
+            retry->nodes[index].slot = RETRY_DUE;
+            retry->due[count++] = index;
+        }
+        retry->heads[slot] = RETRY_NONE;
+        retry->occupied[0] &= ~(UINT64_C(1) << slot);
+        retry->current++;
+
+        wake_on_lan_errors_t error = retry_send_due(retry, sender, count);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            return_value = error;
+        }
+    }
+
+    if(next_ns)
+    {
+        *next_ns = (0 == retry->pending) ? UINT64_MAX : retry->start_ns + retry_next_tick(retry) * retry->tick_ns;
+    }
+
+    return return_value;
+}
+
+wake_on_lan_errors_t wol_retry_run(wol_retry_t * retry, wake_on_lan_sender_t * sender)
+{
+    wake_on_lan_errors_t return_value = WAKE_ON_LAN_ERRORS_NONE;
+
+    for(;;)
+    {
+        uint64_t next_ns;
+        wake_on_lan_errors_t error = wol_retry_poll(retry, sender, &next_ns);
+        if(WAKE_ON_LAN_ERRORS_NONE != error)
+        {
+            return_value = error;
+        }
+
+        if(WAKE_ON_LAN_ERRORS_UNKNOWN == error || 0 == retry->pending)
+        {
+            break;
+        }
+
+        wol_sleep_until_ns(next_ns);
+    }
+
+    return return_value;
+}
+
+void wol_retry_close(wol_retry_t * retry)
+{
+    if(NULL == retry)
+    {
+        return;
+    }
+
+    free(retry->due);
+    free(retry->nodes);
+    retry->due = NULL;
+    retry->nodes = NULL;
+    retry->pending = 0;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,149 @@
+//! @file
+//! @brief The wake_on_lan_retry header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Resends magic packets to many targets on their own schedules. Every target has a deadline,
+//! a budget of resends and an interval that doubles after each resend, optionally with jitter
+//! so that hosts woken together do not stay in lockstep. The deadlines are kept in a hierarchical
+//! timer wheel, so scheduling, confirming and expiring a target are O(1) no matter how many
+//! targets are outstanding, and due targets are sent together with ::wake_on_lan_batch().
+//!
+//! @note The scheduler is not thread-safe, use one scheduler per thread.
+
+#ifndef INC_WAKE_ON_LAN_RETRY_H_
+#define INC_WAKE_ON_LAN_RETRY_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Default of wol_retry_options_s::interval_ms
+#define WOL_RETRY_INTERVAL_MS 1000
+
+//! @brief Default of wol_retry_options_s::max_interval_ms
+#define WOL_RETRY_MAX_INTERVAL_MS 16000
+
+//! @brief Default of wol_retry_options_s::retries
+#define WOL_RETRY_RETRIES 5
+
+//! @brief Default of wol_retry_options_s::tick_ms
+#define WOL_RETRY_TICK_MS 1
+
+//! @brief Number of levels of the timer wheel
+#define WOL_RETRY_LEVELS 4
+
+//! @brief Number of slots of each level, the range of the wheel is `WOL_RETRY_SLOTS ^ WOL_RETRY_LEVELS` ticks
+#define WOL_RETRY_SLOTS 64
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Options of ::wol_retry_open(), all zero is a valid default
+typedef struct wol_retry_options_s
+{
+    uint32_t interval_ms;               //!< Time from the first packet until the first resend, doubled after every resend, 0 for ::WOL_RETRY_INTERVAL_MS
+    uint32_t max_interval_ms;           //!< Largest time between two resends, 0 for ::WOL_RETRY_MAX_INTERVAL_MS
+    uint32_t retries;                   //!< Resends of each target after its first packet, 0 for ::WOL_RETRY_RETRIES, see ::wol_retry_schedule() for other budgets
+    uint32_t jitter_percent;            //!< Each delay is moved randomly by up to this percentage, 0 for no jitter
+    uint32_t tick_ms;                   //!< Resolution of the deadlines, 0 for ::WOL_RETRY_TICK_MS
+    wol_send_callback_t callback;       //!< Called for every packet with its result, can be NULL; may call ::wol_retry_confirm() and ::wol_retry_schedule()
+    void * context;                     //!< Passed to wol_retry_options_s::callback
+} wol_retry_options_t;
+
+//! @brief Retry scheduler of a target array, see ::wol_retry_open()
+typedef struct wol_retry_s
+{
+    const wol_target_t * targets;       //!< Targets of the scheduler, indexed by the callback, ::wol_retry_confirm() and ::wol_retry_schedule()
+    size_t count;                       //!< Number of targets
+    wol_retry_options_t options;        //!< Options with the defaults filled in
+    struct wol_retry_node_s * nodes;    //!< Schedule of each target
+    uint32_t * due;                     //!< Indices of the targets that expire in one tick
+    uint32_t heads[WOL_RETRY_LEVELS * WOL_RETRY_SLOTS]; //!< First node of each slot of the wheel
+    uint64_t occupied[WOL_RETRY_LEVELS]; //!< One bit for each slot of a level that is not empty
+    uint64_t start_ns;                  //!< ::wol_clock_ns() time of tick 0
+    uint64_t tick_ns;                   //!< Length of one tick
+    uint64_t current;                   //!< Next tick to expire
+    uint64_t random;                    //!< State of the jitter generator
+    size_t pending;                     //!< Number of scheduled targets, the scheduler is done when it reaches 0
+    size_t sent;                        //!< Number of packets sent so far
+    size_t exhausted;                   //!< Number of targets whose budget ran out without confirmation
+} wol_retry_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Opens a scheduler and schedules the first packet of every target for now
+//! @param[out] retry Pointer to the scheduler to initialize
+//! @param targets Array of `n` targets, must stay valid until ::wol_retry_close()
+//! @param n Number of targets, less than `UINT32_MAX`
+//! @param options Pointer to the options, can be NULL for the defaults
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_UNKNOWN
+wake_on_lan_errors_t wol_retry_open(wol_retry_t * retry, const wol_target_t * targets, size_t n, const wol_retry_options_t * options, wake_on_lan_t * wol);
+
+//! @brief Schedules the next packet of a target, replacing its current deadline and budget and restarting its backoff
+//! @param retry Pointer to an open scheduler
+//! @param index Index of the target
+//! @param delay_ms Time until the next packet, without jitter
+//! @param retries Packets sent to the target after the next one
+void wol_retry_schedule(wol_retry_t * retry, size_t index, uint32_t delay_ms, uint32_t retries);
+
+//! @brief Removes a target that is confirmed to be up, no more packets are sent to it
+//! @param retry Pointer to an open scheduler
+//! @param index Index of the target, a target that is not scheduled is ignored
+void wol_retry_confirm(wol_retry_t * retry, size_t index);
+
+//! @brief Sends every target whose deadline has passed and schedules its next resend
+//! @details Call it from an event loop when wol_retry_s::pending is not 0 and `next_ns` has come.
+//! @param retry Pointer to an open scheduler
+//! @param sender Pointer to an open sender context
+//! @param[out] next_ns ::wol_clock_ns() time of the next deadline, `UINT64_MAX` if no target is pending, can be NULL
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every packet was sent, otherwise the error of a failed packet
+wake_on_lan_errors_t wol_retry_poll(wol_retry_t * retry, wake_on_lan_sender_t * sender, uint64_t * next_ns);
+
+//! @brief Sends and resends until every target is confirmed or has used its budget
+//! @param retry Pointer to an open scheduler
+//! @param sender Pointer to an open sender context
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every packet was sent, otherwise the error of a failed packet
+wake_on_lan_errors_t wol_retry_run(wol_retry_t * retry, wake_on_lan_sender_t * sender);
+
+//! @brief Releases a scheduler
+//! @param retry Pointer to the scheduler, a closed scheduler is ignored
+void wol_retry_close(wol_retry_t * retry);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_RETRY_H_ */
@@ -0,0 +1,286 @@
+//! @file
+//! @brief The wake_on_lan_stagger source file.
+//! @details The description can be found in the header file
+
+
+/*---------------------------------------------------------------------*
+ *  private: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan_stagger.h"
+
+#include <stdlib.h>
+
+
+/*---------------------------------------------------------------------*
+ *  private: definitions
+ *---------------------------------------------------------------------*/
+
+//! @brief Mask of the target index in the low half of a sort key
+#define STAGGER_INDEX_MASK UINT64_C(0xFFFFFFFF)
+
+
+/*---------------------------------------------------------------------*
+ *  private: typedefs
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public:  variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  private: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Orders sort keys ascending, for `qsort()`
+//! @param a Pointer to the first key
+//! @param b Pointer to the second key
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_key(const void * a, const void * b);
+
+//! @brief Orders timeline entries by offset and index, for `qsort()`
+//! @param a Pointer to the first ::wol_stagger_entry_t
+//! @param b Pointer to the second ::wol_stagger_entry_t
+//! @return Negative, 0 or positive as required by `qsort()`
+static int compare_entry(const void * a, const void * b);
+
+//! @brief Computes the evenly spread offset of a position of the timeline
+//! @param position Position in the timeline
+//! @param n Number of positions
+//! @param duration_ns Duration of the timeline
+//! @return `position * duration_ns / n` without overflow
+static uint64_t stagger_offset(size_t position, size_t n, uint64_t duration_ns);
+
+//! @brief Orders the targets so that the groups are interleaved in proportion to their size
+//! @param groups Array of `n` groups
+//! @param n Number of targets
+//! @param[out] keys Array of `n` keys, receives the targets in timeline order, the index in the low 32 bits
+//! @param[out] slots Array of `n` entries, receives the position of each target among the targets sorted by group
+//! @param[out] ranks Array of `n` entries, receives the position of each target inside its group
+static void stagger_interleave(const uint32_t * groups, size_t n, uint64_t * keys, uint32_t * slots, uint32_t * ranks);
+
+
+/*---------------------------------------------------------------------*
+ *  private: functions
+ *---------------------------------------------------------------------*/
+
+static int compare_key(const void * a, const void * b)
+{
+    uint64_t key_a = *(const uint64_t *)a;
+    uint64_t key_b = *(const uint64_t *)b;
+
+    return (key_a < key_b) ? -1 : (key_a > key_b) ? 1 : 0;
+}
+
+static int compare_entry(const void * a, const void * b)
+{
+    const wol_stagger_entry_t * entry_a = a;
+    const wol_stagger_entry_t * entry_b = b;
+
+    if(entry_a->offset_ns != entry_b->offset_ns)
+    {
+        return (entry_a->offset_ns < entry_b->offset_ns) ? -1 : 1;
+    }
+
+    return (entry_a->index < entry_b->index) ? -1 : (entry_a->index > entry_b->index) ? 1 : 0;
+}
+
+static uint64_t stagger_offset(size_t position, size_t n, uint64_t duration_ns)
+{
+    // Split the product, the remainder part stays below n * n
+    return (duration_ns / n) * position + (duration_ns % n) * position / n;
+}
+
+static void stagger_interleave(const uint32_t * groups, size_t n, uint64_t * keys, uint32_t * slots, uint32_t * ranks)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        keys[i] = (uint64_t)groups[i] << 32 | i;
+    }
+    qsort(keys, n, sizeof(*keys), compare_key);
+
+    // Every target gets the middle of its share of the group as position, 32-bit fixed point,
+    // so a group of 3 lands at 1/6, 3/6 and 5/6 of the duration whatever the other groups are
+    for(size_t start = 0; start < n;)
+    {
+        uint32_t group = (uint32_t)(keys[start] >> 32);
+        size_t end = start + 1;
+        while(end < n && group == (uint32_t)(keys[end] >> 32))
+        {
+            end++;
+        }
+
+        double size = (double)(end - start);
+        for(size_t i = start; i < end; i++)
+        {
+            uint32_t index = (uint32_t)(keys[i] & STAGGER_INDEX_MASK);
+            slots[index] = (uint32_t)i;
+            ranks[index] = (uint32_t)(i - start);
+        }
+        for(size_t i = start; i < end; i++)
+        {
+            double position = ((double)(i - start) + 0.5) / size * 4294967296.0;
+            keys[i] = (uint64_t)position << 32 | (keys[i] & STAGGER_INDEX_MASK);
+        }
+
+        start = end;
+    }
+
+    qsort(keys, n, sizeof(*keys), compare_key);
+}
+
+
+/*---------------------------------------------------------------------*
+ *  public:  functions
+ *---------------------------------------------------------------------*/
+
+wake_on_lan_errors_t wol_stagger_plan(wol_stagger_t * stagger, const uint32_t * groups, size_t n, const wol_stagger_options_t * options, wake_on_lan_t * wol)
+{
+    if(NULL == stagger || UINT32_MAX <= n)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_UNKNOWN;
+    }
+
+    wol_stagger_options_t defaults = { 0 };
+    if(NULL == options)
+    {
+        options = &defaults;
+    }
+
+    uint64_t duration_ns = (uint64_t)options->duration_ms * UINT64_C(1000000);
+    uint64_t window_ns = (uint64_t)(options->group_window_ms ? options->group_window_ms : WOL_STAGGER_GROUP_WINDOW_MS) * UINT64_C(1000000);
+    size_t cap = options->group_cap;
+
+    stagger->entries = malloc((n ? n : 1) * sizeof(*stagger->entries));
+    stagger->count = n;
+    stagger->end_ns = 0;
+    if(NULL == stagger->entries)
+    {
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    if(NULL == groups)
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            stagger->entries[i].offset_ns = stagger_offset(i, n, duration_ns);
+            stagger->entries[i].index = (uint32_t)i;
+        }
+        stagger->end_ns = n ? stagger->entries[n - 1].offset_ns : 0;
+
+        return WAKE_ON_LAN_ERRORS_NONE;
+    }
+
+    uint64_t * keys = malloc((n ? n : 1) * sizeof(*keys));
+    uint64_t * times = malloc((n ? n : 1) * sizeof(*times));
+    uint32_t * slots = malloc((n ? n : 1) * sizeof(*slots));
+    uint32_t * ranks = malloc((n ? n : 1) * sizeof(*ranks));
+    if(NULL == keys || NULL == times || NULL == slots || NULL == ranks)
+    {
+        free(ranks);
+        free(slots);
+        free(times);
+        free(keys);
+        wol_stagger_close(stagger);
+        if(wol) { wol->last_error = -1; }
+        return WAKE_ON_LAN_ERRORS_MEMORY;
+    }
+
+    stagger_interleave(groups, n, keys, slots, ranks);
+
+    // The targets of a group come in the order of their rank, so the time of the wake `cap`
+    // wakes earlier in the same group is always known; the times stay ascending inside a group
+    for(size_t i = 0; i < n; i++)
+    {
+        uint32_t index = (uint32_t)(keys[i] & STAGGER_INDEX_MASK);
+        uint32_t slot = slots[index];
+        uint64_t time = stagger_offset(i, n, duration_ns);
+
+        if(0 != cap && 0 != groups[index] && cap <= ranks[index] && time < times[slot - cap] + window_ns)
+        {
+            time = times[slot - cap] + window_ns;
+        }
+
+        times[slot] = time;
+        stagger->entries[i].offset_ns = time;
+        stagger->entries[i].index = index;
+        if(stagger->end_ns < time)
+        {
+            stagger->end_ns = time;
+        }
+    }
+
+    qsort(stagger->entries, n, sizeof(*stagger->entries), compare_entry);
+
+    free(ranks);
+    free(slots);
+    free(times);
+    free(keys);
+
+    return WAKE_ON_LAN_ERRORS_NONE;
+}
+
+wake_on_lan_errors_t wol_stagger_send(const wol_stagger_t * stagger, wake_on_lan_sender_t * sender, const wol_target_t * targets, wol_result_t * results)
+{
+    wake_on_lan_errors_t error = WAKE_ON_LAN_ERRORS_NONE;
+    wol_target_t batch[WOL_STAGGER_BATCH];
+    wol_result_t batch_results[WOL_STAGGER_BATCH];
+
+    uint64_t start_ns = wol_clock_ns();
+
+    for(size_t i = 0; i < stagger->count;)
+    {
+        wol_sleep_until_ns(start_ns + stagger->entries[i].offset_ns);
+
+        // Everything that is due by now goes out together, a late start catches up in batches
+        uint64_t now_ns = wol_clock_ns();
+        size_t n = 0;
+        while(i + n < stagger->count && n < WOL_STAGGER_BATCH && start_ns + stagger->entries[i + n].offset_ns <= now_ns)
+        {
+            batch[n] = targets[stagger->entries[i + n].index];
+            n++;
+        }
+        if(0 == n)
+        {
+            continue;
+        }
+
+        wake_on_lan_errors_t batch_error = wake_on_lan_batch(sender, batch, n, batch_results);
+        if(WAKE_ON_LAN_ERRORS_NONE == error)
+        {
+            error = batch_error;
+        }
+
+        if(results)
+        {
+            for(size_t j = 0; j < n; j++)
+            {
+                results[stagger->entries[i + j].index] = batch_results[j];
+            }
+        }
+
+        i += n;
+    }
+
+    return error;
+}
+
+void wol_stagger_close(wol_stagger_t * stagger)
+{
+    if(NULL == stagger)
+    {
+        return;
+    }
+
+    free(stagger->entries);
+    stagger->entries = NULL;
+    stagger->count = 0;
+}
+
+
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
@@ -0,0 +1,114 @@
+//! @file
+//! @brief The wake_on_lan_stagger header file.
+//! @details The module can be used in C and C++ under Windows and Linux
+//!
+//! Spreads the wake of many hosts over a duration, so that their power supplies do not
+//! start all at once. Hosts can be put into groups, e.g. the rack or the PDU they are
+//! connected to, and each group can be limited to a number of wakes within a window.
+//! The whole plan is computed up front into a timeline sorted by send time, so sending
+//! only walks the timeline and hands the entries that are due to ::wake_on_lan_batch().
+//!
+//! The groups are interleaved in proportion to their size, so that every group is spread
+//! over the whole duration. A group that would exceed its cap is delayed until the window
+//! allows the next wake, so the plan can end after the duration, see wol_stagger_s::end_ns.
+
+#ifndef INC_WAKE_ON_LAN_STAGGER_H_
+#define INC_WAKE_ON_LAN_STAGGER_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*---------------------------------------------------------------------*
+ *  public: include files
+ *---------------------------------------------------------------------*/
+
+#include "wake_on_lan.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*---------------------------------------------------------------------*
+ *  public: define
+ *---------------------------------------------------------------------*/
+
+//! @brief Default of wol_stagger_options_s::group_window_ms
+#define WOL_STAGGER_GROUP_WINDOW_MS 1000
+
+//! @brief Largest number of targets that ::wol_stagger_send() sends with one batch
+#define WOL_STAGGER_BATCH 64
+
+
+/*---------------------------------------------------------------------*
+ *  public: typedefs
+ *---------------------------------------------------------------------*/
+
+//! @brief Options of ::wol_stagger_plan(), all zero is a valid default
+typedef struct wol_stagger_options_s
+{
+    uint32_t duration_ms;               //!< Time over which the targets are spread, 0 sends all targets at once
+    uint32_t group_cap;                 //!< Largest number of wakes of one group within wol_stagger_options_s::group_window_ms, 0 for no cap
+    uint32_t group_window_ms;           //!< Window of wol_stagger_options_s::group_cap, 0 for ::WOL_STAGGER_GROUP_WINDOW_MS
+} wol_stagger_options_t;
+
+//! @brief One entry of the timeline of a plan
+typedef struct wol_stagger_entry_s
+{
+    uint64_t offset_ns;                 //!< Time of the packet after the start of ::wol_stagger_send()
+    uint32_t index;                     //!< Index of the target
+} wol_stagger_entry_t;
+
+//! @brief Timeline of a staggered wake, see ::wol_stagger_plan()
+typedef struct wol_stagger_s
+{
+    wol_stagger_entry_t * entries;      //!< One entry for each target, sorted by wol_stagger_entry_s::offset_ns and index
+    size_t count;                       //!< Number of entries
+    uint64_t end_ns;                    //!< Offset of the last entry
+} wol_stagger_t;
+
+
+/*---------------------------------------------------------------------*
+ *  public: extern variables
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  public: function prototypes
+ *---------------------------------------------------------------------*/
+
+//! @brief Computes the timeline of a staggered wake
+//! @param[out] stagger Pointer to the plan to initialize
+//! @param groups Array of `n` groups, e.g. from wol_parse_s::groups; group 0 is interleaved like any group but never capped,
+//!               can be NULL to spread the targets evenly without groups
+//! @param n Number of targets, less than `UINT32_MAX`
+//! @param options Pointer to the options, can be NULL for the defaults
+//! @param[out] wol Pointer to the structure ::wake_on_lan_t to get more information about the execution, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE, ::WAKE_ON_LAN_ERRORS_MEMORY or ::WAKE_ON_LAN_ERRORS_UNKNOWN
+wake_on_lan_errors_t wol_stagger_plan(wol_stagger_t * stagger, const uint32_t * groups, size_t n, const wol_stagger_options_t * options, wake_on_lan_t * wol);
+
+//! @brief Sends the magic packets of a plan at their times, returns after the last one
+//! @param stagger Pointer to a plan
+//! @param sender Pointer to an open sender context
+//! @param targets Array of the targets the plan was computed for
+//! @param[out] results Array of one result for each target, indexed like `targets`, can be NULL if not necessary
+//! @return ::WAKE_ON_LAN_ERRORS_NONE if every target was sent, otherwise the error of a failed target
+wake_on_lan_errors_t wol_stagger_send(const wol_stagger_t * stagger, wake_on_lan_sender_t * sender, const wol_target_t * targets, wol_result_t * results);
+
+//! @brief Releases a plan
+//! @param stagger Pointer to the plan, a closed plan is ignored
+void wol_stagger_close(wol_stagger_t * stagger);
+
+
+/*---------------------------------------------------------------------*
+ *  public: static inline functions
+ *---------------------------------------------------------------------*/
+/*---------------------------------------------------------------------*
+ *  eof
+ *---------------------------------------------------------------------*/
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_WAKE_ON_LAN_STAGGER_H_ */